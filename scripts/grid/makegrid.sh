@@ -1,5 +1,8 @@
 #!/bin/bash
 
+# vx_lite enumerates the same grid without an input file:
+#   vx_lite --grid -120.5,-113.5,0.1,31,36.5,0.1,0,10000,100
+
 for x in `seq -120.5 0.1 -113.5`; do \
  for y in `seq 31 0.1 36.5`; do \
   for z in `seq 0 100 10000`; do \
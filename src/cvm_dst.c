@@ -1,197 +1,380 @@
 /** cvmdst - A simple program to compute distance to velocity interfaces
     cvmdst accepts Geographic Coordinates or UTM Zone 11 coordinates.
 7/2007: AP: added distance to interface calculations
+10/2026: Distances computed with the built-in vx_bvh engine instead of
+         GTS. Surfaces are read from .gts or GOCAD .ts files in any
+         directory, points are processed in blocks on several threads,
+         and binary input triplets and output records are supported.
+10/2026: Surface hierarchies cached in memory mapped files (-c)
+10/2026: Binary .vxm meshes of vx_ts2mesh looked up first
 **/
 
 
+#define _GNU_SOURCE
+
 #include <string.h>
+#include <strings.h>
+#include <stdlib.h>
 #include <stdio.h>
-#include "proj.h"
-#include "cproj.h"
+#include <math.h>
+#include <getopt.h>
+#include <libgen.h>
 #include "params.h"
-#include "coor_para.h"
-//GTS includes
-#include "gts.h"
-#include <stdlib.h>
-
-void gctp ();
-char cbuffer;
-char lbuffer[80];
-
-int main (int argc, char *argv[])
-{
-//GTS variables
-  GtsSurface * s, * sto, * smo;
-  GtsPoint * p, * hit;
-  GtsBBox * bb;
-  gdouble gdist;
-  GtsFile * fp;
-  GNode * tree, * totree, * motree;
-
-  int i, n = 0;
-  float coor[3];
-  double SP[2],SPUTM[2];
-  char file1[20]="tt";
-
-  if(argv[1])
-    if(!strcmp(argv[1], "-h"))
-      {
-	printf("     cvmdst4.1 - (c) A. Plesch 2007\n");
-	printf("Harvard University\n");
-	printf("Compute Distances to Topography, Top Basement and Moho\n");
-	printf("     usage: cvmdst < file.in\n");
-	printf("cvmdst accepts geographic coordinates and \n");
-	printf("UTM Zone 11, WGS84, coordinates in X Y Z columns.\n");
-	printf("Output is:\n");
-	printf("X Y Z utmX utmY t_x t_y t_z t_dst b_x b_y b_z b_dst m_x m_y m_z m_dst\n");
-	printf("The ?_dst numbers are the scalar distances, the ?_xyz numbers are the location of the closest point on the respective surface\n");
-	exit(0);
-      }
-
-/** load top basement **/
-
-  s = gts_surface_new (gts_surface_class (),
-		       gts_face_class (),
-		       gts_edge_class (),
-		       gts_vertex_class ());
-
- FILE * f = fopen ("BASE.gts", "r");
- fp = gts_file_new (f);
- if (fp == NULL) {
-   fputs ("cvmdist: BASE.gts could not be opened\n",
-          stderr);
-   return 1; /* failure */
- }
- if (gts_surface_read (s, fp)) {
-   fputs ("cvmdist: BASE.gts is not a valid GTS file\n",
-          stderr);
-   fprintf (stderr, "BASE.gts:%d:%d: %s\n", fp->line, fp->pos, fp->error);
-   return 1; /* failure */
- }
-
- // gts_surface_print_stats (s, stderr);
- gts_file_destroy (fp);
-
-/** load topography **/
-
-  sto = gts_surface_new (gts_surface_class (),
-		       gts_face_class (),
-		       gts_edge_class (),
-		       gts_vertex_class ());
-
- f = fopen ("BATO.gts", "r");
- fp = gts_file_new (f);
-
- if (gts_surface_read (sto, fp)) {
-   fputs ("cvmdist: BATO.gts is not a valid GTS file\n",
-          stderr);
-   fprintf (stderr, "BATO.gts:%d:%d: %s\n", fp->line, fp->pos, fp->error);
-   return 1; /* failure */
- }
-
- // gts_surface_print_stats (s, stderr);
- gts_file_destroy (fp);
-
-/** load moho **/
+#include "utils.h"
+#include "vx_sub.h"
+#include "vx_rec.h"
+#include "vx_fmt.h"
+#include "vx_stats.h"
+#include "vx_mesh.h"
+#include "vx_bvh.h"
 
-  smo = gts_surface_new (gts_surface_class (),
-		       gts_face_class (),
-		       gts_edge_class (),
-		       gts_vertex_class ());
 
- f = fopen ("MOHO.gts", "r");
- fp = gts_file_new (f);
+/* Default surfaces, in output order */
+#define CVMDST_SURFACES "BATO,BASE,MOHO"
 
- if (gts_surface_read (smo, fp)) {
-   fputs ("cvmdist: MOHO.gts is not a valid GTS file\n",
-          stderr);
-   fprintf (stderr, "MOHO.gts:%d:%d: %s\n", fp->line, fp->pos, fp->error);
-   return 1; /* failure */
- }
+/* Max number of surfaces */
+#define CVMDST_MAX_SURF 16
 
- // gts_surface_print_stats (s, stderr);
- gts_file_destroy (fp);
+/* Default number of points per block */
+#define CVMDST_BLOCK 4096
 
-/** tree of bounding boxes of all faces of surface **/
- tree = gts_bb_tree_surface(s);
- totree = gts_bb_tree_surface(sto);
- motree = gts_bb_tree_surface(smo);
- 
+/* Max length of input line */
+#define CVMDST_LINE 1024
 
-/* let's make points to be reused */
 
- p = gts_point_new (gts_point_class (), 0, 0, 0);
- hit = gts_point_new (gts_point_class (), 0, 0, 0);
-
- i=0;
- while (fread(&cbuffer,sizeof(char),1,stdin)==1)
-   {lbuffer[i]=cbuffer;
-   i++;
-   if(cbuffer=='\n')
-     {sscanf(lbuffer, "%f %f %f", &coor[0],&coor[1],&coor[2]);
-     if(coor[1]<10000000)
-       printf("%12.4f %13.4f %9.2f ",coor[0],coor[1],coor[2]);
-
-/* In case we got anything like degrees */
-
-     if ((coor[0]<360.)&&(fabs(coor[1])<90.))
-       {
-	 for(n=0;n>15;n++) inparm[n]=0;
-
-
-	 SP[0]=coor[0];
-	 SP[1]=coor[1];
-
-	 gctp(SP,&insys,&inzone,inparm,&inunit,&indatum,&ipr,efile,&jpr,file1,
-	      SPUTM,&outsys,&outzone,inparm,&outunit,&outdatum,
-	      file27, file83,&iflg);
-
-	 coor[0]=SPUTM[0];
-	 coor[1]=SPUTM[1];
-
-       }
-
-/* Now we have UTM Zone 11 */
-
-  if (coor[1]<10000000) /*** Prevent all to obvious bad coordinates from being displayed */
-    {
-
-      /* AP: Let's provide the computed UTM coordinates as well */
-      printf("%10.2f %11.2f ", coor[0], coor[1]);
-
-      /** compute distance to basement with gts **/
-
-      gts_point_set (p, coor[0], coor[1], coor[2]);
+/* Surface */
+typedef struct cvmdst_surf_t
+{
+  char path[CMLEN];
+  vx_bvh_t bvh;
+} cvmdst_surf_t;
+
+
+/* Surfaces and output settings */
+static cvmdst_surf_t surfs[CVMDST_MAX_SURF];
+static int num_surfs = 0;
+static int binary_out = False;
+static vx_byteorder_t out_order = VX_BYTEORDER_LSB;
+static int verbose = False;
+
+
+/* Usage function */
+void usage() {
+  printf("     cvmdst4.1 - (c) A. Plesch 2007\n");
+  printf("Harvard University\n");
+  printf("Compute Distances to Topography, Top Basement and Moho\n");
+  printf("     usage: cvmdst [-d dir] [-s surfaces] [-c cachedir] [-i f32/f64] [-o] [-e lsb/msb/native] [-t threads] [-b points] [-v] < file.in\n");
+  printf("cvmdst accepts geographic coordinates and \n");
+  printf("UTM Zone 11, WGS84, coordinates in X Y Z columns.\n");
+  printf("Flags:\n");
+  printf("\t-d directory containing the surfaces (default is '.').\n");
+  printf("\t-s comma separated surfaces (default is %s). Names without\n",
+	 CVMDST_SURFACES);
+  printf("\t   extension are looked up as binary .vxm meshes of vx_ts2mesh,\n");
+  printf("\t   then as .gts, then as GOCAD .ts.\n");
+  printf("\t-c directory of surface caches. Each surface is indexed once and\n");
+  printf("\t   mapped from <surface>.bvh while its files are unchanged.\n");
+  printf("\t-i reads binary X Y Z triplets of type f32 or f64 instead of text.\n");
+  printf("\t-o writes binary records of f64 values instead of text:\n");
+  printf("\t   X Y Z utmX utmY, then ?_x ?_y ?_z ?_dst for each surface.\n");
+  printf("\t-e byte order of binary input and output (default is lsb).\n");
+  printf("\t-t number of threads (default is 1).\n");
+  printf("\t-b number of points per block (default is %d).\n",
+	 CVMDST_BLOCK);
+  printf("\t-v report surface load times to stderr.\n");
+  printf("Output is:\n");
+  printf("X Y Z utmX utmY t_x t_y t_z t_dst b_x b_y b_z b_dst m_x m_y m_z m_dst\n");
+  printf("The ?_dst numbers are the scalar distances, the ?_xyz numbers are the location of the closest point on the respective surface\n");
+  exit(0);
+}
 
-      //      printf ("%f %f %f %f\n", p->x, p->y, p->z, gdist);
-      
-      gdist = sqrt(gts_bb_tree_point_distance (totree, p, (GtsBBoxDistFunc) gts_point_triangle_distance2, &bb));
 
-      gts_point_triangle_closest (p, GTS_TRIANGLE(bb->bounded), hit);
+/* Load surface 'name' from 'dir' and build its hierarchy, or map it
+   from 'cachedir' */
+int load_surface(const char *dir, const char *name, const char *cachedir,
+		 cvmdst_surf_t *surf)
+{
+  char base[CMLEN], cache[CMLEN];
+  unsigned long long start = vx_stats_now();
+  const char *exts[3] = {".vxm", ".gts", ".ts"};
+  FILE *fp;
+  int cached, k;
+
+  if (strchr(name, '.') != NULL) {
+    snprintf(surf->path, CMLEN, "%s/%s", dir, name);
+  } else {
+    for (k = 0; k < 3; k++) {
+      snprintf(surf->path, CMLEN, "%s/%s%s", dir, name, exts[k]);
+      fp = fopen(surf->path, "r");
+      if (fp != NULL) {
+	fclose(fp);
+	break;
+      }
+    }
+  }
+
+  if (cachedir != NULL) {
+    snprintf(base, CMLEN, "%s", surf->path);
+    snprintf(cache, CMLEN, "%s/%s.bvh", cachedir, basename(base));
+  }
+  if (vx_bvh_load(surf->path, (cachedir != NULL) ? cache : NULL,
+		  &(surf->bvh), &cached) != 0) {
+    fprintf(stderr, "cvmdist: %s could not be loaded\n", surf->path);
+    return(1);
+  }
+  if (verbose) {
+    fprintf(stderr, "%s: %zu triangles %s in %.3f s\n", surf->path,
+	    surf->bvh.num_tris, cached ? "mapped" : "indexed",
+	    (vx_stats_now() - start) * 1.0e-9);
+  }
+  return(0);
+}
 
-      printf ("%f %f %f %f ", hit->x, hit->y, hit->z, gdist);
 
-      gdist = sqrt(gts_bb_tree_point_distance (tree, p, (GtsBBoxDistFunc) gts_point_triangle_distance2, &bb));
+/* Read up to 'cap' text points, one X Y Z line each. Lines without
+   three numbers are skipped */
+size_t read_text(double *xyz, size_t cap)
+{
+  char line[CVMDST_LINE];
+  char *p, *end;
+  size_t n = 0;
+  int k;
+
+  while ((n < cap) && (fgets(line, sizeof(line), stdin) != NULL)) {
+    p = line;
+    for (k = 0; k < 3; k++) {
+      xyz[n * 3 + k] = vx_parse_double(p, &end);
+      if (end == p) {
+	break;
+      }
+      p = end;
+    }
+    if (k == 3) {
+      n++;
+    }
+  }
+  return(n);
+}
 
-      //      printf ("bb %f %f %f\n DIST: %f\n",bb->x1,bb->y1,bb->z1,gdist);
 
-      gts_point_triangle_closest (p, GTS_TRIANGLE(bb->bounded), hit);
+/* Append value formatted as "%<width>.<prec>f" and a separator */
+char *put_fixed(char *out, double val, int width, int prec, char sep)
+{
+  out += vx_fmt_fixed(out, val, width, prec);
+  *out++ = sep;
+  return(out);
+}
 
-      printf ("%f %f %f %f ", hit->x, hit->y, hit->z, gdist);
 
-      gdist = sqrt(gts_bb_tree_point_distance (motree, p, (GtsBBoxDistFunc) gts_point_triangle_distance2, &bb));
+/* Write block results */
+int write_block(const double *xyz, const double *utm, double **hit,
+		double **dist, size_t n, char *out)
+{
+  char *p;
+  double *rec;
+  size_t i, len;
+  int s, k, nv = 5 + 4 * num_surfs;
+
+  if (binary_out) {
+    rec = (double *)out;
+    for (i = 0; i < n; i++) {
+      memcpy(&rec[0], &xyz[i * 3], 3 * sizeof(double));
+      memcpy(&rec[3], &utm[i * 3], 2 * sizeof(double));
+      for (s = 0; s < num_surfs; s++) {
+	memcpy(&rec[5 + s * 4], &hit[s][i * 3], 3 * sizeof(double));
+	rec[8 + s * 4] = dist[s][i];
+      }
+      if (out_order != vx_system_endian()) {
+	for (k = 0; k < nv; k++) {
+	  vx_rec_swap((char *)&rec[k], sizeof(double));
+	}
+      }
+      rec += nv;
+    }
+    len = n * nv * sizeof(double);
+  } else {
+    p = out;
+    for (i = 0; i < n; i++) {
+      /*** Prevent all to obvious bad coordinates from being displayed */
+      if (xyz[i * 3 + 1] >= 10000000) {
+	continue;
+      }
+      p = put_fixed(p, xyz[i * 3], 12, 4, ' ');
+      p = put_fixed(p, xyz[i * 3 + 1], 13, 4, ' ');
+      p = put_fixed(p, xyz[i * 3 + 2], 9, 2, ' ');
+      if (utm[i * 3 + 1] >= 10000000) {
+	continue;
+      }
+      p = put_fixed(p, utm[i * 3], 10, 2, ' ');
+      p = put_fixed(p, utm[i * 3 + 1], 11, 2, ' ');
+      for (s = 0; s < num_surfs; s++) {
+	for (k = 0; k < 3; k++) {
+	  p = put_fixed(p, hit[s][i * 3 + k], 0, 6, ' ');
+	}
+	p = put_fixed(p, dist[s][i], 0, 6, (s == num_surfs - 1) ? '\n' : ' ');
+      }
+    }
+    len = p - out;
+  }
+
+  if (fwrite(out, 1, len, stdout) != len) {
+    fprintf(stderr, "Failed to write output\n");
+    return(1);
+  }
+  return(0);
+}
 
-      gts_point_triangle_closest (p, GTS_TRIANGLE(bb->bounded), hit);
 
-      printf ("%f %f %f %f\n", hit->x, hit->y, hit->z, gdist);
+int main (int argc, char *argv[])
+{
+  char dir[CMLEN];
+  char names[CMLEN];
+  char cachedir[CMLEN];
+  char *name, *save = NULL;
+  double *xyz, *utm, *hit[CVMDST_MAX_SURF], *dist[CVMDST_MAX_SURF];
+  char *out;
+  vx_byteorder_t byteorder = VX_BYTEORDER_LSB;
+  long blocksize = CVMDST_BLOCK;
+  int num_threads = 1;
+  int esize = 0;
+  int opt, s, retval = 0;
+  size_t i, n, outcap;
+
+  strcpy(dir, ".");
+  strcpy(names, CVMDST_SURFACES);
+  strcpy(cachedir, "");
+
+  /* Parse options */
+  while ((opt = getopt(argc, argv, "b:c:d:e:i:os:t:vh")) != -1) {
+    switch (opt) {
+    case 'b':
+      blocksize = atol(optarg);
+      if (blocksize < 1) {
+	fprintf(stderr, "Invalid block size %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'c':
+      snprintf(cachedir, CMLEN, "%s", optarg);
+      break;
+    case 'd':
+      snprintf(dir, CMLEN, "%s", optarg);
+      break;
+    case 'e':
+      if (vx_rec_parse_byteorder(optarg, &byteorder) != 0) {
+	fprintf(stderr, "Invalid byte order %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'i':
+      if (strcasecmp(optarg, "f32") == 0) {
+	esize = 4;
+      } else if (strcasecmp(optarg, "f64") == 0) {
+	esize = 8;
+      } else {
+	fprintf(stderr, "Invalid input type %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'o':
+      binary_out = True;
+      break;
+    case 's':
+      snprintf(names, CMLEN, "%s", optarg);
+      break;
+    case 't':
+      num_threads = atoi(optarg);
+      if (num_threads < 1) {
+	fprintf(stderr, "Invalid thread count %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'v':
+      verbose = True;
+      break;
+    case 'h':
+      usage();
+      break;
+    default: /* '?' */
+      usage();
+    }
+  }
+  out_order = byteorder;
+
+  /* Load surfaces */
+  for (name = strtok_r(names, ",", &save); name != NULL;
+       name = strtok_r(NULL, ",", &save)) {
+    if (num_surfs == CVMDST_MAX_SURF) {
+      fprintf(stderr, "At most %d surfaces\n", CVMDST_MAX_SURF);
+      return(1);
+    }
+    if (load_surface(dir, name, (strlen(cachedir) > 0) ? cachedir : NULL,
+		     &surfs[num_surfs]) != 0) {
+      return(1);
+    }
+    num_surfs++;
+  }
+  if (num_surfs == 0) {
+    fprintf(stderr, "No surfaces\n");
+    return(1);
+  }
+
+  /* Block buffers, text lines are at most 5 + 4 * surfaces numbers */
+  outcap = blocksize * (5 + 4 * num_surfs) * (VX_FMT_MAX_LEN + 1);
+  xyz = malloc(blocksize * 3 * sizeof(double));
+  utm = malloc(blocksize * 3 * sizeof(double));
+  out = malloc(outcap);
+  if ((xyz == NULL) || (utm == NULL) || (out == NULL)) {
+    fprintf(stderr, "Failed to allocate block\n");
+    return(1);
+  }
+  for (s = 0; s < num_surfs; s++) {
+    hit[s] = malloc(blocksize * 3 * sizeof(double));
+    dist[s] = malloc(blocksize * sizeof(double));
+    if ((hit[s] == NULL) || (dist[s] == NULL)) {
+      fprintf(stderr, "Failed to allocate block\n");
+      return(1);
+    }
+  }
 
-      //      gdist = gts_point_distance2 (p, hit);
+  while (retval == 0) {
+    if (esize > 0) {
+      n = vx_rec_read_coords(stdin, esize, byteorder, xyz, blocksize);
+    } else {
+      n = read_text(xyz, blocksize);
+    }
+    if (n == 0) {
+      break;
+    }
 
-      //      printf ("DIST2: %f\n",gdist);
+    /* In case we got anything like degrees */
+    for (i = 0; i < n; i++) {
+      memcpy(&utm[i * 3], &xyz[i * 3], 3 * sizeof(double));
+      if ((xyz[i * 3] < 360.) && (fabs(xyz[i * 3 + 1]) < 90.)) {
+	vx_geo2utm(&xyz[i * 3], &utm[i * 3]);
+      }
+    }
 
+    /* Now we have UTM Zone 11 */
+    for (s = 0; s < num_surfs; s++) {
+      if (vx_bvh_closest_parallel(&(surfs[s].bvh), utm, n, hit[s], dist[s],
+				  NULL, num_threads) != 0) {
+	fprintf(stderr, "Distance query failed\n");
+	retval = 1;
+      }
+    }
+    if (retval == 0) {
+      retval = write_block(xyz, utm, hit, dist, n, out);
     }
-  i=0;
-     }
-   }
- gts_finalize();
+  }
+
+  for (s = 0; s < num_surfs; s++) {
+    vx_bvh_free(&(surfs[s].bvh));
+    free(hit[s]);
+    free(dist[s]);
+  }
+  free(xyz);
+  free(utm);
+  free(out);
+  return(retval);
 }
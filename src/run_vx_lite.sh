@@ -4,7 +4,7 @@
 FLAGS=""
 
 # Pass along any arguments to vx_lite
-while getopts 'm:ghsz:' OPTION
+while getopts 'm:ghnp:sz:' OPTION
 do
   if [ "$OPTARG" != "" ]; then
       FLAGS="${FLAGS} -$OPTION $OPTARG"
@@ -2,11 +2,15 @@
     utils.c - Commonly used math and interpolation routines.
 
     01/2011: PES: Initial implementation
+    10/2026: File stamps for the keys of cached grids and maps
 **/
 
+#define _GNU_SOURCE
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <sys/stat.h>
 #include "utils.h"
 
 
@@ -49,3 +53,34 @@ double vx_interpolate(double v1, double v2, double ratio) {
 double vx_dist_2d(double x1, double y1, double x2, double y2) {
   return(sqrt(pow(x2-x1, 2.0) + pow(y2-y1, 2.0)));
 }
+
+
+/* Fold bytes into 64 bit FNV-1a hash */
+uint64_t vx_fnv(uint64_t h, const void *buf, size_t len)
+{
+  const unsigned char *p = (const unsigned char *)buf;
+  size_t i;
+
+  for (i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return(h);
+}
+
+
+/* Fold file size and modification time into hash */
+int vx_file_stamp(const char *path, uint64_t *h)
+{
+  struct stat st;
+  long long stamp[3];
+
+  if ((stat(path, &st) != 0) || (!S_ISREG(st.st_mode))) {
+    return(1);
+  }
+  stamp[0] = (long long)st.st_size;
+  stamp[1] = (long long)st.st_mtim.tv_sec;
+  stamp[2] = (long long)st.st_mtim.tv_nsec;
+  *h = vx_fnv(*h, stamp, sizeof(stamp));
+  return(0);
+}
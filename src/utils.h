@@ -1,6 +1,9 @@
 #ifndef VX_UTILS_H
 #define VX_UTILS_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 /* Byte order */
 typedef enum { VX_BYTEORDER_LSB = 0, 
                VX_BYTEORDER_MSB } vx_byteorder_t;
@@ -18,4 +21,15 @@ double vx_interpolate(double v1, double v2, double ratio);
 /* 2D distance */
 double vx_dist_2d(double x1, double y1, double x2, double y2);
 
+/* Initial value of 64 bit FNV-1a hashes */
+#define VX_FNV_INIT 0xcbf29ce484222325ULL
+
+/* Fold 'len' bytes into 64 bit FNV-1a hash 'h' */
+uint64_t vx_fnv(uint64_t h, const void *buf, size_t len);
+
+/* Fold size and modification time of regular file 'path' into hash
+   'h'. Caches derived from model and surface files are keyed on these
+   stamps. Returns 1 if 'path' is not a regular file */
+int vx_file_stamp(const char *path, uint64_t *h);
+
 #endif
@@ -2,6 +2,7 @@
     vs30_gtl.c - Vs30 derived GTL based on Ely (2010)
 
     01/2011: PES: Initial implementation
+    10/2026: 64-bit cell counts and byte offsets
 **/
 
 #include <string.h>
@@ -112,7 +113,7 @@ int gtl_interp(gtl_entry_t *entry, int *updated) {
 
 /* Retrieve GTL data point in UTM */
 void gtl_getcoord(gtl_grid_t *entry) {
-  int j;
+  size_t j;
   int gcoor[3];
   float vs30;
 
@@ -133,7 +134,7 @@ void gtl_getcoord(gtl_grid_t *entry) {
 
   // Check if inside GTL
   if(gcoor[0]>=0 && gcoor[1]>=0 && gcoor[0]<gtl.x && gcoor[1]<gtl.y) {
-    j = ((gcoor[1] * gtl.x) + gcoor[0]) * gtl.dsize;
+    j = (((size_t)gcoor[1] * gtl.x) + gcoor[0]) * gtl.dsize;
     memcpy(&vs30, &gtlbuffer[j], gtl.dsize);
 
     /* Save data */
@@ -243,8 +244,8 @@ double gtl_get_adj_transition(double topo_gap) {
 /* Initialize GTL */
 int gtl_setup(char *file_path) {
   FILE *ifi;
-  int j;
-  int bufsize, ncells;
+  size_t j;
+  size_t bufsize, ncells;
   union zahl l, *h;
   char mdlfile[256], hdrfile[256];
   char cfgbuf[512];
@@ -307,7 +308,7 @@ int gtl_setup(char *file_path) {
   gtl.y = round((gtl.extent[3] - gtl.extent[2]) / gtl.spacing) + 1;
 
   /* Allocate memory buffer for GTL */
-  ncells = gtl.x * gtl.y;
+  ncells = (size_t)gtl.x * gtl.y;
   bufsize = ncells * gtl.dsize;
   gtlbuffer=(char *)malloc(bufsize);
   if (gtlbuffer == NULL) {
@@ -321,8 +322,8 @@ int gtl_setup(char *file_path) {
   }
 
   if (fread(gtlbuffer, gtl.dsize, ncells, ifi) != ncells) {
-    fprintf(stderr, "Failed to read %d cells of size %d from %s\n", 
-            ncells, ncells, mdlfile);
+    fprintf(stderr, "Failed to read %zu cells of size %d from %s\n", 
+            ncells, gtl.dsize, mdlfile);
     fclose(ifi);
     return(1);
   }
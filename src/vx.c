@@ -1,5 +1,6 @@
 /** VX - A simple program to extract velocity values from
     a voxet. VX accepts Geographic Coordinates or UTM Zone 11 coordinates.
+10/2026: 64-bit cell counts and byte offsets
 01/2011: PES: Minor formatting changes to output to make it consistent across all cases
 06/2009: AP: higher precision for output coordinates, coor[] becomes double; replaced GTL in Salton T.
 03/2009: AP: changed density scaling to Nafe-Drake
@@ -42,11 +43,12 @@ struct axis lr_a, mr_a, hr_a, cm_a, node, to_a, mo_a, ba_a;
 struct flags f;
 struct property p0,p1,p2,p3,p4,p5,p6,p7,p8,p9,p10,p11,p12,p13;
 
-int voxbytepos(int *, int* ,int);
+size_t voxbytepos(int *, int* ,int);
 
 int main (int argc, char *argv[])
 {
-  int NCells,i,j;
+  size_t NCells,j;
+  int i;
 //int u,v,w;
 union zahl h,l,m;
 float fl,z;
@@ -128,7 +130,7 @@ GetDim(LALR,"AXIS_N",lr_a.N);
    need to be adjusted accordingly in the .vo file.
 **/
 
-NCells=lr_a.N[0]*lr_a.N[1]*lr_a.N[2];
+NCells=(size_t)lr_a.N[0]*lr_a.N[1]*lr_a.N[2];
 
 sprintf(p0.NAME,"vint");
 GetPropName(LALR,"PROP_FILE",1,p0.FN);
@@ -181,7 +183,7 @@ GetVec(LAHR,"AXIS_MAX",hr_a.MAX);
 GetDim(LAHR,"AXIS_N ",hr_a.N);
 //printf("%d %d %d ",hr_a.N[0],hr_a.N[1],hr_a.N[2]);
 
-NCells=hr_a.N[0]*hr_a.N[1]*hr_a.N[2];
+NCells=(size_t)hr_a.N[0]*hr_a.N[1]*hr_a.N[2];
 
 sprintf(p1.NAME,"vint");
 GetPropName(LAHR,"PROP_FILE",1,p2.FN);
@@ -233,7 +235,7 @@ GetVec(LACM,"AXIS_MAX",cm_a.MAX);
 GetDim(LACM,"AXIS_N ",cm_a.N);
 //printf("%d %d %d ",cm_a.N[0],cm_a.N[1],cm_a.N[2]);
 
-NCells=cm_a.N[0]*cm_a.N[1]*cm_a.N[2];
+NCells=(size_t)cm_a.N[0]*cm_a.N[1]*cm_a.N[2];
 
 sprintf(p3.NAME,"cvp");
 GetPropName(LACM,"PROP_FILE",1,p3.FN);
@@ -281,7 +283,7 @@ GetVec(LATO,"AXIS_MAX",to_a.MAX);
 GetDim(LATO,"AXIS_N ",to_a.N);
 //printf("%d %d %d ",to_a.N[0],to_a.N[1],to_a.N[2]);
 
-NCells=to_a.N[0]*to_a.N[1]*to_a.N[2];
+NCells=(size_t)to_a.N[0]*to_a.N[1]*to_a.N[2];
 
 // topo
 
@@ -609,12 +611,12 @@ i=0;
 
 /********************************************************/
 
-int voxbytepos(int *ic,int *gs,int esize)
+size_t voxbytepos(int *ic,int *gs,int esize)
 
 {
-int pos;
+size_t pos;
 
-pos=(gs[0]*gs[1]*(ic[2])+gs[0]*(ic[1])+ic[0])*esize;
+pos=(((size_t)gs[1]*ic[2]+ic[1])*gs[0]+ic[0])*esize;
 
 return pos;
 }
@@ -765,7 +767,8 @@ return 1;
 int LoadVolume (char *FN, int ESIZE, char *buffer)
 { 
 FILE *ifi;
-int i,j;
+int i;
+size_t j;
 union zahl l,h;
 
 ifi=fopen(FN,"r");
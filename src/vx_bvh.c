@@ -0,0 +1,700 @@
+/** vx_bvh.c - Bounding volume hierarchy over triangle meshes for
+    closest point and distance queries to model surfaces. The tree is
+    built by median splits along the longest axis of the triangle
+    centroids, and searched nearest child first with boxes pruned
+    against the best distance found so far.
+
+10/2026: Initial implementation
+10/2026: Surface height queries along vertical lines
+10/2026: Hierarchies saved to and mapped from cache files
+**/
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "vx_sched.h"
+#include "vx_bvh.h"
+
+
+/* Tolerance of points on triangle edges in height queries */
+#define VX_BVH_EDGE_EPS 1.0e-9
+
+/* Cache file magic and byte order mark */
+#define VX_BVH_MAGIC "VXBVH01"
+#define VX_BVH_ORDER 0x01020304
+
+
+/* Cache file header, followed by the nodes, triangles and ids */
+typedef struct vx_bvh_header_t
+{
+  char magic[8];
+  uint32_t order;
+  uint32_t node_size;
+  uint64_t checksum;
+  uint64_t num_nodes;
+  uint64_t num_tris;
+  uint64_t pad[3];
+} vx_bvh_header_t;
+
+/* Build state */
+typedef struct vx_bvh_build_t
+{
+  const vx_mesh_t *mesh;
+  double *cent;              /* triangle centroids */
+  uint32_t *order;           /* triangles in leaf order */
+  vx_bvh_t *bvh;
+} vx_bvh_build_t;
+
+
+/* Parallel query task */
+typedef struct vx_bvh_task_t
+{
+  const vx_bvh_t *bvh;
+  const double *xyz;
+  size_t n;
+  double *hit;
+  double *dist;
+  uint32_t *tri;
+} vx_bvh_task_t;
+
+
+/* Partially sort order[lo..hi) so element k has rank k by centroid
+   coordinate 'axis' */
+static void vx_bvh_select(vx_bvh_build_t *b, size_t lo, size_t hi,
+			  size_t k, int axis)
+{
+  uint32_t *o = b->order, t;
+  double pivot;
+  size_t i, j;
+
+  while (hi - lo > 1) {
+    pivot = b->cent[o[lo + (hi - lo) / 2] * 3 + axis];
+    i = lo;
+    j = hi - 1;
+    while (i <= j) {
+      while (b->cent[o[i] * 3 + axis] < pivot) {
+	i++;
+      }
+      while (b->cent[o[j] * 3 + axis] > pivot) {
+	j--;
+      }
+      if (i <= j) {
+	t = o[i];
+	o[i] = o[j];
+	o[j] = t;
+	i++;
+	if (j == 0) {
+	  break;
+	}
+	j--;
+      }
+    }
+    if (k <= j) {
+      hi = j + 1;
+    } else if (k >= i) {
+      lo = i;
+    } else {
+      return;
+    }
+  }
+}
+
+
+/* Build subtree over order[lo..hi). Returns node index */
+static uint32_t vx_bvh_build_node(vx_bvh_build_t *b, size_t lo, size_t hi)
+{
+  vx_bvh_node_t *node;
+  const double *v;
+  double cmin[3], cmax[3];
+  uint32_t index = b->bvh->num_nodes++;
+  size_t i;
+  int j, k, axis;
+
+  node = &(b->bvh->nodes[index]);
+  for (k = 0; k < 3; k++) {
+    node->min[k] = cmin[k] = INFINITY;
+    node->max[k] = cmax[k] = -INFINITY;
+  }
+  for (i = lo; i < hi; i++) {
+    for (j = 0; j < 3; j++) {
+      v = &(b->mesh->verts[(size_t)b->mesh->tris[b->order[i] * 3 + j] * 3]);
+      for (k = 0; k < 3; k++) {
+	node->min[k] = fmin(node->min[k], v[k]);
+	node->max[k] = fmax(node->max[k], v[k]);
+      }
+    }
+    for (k = 0; k < 3; k++) {
+      cmin[k] = fmin(cmin[k], b->cent[b->order[i] * 3 + k]);
+      cmax[k] = fmax(cmax[k], b->cent[b->order[i] * 3 + k]);
+    }
+  }
+
+  if (hi - lo <= VX_BVH_LEAF) {
+    node->first = lo;
+    node->count = hi - lo;
+    return(index);
+  }
+
+  /* Median split along the longest centroid axis */
+  axis = 0;
+  for (k = 1; k < 3; k++) {
+    if (cmax[k] - cmin[k] > cmax[axis] - cmin[axis]) {
+      axis = k;
+    }
+  }
+  vx_bvh_select(b, lo, hi, lo + (hi - lo) / 2, axis);
+
+  node->count = 0;
+  vx_bvh_build_node(b, lo, lo + (hi - lo) / 2);
+  node = &(b->bvh->nodes[index]);
+  node->first = vx_bvh_build_node(b, lo + (hi - lo) / 2, hi);
+  return(index);
+}
+
+
+/* Build hierarchy */
+int vx_bvh_build(const vx_mesh_t *mesh, vx_bvh_t *bvh)
+{
+  vx_bvh_build_t b;
+  const double *v;
+  size_t i;
+  int j, k;
+
+  memset(bvh, 0, sizeof(vx_bvh_t));
+  if ((mesh->num_tris == 0) || (mesh->num_tris >= UINT32_MAX / 2)) {
+    return(1);
+  }
+  for (i = 0; i < mesh->num_tris * 3; i++) {
+    if (mesh->tris[i] >= mesh->num_verts) {
+      fprintf(stderr, "Triangle vertex %u out of range\n", mesh->tris[i]);
+      return(1);
+    }
+  }
+
+  b.mesh = mesh;
+  b.bvh = bvh;
+  b.cent = malloc(mesh->num_tris * 3 * sizeof(double));
+  b.order = malloc(mesh->num_tris * sizeof(uint32_t));
+  bvh->nodes = malloc(2 * mesh->num_tris * sizeof(vx_bvh_node_t));
+  bvh->tris = malloc(mesh->num_tris * 9 * sizeof(double));
+  bvh->ids = malloc(mesh->num_tris * sizeof(uint32_t));
+  if ((b.cent == NULL) || (b.order == NULL) || (bvh->nodes == NULL) ||
+      (bvh->tris == NULL) || (bvh->ids == NULL)) {
+    free(b.cent);
+    free(b.order);
+    vx_bvh_free(bvh);
+    return(1);
+  }
+
+  for (i = 0; i < mesh->num_tris; i++) {
+    b.order[i] = i;
+    for (k = 0; k < 3; k++) {
+      b.cent[i * 3 + k] = 0.0;
+    }
+    for (j = 0; j < 3; j++) {
+      v = &(mesh->verts[(size_t)mesh->tris[i * 3 + j] * 3]);
+      for (k = 0; k < 3; k++) {
+	b.cent[i * 3 + k] += v[k] / 3.0;
+      }
+    }
+  }
+  vx_bvh_build_node(&b, 0, mesh->num_tris);
+
+  /* Triangles in leaf order */
+  bvh->num_tris = mesh->num_tris;
+  for (i = 0; i < mesh->num_tris; i++) {
+    bvh->ids[i] = b.order[i];
+    for (j = 0; j < 3; j++) {
+      v = &(mesh->verts[(size_t)mesh->tris[b.order[i] * 3 + j] * 3]);
+      memcpy(&(bvh->tris[i * 9 + j * 3]), v, 3 * sizeof(double));
+    }
+  }
+
+  free(b.cent);
+  free(b.order);
+  return(0);
+}
+
+
+/* Free hierarchy */
+void vx_bvh_free(vx_bvh_t *bvh)
+{
+  if (bvh->map != NULL) {
+    munmap(bvh->map, bvh->map_len);
+  } else {
+    free(bvh->nodes);
+    free(bvh->tris);
+    free(bvh->ids);
+  }
+  memset(bvh, 0, sizeof(vx_bvh_t));
+}
+
+
+/* Save hierarchy to a temporary file renamed into place, so readers
+   never map a partial file */
+int vx_bvh_save(const vx_bvh_t *bvh, const char *path, uint64_t checksum)
+{
+  vx_bvh_header_t h;
+  char tmp[4096];
+  FILE *fp;
+  int retval = 0;
+
+  memset(&h, 0, sizeof(vx_bvh_header_t));
+  memcpy(h.magic, VX_BVH_MAGIC, sizeof(h.magic));
+  h.order = VX_BVH_ORDER;
+  h.node_size = sizeof(vx_bvh_node_t);
+  h.checksum = checksum;
+  h.num_nodes = bvh->num_nodes;
+  h.num_tris = bvh->num_tris;
+
+  snprintf(tmp, sizeof(tmp), "%s.%ld", path, (long)getpid());
+  fp = fopen(tmp, "wb");
+  if (fp == NULL) {
+    fprintf(stderr, "Failed to open cache file %s\n", tmp);
+    return(1);
+  }
+  if ((fwrite(&h, sizeof(vx_bvh_header_t), 1, fp) != 1) ||
+      (fwrite(bvh->nodes, sizeof(vx_bvh_node_t), bvh->num_nodes, fp) !=
+       bvh->num_nodes) ||
+      (fwrite(bvh->tris, 9 * sizeof(double), bvh->num_tris, fp) !=
+       bvh->num_tris) ||
+      (fwrite(bvh->ids, sizeof(uint32_t), bvh->num_tris, fp) !=
+       bvh->num_tris)) {
+    retval = 1;
+  }
+  if ((fclose(fp) != 0) || (retval != 0) || (rename(tmp, path) != 0)) {
+    fprintf(stderr, "Failed to write cache file %s\n", path);
+    remove(tmp);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Map hierarchy from cache file */
+int vx_bvh_map(vx_bvh_t *bvh, const char *path, uint64_t checksum)
+{
+  const vx_bvh_header_t *h;
+  struct stat st;
+  char *map;
+  size_t len;
+  int fd;
+
+  memset(bvh, 0, sizeof(vx_bvh_t));
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return(1);
+  }
+  if ((fstat(fd, &st) != 0) || (st.st_size < (off_t)sizeof(vx_bvh_header_t))) {
+    close(fd);
+    return(1);
+  }
+  len = (size_t)st.st_size;
+  map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return(1);
+  }
+
+  h = (const vx_bvh_header_t *)map;
+  if ((memcmp(h->magic, VX_BVH_MAGIC, sizeof(h->magic)) != 0) ||
+      (h->order != VX_BVH_ORDER) ||
+      (h->node_size != sizeof(vx_bvh_node_t)) ||
+      (h->checksum != checksum) || (h->num_tris == 0) ||
+      (h->num_tris >= UINT32_MAX / 2) ||
+      (h->num_nodes > 2 * h->num_tris) ||
+      (len != sizeof(vx_bvh_header_t) +
+       h->num_nodes * sizeof(vx_bvh_node_t) +
+       h->num_tris * (9 * sizeof(double) + sizeof(uint32_t)))) {
+    munmap(map, len);
+    return(1);
+  }
+
+  bvh->num_nodes = h->num_nodes;
+  bvh->num_tris = h->num_tris;
+  bvh->nodes = (vx_bvh_node_t *)(map + sizeof(vx_bvh_header_t));
+  bvh->tris = (double *)&(bvh->nodes[bvh->num_nodes]);
+  bvh->ids = (uint32_t *)&(bvh->tris[bvh->num_tris * 9]);
+  bvh->map = map;
+  bvh->map_len = len;
+  return(0);
+}
+
+
+/* Hierarchy of mesh, through cache file */
+int vx_bvh_load(const char *path, const char *cache, vx_bvh_t *bvh,
+		int *cached)
+{
+  vx_mesh_t mesh;
+  uint64_t sum = 0;
+  int retval;
+
+  if (cached != NULL) {
+    *cached = 0;
+  }
+  if (cache != NULL) {
+    if (vx_mesh_checksum(path, &sum) != 0) {
+      return(1);
+    }
+    if (vx_bvh_map(bvh, cache, sum) == 0) {
+      if (cached != NULL) {
+	*cached = 1;
+      }
+      return(0);
+    }
+  }
+
+  if (vx_mesh_load(path, &mesh) != 0) {
+    return(1);
+  }
+  retval = vx_bvh_build(&mesh, bvh);
+  vx_mesh_free(&mesh);
+  if ((retval == 0) && (cache != NULL) && (vx_bvh_save(bvh, cache, sum) != 0)) {
+    fprintf(stderr, "Hierarchy of %s not cached\n", path);
+  }
+  return(retval);
+}
+
+
+/* Closest point on segment a, b to 'p' */
+static void vx_bvh_closest_seg(const double *p, const double *a,
+			       const double *b, double *q)
+{
+  double ab[3], t = 0.0, len = 0.0;
+  int k;
+
+  for (k = 0; k < 3; k++) {
+    ab[k] = b[k] - a[k];
+    t += (p[k] - a[k]) * ab[k];
+    len += ab[k] * ab[k];
+  }
+  t = (len > 0.0) ? fmin(fmax(t / len, 0.0), 1.0) : 0.0;
+  for (k = 0; k < 3; k++) {
+    q[k] = a[k] + t * ab[k];
+  }
+}
+
+
+/* Squared distance between points */
+static inline double vx_bvh_dist2(const double *p, const double *q)
+{
+  return((p[0] - q[0]) * (p[0] - q[0]) + (p[1] - q[1]) * (p[1] - q[1]) +
+	 (p[2] - q[2]) * (p[2] - q[2]));
+}
+
+
+/* Closest point on triangle, by the Voronoi regions of its vertices,
+   edges and face. Degenerate triangles fall back to their edges */
+void vx_bvh_closest_tri(const double *p, const double *a, const double *b,
+			const double *c, double *q)
+{
+  double ab[3], ac[3], ap[3], bp[3], cp[3], e[3];
+  double d1 = 0.0, d2 = 0.0, d3 = 0.0, d4 = 0.0, d5 = 0.0, d6 = 0.0;
+  double va, vb, vc, v, w, denom, best, d;
+  int k;
+
+  for (k = 0; k < 3; k++) {
+    ab[k] = b[k] - a[k];
+    ac[k] = c[k] - a[k];
+    ap[k] = p[k] - a[k];
+    bp[k] = p[k] - b[k];
+    cp[k] = p[k] - c[k];
+    d1 += ab[k] * ap[k];
+    d2 += ac[k] * ap[k];
+    d3 += ab[k] * bp[k];
+    d4 += ac[k] * bp[k];
+    d5 += ab[k] * cp[k];
+    d6 += ac[k] * cp[k];
+  }
+
+  if ((d1 <= 0.0) && (d2 <= 0.0)) {
+    memcpy(q, a, 3 * sizeof(double));
+    return;
+  }
+  if ((d3 >= 0.0) && (d4 <= d3)) {
+    memcpy(q, b, 3 * sizeof(double));
+    return;
+  }
+  vc = d1 * d4 - d3 * d2;
+  if ((vc <= 0.0) && (d1 >= 0.0) && (d3 <= 0.0)) {
+    v = d1 / (d1 - d3);
+    for (k = 0; k < 3; k++) {
+      q[k] = a[k] + v * ab[k];
+    }
+    return;
+  }
+  if ((d6 >= 0.0) && (d5 <= d6)) {
+    memcpy(q, c, 3 * sizeof(double));
+    return;
+  }
+  vb = d5 * d2 - d1 * d6;
+  if ((vb <= 0.0) && (d2 >= 0.0) && (d6 <= 0.0)) {
+    w = d2 / (d2 - d6);
+    for (k = 0; k < 3; k++) {
+      q[k] = a[k] + w * ac[k];
+    }
+    return;
+  }
+  va = d3 * d6 - d5 * d4;
+  if ((va <= 0.0) && (d4 - d3 >= 0.0) && (d5 - d6 >= 0.0)) {
+    w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    for (k = 0; k < 3; k++) {
+      q[k] = b[k] + w * (c[k] - b[k]);
+    }
+    return;
+  }
+
+  denom = va + vb + vc;
+  if (!(denom > 0.0)) {
+    vx_bvh_closest_seg(p, a, b, q);
+    best = vx_bvh_dist2(p, q);
+    vx_bvh_closest_seg(p, b, c, e);
+    if ((d = vx_bvh_dist2(p, e)) < best) {
+      memcpy(q, e, 3 * sizeof(double));
+      best = d;
+    }
+    vx_bvh_closest_seg(p, c, a, e);
+    if (vx_bvh_dist2(p, e) < best) {
+      memcpy(q, e, 3 * sizeof(double));
+    }
+    return;
+  }
+  v = vb / denom;
+  w = vc / denom;
+  for (k = 0; k < 3; k++) {
+    q[k] = a[k] + ab[k] * v + ac[k] * w;
+  }
+}
+
+
+/* Squared distance from point to node box */
+static inline double vx_bvh_box_dist2(const vx_bvh_node_t *node,
+				      const double *p)
+{
+  double d, sum = 0.0;
+  int k;
+
+  for (k = 0; k < 3; k++) {
+    d = fmax(fmax(node->min[k] - p[k], p[k] - node->max[k]), 0.0);
+    sum += d * d;
+  }
+  return(sum);
+}
+
+
+/* Closest point search seeded with triangle 'hint' (leaf order) or
+   VX_BVH_NONE. Returns squared distance and leaf order triangle */
+static double vx_bvh_search(const vx_bvh_t *bvh, const double *p,
+			    uint32_t hint, double *hit, uint32_t *best_tri)
+{
+  const vx_bvh_node_t *node, *l, *r;
+  const double *t;
+  uint32_t stack[VX_BVH_STACK];
+  double q[3], best = INFINITY, d, dl, dr;
+  uint32_t i, ni, top = 0;
+
+  *best_tri = VX_BVH_NONE;
+  if (hint != VX_BVH_NONE) {
+    t = &(bvh->tris[(size_t)hint * 9]);
+    vx_bvh_closest_tri(p, t, &t[3], &t[6], hit);
+    best = vx_bvh_dist2(p, hit);
+    *best_tri = hint;
+  }
+
+  if (vx_bvh_box_dist2(&(bvh->nodes[0]), p) < best) {
+    stack[top++] = 0;
+  }
+  while (top > 0) {
+    ni = stack[--top];
+    node = &(bvh->nodes[ni]);
+
+    if (node->count > 0) {
+      for (i = node->first; i < node->first + node->count; i++) {
+	t = &(bvh->tris[(size_t)i * 9]);
+	vx_bvh_closest_tri(p, t, &t[3], &t[6], q);
+	d = vx_bvh_dist2(p, q);
+	if (d < best) {
+	  best = d;
+	  *best_tri = i;
+	  memcpy(hit, q, 3 * sizeof(double));
+	}
+      }
+      continue;
+    }
+
+    /* Visit the nearer child first */
+    l = &(bvh->nodes[ni + 1]);
+    r = &(bvh->nodes[node->first]);
+    dl = vx_bvh_box_dist2(l, p);
+    dr = vx_bvh_box_dist2(r, p);
+    if (dl <= dr) {
+      if (dr < best) {
+	stack[top++] = node->first;
+      }
+      if (dl < best) {
+	stack[top++] = ni + 1;
+      }
+    } else {
+      if (dl < best) {
+	stack[top++] = ni + 1;
+      }
+      if (dr < best) {
+	stack[top++] = node->first;
+      }
+    }
+  }
+  return(best);
+}
+
+
+/* Closest point to 'p' */
+double vx_bvh_closest(const vx_bvh_t *bvh, const double *p, double *hit,
+		      uint32_t *tri)
+{
+  double q[3], d2;
+  uint32_t t;
+
+  if (!isfinite(p[0]) || !isfinite(p[1]) || !isfinite(p[2])) {
+    if (hit != NULL) {
+      hit[0] = hit[1] = hit[2] = NAN;
+    }
+    if (tri != NULL) {
+      *tri = VX_BVH_NONE;
+    }
+    return(NAN);
+  }
+
+  d2 = vx_bvh_search(bvh, p, VX_BVH_NONE, q, &t);
+  if (hit != NULL) {
+    memcpy(hit, q, 3 * sizeof(double));
+  }
+  if (tri != NULL) {
+    *tri = bvh->ids[t];
+  }
+  return(sqrt(d2));
+}
+
+
+/* Closest points of batch */
+void vx_bvh_closest_batch(const vx_bvh_t *bvh, const double *xyz, size_t n,
+			  double *hit, double *dist, uint32_t *tri)
+{
+  const double *p;
+  uint32_t t, hint = VX_BVH_NONE;
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    p = &xyz[i * 3];
+    if (!isfinite(p[0]) || !isfinite(p[1]) || !isfinite(p[2])) {
+      hit[i * 3] = hit[i * 3 + 1] = hit[i * 3 + 2] = NAN;
+      dist[i] = NAN;
+      if (tri != NULL) {
+	tri[i] = VX_BVH_NONE;
+      }
+      continue;
+    }
+    dist[i] = sqrt(vx_bvh_search(bvh, p, hint, &hit[i * 3], &t));
+    if (tri != NULL) {
+      tri[i] = bvh->ids[t];
+    }
+    hint = t;
+  }
+}
+
+
+/* Highest surface elevation at x, y */
+double vx_bvh_height(const vx_bvh_t *bvh, double x, double y)
+{
+  const vx_bvh_node_t *node;
+  const double *t;
+  uint32_t stack[VX_BVH_STACK];
+  double best = -INFINITY, det, l1, l2, z;
+  uint32_t i, ni, top = 0;
+
+  if (!isfinite(x) || !isfinite(y) || (bvh->num_nodes == 0)) {
+    return(NAN);
+  }
+
+  stack[top++] = 0;
+  while (top > 0) {
+    ni = stack[--top];
+    node = &(bvh->nodes[ni]);
+    if ((x < node->min[0]) || (x > node->max[0]) ||
+	(y < node->min[1]) || (y > node->max[1]) || (node->max[2] <= best)) {
+      continue;
+    }
+
+    if (node->count == 0) {
+      stack[top++] = node->first;
+      stack[top++] = ni + 1;
+      continue;
+    }
+
+    /* Barycentric coordinates in map view, vertical triangles have
+       no height */
+    for (i = node->first; i < node->first + node->count; i++) {
+      t = &(bvh->tris[(size_t)i * 9]);
+      det = (t[4] - t[7]) * (t[0] - t[6]) + (t[6] - t[3]) * (t[1] - t[7]);
+      if (det == 0.0) {
+	continue;
+      }
+      l1 = ((t[4] - t[7]) * (x - t[6]) + (t[6] - t[3]) * (y - t[7])) / det;
+      l2 = ((t[7] - t[1]) * (x - t[6]) + (t[0] - t[6]) * (y - t[7])) / det;
+      if ((l1 < -VX_BVH_EDGE_EPS) || (l2 < -VX_BVH_EDGE_EPS) ||
+	  (l1 + l2 > 1.0 + VX_BVH_EDGE_EPS)) {
+	continue;
+      }
+      z = l1 * t[2] + l2 * t[5] + (1.0 - l1 - l2) * t[8];
+      if (z > best) {
+	best = z;
+      }
+    }
+  }
+  return(isinf(best) ? NAN : best);
+}
+
+
+/* Parallel query task */
+static int vx_bvh_task(size_t task, void *arg)
+{
+  vx_bvh_task_t *a = (vx_bvh_task_t *)arg;
+  size_t start = task * VX_BVH_CHUNK;
+  size_t len = VX_BVH_CHUNK;
+
+  if (start + len > a->n) {
+    len = a->n - start;
+  }
+  vx_bvh_closest_batch(a->bvh, &(a->xyz[start * 3]), len,
+		       &(a->hit[start * 3]), &(a->dist[start]),
+		       (a->tri != NULL) ? &(a->tri[start]) : NULL);
+  return(0);
+}
+
+
+/* Closest points of batch on several threads */
+int vx_bvh_closest_parallel(const vx_bvh_t *bvh, const double *xyz,
+			    size_t n, double *hit, double *dist,
+			    uint32_t *tri, int num_threads)
+{
+  vx_bvh_task_t a;
+
+  if (num_threads <= 1) {
+    vx_bvh_closest_batch(bvh, xyz, n, hit, dist, tri);
+    return(0);
+  }
+  a.bvh = bvh;
+  a.xyz = xyz;
+  a.n = n;
+  a.hit = hit;
+  a.dist = dist;
+  a.tri = tri;
+  return(vx_sched_run((n + VX_BVH_CHUNK - 1) / VX_BVH_CHUNK, num_threads,
+		      NULL, vx_bvh_task, &a, NULL));
+}
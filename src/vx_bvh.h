@@ -0,0 +1,97 @@
+#ifndef VX_BVH_H
+#define VX_BVH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "vx_mesh.h"
+
+/* Max triangles per leaf */
+#define VX_BVH_LEAF 4
+
+/* Traversal stack depth, enough for median splits of 2^32 triangles */
+#define VX_BVH_STACK 128
+
+/* Points per task of parallel queries */
+#define VX_BVH_CHUNK 1024
+
+/* Triangle id of points without a closest point */
+#define VX_BVH_NONE UINT32_MAX
+
+
+/* Node of bounding volume hierarchy. The left child of an inner node
+   follows it, 'first' is the right child. Leaves hold triangles
+   first to first + count - 1 */
+typedef struct vx_bvh_node_t
+{
+  double min[3];
+  double max[3];
+  uint32_t first;
+  uint32_t count;            /* 0 for inner nodes */
+} vx_bvh_node_t;
+
+
+/* Bounding volume hierarchy over the triangles of a mesh. Nodes are
+   in depth first order and triangle vertices are stored in leaf
+   order, so a query walks memory mostly forward */
+typedef struct vx_bvh_t
+{
+  size_t num_nodes;
+  size_t num_tris;
+  vx_bvh_node_t *nodes;
+  double *tris;              /* 9 coordinates per triangle */
+  uint32_t *ids;             /* mesh triangle index of each triangle */
+  void *map;                 /* cache file mapping, NULL when built */
+  size_t map_len;
+} vx_bvh_t;
+
+
+/* Build hierarchy over 'mesh'. Returns 1 on failure */
+int vx_bvh_build(const vx_mesh_t *mesh, vx_bvh_t *bvh);
+
+/* Free hierarchy */
+void vx_bvh_free(vx_bvh_t *bvh);
+
+/* Save hierarchy to cache file 'path', tagged with the 'checksum' of
+   its source. Returns 1 on failure */
+int vx_bvh_save(const vx_bvh_t *bvh, const char *path, uint64_t checksum);
+
+/* Map hierarchy read-only from cache file 'path'. Returns 1 on
+   failure, or if the file was saved on another architecture or with
+   another checksum */
+int vx_bvh_map(vx_bvh_t *bvh, const char *path, uint64_t checksum);
+
+/* Hierarchy of mesh 'path', mapped from cache file 'cache' when it
+   matches the mesh checksum, otherwise built and saved there. 'cache'
+   may be NULL to always build. '*cached' (may be NULL) tells if the
+   cache was used. Returns 1 on failure */
+int vx_bvh_load(const char *path, const char *cache, vx_bvh_t *bvh,
+		int *cached);
+
+/* Closest point 'hit' on the surface to point 'p' and the mesh index
+   of its triangle, either may be NULL. Returns distance, NaN for
+   points that are not finite */
+double vx_bvh_closest(const vx_bvh_t *bvh, const double *p, double *hit,
+		      uint32_t *tri);
+
+/* Closest points of 'n' points 'xyz'. 'hit' holds 3 values and 'dist'
+   one per point, 'tri' may be NULL. Each search starts from the
+   triangle closest to the previous point, which prunes most of the
+   tree for coherent inputs */
+void vx_bvh_closest_batch(const vx_bvh_t *bvh, const double *xyz, size_t n,
+			  double *hit, double *dist, uint32_t *tri);
+
+/* Same as vx_bvh_closest_batch on 'num_threads' threads. Returns 1 on
+   failure */
+int vx_bvh_closest_parallel(const vx_bvh_t *bvh, const double *xyz,
+			    size_t n, double *hit, double *dist,
+			    uint32_t *tri, int num_threads);
+
+/* Highest elevation of the surface on the vertical line through
+   'x', 'y'. Returns NaN where the line misses the surface */
+double vx_bvh_height(const vx_bvh_t *bvh, double x, double y);
+
+/* Closest point on triangle a, b, c to 'p' */
+void vx_bvh_closest_tri(const double *p, const double *a, const double *b,
+			const double *c, double *q);
+
+#endif
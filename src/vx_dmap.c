@@ -0,0 +1,476 @@
+/** vx_dmap.c - Precomputed depth maps of the model on the nodes of the
+    topo grid: depths to the 1.0 and 2.5 km/s Vs isosurfaces, to the
+    basement and to the Moho. Maps are built once from the model
+    columns, cached on disk with a key naming the model files and read
+    back with constant time lookups.
+
+10/2026: Initial implementation
+**/
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <stdint.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "params.h"
+#include "vx_rec.h"
+#include "vx_sched.h"
+#include "vx_dmap.h"
+#include "utils.h"
+
+
+/* Magic line of map files */
+#define VX_DMAP_MAGIC "VXDMAP 1\n"
+
+/* Max length of map file header lines */
+#define VX_DMAP_LINE (VX_DMAP_PATH + 256)
+
+/* Extension of map files, left out of the model key */
+#define VX_DMAP_EXT ".vxd"
+
+
+/* Layer names */
+char *VX_DMAP_NAMES[VX_DMAP_NUM] = {"z1.0", "z2.5", "base", "moho"};
+
+
+/* Build task */
+typedef struct vx_dmap_task_t
+{
+  vx_dmap_t *map;
+  const vx_site_opts_t *opts;
+} vx_dmap_task_t;
+
+
+/* Default spec */
+void vx_dmap_defaults(vx_dmap_spec_t *spec, const char *modeldir)
+{
+  memset(spec, 0, sizeof(vx_dmap_spec_t));
+  snprintf(spec->modeldir, VX_DMAP_PATH, "%s", modeldir);
+  spec->use_gtl = True;
+  spec->use_scec = False;
+  vx_site_defaults(&(spec->site));
+  spec->num_threads = 1;
+}
+
+
+/* Depth of interface 'elev' below 'surface', NaN if either is no data */
+static float vx_dmap_depth(float surface, float elev)
+{
+  if ((surface < -90000.0) || (elev < -90000.0)) {
+    return(NAN);
+  }
+  return(surface - elev);
+}
+
+
+/* Fill one x row of the maps */
+static int vx_dmap_task(size_t task, void *arg)
+{
+  vx_dmap_task_t *a = (vx_dmap_task_t *)arg;
+  vx_dmap_t *map = a->map;
+  size_t i, nx = map->dims[0], n = nx * map->dims[1];
+  float *node = &(map->data[task * nx]);
+  vx_entry_t entry;
+  vx_site_t site;
+  double coor[3];
+  float surface;
+
+  for (i = 0; i < nx; i++) {
+    coor[0] = map->origin[0] + i * map->step[0];
+    coor[1] = map->origin[1] + task * map->step[1];
+    coor[2] = 0.0;
+
+    memset(&site, 0, sizeof(vx_site_t));
+    site.coor[0] = coor[0];
+    site.coor[1] = coor[1];
+    site.coor_type = VX_COORD_UTM;
+    vx_site_metrics(&site, a->opts);
+    node[i + VX_DMAP_Z1 * n] = site.z1;
+    node[i + VX_DMAP_Z25 * n] = site.z25;
+
+    /* Interfaces are read with the topo at the node */
+    node[i + VX_DMAP_BASE * n] = NAN;
+    node[i + VX_DMAP_MOHO * n] = NAN;
+    vx_getsurface(coor, VX_COORD_UTM, &surface);
+    memset(&entry, 0, sizeof(vx_entry_t));
+    memcpy(entry.coor, coor, 3 * sizeof(double));
+    entry.coor_type = VX_COORD_UTM;
+    if ((surface > -90000.0) &&
+	(vx_getcoord_zmode(&entry, VX_ZMODE_ELEV) == 0)) {
+      node[i + VX_DMAP_BASE * n] = vx_dmap_depth(surface, entry.base);
+      node[i + VX_DMAP_MOHO * n] = vx_dmap_depth(surface, entry.moho);
+    }
+  }
+  return(0);
+}
+
+
+/* Build maps */
+int vx_dmap_build(vx_dmap_t *map, const vx_site_opts_t *opts,
+		  int num_threads)
+{
+  vx_dmap_task_t arg;
+  double origin[2], step[2];
+  int dims[2], k;
+
+  memset(map, 0, sizeof(vx_dmap_t));
+  if (vx_get_surface_grid(origin, step, dims) != 0) {
+    fprintf(stderr, "No model set up\n");
+    return(1);
+  }
+  for (k = 0; k < 2; k++) {
+    map->origin[k] = origin[k];
+    map->step[k] = step[k];
+    map->dims[k] = (dims[k] > 0) ? dims[k] : 0;
+  }
+  map->data = malloc(map->dims[0] * map->dims[1] * VX_DMAP_NUM *
+		     sizeof(float));
+  if (map->data == NULL) {
+    fprintf(stderr, "Failed to allocate maps of %zu x %zu nodes\n",
+	    map->dims[0], map->dims[1]);
+    return(1);
+  }
+
+  arg.map = map;
+  arg.opts = opts;
+  if (vx_sched_run(map->dims[1], num_threads, NULL, vx_dmap_task, &arg,
+		   NULL) != 0) {
+    fprintf(stderr, "Failed to fill maps\n");
+    vx_dmap_free(map);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Free maps */
+void vx_dmap_free(vx_dmap_t *map)
+{
+  free(map->data);
+  memset(map, 0, sizeof(vx_dmap_t));
+}
+
+
+/* Save maps to a temporary file renamed into place, so processes
+   sharing the model never read a partial file */
+int vx_dmap_write(const char *path, const vx_dmap_t *map, const char *key)
+{
+  char tmp[VX_DMAP_LINE];
+  FILE *fp;
+  size_t n = map->dims[0] * map->dims[1] * VX_DMAP_NUM;
+  int k, retval = 0;
+
+  snprintf(tmp, sizeof(tmp), "%s.%ld", path, (long)getpid());
+  fp = fopen(tmp, "wb");
+  if (fp == NULL) {
+    fprintf(stderr, "Failed to open map file %s\n", tmp);
+    return(1);
+  }
+  fputs(VX_DMAP_MAGIC, fp);
+  fprintf(fp, "KEY %s\n", (key != NULL) ? key : "");
+  fprintf(fp, "LAYERS");
+  for (k = 0; k < VX_DMAP_NUM; k++) {
+    fprintf(fp, " %s", VX_DMAP_NAMES[k]);
+  }
+  fprintf(fp, "\n");
+  fprintf(fp, "ORIGIN %.17g %.17g\n", map->origin[0], map->origin[1]);
+  fprintf(fp, "STEP %.17g %.17g\n", map->step[0], map->step[1]);
+  fprintf(fp, "DIMS %zu %zu\n", map->dims[0], map->dims[1]);
+  fprintf(fp, "BYTEORDER %s\n",
+	  (vx_system_endian() == VX_BYTEORDER_LSB) ? "lsb" : "msb");
+  fprintf(fp, "END\n");
+  if (fwrite(map->data, sizeof(float), n, fp) != n) {
+    retval = 1;
+  }
+  if ((fclose(fp) != 0) || (retval != 0) || (rename(tmp, path) != 0)) {
+    fprintf(stderr, "Failed to write map file %s\n", path);
+    remove(tmp);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Load maps */
+int vx_dmap_read(const char *path, vx_dmap_t *map, const char *key)
+{
+  FILE *fp;
+  char line[VX_DMAP_LINE], layers[VX_DMAP_LINE], order[16] = "";
+  size_t i, n, len;
+  int k, fields = 0;
+
+  memset(map, 0, sizeof(vx_dmap_t));
+  fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return(1);
+  }
+  if ((fgets(line, sizeof(line), fp) == NULL) ||
+      (strcmp(line, VX_DMAP_MAGIC) != 0)) {
+    fclose(fp);
+    return(1);
+  }
+
+  strcpy(layers, "LAYERS");
+  for (k = 0; k < VX_DMAP_NUM; k++) {
+    strcat(layers, " ");
+    strcat(layers, VX_DMAP_NAMES[k]);
+  }
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    len = strlen(line);
+    if ((len > 0) && (line[len - 1] == '\n')) {
+      line[--len] = '\0';
+    }
+    if (strcmp(line, "END") == 0) {
+      break;
+    } else if (strncmp(line, "KEY ", 4) == 0) {
+      if ((key != NULL) && (strcmp(&line[4], key) != 0)) {
+	fclose(fp);
+	return(1);
+      }
+      fields++;
+    } else if ((strcmp(line, layers) == 0) ||
+	       (sscanf(line, "ORIGIN %lf %lf", &map->origin[0],
+		       &map->origin[1]) == 2) ||
+	       (sscanf(line, "STEP %lf %lf", &map->step[0],
+		       &map->step[1]) == 2) ||
+	       (sscanf(line, "DIMS %zu %zu", &map->dims[0],
+		       &map->dims[1]) == 2) ||
+	       (sscanf(line, "BYTEORDER %15s", order) == 1)) {
+      fields++;
+    }
+  }
+
+  if ((fields != 6) || (map->dims[0] < 1) || (map->dims[1] < 1) ||
+      (map->dims[0] > ((size_t)1 << 20)) ||
+      (map->dims[1] > ((size_t)1 << 20)) ||
+      !(map->step[0] > 0.0) || !(map->step[1] > 0.0)) {
+    fprintf(stderr, "Invalid map file %s\n", path);
+    fclose(fp);
+    memset(map, 0, sizeof(vx_dmap_t));
+    return(1);
+  }
+
+  n = map->dims[0] * map->dims[1] * VX_DMAP_NUM;
+  map->data = malloc(n * sizeof(float));
+  if ((map->data == NULL) || (fread(map->data, sizeof(float), n, fp) != n)) {
+    fprintf(stderr, "Failed to read map file %s\n", path);
+    fclose(fp);
+    vx_dmap_free(map);
+    return(1);
+  }
+  fclose(fp);
+
+  if (strcmp(order, (vx_system_endian() == VX_BYTEORDER_LSB) ?
+	     "lsb" : "msb") != 0) {
+    for (i = 0; i < n; i++) {
+      vx_rec_swap((char *)&(map->data[i]), sizeof(float));
+    }
+  }
+  return(0);
+}
+
+
+/* Order of file names */
+static int vx_dmap_cmp(const void *a, const void *b)
+{
+  return(strcmp(*(char * const *)a, *(char * const *)b));
+}
+
+
+/* Cache key of spec. Stamps of the regular files of the model
+   directory are hashed in name order; map files are left out so a
+   cache kept there does not change the key */
+int vx_dmap_key(const vx_dmap_spec_t *spec, char *key, size_t len)
+{
+  char path[VX_DMAP_LINE], **names = NULL, **more;
+  DIR *dp;
+  struct dirent *de;
+  uint64_t h = VX_FNV_INIT;
+  size_t i, n = 0, cap = 0, l;
+
+  dp = opendir(spec->modeldir);
+  if (dp == NULL) {
+    fprintf(stderr, "Failed to open model directory %s\n", spec->modeldir);
+    return(1);
+  }
+  while ((de = readdir(dp)) != NULL) {
+    l = strlen(de->d_name);
+    if ((de->d_name[0] == '.') || (strstr(de->d_name, VX_DMAP_EXT) != NULL)) {
+      continue;
+    }
+    if (n == cap) {
+      cap = (cap > 0) ? cap * 2 : 64;
+      more = realloc(names, cap * sizeof(char *));
+      if (more == NULL) {
+	break;
+      }
+      names = more;
+    }
+    names[n] = malloc(l + 1);
+    if (names[n] == NULL) {
+      break;
+    }
+    memcpy(names[n++], de->d_name, l + 1);
+  }
+  closedir(dp);
+  if (de != NULL) {
+    fprintf(stderr, "Failed to list model directory %s\n", spec->modeldir);
+    for (i = 0; i < n; i++) {
+      free(names[i]);
+    }
+    free(names);
+    return(1);
+  }
+
+  qsort(names, n, sizeof(char *), vx_dmap_cmp);
+  for (i = 0; i < n; i++) {
+    snprintf(path, sizeof(path), "%s/%s", spec->modeldir, names[i]);
+    if (vx_file_stamp(path, &h) == 0) {
+      h = vx_fnv(h, names[i], strlen(names[i]) + 1);
+    }
+    free(names[i]);
+  }
+  free(names);
+
+  snprintf(key, len, "%s files=%016llx gtl=%d scec=%d tol=%.17g depth=%.17g",
+	   spec->modeldir, (unsigned long long)h, spec->use_gtl != 0,
+	   spec->use_scec != 0, spec->site.tol, spec->site.max_depth);
+  return(0);
+}
+
+
+/* Cached maps of spec */
+int vx_dmap_open(const vx_dmap_spec_t *spec, const char *cache,
+		 vx_dmap_t *map, int *cached)
+{
+  char key[VX_DMAP_LINE], path[VX_DMAP_LINE];
+  int retval;
+
+  if (cached != NULL) {
+    *cached = 0;
+  }
+  if (cache == NULL) {
+    snprintf(path, sizeof(path), "%s/%s", spec->modeldir, VX_DMAP_CACHE);
+  } else {
+    snprintf(path, sizeof(path), "%s", cache);
+  }
+  if (vx_dmap_key(spec, key, sizeof(key)) != 0) {
+    return(1);
+  }
+  if (vx_dmap_read(path, map, key) == 0) {
+    if (cached != NULL) {
+      *cached = 1;
+    }
+    return(0);
+  }
+
+  if (vx_setup(spec->modeldir) != 0) {
+    fprintf(stderr, "Failed to init vx\n");
+    return(1);
+  }
+  if (spec->use_scec) {
+    vx_register_scec();
+  }
+  vx_setgtl(spec->use_gtl);
+  retval = vx_dmap_build(map, &(spec->site), spec->num_threads);
+  vx_cleanup();
+  if (retval != 0) {
+    return(1);
+  }
+
+  /* The default cache directory is created on first use */
+  if (cache == NULL) {
+    snprintf(path, sizeof(path), "%s/%s", spec->modeldir, VX_DMAP_CACHE);
+    *strrchr(path, '/') = '\0';
+    if ((mkdir(path, 0755) != 0) && (errno != EEXIST)) {
+      fprintf(stderr, "Failed to create cache directory %s\n", path);
+    }
+    snprintf(path, sizeof(path), "%s/%s", spec->modeldir, VX_DMAP_CACHE);
+  }
+  if (vx_dmap_write(path, map, key) != 0) {
+    fprintf(stderr, "Maps of %s not cached\n", spec->modeldir);
+  }
+  return(0);
+}
+
+
+/* Grid coordinates of 'coor'. Returns 1 outside the maps */
+static int vx_dmap_grid(const vx_dmap_t *map, const double *coor,
+			vx_coord_t coor_type, double *g)
+{
+  double utm[3];
+  int k;
+
+  if (coor_type == VX_COORD_GEO) {
+    vx_geo2utm((double *)coor, utm);
+  } else {
+    utm[0] = coor[0];
+    utm[1] = coor[1];
+  }
+
+  /* Nodes cover half a cell around them, as in vx_getcoord */
+  for (k = 0; k < 2; k++) {
+    g[k] = (utm[k] - map->origin[k]) / map->step[k];
+    if (!(g[k] >= -0.5) || !(g[k] < map->dims[k] - 0.5)) {
+      return(1);
+    }
+  }
+  return(0);
+}
+
+
+/* Closest node value */
+double vx_dmap_get(const vx_dmap_t *map, vx_dmap_layer_t layer,
+		   const double *coor, vx_coord_t coor_type)
+{
+  double g[2];
+  size_t i, j;
+
+  if (vx_dmap_grid(map, coor, coor_type, g) != 0) {
+    return(NAN);
+  }
+  i = (size_t)round(fmax(g[0], 0.0));
+  j = (size_t)round(fmax(g[1], 0.0));
+  return(map->data[(layer * map->dims[1] + j) * map->dims[0] + i]);
+}
+
+
+/* Interpolated value */
+double vx_dmap_interp(const vx_dmap_t *map, vx_dmap_layer_t layer,
+		      const double *coor, vx_coord_t coor_type)
+{
+  const float *c;
+  double g[2], w[2], lo, hi;
+  size_t cell[2], nx = map->dims[0];
+  int k;
+
+  if (vx_dmap_grid(map, coor, coor_type, g) != 0) {
+    return(NAN);
+  }
+  for (k = 0; k < 2; k++) {
+    if (map->dims[k] < 2) {
+      return(vx_dmap_get(map, layer, coor, coor_type));
+    }
+    g[k] = fmin(fmax(g[k], 0.0), map->dims[k] - 1.0);
+    cell[k] = (size_t)g[k];
+    if (cell[k] > map->dims[k] - 2) {
+      cell[k] = map->dims[k] - 2;
+    }
+    w[k] = g[k] - cell[k];
+  }
+
+  c = &(map->data[(layer * map->dims[1] + cell[1]) * nx + cell[0]]);
+  if (isnan(c[0]) || isnan(c[1]) || isnan(c[nx]) || isnan(c[nx + 1])) {
+    return(vx_dmap_get(map, layer, coor, coor_type));
+  }
+  lo = c[0] + w[0] * (c[1] - c[0]);
+  hi = c[nx] + w[0] * (c[nx + 1] - c[nx]);
+  return(lo + w[1] * (hi - lo));
+}
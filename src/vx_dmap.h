@@ -0,0 +1,89 @@
+#ifndef VX_DMAP_H
+#define VX_DMAP_H
+
+#include <stddef.h>
+#include "vx_sub.h"
+#include "vx_site.h"
+
+/* Max length of model paths and cache keys */
+#define VX_DMAP_PATH 1024
+
+/* Default cache file, relative to the model directory */
+#define VX_DMAP_CACHE "cache/depthmaps.vxd"
+
+
+/* Map layers, all depths in m below the surface */
+typedef enum { VX_DMAP_Z1 = 0,
+	       VX_DMAP_Z25,
+	       VX_DMAP_BASE,
+	       VX_DMAP_MOHO } vx_dmap_layer_t;
+
+#define VX_DMAP_NUM 4
+
+extern char *VX_DMAP_NAMES[VX_DMAP_NUM];
+
+
+/* Depth maps on the nodes of the model topo grid. Layers are stored
+   one after the other, x fastest, NaN where undefined */
+typedef struct vx_dmap_t
+{
+  double origin[2];          /* UTM of node 0, 0 */
+  double step[2];
+  size_t dims[2];
+  float *data;
+} vx_dmap_t;
+
+
+/* Model and settings the maps are built from */
+typedef struct vx_dmap_spec_t
+{
+  char modeldir[VX_DMAP_PATH];
+  int use_gtl;
+  int use_scec;
+  vx_site_opts_t site;       /* isosurface search of z1 and z25 */
+  int num_threads;
+} vx_dmap_spec_t;
+
+
+/* Default spec of model 'modeldir': GTL on, no background */
+void vx_dmap_defaults(vx_dmap_spec_t *spec, const char *modeldir);
+
+/* Build maps from the model set up with vx_setup, with the current
+   GTL and background settings, on 'num_threads' threads. Returns 1 on
+   failure */
+int vx_dmap_build(vx_dmap_t *map, const vx_site_opts_t *opts,
+		  int num_threads);
+
+/* Free maps */
+void vx_dmap_free(vx_dmap_t *map);
+
+/* Save maps to 'path', tagged with 'key'. Returns 1 on failure */
+int vx_dmap_write(const char *path, const vx_dmap_t *map, const char *key);
+
+/* Load maps saved with 'key' (NULL for any) from 'path'. Returns 1
+   on failure or if the keys differ */
+int vx_dmap_read(const char *path, vx_dmap_t *map, const char *key);
+
+/* Cache key of 'spec', from the names and vx_file_stamp stamps of the
+   model files and the settings */
+int vx_dmap_key(const vx_dmap_spec_t *spec, char *key, size_t len);
+
+/* Maps of 'spec', loaded from file 'cache' if they were built from
+   the same model files and settings, otherwise built and saved there.
+   'cache' NULL selects VX_DMAP_CACHE in the model directory. Building
+   sets up the model and cleans it up, so the caller must not have a
+   model set up at the time. '*cached' (may be NULL) tells if the maps
+   were loaded. Returns 1 on failure */
+int vx_dmap_open(const vx_dmap_spec_t *spec, const char *cache,
+		 vx_dmap_t *map, int *cached);
+
+/* Layer value at the node closest to 'coor'. NaN outside the maps */
+double vx_dmap_get(const vx_dmap_t *map, vx_dmap_layer_t layer,
+		   const double *coor, vx_coord_t coor_type);
+
+/* Layer value at 'coor' by bilinear interpolation. Cells with an
+   undefined corner give the closest node value. NaN outside the maps */
+double vx_dmap_interp(const vx_dmap_t *map, vx_dmap_layer_t layer,
+		      const double *coor, vx_coord_t coor_type);
+
+#endif
@@ -0,0 +1,189 @@
+/**
+    vx_dmapgen - Build the depth maps of a model (Z1.0, Z2.5, basement
+    and Moho depth on the topo grid), cache them in the model
+    directory and look them up at input points. Accepts Geographic
+    Coordinates or UTM Zone 11 coordinates.
+
+    10/2026: Initial implementation
+**/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <getopt.h>
+#include "params.h"
+#include "vx_sub.h"
+#include "vx_fmt.h"
+#include "vx_stats.h"
+#include "vx_dmap.h"
+
+
+/* Max length of input and output lines */
+#define VX_DMAPGEN_LINE 1024
+
+
+/* Usage function */
+void usage() {
+  printf("     vx_dmapgen - (c) Harvard University, SCEC\n");
+  printf("Build maps of the depths to the Vs %.1f and %.1f km/s isosurfaces,\n",
+	 VX_SITE_VS_Z1 / 1000.0, VX_SITE_VS_Z25 / 1000.0);
+  printf("the basement and the Moho on the nodes of the model topo grid,\n");
+  printf("cache them in a map file and optionally look them up at points\n");
+  printf("read from stdin. The map file is reused until the model files or\n");
+  printf("the settings change.\n\n");
+  printf("\tusage: vx_dmapgen [-m dir] [-c mapfile] [-g] [-s] [-r tol] [-d depth] [-t threads] [-q] [-i] < file.in\n\n");
+  printf("Flags:\n");
+  printf("\t-m directory containing model files (default is '.').\n");
+  printf("\t-c map file to load or build (default is dir/%s).\n",
+	 VX_DMAP_CACHE);
+  printf("\t-g disable GTL (default is on).\n");
+  printf("\t-s directs use of SCEC 1D background and topo.\n");
+  printf("\t-r depth resolution of the isosurfaces in m (default is %.1f).\n",
+	 VX_SITE_TOL);
+  printf("\t-d max depth searched for the isosurfaces in m (default is\n");
+  printf("\t   %.0f).\n", VX_SITE_MAX_DEPTH);
+  printf("\t-t number of threads (default is 1).\n");
+  printf("\t-q look up the maps at X Y points read from stdin.\n");
+  printf("\t-i interpolate bilinearly between nodes (default is the\n");
+  printf("\t   closest node).\n\n");
+  printf("Output format is:\n");
+  printf("\tX Y z1.0 z2.5 base moho\n\n");
+  printf("Depths are in m below the surface, nan where undefined and\n");
+  printf("outside the maps.\n\n");
+  printf("Version: %s\n\n", VERSION);
+  exit (0);
+}
+
+
+/* Look up maps at stdin points */
+int lookup_points(const vx_dmap_t *map, int interp)
+{
+  char line[VX_DMAPGEN_LINE], out[VX_DMAPGEN_LINE], *p, *end;
+  double xy[2], val;
+  vx_coord_t coor_type;
+  int k, len;
+
+  while (fgets(line, sizeof(line), stdin) != NULL) {
+    p = line;
+    for (k = 0; k < 2; k++) {
+      xy[k] = vx_parse_double(p, &end);
+      if (end == p) {
+	break;
+      }
+      p = end;
+    }
+    if (k < 2) {
+      continue;
+    }
+
+    coor_type = VX_COORD_UTM;
+    if ((xy[0] < 360.) && (fabs(xy[1]) < 90.)) {
+      coor_type = VX_COORD_GEO;
+    }
+
+    len = vx_fmt_fixed(out, xy[0], 0, 4);
+    out[len++] = ' ';
+    len += vx_fmt_fixed(&out[len], xy[1], 0, 4);
+    for (k = 0; k < VX_DMAP_NUM; k++) {
+      if (interp) {
+	val = vx_dmap_interp(map, (vx_dmap_layer_t)k, xy, coor_type);
+      } else {
+	val = vx_dmap_get(map, (vx_dmap_layer_t)k, xy, coor_type);
+      }
+      out[len++] = ' ';
+      len += vx_fmt_fixed(&out[len], val, 0, 2);
+    }
+    out[len++] = '\n';
+    if (fwrite(out, 1, len, stdout) != (size_t)len) {
+      fprintf(stderr, "Failed to write output\n");
+      return(1);
+    }
+  }
+  return(0);
+}
+
+
+int main (int argc, char *argv[])
+{
+  vx_dmap_spec_t spec;
+  vx_dmap_t map;
+  char mapfile[CMLEN];
+  int query = False;
+  int interp = False;
+  int cached = 0;
+  unsigned long long start;
+  int opt, retval;
+
+  vx_dmap_defaults(&spec, ".");
+  strcpy(mapfile, "");
+
+  /* Parse options */
+  while ((opt = getopt(argc, argv, "c:d:gim:qr:st:h")) != -1) {
+    switch (opt) {
+    case 'c':
+      snprintf(mapfile, CMLEN, "%s", optarg);
+      break;
+    case 'd':
+      spec.site.max_depth = atof(optarg);
+      if (!(spec.site.max_depth > 0.0)) {
+	fprintf(stderr, "Invalid max depth %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'g':
+      spec.use_gtl = False;
+      break;
+    case 'i':
+      interp = True;
+      break;
+    case 'm':
+      snprintf(spec.modeldir, VX_DMAP_PATH, "%s", optarg);
+      break;
+    case 'q':
+      query = True;
+      break;
+    case 'r':
+      spec.site.tol = atof(optarg);
+      if (!(spec.site.tol > 0.0)) {
+	fprintf(stderr, "Invalid resolution %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 's':
+      spec.use_scec = True;
+      break;
+    case 't':
+      spec.num_threads = atoi(optarg);
+      if (spec.num_threads < 1) {
+	fprintf(stderr, "Invalid thread count %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'h':
+      usage();
+      break;
+    default: /* '?' */
+      usage();
+    }
+  }
+
+  start = vx_stats_now();
+  if (vx_dmap_open(&spec, (strlen(mapfile) > 0) ? mapfile : NULL, &map,
+		   &cached) != 0) {
+    fprintf(stderr, "Failed to build maps of %s\n", spec.modeldir);
+    return(1);
+  }
+  fprintf(stderr, "%s: maps of %zux%zu nodes, %s in %.3f s\n",
+	  (strlen(mapfile) > 0) ? mapfile : VX_DMAP_CACHE, map.dims[0],
+	  map.dims[1], cached ? "cached" : "built",
+	  (vx_stats_now() - start) * 1.0e-9);
+
+  retval = 0;
+  if (query) {
+    retval = lookup_points(&map, interp);
+  }
+  vx_dmap_free(&map);
+  return(retval);
+}
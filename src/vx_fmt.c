@@ -0,0 +1,209 @@
+/** vx_fmt.c - Locale independent number parsing and fixed width
+    formatting for the text query paths. Common inputs are handled
+    with exact floating point arithmetic; anything else is passed to
+    strtod/snprintf, so results always match the C library.
+
+10/2026: Initial implementation
+**/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "vx_fmt.h"
+
+/* Largest mantissa exactly representable as double */
+#define VX_FMT_MAX_MANT 9007199254740992ULL
+
+/* Largest scaled value formatted on the fast path */
+#define VX_FMT_MAX_SCALED 1.0e15
+
+
+/* Exact powers of ten */
+static const double vx_fmt_pow10[23] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+
+/* Parse ASCII decimal number. Same result and end pointer as strtod
+   in the C locale */
+double vx_parse_double(const char *str, char **endptr)
+{
+  const char *p = str;
+  unsigned long long mant = 0;
+  int neg = 0;
+  int ndigits = 0;
+  int nsig = 0;
+  int exp10 = 0;
+  int eneg = 0;
+  int e = 0;
+  const char *q;
+  double val;
+
+  while ((*p == ' ') || (*p == '\t') || (*p == '\n') ||
+	 (*p == '\r') || (*p == '\v') || (*p == '\f')) {
+    p++;
+  }
+  if ((*p == '-') || (*p == '+')) {
+    neg = (*p == '-');
+    p++;
+  }
+
+  /* Leave hex, inf and nan to the C library */
+  if ((p[0] == '0') && ((p[1] == 'x') || (p[1] == 'X'))) {
+    return(strtod(str, endptr));
+  }
+
+  while ((*p >= '0') && (*p <= '9')) {
+    if ((nsig > 0) || (*p != '0')) {
+      if (nsig == 19) {
+	return(strtod(str, endptr));
+      }
+      mant = mant * 10 + (*p - '0');
+      nsig++;
+    }
+    ndigits++;
+    p++;
+  }
+  if (*p == '.') {
+    p++;
+    while ((*p >= '0') && (*p <= '9')) {
+      if ((nsig > 0) || (*p != '0')) {
+	if (nsig == 19) {
+	  return(strtod(str, endptr));
+	}
+	mant = mant * 10 + (*p - '0');
+	nsig++;
+      }
+      exp10--;
+      ndigits++;
+      p++;
+    }
+  }
+  if (ndigits == 0) {
+    return(strtod(str, endptr));
+  }
+
+  /* Exponent, only consumed if followed by digits */
+  if ((*p == 'e') || (*p == 'E')) {
+    q = p + 1;
+    if ((*q == '-') || (*q == '+')) {
+      eneg = (*q == '-');
+      q++;
+    }
+    if ((*q >= '0') && (*q <= '9')) {
+      while ((*q >= '0') && (*q <= '9')) {
+	if (e < 10000) {
+	  e = e * 10 + (*q - '0');
+	}
+	q++;
+      }
+      exp10 += (eneg ? -e : e);
+      p = q;
+    }
+  }
+
+  /* Exact when both mantissa and power of ten are exact doubles */
+  if (mant == 0) {
+    val = 0.0;
+  } else if ((mant <= VX_FMT_MAX_MANT) && (exp10 >= -22) &&
+	     (exp10 <= 22)) {
+    if (exp10 < 0) {
+      val = (double)mant / vx_fmt_pow10[-exp10];
+    } else {
+      val = (double)mant * vx_fmt_pow10[exp10];
+    }
+  } else {
+    return(strtod(str, endptr));
+  }
+
+  if (endptr != NULL) {
+    *endptr = (char *)p;
+  }
+  return(neg ? -val : val);
+}
+
+
+/* Format value as printf("%<width>.<prec>f"). Writes terminated
+   string to buf and returns its length */
+int vx_fmt_fixed(char *buf, double val, int width, int prec)
+{
+  char tmp[32];
+  double scale, scaled, n, frac, err;
+  unsigned long long digits;
+  int neg, len, i, pad;
+
+  if ((prec < 0) || (prec > VX_FMT_MAX_PREC) || !isfinite(val)) {
+    return(snprintf(buf, VX_FMT_MAX_LEN, "%*.*f", width, prec, val));
+  }
+  neg = signbit(val);
+  scale = vx_fmt_pow10[prec];
+  scaled = fabs(val) * scale;
+  if (scaled >= VX_FMT_MAX_SCALED) {
+    return(snprintf(buf, VX_FMT_MAX_LEN, "%*.*f", width, prec, val));
+  }
+
+  /* Round the exact product to nearest, ties to even. The rounded
+     product only misleads rint() when it lands exactly on a half, in
+     which case the rounding error of the multiply decides */
+  n = rint(scaled);
+  frac = scaled - floor(scaled);
+  if (frac == 0.5) {
+    err = fma(fabs(val), scale, -scaled);
+    if (err > 0.0) {
+      n = floor(scaled) + 1.0;
+    } else if (err < 0.0) {
+      n = floor(scaled);
+    }
+  }
+  digits = (unsigned long long)n;
+
+  /* Digits in reverse */
+  len = 0;
+  for (i = 0; i < prec; i++) {
+    tmp[len++] = '0' + (char)(digits % 10);
+    digits /= 10;
+  }
+  if (prec > 0) {
+    tmp[len++] = '.';
+  }
+  do {
+    tmp[len++] = '0' + (char)(digits % 10);
+    digits /= 10;
+  } while (digits > 0);
+  if (neg) {
+    tmp[len++] = '-';
+  }
+
+  pad = (width > len) ? width - len : 0;
+  memset(buf, ' ', pad);
+  for (i = 0; i < len; i++) {
+    buf[pad + i] = tmp[len - 1 - i];
+  }
+  buf[pad + len] = '\0';
+  return(pad + len);
+}
+
+
+/* Format integer as printf("%d"). Returns length */
+int vx_fmt_int(char *buf, int val)
+{
+  char tmp[16];
+  unsigned int u;
+  int len = 0;
+  int i;
+
+  u = (val < 0) ? 0U - (unsigned int)val : (unsigned int)val;
+  do {
+    tmp[len++] = '0' + (char)(u % 10);
+    u /= 10;
+  } while (u > 0);
+  if (val < 0) {
+    tmp[len++] = '-';
+  }
+  for (i = 0; i < len; i++) {
+    buf[i] = tmp[len - 1 - i];
+  }
+  buf[len] = '\0';
+  return(len);
+}
@@ -0,0 +1,23 @@
+#ifndef VX_FMT_H
+#define VX_FMT_H
+
+/* Max precision handled by the fixed point formatter */
+#define VX_FMT_MAX_PREC 9
+
+/* Max bytes written by vx_fmt_fixed/vx_fmt_int, excluding terminator,
+   for widths up to 32 */
+#define VX_FMT_MAX_LEN 350
+
+
+/* Parse ASCII decimal number. Same result and end pointer as strtod
+   in the C locale */
+double vx_parse_double(const char *str, char **endptr);
+
+/* Format value as printf("%<width>.<prec>f"). Writes terminated
+   string to buf and returns its length */
+int vx_fmt_fixed(char *buf, double val, int width, int prec);
+
+/* Format integer as printf("%d"). Returns length */
+int vx_fmt_int(char *buf, int val);
+
+#endif
@@ -0,0 +1,213 @@
+/** vx_grad.c - Interpolated queries returning vp, vs and rho with
+    their spatial gradients from one trilinear voxet stencil, in place
+    of a point query and six finite difference neighbours.
+
+10/2026: Initial implementation
+**/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "params.h"
+#include "vx_sub.h"
+#include "vx_stack.h"
+#include "vx_grad.h"
+
+
+/* Half vp interval of the density derivative, m/s */
+#define VX_GRAD_DVP 0.5
+
+
+/* Properties of voxet node 'i' */
+static inline void vx_grad_node(const vx_volume_t *vol, const int *i,
+				float *vp, float *vs, float *tag)
+{
+  size_t pos = ((size_t)vol->a.N[1] * i[2] + i[1]) * vol->a.N[0] + i[0];
+
+  memcpy(vp, &vol->vp[pos * vol->vp_p.ESIZE], vol->vp_p.ESIZE);
+  memcpy(vs, &vol->vs[pos * vol->vs_p.ESIZE], vol->vs_p.ESIZE);
+  memcpy(tag, &vol->tag[pos * vol->tag_p.ESIZE], vol->tag_p.ESIZE);
+}
+
+
+/* Density and its gradient from vp */
+static void vx_grad_rho(vx_grad_t *g)
+{
+  double d;
+  int k;
+
+  g->rho = calc_rho(g->vp, g->data_src);
+  d = (calc_rho(g->vp + VX_GRAD_DVP, g->data_src) -
+       calc_rho(g->vp - VX_GRAD_DVP, g->data_src)) / (2.0 * VX_GRAD_DVP);
+  for (k = 0; k < 3; k++) {
+    g->drho[k] = d * g->dvp[k];
+  }
+}
+
+
+/* Trilinear values and gradients at 'utm' in voxet 'vol', of which
+   'near' is the closest node */
+static void vx_grad_stencil(const vx_volume_t *vol, const double *utm,
+			    const int *near, vx_grad_t *g)
+{
+  float vp[8], vs[8], tag, near_vp, near_vs, near_tag;
+  double f, t[3], w, dw[3];
+  int lo[3], fixed[3], i[3], c, k, m;
+
+  vx_grad_node(vol, near, &near_vp, &near_vs, &near_tag);
+
+  /* Cell of the stencil. Outside the outer nodes the values are held */
+  for (k = 0; k < 3; k++) {
+    f = (utm[k] - vol->a.O[k]) / vol->step[k];
+    lo[k] = (int)floor(f);
+    t[k] = f - lo[k];
+    fixed[k] = False;
+    if (vol->a.N[k] < 2) {
+      lo[k] = 0;
+      t[k] = 0.0;
+      fixed[k] = True;
+    } else if (lo[k] < 0) {
+      lo[k] = 0;
+      t[k] = 0.0;
+      fixed[k] = True;
+    } else if (lo[k] > vol->a.N[k] - 2) {
+      lo[k] = vol->a.N[k] - 2;
+      t[k] = 1.0;
+      fixed[k] = True;
+    }
+  }
+
+  /* Corners without data or across a tag boundary take the closest
+     node */
+  for (c = 0; c < 8; c++) {
+    for (k = 0; k < 3; k++) {
+      i[k] = (vol->a.N[k] < 2) ? 0 : lo[k] + ((c >> k) & 1);
+    }
+    vx_grad_node(vol, i, &vp[c], &vs[c], &tag);
+    if ((tag != near_tag) ||
+	(vp[c] - vol->vp_p.NO_DATA_VALUE < 0.1) ||
+	(vs[c] - vol->vs_p.NO_DATA_VALUE < 0.1)) {
+      vp[c] = near_vp;
+      vs[c] = near_vs;
+    }
+  }
+
+  g->vp = g->vs = 0.0;
+  for (k = 0; k < 3; k++) {
+    g->dvp[k] = g->dvs[k] = 0.0;
+  }
+  for (c = 0; c < 8; c++) {
+    w = 1.0;
+    for (k = 0; k < 3; k++) {
+      w *= ((c >> k) & 1) ? t[k] : 1.0 - t[k];
+      dw[k] = ((c >> k) & 1) ? 1.0 : -1.0;
+      for (m = 0; m < 3; m++) {
+	if (m != k) {
+	  dw[k] *= ((c >> m) & 1) ? t[m] : 1.0 - t[m];
+	}
+      }
+    }
+    g->vp += w * vp[c];
+    g->vs += w * vs[c];
+    for (k = 0; k < 3; k++) {
+      g->dvp[k] += dw[k] * vp[c];
+      g->dvs[k] += dw[k] * vs[c];
+    }
+  }
+  for (k = 0; k < 3; k++) {
+    if (fixed[k]) {
+      g->dvp[k] = g->dvs[k] = 0.0;
+    } else {
+      g->dvp[k] /= vol->step[k];
+      g->dvs[k] /= vol->step[k];
+    }
+  }
+  vx_grad_rho(g);
+}
+
+
+/* Central differences of point queries around 'center'. Neighbours
+   that fail or have no data are replaced by the center, giving one
+   sided differences */
+static void vx_grad_diff(vx_grad_t *g, const vx_entry_t *center)
+{
+  vx_entry_t e[2];
+  double h;
+  int k, s;
+
+  g->vp = center->vp;
+  g->vs = center->vs;
+  g->rho = center->rho;
+  for (k = 0; k < 3; k++) {
+    h = 0.0;
+    for (s = 0; s < 2; s++) {
+      memset(&(e[s]), 0, sizeof(vx_entry_t));
+      memcpy(e[s].coor, center->coor_utm, sizeof(double) * 3);
+      e[s].coor[k] += (s == 0) ? -VX_GRAD_STEP : VX_GRAD_STEP;
+      e[s].coor_type = VX_COORD_UTM;
+      if ((vx_getcoord_zmode(&(e[s]), VX_ZMODE_ELEV) != 0) ||
+	  (e[s].vp < -90000.0) || (e[s].vs < -90000.0) ||
+	  (center->vp < -90000.0) || (center->vs < -90000.0)) {
+	memcpy(&(e[s]), center, sizeof(vx_entry_t));
+      } else {
+	h += VX_GRAD_STEP;
+      }
+    }
+    g->dvp[k] = (h > 0.0) ? (e[1].vp - e[0].vp) / h : 0.0;
+    g->dvs[k] = (h > 0.0) ? (e[1].vs - e[0].vs) / h : 0.0;
+    g->drho[k] = (h > 0.0) ? (e[1].rho - e[0].rho) / h : 0.0;
+  }
+}
+
+
+/* Query properties and gradients */
+int vx_getgrad(vx_grad_t *g)
+{
+  const vx_stack_t *stack = vx_get_stack();
+  vx_entry_t entry;
+  float vp, vs, tag;
+  int j, k, gcoor[3];
+
+  g->interpolated = False;
+  g->vp = g->vs = g->rho = NAN;
+  for (k = 0; k < 3; k++) {
+    g->dvp[k] = g->dvs[k] = g->drho[k] = NAN;
+  }
+
+  memset(&entry, 0, sizeof(vx_entry_t));
+  memcpy(entry.coor, g->coor, sizeof(double) * 3);
+  entry.coor_type = g->coor_type;
+  if (vx_getcoord_zmode(&entry, VX_ZMODE_ELEV) != 0) {
+    return(1);
+  }
+  g->data_src = entry.data_src;
+
+  /* Voxet points as found by the kernel. Points in the GTL keep the
+     voxet source but not the values of their node */
+  j = (stack != NULL) ? vx_stack_find(stack, entry.coor_utm, gcoor) : -1;
+  if ((j >= 0) && (stack->vols[j].src == entry.data_src)) {
+    vx_grad_node(&(stack->vols[j]), gcoor, &vp, &vs, &tag);
+    if ((vp == entry.vp) && (vs == entry.vs)) {
+      vx_grad_stencil(&(stack->vols[j]), entry.coor_utm, gcoor, g);
+      g->interpolated = True;
+      return(0);
+    }
+  }
+
+  vx_grad_diff(g, &entry);
+  return(0);
+}
+
+
+/* Query batch */
+int vx_getgrad_batch(vx_grad_t *g, size_t n)
+{
+  size_t i;
+  int retval = 0;
+
+  for (i = 0; i < n; i++) {
+    retval |= vx_getgrad(&(g[i]));
+  }
+  return(retval);
+}
@@ -0,0 +1,57 @@
+#ifndef VX_GRAD_H
+#define VX_GRAD_H
+
+#include <stddef.h>
+#include "vx_sub.h"
+
+/* Half spacing of the central differences of points off the voxets,
+   m */
+#define VX_GRAD_STEP 1.0
+
+
+/* Interpolated properties at a point and their gradients.
+
+   Points read from a voxet are interpolated trilinearly between the
+   eight voxet nodes around them, the gradients coming from the same
+   stencil:
+
+   - The stencil stays in the voxet owning the point as found by
+     vx_getcoord. It does not reach into other voxets across a voxet
+     boundary.
+   - In the outer half cell along a voxet face the values are
+     extended from the face nodes, with zero gradient across the face.
+   - Nodes with no data, or with a tag other than that of the node
+     closest to the point, take the values of the closest node.
+     Properties do not blend across tag boundaries, such as basin
+     sediments and basement, and gradients there see only the nodes
+     on the side of the closest node.
+   - Density follows the interpolated vp as in vx_getcoord.
+
+   GTL (points whose vx_getcoord values differ from their voxet node)
+   and background points are queried with vx_getcoord and
+   differenced centrally over VX_GRAD_STEP along each axis, one sided
+   next to points without data. Air points keep the no data values of
+   vx_getcoord with zero gradients */
+typedef struct vx_grad_t
+{
+  double coor[3];            /* z is elevation */
+  vx_coord_t coor_type;
+  vx_src_t data_src;
+  int interpolated;          /* 1 from a voxet stencil, 0 from differences */
+  double vp;
+  double vs;
+  double rho;
+  double dvp[3];             /* per m along UTM x, y and elevation */
+  double dvs[3];
+  double drho[3];
+} vx_grad_t;
+
+
+/* Query properties and gradients at the point of 'g'. Returns 1 if
+   the point could not be queried, with properties and gradients NaN */
+int vx_getgrad(vx_grad_t *g);
+
+/* Query 'n' points. Returns 1 if any point failed */
+int vx_getgrad_batch(vx_grad_t *g, size_t n);
+
+#endif
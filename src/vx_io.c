@@ -1,6 +1,7 @@
 /** vx_io.c - Voxel IO routines
 
 07/2011: PES: Extracted io into separate module from vx_sub.c
+10/2026: Load volumes in chunks with 64-bit cell counts
 **/
 
 #include <string.h>
@@ -14,6 +15,9 @@
 /* Max number of properties */
 #define VX_MAX_PROP 512
 
+/* Cells read per chunk when loading volumes */
+#define VX_IO_CHUNK 16777216
+
  /* Property state */
 char vx_props[VX_MAX_PROP][CMLEN];
 int vx_num_prop = 0;
@@ -178,14 +182,16 @@ int vx_io_getpropval(char *search, int PNumber, float *val)
 }
 
 
-/* Load voxel volume from disk to memory. Translate endian if necessary */
+/* Load voxel volume from disk to memory. Translate endian if necessary.
+   The volume is read in chunks, each swapped while still in cache */
 int vx_io_loadvolume(const char *data_dir, const char *FN, 
-		     int ESIZE, int ncells, char *buffer)
+		     int ESIZE, size_t ncells, char *buffer)
 { 
   FILE *ifi;
-  int j, retval;
+  size_t i, j, n, retval;
   union zahl l,*h;
   char file_path[CMLEN];
+  int swap;
 
   /* Read in the file */
   sprintf(file_path, "%s/%s", data_dir, FN);
@@ -193,29 +199,34 @@ int vx_io_loadvolume(const char *data_dir, const char *FN,
   if (ifi == NULL) {
     return(1);
   }
-  retval = fread(buffer, ESIZE, ncells, ifi);
-  if (retval != ncells) {
-    fprintf(stderr, "Failed to read %d cells of size %d from %s (read %d)\n", 
-	    ncells, ESIZE, file_path, retval);
-    fclose(ifi);
-    return(1);
-  }
-  fclose(ifi);
 
   /* Voxet files are big endian */
-  if (vx_system_endian() == VX_BYTEORDER_LSB) {
-    /* Swap endian */
-    for (j = 0; j < ncells; j++) {
-      h = (union zahl *)&(buffer[j*ESIZE]);
-      l.c[3]=h->c[0];
-      l.c[2]=h->c[1];
-      l.c[1]=h->c[2];
-      l.c[0]=h->c[3];
-      memcpy(&(buffer[j*ESIZE]), &l, sizeof(union zahl));
+  swap = (vx_system_endian() == VX_BYTEORDER_LSB);
+
+  for (i = 0; i < ncells; i += n) {
+    n = (ncells - i < VX_IO_CHUNK) ? ncells - i : VX_IO_CHUNK;
+    retval = fread(&buffer[i*ESIZE], ESIZE, n, ifi);
+    if (retval != n) {
+      fprintf(stderr, 
+	      "Failed to read %zu cells of size %d from %s (read %zu)\n", 
+	      ncells, ESIZE, file_path, i + retval);
+      fclose(ifi);
+      return(1);
     }
-  }
 
+    if (swap) {
+      /* Swap endian */
+      for (j = i; j < i + n; j++) {
+	h = (union zahl *)&(buffer[j*ESIZE]);
+	l.c[3]=h->c[0];
+	l.c[2]=h->c[1];
+	l.c[1]=h->c[2];
+	l.c[0]=h->c[3];
+	memcpy(&(buffer[j*ESIZE]), &l, sizeof(union zahl));
+      }
+    }
+  }
+  fclose(ifi);
 
   return 0;
 }
-
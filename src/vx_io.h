@@ -32,9 +32,9 @@ int vx_io_getpropsize(char *, int, int *);
 int vx_io_getpropval(char *, int, float *);
 
 
-/* Load voxel volume from disk to memory. Translate 
+/* Load voxel volume of 'ncells' cells from disk to memory. Translate 
    endian if necessary */
-int vx_io_loadvolume(const char *, const char *, int, int, char *);
+int vx_io_loadvolume(const char *, const char *, int, size_t, char *);
 
 
 #endif
@@ -0,0 +1,320 @@
+/** vx_kernel.h - Query kernel template. Included by vx_sub.c once per
+    kernel, with the following macros set to constants so the compiler
+    drops the branches of the configurations the kernel does not serve:
+
+    VX_KERNEL_NAME      function name
+    VX_KERNEL_ENHANCED  True to apply Z mode, background model and GTL
+    VX_KERNEL_ZMODE     vx_zmode_t of the kernel
+    VX_KERNEL_GTL       True if GTL is applied
+    VX_KERNEL_BKG       True if a background model is registered
+
+    A kernel locates the point (UTM coordinates, topo and Z mode),
+    looks it up in the voxet stack and finishes with the background
+    model and GTL. Enhanced kernels also get a batch variant,
+    VX_KERNEL_NAME_batch, that locates a chunk of points, looks them
+    all up with vx_stack_lookup_batch and finishes them in turn.
+
+    The macros are undefined at the end of the template.
+
+10/2026: Initial implementation, split from vx_getcoord_private
+10/2026: Split into locate and finish steps around the stack lookup,
+         added batch variant
+**/
+
+#define VX_KERNEL_LOCATE VX_KERNEL_CAT(VX_KERNEL_NAME, _locate)
+#define VX_KERNEL_FINISH VX_KERNEL_CAT(VX_KERNEL_NAME, _finish)
+#define VX_KERNEL_BATCH VX_KERNEL_CAT(VX_KERNEL_NAME, _batch)
+
+
+/* Locate point. Returns 0 to continue with VX_KERNEL_FINISH, 1 on
+   failure and 2 if the query is complete */
+static inline int VX_KERNEL_LOCATE(vx_entry_t *entry, vx_kernel_state_t *s) {
+  size_t pos;
+  double SP[2],SPUTM[2];
+  int gcoor[3];
+
+  /* Initialize variables */
+  s->do_bkg = False;
+  s->surface = 0.0;
+  s->elev = 0.0;
+  s->depth = 0.0;
+
+  /* Proceed only if setup has been performed */
+  if ((entry == NULL) || (is_setup != True)) {
+    return(1);
+  }
+
+  /* Make copy of original input coordinates */
+  memcpy(s->incoor, entry->coor, sizeof(double) * 3);
+
+  /* Initialize entry structure */
+  vx_init_entry(entry);
+
+  /* Generate UTM coords */
+  switch (entry->coor_type) {
+  case VX_COORD_GEO:
+
+    SP[0]=entry->coor[0];
+    SP[1]=entry->coor[1];
+
+    vx_geo2utm(SP, SPUTM);
+
+    entry->coor_utm[0]=SPUTM[0];
+    entry->coor_utm[1]=SPUTM[1];
+    entry->coor_utm[2]=entry->coor[2];
+    break;
+  case VX_COORD_UTM:
+    entry->coor_utm[0]=entry->coor[0];
+    entry->coor_utm[1]=entry->coor[1];
+    entry->coor_utm[2]=entry->coor[2];
+    break;
+  default:
+    return(1);
+    break;
+  }
+
+  /* Now we have UTM Zone 11 */
+  /*** Prevent all to obvious bad coordinates from being displayed */
+  if (entry->coor_utm[1] >= 10000000) {
+    memcpy(entry->coor, s->incoor, sizeof(double) * 3);
+    return(2);
+  }
+
+  VX_STATS_TIMER(t_topo);
+
+  // we start with the elevations; the voxet does not have a vertical
+  // dimension
+  gcoor[0]=round((entry->coor_utm[0]-to_a.O[0])/step_to[0]);
+  gcoor[1]=round((entry->coor_utm[1]-to_a.O[1])/step_to[1]);
+  gcoor[2]=0;
+
+  //check if inside
+  if(gcoor[0]>=0&&gcoor[1]>=0&&
+     gcoor[0]<to_a.N[0]&&gcoor[1]<to_a.N[1]) {
+    entry->elev_cell[0]= to_a.O[0]+gcoor[0]*step_to[0];
+    entry->elev_cell[1]= to_a.O[1]+gcoor[1]*step_to[1];
+    pos=voxbytepos(gcoor,to_a.N,p4.ESIZE);
+    memcpy(&(entry->topo), &tobuffer[pos], p4.ESIZE);
+    memcpy(&(entry->mtop), &mtopbuffer[pos], p4.ESIZE);
+    memcpy(&(entry->base), &babuffer[pos], p4.ESIZE);
+    memcpy(&(entry->moho), &mobuffer[pos], p4.ESIZE);
+    if (((entry->topo - p0.NO_DATA_VALUE < 0.1) ||
+	 (entry->mtop - p0.NO_DATA_VALUE < 0.1))) {
+      s->do_bkg = True;
+    }
+  } else {
+    s->do_bkg = True;
+  }
+  VX_STATS_STOP(VX_STAGE_TOPO, t_topo);
+
+  /* Convert depth/offset Z coordinate to elevation */
+  if (VX_KERNEL_ENHANCED == True) {
+    s->elev = entry->coor_utm[2];
+    vx_getsurface(entry->coor, entry->coor_type, &(s->surface));
+    if (s->surface < -90000.0) {
+      return(1);
+    }
+    switch (VX_KERNEL_ZMODE) {
+    case VX_ZMODE_ELEV:
+      break;
+    case VX_ZMODE_DEPTH:
+      entry->coor[2] = s->surface - s->elev;
+      entry->coor_utm[2] = entry->coor[2];
+      break;
+    case VX_ZMODE_ELEVOFF:
+      entry->coor[2] = s->surface + s->elev;
+      entry->coor_utm[2] = entry->coor[2];
+      break;
+    default:
+      return(1);
+      break;
+    }
+    s->depth = s->surface - entry->coor_utm[2];
+  }
+
+  /* Points with background data skip the stack */
+  s->cascade = ((s->do_bkg == False) || (VX_KERNEL_BKG != True) ||
+		(VX_KERNEL_ENHANCED != True));
+  return(0);
+}
+
+
+/* Look up located point in the voxet stack, or take the batch lookup
+   'hit' if not NULL, and apply background model and GTL */
+static inline int VX_KERNEL_FINISH(vx_entry_t *entry, vx_kernel_state_t *s,
+				   const vx_kernel_hit_t *hit) {
+  int j;
+  size_t pos;
+  vx_volume_t *vol;
+  int gcoor[3];
+  float mtop;
+  double zt, topo_gap;
+
+  if (s->cascade) {
+    /* AP: this calculates the cell numbers from the coordinates and
+       the grid spacing. The -1 is necessary to do the counting
+       correctly. The rounding is necessary because the data are cell
+       centered, eg. they are valid half a cell width away from the
+       data point */
+    VX_STATS_TIMER(t_cascade);
+
+    /* Extract vp/vs from highest priority voxet */
+    if (hit == NULL) {
+      j = vx_stack_find(&vx_stack, entry->coor_utm, gcoor);
+    } else {
+      j = hit->vol;
+      memcpy(gcoor, hit->gcoor, sizeof(int) * 3);
+    }
+    if (j >= 0) {
+      vol = &(vx_stack.vols[j]);
+      /* AP: And here are the cell centers*/
+      entry->vel_cell[0]= vol->a.O[0]+gcoor[0]*vol->step[0];
+      entry->vel_cell[1]= vol->a.O[1]+gcoor[1]*vol->step[1];
+      entry->vel_cell[2]= vol->a.O[2]+gcoor[2]*vol->step[2];
+      if (hit == NULL) {
+	pos=voxbytepos(gcoor,vol->a.N,vol->vp_p.ESIZE);
+	memcpy(&(entry->provenance), &vol->tag[pos], vol->tag_p.ESIZE);
+	memcpy(&(entry->vp), &vol->vp[pos], vol->vp_p.ESIZE);
+	memcpy(&(entry->vs), &vol->vs[pos], vol->vs_p.ESIZE);
+      } else {
+	entry->provenance = hit->tag;
+	entry->vp = hit->vp;
+	entry->vs = hit->vs;
+      }
+      entry->data_src = vol->src;
+    } else {
+      s->do_bkg = True;
+    }
+    VX_STATS_STOP(VX_STAGE_CASCADE, t_cascade);
+    VX_STATS_COUNT(cascade_hits[entry->data_src]);
+  }
+
+  if ((VX_KERNEL_ENHANCED == True) && (VX_KERNEL_BKG == True) &&
+      (s->do_bkg == True)) {
+    /* background model */
+    VX_STATS_TIMER(t_bkg);
+    j = callback_bkg(entry, VX_REQUEST_ALL);
+    VX_STATS_STOP(VX_STAGE_BKG, t_bkg);
+    if (j != 0) {
+      /* Restore original input coords */
+      memcpy(entry->coor, s->incoor, sizeof(double) * 3);
+      return(1);
+    }
+  } else {
+    /* Compute rho */
+    entry->rho = calc_rho(entry->vp, entry->data_src);
+
+    if ((VX_KERNEL_ENHANCED == True) && (VX_KERNEL_GTL == True) &&
+	(s->do_bkg == False)) {
+
+      /* Compute gap between surface and mtop */
+      vx_model_top(entry->coor, entry->coor_type, &mtop, True);
+      if (mtop - p0.NO_DATA_VALUE > 0.1) {
+	topo_gap = s->surface - mtop;
+      } else {
+	topo_gap = 0.0;
+      }
+
+      /* Requery at fixed zt depth if point below trans zone */
+      zt = gtl_get_adj_transition(topo_gap);
+      if ((entry->coor[2] > s->surface - zt) &&
+	  (entry->coor[2] <= s->surface)) {
+	VX_STATS_COUNT(gtl_requery);
+	entry->coor[2] = s->surface - zt;
+	entry->coor_utm[2] = s->surface - zt;
+	vx_kernel_core(entry);
+	entry->coor[2] = s->elev;
+	entry->coor_utm[2] = s->elev;
+
+	// We are inside core CVM-H model. Apply GTL
+	if (vx_apply_gtl_entry(entry, s->depth, topo_gap) != 0) {
+	  /* Restore original input coords */
+	  memcpy(entry->coor, s->incoor, sizeof(double) * 3);
+	  return(1);
+	}
+      }
+    }
+  }
+
+  /* Restore original input coords */
+  memcpy(entry->coor, s->incoor, sizeof(double) * 3);
+  return(0);
+}
+
+
+/* Query point */
+static int VX_KERNEL_NAME(vx_entry_t *entry) {
+  vx_kernel_state_t s;
+  int retval;
+
+  retval = VX_KERNEL_LOCATE(entry, &s);
+  if (retval != 0) {
+    return(retval == 1);
+  }
+  return(VX_KERNEL_FINISH(entry, &s, NULL));
+}
+
+
+#if VX_KERNEL_ENHANCED == True
+
+/* Query points 'start' to 'end' of evaluation order 'order' (NULL for
+   input order), VX_KERNEL_CHUNK at a time */
+static int VX_KERNEL_BATCH(vx_entry_t *entries, const size_t *order,
+			   size_t start, size_t end) {
+  vx_kernel_state_t s[VX_KERNEL_CHUNK];
+  vx_kernel_hit_t hit;
+  int status[VX_KERNEL_CHUNK], slot[VX_KERNEL_CHUNK];
+  int vol[VX_KERNEL_CHUNK], gcoor[VX_KERNEL_CHUNK * 3];
+  float vp[VX_KERNEL_CHUNK], vs[VX_KERNEL_CHUNK], tag[VX_KERNEL_CHUNK];
+  double utm[VX_KERNEL_CHUNK * 3];
+  vx_entry_t *entry;
+  size_t i, k, m, c;
+  int retval = 0;
+
+  for (i = start; i < end; i += m) {
+    m = ((end - i) < VX_KERNEL_CHUNK) ? (end - i) : VX_KERNEL_CHUNK;
+
+    /* Locate chunk, collecting the points for the stack */
+    c = 0;
+    for (k = 0; k < m; k++) {
+      entry = &(entries[(order != NULL) ? order[i + k] : i + k]);
+      status[k] = VX_KERNEL_LOCATE(entry, &s[k]);
+      slot[k] = -1;
+      if ((status[k] == 0) && s[k].cascade) {
+	memcpy(&utm[c * 3], entry->coor_utm, sizeof(double) * 3);
+	slot[k] = c++;
+      }
+    }
+
+    vx_stack_lookup_batch(&vx_stack, utm, c, vol, gcoor, vp, vs, tag);
+
+    for (k = 0; k < m; k++) {
+      entry = &(entries[(order != NULL) ? order[i + k] : i + k]);
+      if (status[k] != 0) {
+	retval |= (status[k] == 1);
+      } else if (slot[k] < 0) {
+	retval |= VX_KERNEL_FINISH(entry, &s[k], NULL);
+      } else {
+	c = slot[k];
+	hit.vol = vol[c];
+	memcpy(hit.gcoor, &gcoor[c * 3], sizeof(int) * 3);
+	hit.vp = vp[c];
+	hit.vs = vs[c];
+	hit.tag = tag[c];
+	retval |= VX_KERNEL_FINISH(entry, &s[k], &hit);
+      }
+    }
+  }
+  return(retval);
+}
+
+#endif
+
+#undef VX_KERNEL_NAME
+#undef VX_KERNEL_ENHANCED
+#undef VX_KERNEL_ZMODE
+#undef VX_KERNEL_GTL
+#undef VX_KERNEL_BKG
+#undef VX_KERNEL_LOCATE
+#undef VX_KERNEL_FINISH
+#undef VX_KERNEL_BATCH
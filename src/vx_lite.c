@@ -6,6 +6,26 @@
     01/2011: PES: Initial implementation derived from vx.c
     07/2011: PES: Added option for specifying model directory,
                   reorganized options
+    10/2026: Added binary input triplets and packed binary output records
+    10/2026: Added pipelined multi-threaded mode. Points are processed
+             in blocks: a reader thread parses input, worker threads
+             query and format, and the main thread writes blocks in 
+             input order.
+    10/2026: Replaced stdio number parsing and formatting with the
+             locale independent vx_fmt routines. Output is unchanged.
+    10/2026: Added client mode, queries go to a running vx_served
+             with the same model when available.
+    10/2026: Added --stats
+    10/2026: Blocks are queried with vx_getcoord_batch
+    10/2026: Added --order to query blocks along a space-filling curve
+    10/2026: Added --classify to query the points of a block by path
+    10/2026: Added --steal to query large blocks with the work-stealing
+             scheduler
+    10/2026: Added --mem to choose the memory backend of the model
+    10/2026: Added --grid to enumerate the points of a regular grid
+             instead of reading them
+    10/2026: Added --profile to write layered profiles of the columns
+             below the points
 **/
 
 
@@ -14,9 +34,124 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <unistd.h>
 #include <getopt.h>
+#include <pthread.h>
 #include "params.h"
+#include "utils.h"
 #include "vx_sub.h"
+#include "vx_rec.h"
+#include "vx_queue.h"
+#include "vx_fmt.h"
+#include "vx_serve.h"
+#include "vx_stats.h"
+#include "vx_sched.h"
+#include "vx_site.h"
+
+
+/* Default number of points per block */
+#define VX_LITE_BLOCK 4096
+
+/* Default depth of input and output block queues */
+#define VX_LITE_QDEPTH 4
+
+/* Size of text input buffer */
+#define VX_LITE_INBUF 1048576
+
+/* Initial bytes of text output reserved per point */
+#define VX_LITE_LINE 256
+
+/* Size of statistics report */
+#define VX_LITE_STATS 8192
+
+/* Size of scheduler report */
+#define VX_LITE_SCHED 32768
+
+/* Max decimals of grid coordinates rounded like parsed text */
+#define VX_LITE_DECIMALS 9
+
+/* Initial number of layers of a profile */
+#define VX_LITE_LAYERS 1024
+
+
+/* Regular grid of points, enumerated with x outermost and z innermost
+   as written by scripts/grid/makegrid.sh. Each column of z values
+   shares its x, y position */
+typedef struct vx_lite_grid_t 
+{
+  double min[3];
+  double step[3];
+  size_t dims[3];
+  double scale[3];           /* 10^decimals of the spec, 0 for none */
+  size_t num_points;
+  size_t next;
+} vx_lite_grid_t;
+
+
+/* Input stream */
+typedef struct vx_lite_input_t 
+{
+  FILE *fp;
+  int esize;                 /* 0 for text, 4/8 for binary triplets */
+  vx_byteorder_t byteorder;
+  char *buf;
+  size_t len;
+  size_t pos;
+  int eof;
+  vx_lite_grid_t *grid;      /* points generated from grid, or NULL */
+} vx_lite_input_t;
+
+
+/* Block of points */
+typedef struct vx_lite_block_t 
+{
+  long seq;
+  size_t n;
+  double *xyz;
+  vx_entry_t *entries;
+  vx_serve_point_t *points;
+  char *out;
+  size_t outlen;
+  size_t outcap;
+} vx_lite_block_t;
+
+
+/* Pipeline state */
+typedef struct vx_lite_pipe_t 
+{
+  vx_lite_input_t *in;
+  size_t blocksize;
+  int num_blocks;
+  vx_queue_t free_q;
+  vx_queue_t work_q;
+  vx_lite_block_t **done;    /* finished blocks, slot seq % num_blocks */
+  long num_read;
+  int read_done;
+  pthread_mutex_t done_lock;
+  pthread_cond_t done_cond;
+} vx_lite_pipe_t;
+
+
+/* Work-stealing state, the chunks are views into one block */
+typedef struct vx_lite_steal_t 
+{
+  vx_lite_block_t *chunks;
+  size_t num_chunks;
+  vx_sched_report_t report;  /* totals over all blocks */
+} vx_lite_steal_t;
+
+
+/* Binary output layout, NULL for text output */
+static vx_rec_layout_t *out_layout = NULL;
+
+/* Query settings */
+static vx_zmode_t query_zmode = VX_ZMODE_ELEVOFF;
+static int query_flags = VX_SERVE_GTL;
+
+/* vx_served socket and model directory, when a server is used */
+static int use_server = False;
+static char server_path[VX_SERVE_MAX_PATH];
+static char modeldir[CMLEN];
 
 
 /* Usage function */
@@ -25,14 +160,64 @@ void usage() {
   printf("Extract velocities from a simple GOCAD voxet. Accepts\n");
   printf("geographic coordinates and UTM Zone 11, NAD27 coordinates in\n");
   printf("X Y Z columns. Z is expressed as elevation offset by default.\n\n");
-  printf("\tusage: vx_lite [-g] [-s] [-m dir] [-z dep/elev/off] < file.in\n\n");
+  printf("\tusage: vx_lite [-g] [-s] [-m dir] [-z dep/elev/off] [-i f32/f64] [-o fields] [-e lsb/msb/native] [-t threads] [-q in,out] [-b points] [-n] [-p socket] [--order curve] [--classify] [--steal] [--mem backend] [--grid spec] [--profile vtol[,dtol]] [--stats] < file.in\n\n");
   printf("Flags:\n");
   printf("\t-g disable GTL (default is on).\n");
   printf("\t-s directs use of SCEC 1D background and topo.\n");
   printf("\t-m directory containing model files (default is '.').\n");
-  printf("\t-z directs use of dep/elev/off for Z column (default is offset).\n\n");
+  printf("\t-z directs use of dep/elev/off for Z column (default is offset).\n");
+  printf("\t-i reads binary X Y Z triplets of type f32 or f64 instead of text.\n");
+  printf("\t-o writes binary records holding the comma separated fields\n");
+  printf("\t   (or 'all') instead of text. Fields are named after the\n");
+  printf("\t   output columns: x y z utm_x utm_y elev_x elev_y topo mtop\n");
+  printf("\t   base moho src cell_x cell_y cell_z tg vp vs rho.\n");
+  printf("\t-e byte order of binary input and output (default is lsb).\n");
+  printf("\t-t number of query threads. With more than one thread, input\n");
+  printf("\t   is read, queried and written by separate pipeline stages.\n");
+  printf("\t   Output is identical to a serial run (default is 1).\n");
+  printf("\t-q depth of the input and output block queues (default is 4,4).\n");
+  printf("\t-b number of points per block (default is 4096).\n");
+  printf("\t-n never use vx_served. By default, queries are sent to a\n");
+  printf("\t   running vx_served that has the same model loaded.\n");
+  printf("\t-p vx_served socket path, fail if no server is listening\n");
+  printf("\t   (default is $%s or /tmp/vx_served.<uid>.sock).\n",
+	 VX_SERVE_ENV);
+  printf("\t--order none/morton/hilbert, query the points of each block\n");
+  printf("\t   along a space-filling curve when they are not already\n");
+  printf("\t   coherent. Helps scattered inputs with large blocks (-b).\n");
+  printf("\t   Output order is unchanged (default is none).\n");
+  printf("\t--classify query the points of each block grouped by path\n");
+  printf("\t   (core, GTL, background, air, none). Output is unchanged.\n");
+  printf("\t--steal with -t, query each block in chunks of %d points\n",
+	 VX_SCHED_CHUNK);
+  printf("\t   spread over the threads by estimated cost, idle threads\n");
+  printf("\t   taking chunks from busy ones. Suits large blocks (-b) with\n");
+  printf("\t   uneven cost. --stats adds per-thread utilisation.\n");
+  printf("\t--mem comma separated memory backend options of the model\n");
+  printf("\t   buffers: thp or huge pages, lock, prefault, interleave\n");
+  printf("\t   over NUMA nodes (default is none). --stats reports the\n");
+  printf("\t   options obtained.\n");
+  printf("\t--grid x1,x2,dx,y1,y2,dy,z1,z2,dz query the points of a\n");
+  printf("\t   regular grid instead of reading them, from x1 to x2 by dx\n");
+  printf("\t   and likewise for y and z, in geographic or UTM coordinates.\n");
+  printf("\t   Points are enumerated and written like the nested loops of\n");
+  printf("\t   scripts/grid/makegrid.sh, z varying fastest.\n");
+  printf("\t--profile vtol[,dtol] write the layered profile of the column\n");
+  printf("\t   below each point down to its Z depth instead of the point.\n");
+  printf("\t   Voxet cells give exact layers, equal layers are merged and\n");
+  printf("\t   GTL and background stretches are cut into layers over which\n");
+  printf("\t   vp and vs change by at most vtol m/s, no thinner than dtol m\n");
+  printf("\t   (default is %.1f). Layer lines are X Y top vp vs rho tg,\n",
+	 VX_SITE_TOL);
+  printf("\t   top in m below the surface. Runs on one thread without\n");
+  printf("\t   vx_served.\n");
+  printf("\t--stats print query timers and hit counters to stderr\n");
+  printf("\t   (requires a build configured with --enable-stats).\n\n");
   printf("Output format is:\n");
   printf("\tX Y Z utmX utmY elevX elevY topo mtop base moho hr/lr/cm cellX cellY cellZ tg vp vs rho\n\n");
+  printf("Binary output starts with a text header terminated by a line\n");
+  printf("'end', listing byte order, record size and field name/type/offset.\n");
+  printf("One record is written per input point.\n\n");
   printf("Version: %s\n\n", VERSION);
   exit (0);
 }
@@ -40,31 +225,967 @@ void usage() {
 extern char *optarg;
 extern int optind, opterr, optopt;
 
+/* Long options */
+static struct option long_options[] = {
+  {"stats", no_argument, NULL, 'S'},
+  {"order", required_argument, NULL, 'O'},
+  {"classify", no_argument, NULL, 'C'},
+  {"steal", no_argument, NULL, 'W'},
+  {"mem", required_argument, NULL, 'M'},
+  {"grid", required_argument, NULL, 'G'},
+  {"profile", required_argument, NULL, 'P'},
+  {NULL, 0, NULL, 0}
+};
+
+
+/* Set coordinate type from the magnitude of the input values */
+void set_coord_type(vx_entry_t *entry)
+{
+  /* In case we got anything like degrees */
+  if ((entry->coor[0]<360.) && (fabs(entry->coor[1])<90)) {
+    entry->coor_type = VX_COORD_GEO;
+  } else {
+    entry->coor_type = VX_COORD_UTM;
+  }
+}
+
+
+/* Refill text input buffer, keeping any unparsed bytes. Returns 1 if
+   the buffer is full with a single token */
+int input_fill(vx_lite_input_t *in)
+{
+  size_t got;
+
+  if (in->pos > 0) {
+    memmove(in->buf, &(in->buf[in->pos]), in->len - in->pos);
+    in->len -= in->pos;
+    in->pos = 0;
+  }
+  if (in->len == VX_LITE_INBUF) {
+    return(1);
+  }
+
+  got = fread(&(in->buf[in->len]), 1, VX_LITE_INBUF - in->len, in->fp);
+  in->len += got;
+  in->buf[in->len] = '\0';
+  if (got == 0) {
+    in->eof = True;
+  }
+  return(0);
+}
+
+
+/* Whitespace as accepted by fscanf */
+int is_space(char c)
+{
+  return((c == ' ') || (c == '\n') || (c == '\t') || (c == '\r') ||
+	 (c == '\v') || (c == '\f'));
+}
+
+
+/* Parse next whitespace separated value from text input. Returns 0 
+   at end of input */
+int input_next_value(vx_lite_input_t *in, double *val)
+{
+  size_t e, used;
+  char *end;
+  char c;
+
+  while (1) {
+    while ((in->pos < in->len) && is_space(in->buf[in->pos])) {
+      in->pos++;
+    }
+    if (in->pos == in->len) {
+      if (in->eof) {
+	return(0);
+      }
+      input_fill(in);
+      continue;
+    }
+
+    /* Make sure the whole token is in the buffer */
+    e = in->pos;
+    while ((e < in->len) && !is_space(in->buf[e])) {
+      e++;
+    }
+    if ((e == in->len) && (!in->eof) && (input_fill(in) == 0)) {
+      continue;
+    }
+
+    c = in->buf[e];
+    in->buf[e] = '\0';
+    *val = vx_parse_double(&(in->buf[in->pos]), &end);
+    in->buf[e] = c;
+    used = end - &(in->buf[in->pos]);
+    in->pos = e;
+    if (used > 0) {
+      return(1);
+    }
+  }
+}
+
+
+/* Parse grid spec x1,x2,dx,y1,y2,dy,z1,z2,dz. Returns 1 if invalid */
+int grid_parse(const char *spec, vx_lite_grid_t *grid)
+{
+  const char *p = spec;
+  char *end;
+  double v[9];
+  int i, k, decimals, max_decimals;
+
+  memset(grid, 0, sizeof(vx_lite_grid_t));
+  grid->num_points = 1;
+  for (k = 0; k < 3; k++) {
+    max_decimals = 0;
+    for (i = k * 3; i < k * 3 + 3; i++) {
+      v[i] = vx_parse_double(p, &end);
+      if ((end == p) || (*end != ((i < 8) ? ',' : '\0'))) {
+	return(1);
+      }
+
+      /* Decimals of the value as written, none with an exponent */
+      decimals = 0;
+      while ((p < end) && (*p != '.') && (*p != 'e') && (*p != 'E')) {
+	p++;
+      }
+      if (*p == '.') {
+	for (p++; (p < end) && (*p >= '0') && (*p <= '9'); p++) {
+	  decimals++;
+	}
+      }
+      if ((p < end) || (decimals > VX_LITE_DECIMALS)) {
+	max_decimals = -1;
+      } else if ((max_decimals >= 0) && (decimals > max_decimals)) {
+	max_decimals = decimals;
+      }
+      p = end + 1;
+    }
+
+    /* Same count of values as seq x1 dx x2 */
+    if ((v[k * 3 + 2] == 0.0) || !isfinite(v[k * 3]) ||
+	!isfinite(v[k * 3 + 1]) || !isfinite(v[k * 3 + 2]) ||
+	((v[k * 3 + 1] - v[k * 3]) / v[k * 3 + 2] < 0.0)) {
+      return(1);
+    }
+    grid->min[k] = v[k * 3];
+    grid->step[k] = v[k * 3 + 2];
+    grid->dims[k] = (size_t)floor((v[k * 3 + 1] - v[k * 3]) / 
+				  v[k * 3 + 2] + 1.0e-9) + 1;
+    grid->scale[k] = (max_decimals >= 0) ? pow(10.0, max_decimals) : 0.0;
+    grid->num_points *= grid->dims[k];
+  }
+  return(0);
+}
+
+
+/* Coordinate 'i' along grid axis 'k'. Values are rounded to the
+   decimals of the spec so they equal the parsed text of the grid */
+double grid_coord(const vx_lite_grid_t *grid, int k, size_t i)
+{
+  double v = grid->min[k] + i * grid->step[k];
+
+  if ((grid->scale[k] > 0.0) && (fabs(v * grid->scale[k]) < 1.0e15)) {
+    v = round(v * grid->scale[k]) / grid->scale[k];
+  }
+  return(v);
+}
+
+
+/* Generate up to 'cap' grid points into block */
+size_t grid_read(vx_lite_grid_t *grid, double *xyz, size_t cap)
+{
+  size_t n, i, ix, iy, iz;
+
+  if (cap > grid->num_points - grid->next) {
+    cap = grid->num_points - grid->next;
+  }
+  iz = grid->next % grid->dims[2];
+  iy = (grid->next / grid->dims[2]) % grid->dims[1];
+  ix = grid->next / grid->dims[2] / grid->dims[1];
+  for (n = 0; n < cap; ) {
+    xyz[n * 3] = grid_coord(grid, 0, ix);
+    xyz[n * 3 + 1] = grid_coord(grid, 1, iy);
+    for (i = n; (i < cap) && (iz < grid->dims[2]); i++, iz++) {
+      xyz[i * 3] = xyz[n * 3];
+      xyz[i * 3 + 1] = xyz[n * 3 + 1];
+      xyz[i * 3 + 2] = grid_coord(grid, 2, iz);
+    }
+    n = i;
+    if (iz == grid->dims[2]) {
+      iz = 0;
+      if (++iy == grid->dims[1]) {
+	iy = 0;
+	ix++;
+      }
+    }
+  }
+  grid->next += n;
+  return(n);
+}
+
+
+/* Read up to 'cap' points into block. Returns number of points read */
+size_t read_block(vx_lite_input_t *in, vx_lite_block_t *blk, size_t cap)
+{
+  size_t n = 0;
+  double *xyz;
+
+  if (in->grid != NULL) {
+    n = grid_read(in->grid, blk->xyz, cap);
+  } else if (in->esize > 0) {
+    n = vx_rec_read_coords(in->fp, in->esize, in->byteorder, 
+			   blk->xyz, cap);
+  } else {
+    while (n < cap) {
+      xyz = &(blk->xyz[n*3]);
+      if ((input_next_value(in, &xyz[0]) == 0) ||
+	  (input_next_value(in, &xyz[1]) == 0) ||
+	  (input_next_value(in, &xyz[2]) == 0)) {
+	break;
+      }
+      n++;
+    }
+  }
+
+  blk->n = n;
+  return(n);
+}
+
+
+/* Make room for 'len' more bytes of block output */
+void block_reserve(vx_lite_block_t *blk, size_t len)
+{
+  char *out;
+  size_t cap = blk->outcap;
+
+  while (blk->outlen + len > cap) {
+    cap = cap * 2;
+  }
+  if (cap != blk->outcap) {
+    out = realloc(blk->out, cap);
+    if (out == NULL) {
+      fprintf(stderr, "Failed to grow output buffer\n");
+      exit(1);
+    }
+    blk->out = out;
+    blk->outcap = cap;
+  }
+}
+
+
+/* Append value formatted as "%<width>.<prec>f" and a separator */
+void block_fixed(vx_lite_block_t *blk, double val, int width, int prec, 
+		 char sep)
+{
+  block_reserve(blk, VX_FMT_MAX_LEN + 2);
+  blk->outlen += vx_fmt_fixed(&(blk->out[blk->outlen]), val, width, prec);
+  blk->out[blk->outlen++] = sep;
+}
+
+
+/* Append string and a separator */
+void block_string(vx_lite_block_t *blk, const char *str, char sep)
+{
+  size_t len = strlen(str);
+
+  block_reserve(blk, len + 2);
+  memcpy(&(blk->out[blk->outlen]), str, len);
+  blk->outlen += len;
+  blk->out[blk->outlen++] = sep;
+}
+
+
+/* Connect to vx_served. Returns socket or -1 */
+int server_connect()
+{
+  int fd;
+
+  fd = vx_serve_connect(server_path);
+  if ((fd >= 0) && (vx_serve_hello(fd, modeldir) != 0)) {
+    close(fd);
+    fd = -1;
+  }
+  return(fd);
+}
+
+
+/* Query all points in block, through vx_served if 'fd' is a server 
+   connection */
+void query_block(vx_lite_block_t *blk, int fd)
+{
+  vx_entry_t *entry;
+  size_t i, n;
+
+  for (i = 0; i < blk->n; i++) {
+    entry = &(blk->entries[i]);
+    memcpy(entry->coor, &(blk->xyz[i*3]), sizeof(double) * 3);
+    set_coord_type(entry);
+    if (fd >= 0) {
+      memcpy(blk->points[i].coor, entry->coor, sizeof(double) * 3);
+      blk->points[i].coor_type = entry->coor_type;
+    }
+  }
+
+  /* Query the points, in requests the server accepts */
+  if (fd < 0) {
+    vx_getcoord_batch(blk->entries, blk->n);
+    return;
+  }
+  for (i = 0; i < blk->n; i += n) {
+    n = blk->n - i;
+    if (n > VX_SERVE_MAX_POINTS) {
+      n = VX_SERVE_MAX_POINTS;
+    }
+    if (vx_serve_query(fd, query_zmode, query_flags, &(blk->points[i]), n,
+		       &(blk->entries[i])) != 0) {
+      fprintf(stderr, "Query to vx_served failed\n");
+      exit(1);
+    }
+  }
+}
+
+
+/* Query all points in block and format results. Text columns match
+   the original printf formats exactly */
+void process_block(vx_lite_block_t *blk, int fd)
+{
+  vx_entry_t *entry;
+  double *xyz;
+  size_t i;
+
+  query_block(blk, fd);
+
+  blk->outlen = 0;
+  for (i = 0; i < blk->n; i++) {
+    xyz = &(blk->xyz[i*3]);
+    entry = &(blk->entries[i]);
+
+    if (out_layout != NULL) {
+      vx_rec_pack(out_layout, entry, 
+		  &(blk->out[i * out_layout->record_size]));
+      continue;
+    }
+
+    if (xyz[1]<10000000) {
+      /* "%14.6f %15.6f %9.2f " */
+      block_fixed(blk, xyz[0], 14, 6, ' ');
+      block_fixed(blk, xyz[1], 15, 6, ' ');
+      block_fixed(blk, xyz[2], 9, 2, ' ');
+    }
+
+    /*** Prevent all to obvious bad coordinates from being displayed */
+    if (entry->coor[1]<10000000) {
+      /* AP: Let's provide the computed UTM coordinates as well */
+      block_fixed(blk, entry->coor_utm[0], 10, 2, ' ');
+      block_fixed(blk, entry->coor_utm[1], 11, 2, ' ');
+      block_fixed(blk, entry->elev_cell[0], 10, 2, ' ');
+      block_fixed(blk, entry->elev_cell[1], 11, 2, ' ');
+      block_fixed(blk, entry->topo, 9, 2, ' ');
+      block_fixed(blk, entry->mtop, 9, 2, ' ');
+      block_fixed(blk, entry->base, 9, 2, ' ');
+      block_fixed(blk, entry->moho, 9, 2, ' ');
+      block_string(blk, VX_SRC_NAMES[entry->data_src], ' ');
+      block_fixed(blk, entry->vel_cell[0], 10, 2, ' ');
+      block_fixed(blk, entry->vel_cell[1], 11, 2, ' ');
+      block_fixed(blk, entry->vel_cell[2], 9, 2, ' ');
+      block_fixed(blk, entry->provenance, 9, 2, ' ');
+      block_fixed(blk, entry->vp, 9, 2, ' ');
+      block_fixed(blk, entry->vs, 9, 2, ' ');
+      block_fixed(blk, entry->rho, 9, 2, '\n');
+    }
+  }
+
+  if (out_layout != NULL) {
+    blk->outlen = blk->n * out_layout->record_size;
+  }
+}
+
+
+/* Write block output to stdout */
+void write_block(vx_lite_block_t *blk)
+{
+  if (fwrite(blk->out, 1, blk->outlen, stdout) != blk->outlen) {
+    fprintf(stderr, "Failed to write output\n");
+    exit(1);
+  }
+}
+
+
+/* Free block */
+void block_free(vx_lite_block_t *blk)
+{
+  if (blk != NULL) {
+    free(blk->xyz);
+    free(blk->entries);
+    free(blk->points);
+    free(blk->out);
+    free(blk);
+  }
+}
+
+
+/* Allocate block for 'cap' points */
+vx_lite_block_t *block_new(size_t cap)
+{
+  vx_lite_block_t *blk;
+
+  blk = malloc(sizeof(vx_lite_block_t));
+  if (blk == NULL) {
+    return(NULL);
+  }
+  if (out_layout != NULL) {
+    blk->outcap = cap * out_layout->record_size;
+  } else {
+    blk->outcap = cap * VX_LITE_LINE;
+  }
+  blk->xyz = malloc(cap * 3 * sizeof(double));
+  blk->entries = malloc(cap * sizeof(vx_entry_t));
+  blk->points = malloc(cap * sizeof(vx_serve_point_t));
+  blk->out = malloc(blk->outcap);
+  if ((blk->xyz == NULL) || (blk->entries == NULL) || 
+      (blk->points == NULL) || (blk->out == NULL)) {
+    block_free(blk);
+    return(NULL);
+  }
+  blk->seq = 0;
+  blk->n = 0;
+  blk->outlen = 0;
+  return(blk);
+}
+
+
+/* Process all input on the calling thread */
+int run_serial(vx_lite_input_t *in, size_t blocksize, int fd)
+{
+  vx_lite_block_t *blk;
+
+  blk = block_new(blocksize);
+  if (blk == NULL) {
+    fprintf(stderr, "Failed to allocate block\n");
+    return(1);
+  }
+
+  while (read_block(in, blk, blocksize) > 0) {
+    process_block(blk, fd);
+    write_block(blk);
+  }
+
+  block_free(blk);
+  return(0);
+}
+
+
+/* Write the layered profiles of the columns below all input points
+   on the calling thread. The Z value of a point is the profile bottom
+   depth. Points outside the model get one layer of no data values */
+int run_profile(vx_lite_input_t *in, size_t blocksize,
+		const vx_site_opts_t *opts)
+{
+  vx_lite_block_t *blk;
+  vx_site_opts_t o;
+  vx_site_t site;
+  vx_layer_t *layers, *more;
+  double *xyz;
+  size_t i;
+  int cap = VX_LITE_LAYERS, n, k;
+
+  blk = block_new(blocksize);
+  layers = malloc(cap * sizeof(vx_layer_t));
+  if ((blk == NULL) || (layers == NULL)) {
+    fprintf(stderr, "Failed to allocate block\n");
+    block_free(blk);
+    free(layers);
+    return(1);
+  }
+  memcpy(&o, opts, sizeof(vx_site_opts_t));
+
+  while (read_block(in, blk, blocksize) > 0) {
+    blk->outlen = 0;
+    for (i = 0; i < blk->n; i++) {
+      xyz = &(blk->xyz[i*3]);
+      memset(&site, 0, sizeof(vx_site_t));
+      site.coor[0] = xyz[0];
+      site.coor[1] = xyz[1];
+      if ((xyz[0]<360.) && (fabs(xyz[1])<90)) {
+	site.coor_type = VX_COORD_GEO;
+      } else {
+	site.coor_type = VX_COORD_UTM;
+      }
+      o.max_depth = xyz[2];
+
+      n = vx_site_profile(&site, &o, layers, cap);
+      if (n > cap) {
+	more = realloc(layers, n * sizeof(vx_layer_t));
+	if (more == NULL) {
+	  fprintf(stderr, "Failed to grow profile\n");
+	  exit(1);
+	}
+	layers = more;
+	cap = n;
+	n = vx_site_profile(&site, &o, layers, cap);
+      }
+      if (n <= 0) {
+	memset(layers, 0, sizeof(vx_layer_t));
+	layers[0].vp = layers[0].vs = layers[0].rho = -99999.0;
+	n = 1;
+      }
+
+      for (k = 0; k < n; k++) {
+	block_fixed(blk, xyz[0], 14, 6, ' ');
+	block_fixed(blk, xyz[1], 15, 6, ' ');
+	block_fixed(blk, layers[k].top, 10, 3, ' ');
+	block_fixed(blk, layers[k].vp, 9, 2, ' ');
+	block_fixed(blk, layers[k].vs, 9, 2, ' ');
+	block_fixed(blk, layers[k].rho, 9, 2, ' ');
+	block_fixed(blk, layers[k].provenance, 9, 2, '\n');
+      }
+    }
+    write_block(blk);
+  }
+
+  free(layers);
+  block_free(blk);
+  return(0);
+}
+
+
+/* Reader stage: fill free blocks from input */
+void *pipe_reader(void *arg)
+{
+  vx_lite_pipe_t *pipe = (vx_lite_pipe_t *)arg;
+  vx_lite_block_t *blk;
+  long seq = 0;
+
+  while ((blk = vx_queue_pop(&(pipe->free_q))) != NULL) {
+    if (read_block(pipe->in, blk, pipe->blocksize) == 0) {
+      vx_queue_push(&(pipe->free_q), blk);
+      break;
+    }
+    blk->seq = seq++;
+    vx_queue_push(&(pipe->work_q), blk);
+  }
+
+  vx_queue_close(&(pipe->work_q));
+
+  pthread_mutex_lock(&(pipe->done_lock));
+  pipe->num_read = seq;
+  pipe->read_done = True;
+  pthread_cond_signal(&(pipe->done_cond));
+  pthread_mutex_unlock(&(pipe->done_lock));
+  return(NULL);
+}
+
+
+/* Query stage: process blocks in any order */
+void *pipe_worker(void *arg)
+{
+  vx_lite_pipe_t *pipe = (vx_lite_pipe_t *)arg;
+  vx_lite_block_t *blk;
+  int fd = -1;
+
+  /* Each worker uses its own server connection */
+  if (use_server) {
+    fd = server_connect();
+    if (fd < 0) {
+      fprintf(stderr, "Failed to connect to vx_served\n");
+      exit(1);
+    }
+  }
+
+  while ((blk = vx_queue_pop(&(pipe->work_q))) != NULL) {
+    process_block(blk, fd);
+    pthread_mutex_lock(&(pipe->done_lock));
+    pipe->done[blk->seq % pipe->num_blocks] = blk;
+    pthread_cond_signal(&(pipe->done_cond));
+    pthread_mutex_unlock(&(pipe->done_lock));
+  }
+
+  if (fd >= 0) {
+    close(fd);
+  }
+  return(NULL);
+}
+
+
+/* Process input with a reader thread, 'num_threads' query threads and 
+   the calling thread writing finished blocks in input order. At most
+   qin blocks wait to be queried and qout finished blocks wait to be
+   written. Since a block is only returned to the free pool once it is
+   written, at most num_blocks sequence numbers are in flight and each
+   maps to a distinct slot of the done array. */
+int run_pipeline(vx_lite_input_t *in, size_t blocksize, int num_threads, 
+		 int qin, int qout)
+{
+  vx_lite_pipe_t pipe;
+  vx_lite_block_t *blk, **blocks;
+  pthread_t reader;
+  pthread_t *workers;
+  long next = 0;
+  int i, num_started = 0, have_reader = False, retval = 0;
+
+  memset(&pipe, 0, sizeof(vx_lite_pipe_t));
+  pipe.in = in;
+  pipe.blocksize = blocksize;
+  pipe.num_blocks = qin + num_threads + qout;
+  pipe.num_read = 0;
+  pipe.read_done = False;
+  pthread_mutex_init(&(pipe.done_lock), NULL);
+  pthread_cond_init(&(pipe.done_cond), NULL);
+
+  /* Blocks are owned here and freed on exit wherever they are queued */
+  pipe.done = calloc(pipe.num_blocks, sizeof(vx_lite_block_t *));
+  blocks = calloc(pipe.num_blocks, sizeof(vx_lite_block_t *));
+  workers = malloc(num_threads * sizeof(pthread_t));
+  if ((pipe.done == NULL) || (blocks == NULL) || (workers == NULL) ||
+      (vx_queue_init(&(pipe.free_q), pipe.num_blocks) != 0) ||
+      (vx_queue_init(&(pipe.work_q), qin) != 0)) {
+    fprintf(stderr, "Failed to allocate pipeline\n");
+    retval = 1;
+    goto done;
+  }
+
+  for (i = 0; i < pipe.num_blocks; i++) {
+    blocks[i] = block_new(blocksize);
+    if (blocks[i] == NULL) {
+      fprintf(stderr, "Failed to allocate block\n");
+      retval = 1;
+      goto done;
+    }
+    vx_queue_push(&(pipe.free_q), blocks[i]);
+  }
+
+  /* Start stages */
+  if (pthread_create(&reader, NULL, pipe_reader, &pipe) != 0) {
+    fprintf(stderr, "Failed to start reader thread\n");
+    retval = 1;
+    goto done;
+  }
+  have_reader = True;
+  for (num_started = 0; num_started < num_threads; num_started++) {
+    if (pthread_create(&workers[num_started], NULL, pipe_worker,
+		       &pipe) != 0) {
+      fprintf(stderr, "Failed to start query thread\n");
+      retval = 1;
+      goto done;
+    }
+  }
+
+  /* Write blocks in order */
+  while (1) {
+    pthread_mutex_lock(&(pipe.done_lock));
+    while ((pipe.done[next % pipe.num_blocks] == NULL) &&
+	   !((pipe.read_done) && (next == pipe.num_read))) {
+      pthread_cond_wait(&(pipe.done_cond), &(pipe.done_lock));
+    }
+    blk = pipe.done[next % pipe.num_blocks];
+    pipe.done[next % pipe.num_blocks] = NULL;
+    pthread_mutex_unlock(&(pipe.done_lock));
+    if (blk == NULL) {
+      break;
+    }
+
+    write_block(blk);
+    next++;
+    vx_queue_push(&(pipe.free_q), blk);
+  }
+
+ done:
+  /* Closed queues end the stages still running */
+  if (retval != 0) {
+    if (pipe.free_q.items != NULL) {
+      vx_queue_close(&(pipe.free_q));
+    }
+    if (pipe.work_q.items != NULL) {
+      vx_queue_close(&(pipe.work_q));
+    }
+  }
+  if (have_reader) {
+    pthread_join(reader, NULL);
+  }
+  for (i = 0; i < num_started; i++) {
+    pthread_join(workers[i], NULL);
+  }
+
+  /* Release blocks */
+  if (blocks != NULL) {
+    for (i = 0; i < pipe.num_blocks; i++) {
+      block_free(blocks[i]);
+    }
+  }
+  if (pipe.free_q.items != NULL) {
+    vx_queue_free(&(pipe.free_q));
+  }
+  if (pipe.work_q.items != NULL) {
+    vx_queue_free(&(pipe.work_q));
+  }
+  pthread_mutex_destroy(&(pipe.done_lock));
+  pthread_cond_destroy(&(pipe.done_cond));
+  free(pipe.done);
+  free(blocks);
+  free(workers);
+
+  return(retval);
+}
+
+
+/* Scheduler task: query and format one chunk */
+int steal_chunk(size_t task, void *arg)
+{
+  vx_lite_steal_t *st = (vx_lite_steal_t *)arg;
+
+  process_block(&(st->chunks[task]), -1);
+  return(0);
+}
+
+
+/* Add scheduler report of one block to totals */
+void steal_report_add(vx_sched_report_t *total, const vx_sched_report_t *r)
+{
+  int i;
+
+  if (r->num_threads > total->num_threads) {
+    total->num_threads = r->num_threads;
+  }
+  total->num_tasks += r->num_tasks;
+  total->wall_s += r->wall_s;
+  for (i = 0; i < r->num_threads; i++) {
+    total->threads[i].tasks += r->threads[i].tasks;
+    total->threads[i].steals += r->threads[i].steals;
+    total->threads[i].seeded_cost += r->threads[i].seeded_cost;
+    total->threads[i].busy_s += r->threads[i].busy_s;
+  }
+}
+
+
+/* Process input in blocks, each queried by 'num_threads' threads in
+   chunks with work stealing. Input is read and output written between
+   blocks, so blocks should be large */
+int run_steal(vx_lite_input_t *in, size_t blocksize, int num_threads,
+	      vx_sched_report_t *report)
+{
+  vx_lite_block_t *blk, *chunk;
+  vx_lite_steal_t st;
+  vx_sched_report_t r;
+  double *cost;
+  size_t i, cap, n;
+  int retval = 0;
+
+  memset(&st, 0, sizeof(vx_lite_steal_t));
+  st.num_chunks = (blocksize + VX_SCHED_CHUNK - 1) / VX_SCHED_CHUNK;
+  blk = block_new(blocksize);
+  st.chunks = calloc(st.num_chunks, sizeof(vx_lite_block_t));
+  cost = malloc(st.num_chunks * sizeof(double));
+  if ((blk == NULL) || (st.chunks == NULL) || (cost == NULL)) {
+    fprintf(stderr, "Failed to allocate block\n");
+    retval = 1;
+    goto done;
+  }
+
+  /* Chunks share the block input and entries, and own their output */
+  for (i = 0; i < st.num_chunks; i++) {
+    chunk = &(st.chunks[i]);
+    chunk->xyz = &(blk->xyz[i * VX_SCHED_CHUNK * 3]);
+    chunk->entries = &(blk->entries[i * VX_SCHED_CHUNK]);
+    chunk->points = &(blk->points[i * VX_SCHED_CHUNK]);
+    cap = (out_layout != NULL) ? out_layout->record_size : VX_LITE_LINE;
+    chunk->outcap = VX_SCHED_CHUNK * cap;
+    chunk->out = malloc(chunk->outcap);
+    if (chunk->out == NULL) {
+      fprintf(stderr, "Failed to allocate block\n");
+      retval = 1;
+      goto done;
+    }
+  }
+
+  while ((n = read_block(in, blk, blocksize)) > 0) {
+    /* Estimate chunk costs from the point types and paths */
+    for (i = 0; i < n; i++) {
+      memcpy(blk->entries[i].coor, &(blk->xyz[i*3]), sizeof(double) * 3);
+      set_coord_type(&(blk->entries[i]));
+    }
+    st.num_chunks = (n + VX_SCHED_CHUNK - 1) / VX_SCHED_CHUNK;
+    for (i = 0; i < st.num_chunks; i++) {
+      chunk = &(st.chunks[i]);
+      chunk->n = (i + 1 < st.num_chunks) ? VX_SCHED_CHUNK :
+	n - i * VX_SCHED_CHUNK;
+      cost[i] = vx_sched_cost(chunk->entries, chunk->n);
+    }
+
+    vx_sched_run(st.num_chunks, num_threads, cost, steal_chunk, &st, &r);
+    steal_report_add(&(st.report), &r);
+
+    for (i = 0; i < st.num_chunks; i++) {
+      write_block(&(st.chunks[i]));
+    }
+  }
+
+ done:
+  if (report != NULL) {
+    memcpy(report, &(st.report), sizeof(vx_sched_report_t));
+  }
+  if (st.chunks != NULL) {
+    n = (blocksize + VX_SCHED_CHUNK - 1) / VX_SCHED_CHUNK;
+    for (i = 0; i < n; i++) {
+      free(st.chunks[i].out);
+    }
+  }
+  free(st.chunks);
+  free(cost);
+  block_free(blk);
+  return(retval);
+}
+
 
 int main (int argc, char *argv[])
 {
-  vx_entry_t entry;
-  char modeldir[CMLEN];
   vx_zmode_t zmode;
   int use_gtl = True;
   int use_scec = False;
   int opt;
+  char *out_fields = NULL;
+  vx_byteorder_t byteorder = VX_BYTEORDER_LSB;
+  vx_rec_layout_t layout;
+  vx_lite_input_t in;
+  vx_lite_grid_t grid;
+  int num_threads = 1;
+  int qin = VX_LITE_QDEPTH;
+  int qout = VX_LITE_QDEPTH;
+  long blocksize = VX_LITE_BLOCK;
+  int no_server = False;
+  int show_stats = False;
+  vx_order_t order = VX_ORDER_NONE;
+  int use_classify = False;
+  int use_steal = False;
+  int use_mem = False;
+  vx_mem_opts_t mem;
+  vx_mem_report_t mem_report;
+  vx_stats_t stats;
+  char stats_text[VX_LITE_STATS];
+  vx_sched_report_t *report = NULL;
+  vx_site_opts_t profile;
+  int use_profile = False;
+  char *sched_text = NULL;
+  char *path = NULL;
+  int fd = -1;
+  int retval = 0;
   
   zmode = VX_ZMODE_ELEVOFF;
   strcpy(modeldir, ".");
 
+  memset(&in, 0, sizeof(vx_lite_input_t));
+  in.fp = stdin;
+  memset(&mem, 0, sizeof(vx_mem_opts_t));
+  vx_site_defaults(&profile);
+
   /* Parse options */
-  while ((opt = getopt(argc, argv, "gm:sz:h")) != -1) {
+  while ((opt = getopt_long(argc, argv, "b:e:gi:m:no:p:q:st:z:h", 
+			    long_options, NULL)) != -1) {
     switch (opt) {
+    case 'b':
+      blocksize = atol(optarg);
+      if (blocksize < 1) {
+	fprintf(stderr, "Invalid block size %s\n", optarg);
+	usage();
+	exit(1);
+      }
+      break;
+    case 'C':
+      use_classify = True;
+      break;
+    case 'e':
+      if (vx_rec_parse_byteorder(optarg, &byteorder) != 0) {
+	fprintf(stderr, "Invalid byte order %s\n", optarg);
+	usage();
+	exit(1);
+      }
+      break;
+    case 'G':
+      if (grid_parse(optarg, &grid) != 0) {
+	fprintf(stderr, "Invalid grid %s\n", optarg);
+	usage();
+	exit(1);
+      }
+      in.grid = &grid;
+      break;
     case 'g':
       use_gtl = False;
       break;
+    case 'i':
+      if (strcasecmp(optarg, "f32") == 0) {
+	in.esize = 4;
+      } else if (strcasecmp(optarg, "f64") == 0) {
+	in.esize = 8;
+      } else {
+	fprintf(stderr, "Invalid input type %s\n", optarg);
+	usage();
+	exit(1);
+      }
+      break;
     case 'm':
       strcpy(modeldir, optarg);
       break;
+    case 'M':
+      if (vx_mem_parse(optarg, &mem) != 0) {
+	fprintf(stderr, "Invalid memory backend %s\n", optarg);
+	usage();
+	exit(1);
+      }
+      use_mem = True;
+      break;
+    case 'n':
+      no_server = True;
+      break;
+    case 'o':
+      out_fields = optarg;
+      break;
+    case 'O':
+      if (vx_order_parse(optarg, &order) != 0) {
+	fprintf(stderr, "Invalid order %s\n", optarg);
+	usage();
+	exit(1);
+      }
+      break;
+    case 'p':
+      path = optarg;
+      break;
+    case 'P':
+      if ((sscanf(optarg, "%lf,%lf", &profile.vel_tol, &profile.tol) < 1) ||
+	  !(profile.vel_tol > 0.0) || !(profile.tol > 0.0)) {
+	fprintf(stderr, "Invalid profile tolerance %s\n", optarg);
+	usage();
+	exit(1);
+      }
+      use_profile = True;
+      break;
+    case 'q':
+      if (sscanf(optarg, "%d,%d", &qin, &qout) < 1) {
+	qin = 0;
+      } else if (strchr(optarg, ',') == NULL) {
+	qout = qin;
+      }
+      if ((qin < 1) || (qout < 1)) {
+	fprintf(stderr, "Invalid queue depth %s\n", optarg);
+	usage();
+	exit(1);
+      }
+      break;
     case 's':
       use_scec = True;
       break;
+    case 'S':
+      show_stats = True;
+      break;
+    case 't':
+      num_threads = atoi(optarg);
+      if (num_threads < 1) {
+	fprintf(stderr, "Invalid thread count %s\n", optarg);
+	usage();
+	exit(1);
+      }
+      break;
+    case 'W':
+      use_steal = True;
+      break;
     case 'z':
       if (strcasecmp(optarg, "dep") == 0) {
 	zmode = VX_ZMODE_DEPTH;
@@ -88,65 +1209,139 @@ int main (int argc, char *argv[])
     }
   }
 
-  /* Perform setup */
-  if (vx_setup(modeldir) != 0) {
-    fprintf(stderr, "Failed to init vx\n");
+  in.byteorder = byteorder;
+  if ((in.grid != NULL) && (in.esize > 0)) {
+    fprintf(stderr, "Options --grid and -i are exclusive\n");
+    exit(1);
+  }
+  if (use_profile && (out_fields != NULL)) {
+    fprintf(stderr, "Options --profile and -o are exclusive\n");
+    exit(1);
+  }
+  if (use_steal && (num_threads < 2)) {
+    fprintf(stderr, "Option --steal requires -t with more than one thread\n");
     exit(1);
   }
+  if (use_profile) {
+    no_server = True;
+  }
+  if (out_fields != NULL) {
+    if (vx_rec_parse_fields(out_fields, byteorder, &layout) != 0) {
+      fprintf(stderr, "Invalid output field list %s\n", out_fields);
+      exit(1);
+    }
+    out_layout = &layout;
+  }
+  if ((in.esize == 0) && (in.grid == NULL)) {
+    in.buf = malloc(VX_LITE_INBUF + 1);
+    if (in.buf == NULL) {
+      fprintf(stderr, "Failed to allocate input buffer\n");
+      exit(1);
+    }
+    in.buf[0] = '\0';
+  }
+
+  query_zmode = zmode;
+  query_flags = (use_gtl ? VX_SERVE_GTL : 0) | (use_scec ? VX_SERVE_SCEC : 0);
+
+  /* Use a running vx_served holding the same model if there is one */
+  if (!no_server) {
+    if (vx_serve_socket_path(path, server_path) != 0) {
+      fprintf(stderr, "Socket path too long\n");
+      exit(1);
+    }
+    fd = server_connect();
+    if (fd >= 0) {
+      use_server = True;
+    } else if (path != NULL) {
+      fprintf(stderr, "No vx_served for %s on %s\n", modeldir, path);
+      exit(1);
+    }
+  }
 
-  /* Register SCEC 1D background model */
-  if (use_scec) {
-    vx_register_scec();
+  /* The server holds the model with its own settings */
+  if (use_server && ((order != VX_ORDER_NONE) || use_classify || use_mem ||
+		     use_steal)) {
+    fprintf(stderr, "Using vx_served, ignoring%s%s%s%s (use -n to query "
+	    "locally)\n", ((order != VX_ORDER_NONE) ? " --order" : ""),
+	    (use_classify ? " --classify" : ""), (use_mem ? " --mem" : ""),
+	    (use_steal ? " --steal" : ""));
   }
 
-  /* Set GTL */
-  vx_setgtl(use_gtl);
+  if (!use_server) {
+    /* Perform setup */
+    vx_setmem(&mem);
+    if (vx_setup(modeldir) != 0) {
+      fprintf(stderr, "Failed to init vx\n");
+      exit(1);
+    }
 
-  /* Set zmode */
-  vx_setzmode(zmode);
+    /* Register SCEC 1D background model */
+    if (use_scec) {
+      vx_register_scec();
+    }
 
-  /* now let's start with searching .... */
-  while (!feof(stdin)) {
-    if (fscanf(stdin,"%lf %lf %lf",
-	       &entry.coor[0],&entry.coor[1],&entry.coor[2]) == 3) {
+    /* Set GTL */
+    vx_setgtl(use_gtl);
 
-      if (entry.coor[1]<10000000) {
-	printf("%14.6f %15.6f %9.2f ", 
-	       entry.coor[0], entry.coor[1], entry.coor[2]);
-      }
+    /* Set zmode */
+    vx_setzmode(zmode);
 
-      /* In case we got anything like degrees */
-      if ((entry.coor[0]<360.) && (fabs(entry.coor[1])<90)) {
-	entry.coor_type = VX_COORD_GEO;
-      } else {
-	entry.coor_type = VX_COORD_UTM;
-      }
+    /* Set batch ordering and classification */
+    vx_setorder(order);
+    vx_setclassify(use_classify);
+  }
 
-      /* Query the point */
-      vx_getcoord(&entry);
+  /* now let's start with searching .... */
+  if ((out_layout != NULL) && (vx_rec_write_header(stdout, out_layout) != 0)) {
+    fprintf(stderr, "Failed to write record header\n");
+    exit(1);
+  }
+  if (use_profile) {
+    retval = run_profile(&in, blocksize, &profile);
+  } else if ((num_threads > 1) && use_steal && !use_server) {
+    report = calloc(1, sizeof(vx_sched_report_t));
+    if (report == NULL) {
+      fprintf(stderr, "Failed to allocate scheduler report\n");
+      exit(1);
+    }
+    retval = run_steal(&in, blocksize, num_threads, report);
+  } else if (num_threads > 1) {
+    retval = run_pipeline(&in, blocksize, num_threads, qin, qout);
+  } else {
+    retval = run_serial(&in, blocksize, fd);
+  }
 
-      /*** Prevent all to obvious bad coordinates from being displayed */
-      if (entry.coor[1]<10000000) {
-	//printf("%14.6f %15.6f %9.2f ", 
-	//       entry.coor[0], entry.coor[1], entry.coor[2]);
-	/* AP: Let's provide the computed UTM coordinates as well */
-	printf("%10.2f %11.2f ", entry.coor_utm[0], entry.coor_utm[1]);
-	
-	printf("%10.2f %11.2f ", entry.elev_cell[0], entry.elev_cell[1]);
-	printf("%9.2f ", entry.topo);
-	printf("%9.2f ", entry.mtop);
-	printf("%9.2f ", entry.base);
-	printf("%9.2f ", entry.moho);
-	printf("%s %10.2f %11.2f %9.2f ", VX_SRC_NAMES[entry.data_src], 
-	       entry.vel_cell[0], entry.vel_cell[1], entry.vel_cell[2]);
-	printf("%9.2f %9.2f %9.2f ", entry.provenance, entry.vp, entry.vs);
-	printf("%9.2f\n", entry.rho);
+  if (show_stats) {
+    if (use_server) {
+      fprintf(stderr, "Queries were answered by vx_served, "
+	      "see vx_served -x stats\n");
+    } else {
+      vx_get_stats(&stats);
+      vx_stats_text(&stats, stats_text, sizeof(stats_text));
+      fputs(stats_text, stderr);
+      vx_get_mem_report(&mem_report);
+      vx_mem_text(&mem_report, stats_text, sizeof(stats_text));
+      fputs(stats_text, stderr);
+    }
+    if (report != NULL) {
+      sched_text = malloc(VX_LITE_SCHED);
+      if (sched_text != NULL) {
+	vx_sched_text(report, sched_text, VX_LITE_SCHED);
+	fputs(sched_text, stderr);
+	free(sched_text);
       }
     }
   }
+  free(report);
 
   /* Perform cleanup */
-  vx_cleanup();
+  if (use_server) {
+    close(fd);
+  } else {
+    vx_cleanup();
+  }
+  free(in.buf);
 
-  return 0;
+  return retval;
 }
@@ -0,0 +1,436 @@
+/** vx_mem.c - Memory backends for model buffers. Buffers can be
+    backed by transparent or explicit huge pages, locked, prefaulted
+    and interleaved over NUMA nodes. Each option degrades to the
+    default when the system refuses it, and the report tells what was
+    actually obtained.
+
+10/2026: Initial implementation
+**/
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "vx_stats.h"
+#include "vx_mem.h"
+
+/* Interleave policy of mbind, numaif.h is not always installed */
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+
+/* Max length of a line of /proc/self/smaps */
+#define VX_MEM_LINE 512
+
+
+/* Names, indexed by vx_mem_pages_t and vx_mem_numa_t */
+char *VX_MEM_PAGES_NAMES[VX_MEM_PAGES_NUM] = {"default", "thp", "huge"};
+char *VX_MEM_NUMA_NAMES[VX_MEM_NUMA_NUM] = {"none", "interleave"};
+
+
+/* Mapped buffer. THP buffers are mapped between two inaccessible
+   guard pages, so that their VMAs never merge with neighbours and
+   smaps reports the huge pages of each buffer alone */
+typedef struct vx_mem_buf_t
+{
+  char *ptr;
+  size_t size;               /* requested length */
+  size_t len;                /* usable mapped length */
+  char *map;                 /* mapping, with guard pages */
+  size_t map_len;
+  vx_mem_pages_t pages;
+  unsigned long long huge;   /* huge page bytes of the last smaps scan */
+  struct vx_mem_buf_t *next;
+} vx_mem_buf_t;
+
+
+/* Options, report and mapped buffers */
+static vx_mem_opts_t vx_mem_opts;
+static vx_mem_report_t vx_mem_report;
+static vx_mem_buf_t *vx_mem_bufs = NULL;
+static pthread_mutex_t vx_mem_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* Parse options */
+int vx_mem_parse(const char *spec, vx_mem_opts_t *opts)
+{
+  char item[32];
+  const char *p = spec, *end;
+  size_t len;
+
+  memset(opts, 0, sizeof(vx_mem_opts_t));
+  while (*p != '\0') {
+    end = strchr(p, ',');
+    len = (end == NULL) ? strlen(p) : (size_t)(end - p);
+    if (len >= sizeof(item)) {
+      return(1);
+    }
+    memcpy(item, p, len);
+    item[len] = '\0';
+
+    if (strcasecmp(item, "none") == 0) {
+      memset(opts, 0, sizeof(vx_mem_opts_t));
+    } else if (strcasecmp(item, "thp") == 0) {
+      opts->pages = VX_MEM_PAGES_THP;
+    } else if (strcasecmp(item, "huge") == 0) {
+      opts->pages = VX_MEM_PAGES_HUGE;
+    } else if (strcasecmp(item, "lock") == 0) {
+      opts->lock = 1;
+    } else if (strcasecmp(item, "prefault") == 0) {
+      opts->prefault = 1;
+    } else if (strcasecmp(item, "interleave") == 0) {
+      opts->numa = VX_MEM_NUMA_INTERLEAVE;
+    } else {
+      return(1);
+    }
+    p += len;
+    if (*p == ',') {
+      p++;
+    }
+  }
+  return(0);
+}
+
+
+/* Read online NUMA nodes into 'mask'. Returns number of nodes */
+static int vx_mem_read_nodes(unsigned long *mask)
+{
+  FILE *fp;
+  char line[VX_MEM_LINE];
+  char *p, *end;
+  long lo, hi, i;
+  int n = 0;
+
+  *mask = 0;
+  fp = fopen("/sys/devices/system/node/online", "r");
+  if (fp == NULL) {
+    return(1);
+  }
+  if (fgets(line, sizeof(line), fp) != NULL) {
+    p = line;
+    while (1) {
+      lo = strtol(p, &end, 10);
+      if (end == p) {
+	break;
+      }
+      hi = lo;
+      if (*end == '-') {
+	p = end + 1;
+	hi = strtol(p, &end, 10);
+      }
+      for (i = lo; (i <= hi) && (i < VX_MEM_MAX_NODES); i++) {
+	*mask |= 1UL << i;
+	n++;
+      }
+      if (*end != ',') {
+	break;
+      }
+      p = end + 1;
+    }
+  }
+  fclose(fp);
+  return((n > 0) ? n : 1);
+}
+
+
+/* Number of online NUMA nodes */
+int vx_mem_numa_nodes()
+{
+  unsigned long mask;
+
+  return(vx_mem_read_nodes(&mask));
+}
+
+
+/* Set options and reset report */
+void vx_mem_set(const vx_mem_opts_t *opts)
+{
+  pthread_mutex_lock(&vx_mem_lock);
+  vx_mem_opts = *opts;
+  memset(&vx_mem_report, 0, sizeof(vx_mem_report_t));
+  vx_mem_report.requested = *opts;
+  vx_mem_report.got = *opts;
+  vx_mem_report.numa_nodes = vx_mem_numa_nodes();
+
+  /* One node has nothing to spread */
+  if (vx_mem_report.numa_nodes < 2) {
+    vx_mem_report.got.numa = VX_MEM_NUMA_NONE;
+  }
+  pthread_mutex_unlock(&vx_mem_lock);
+}
+
+
+/* Map 'len' bytes of 'buf' backed by 'pages', downgraded when
+   refused. THP mappings are aligned to the huge page size and guarded */
+static int vx_mem_map(vx_mem_buf_t *buf, size_t len, vx_mem_pages_t *pages)
+{
+  char *base, *ptr;
+  size_t lead, guard = sysconf(_SC_PAGESIZE);
+
+#ifdef MAP_HUGETLB
+  if (*pages == VX_MEM_PAGES_HUGE) {
+    ptr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+	       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED) {
+      buf->ptr = buf->map = ptr;
+      buf->map_len = len;
+      return(0);
+    }
+  }
+#endif
+  if (*pages == VX_MEM_PAGES_HUGE) {
+    *pages = VX_MEM_PAGES_THP;
+  }
+
+#ifdef MADV_HUGEPAGE
+  if (*pages == VX_MEM_PAGES_THP) {
+    base = mmap(NULL, len + VX_MEM_HUGE_SIZE + 2 * guard,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+      return(1);
+    }
+    ptr = (char *)(((uintptr_t)base + guard + VX_MEM_HUGE_SIZE - 1) &
+		   ~(uintptr_t)(VX_MEM_HUGE_SIZE - 1));
+    lead = ptr - guard - base;
+    if (lead > 0) {
+      munmap(base, lead);
+    }
+    munmap(ptr + len + guard, VX_MEM_HUGE_SIZE - lead);
+    mprotect(ptr - guard, guard, PROT_NONE);
+    mprotect(ptr + len, guard, PROT_NONE);
+    buf->ptr = ptr;
+    buf->map = ptr - guard;
+    buf->map_len = len + 2 * guard;
+    if (madvise(ptr, len, MADV_HUGEPAGE) != 0) {
+      *pages = VX_MEM_PAGES_DEFAULT;
+    }
+    return(0);
+  }
+#endif
+  *pages = VX_MEM_PAGES_DEFAULT;
+
+  ptr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) {
+    return(1);
+  }
+  buf->ptr = buf->map = ptr;
+  buf->map_len = len;
+  return(0);
+}
+
+
+/* Allocate buffer */
+void *vx_mem_alloc(size_t len)
+{
+  vx_mem_buf_t *buf;
+  vx_mem_pages_t pages = vx_mem_opts.pages;
+  void *ptr;
+  unsigned long mask;
+  unsigned long long t0, t_fault = 0;
+  size_t i, page, maplen;
+  int nodes, numa = VX_MEM_NUMA_NONE, locked = 0;
+
+  if ((pages == VX_MEM_PAGES_DEFAULT) && (!vx_mem_opts.lock) &&
+      (!vx_mem_opts.prefault) && (vx_mem_opts.numa == VX_MEM_NUMA_NONE)) {
+    ptr = malloc(len);
+    if (ptr != NULL) {
+      pthread_mutex_lock(&vx_mem_lock);
+      vx_mem_report.buffers++;
+      vx_mem_report.bytes += len;
+      pthread_mutex_unlock(&vx_mem_lock);
+    }
+    return(ptr);
+  }
+
+  buf = malloc(sizeof(vx_mem_buf_t));
+  if (buf == NULL) {
+    return(NULL);
+  }
+  page = sysconf(_SC_PAGESIZE);
+  if (pages != VX_MEM_PAGES_DEFAULT) {
+    page = VX_MEM_HUGE_SIZE;
+  }
+  maplen = (len + page - 1) / page * page;
+  if (maplen == 0) {
+    maplen = page;
+  }
+  if (vx_mem_map(buf, maplen, &pages) != 0) {
+    free(buf);
+    return(NULL);
+  }
+  buf->size = len;
+  buf->len = maplen;
+  buf->pages = pages;
+  buf->huge = 0;
+
+  /* Spread pages over the nodes before they are faulted in */
+#ifdef SYS_mbind
+  if (vx_mem_opts.numa != VX_MEM_NUMA_NONE) {
+    nodes = vx_mem_read_nodes(&mask);
+    if ((nodes > 1) &&
+	(syscall(SYS_mbind, buf->ptr, maplen, MPOL_INTERLEAVE, &mask,
+		 VX_MEM_MAX_NODES + 1, 0) == 0)) {
+      numa = VX_MEM_NUMA_INTERLEAVE;
+    }
+  }
+#endif
+
+  if (vx_mem_opts.prefault) {
+    t0 = vx_stats_now();
+    for (i = 0; i < maplen; i += sysconf(_SC_PAGESIZE)) {
+      ((volatile char *)buf->ptr)[i] = 0;
+    }
+    t_fault = vx_stats_now() - t0;
+  }
+  if (vx_mem_opts.lock) {
+    locked = (mlock(buf->ptr, maplen) == 0);
+  }
+
+  pthread_mutex_lock(&vx_mem_lock);
+  buf->next = vx_mem_bufs;
+  vx_mem_bufs = buf;
+  vx_mem_report.buffers++;
+  vx_mem_report.bytes += len;
+  vx_mem_report.prefault_ns += t_fault;
+  if (pages == VX_MEM_PAGES_HUGE) {
+    vx_mem_report.huge_bytes += len;
+  }
+  if (locked) {
+    vx_mem_report.locked_bytes += maplen;
+  } else {
+    vx_mem_report.got.lock = 0;
+  }
+  if (pages < vx_mem_report.got.pages) {
+    vx_mem_report.got.pages = pages;
+  }
+  if (numa < (int)vx_mem_report.got.numa) {
+    vx_mem_report.got.numa = numa;
+  }
+  pthread_mutex_unlock(&vx_mem_lock);
+
+  return(buf->ptr);
+}
+
+
+/* Free buffer */
+void vx_mem_free(void *ptr)
+{
+  vx_mem_buf_t **prev, *buf;
+
+  if (ptr == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&vx_mem_lock);
+  for (prev = &vx_mem_bufs; *prev != NULL; prev = &((*prev)->next)) {
+    if ((*prev)->ptr == ptr) {
+      break;
+    }
+  }
+  buf = *prev;
+  if (buf != NULL) {
+    *prev = buf->next;
+  }
+  pthread_mutex_unlock(&vx_mem_lock);
+
+  if (buf == NULL) {
+    free(ptr);
+    return;
+  }
+  munmap(buf->map, buf->map_len);
+  free(buf);
+}
+
+
+/* Bytes of THP buffers backed by huge pages, from /proc/self/smaps.
+   Only VMAs inside a buffer count, each buffer at most its size */
+static unsigned long long vx_mem_thp_bytes()
+{
+  FILE *fp;
+  char line[VX_MEM_LINE];
+  vx_mem_buf_t *buf, *cur = NULL;
+  unsigned long start, end;
+  unsigned long long kb, total = 0;
+
+  fp = fopen("/proc/self/smaps", "r");
+  if (fp == NULL) {
+    return(0);
+  }
+  for (buf = vx_mem_bufs; buf != NULL; buf = buf->next) {
+    buf->huge = 0;
+  }
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+      for (cur = vx_mem_bufs; cur != NULL; cur = cur->next) {
+	if ((cur->pages == VX_MEM_PAGES_THP) &&
+	    ((unsigned long)cur->ptr <= start) &&
+	    ((unsigned long)cur->ptr + cur->len >= end)) {
+	  break;
+	}
+      }
+    } else if ((cur != NULL) &&
+	       (sscanf(line, "AnonHugePages: %llu kB", &kb) == 1)) {
+      cur->huge += kb * 1024;
+    }
+  }
+  fclose(fp);
+
+  for (buf = vx_mem_bufs; buf != NULL; buf = buf->next) {
+    total += (buf->huge < buf->size) ? buf->huge : buf->size;
+  }
+  return(total);
+}
+
+
+/* Report on allocations */
+void vx_mem_get_report(vx_mem_report_t *report)
+{
+  pthread_mutex_lock(&vx_mem_lock);
+  *report = vx_mem_report;
+  report->huge_bytes += vx_mem_thp_bytes();
+  pthread_mutex_unlock(&vx_mem_lock);
+}
+
+
+/* Format report */
+int vx_mem_text(const vx_mem_report_t *report, char *buf, size_t len)
+{
+  const vx_mem_opts_t *o;
+  size_t n = 0;
+  int i;
+
+  if (len == 0) {
+    return(0);
+  }
+  buf[0] = '\0';
+
+  for (i = 0; i < 2; i++) {
+    o = (i == 0) ? &(report->requested) : &(report->got);
+    n += snprintf(&buf[n], (n < len) ? len - n : 0,
+		  "memory %-9s pages %-7s lock %d prefault %d numa %s\n",
+		  (i == 0) ? "requested" : "got",
+		  VX_MEM_PAGES_NAMES[o->pages], o->lock, o->prefault,
+		  VX_MEM_NUMA_NAMES[o->numa]);
+    if (n > len) {
+      n = len;
+    }
+  }
+  n += snprintf(&buf[n], (n < len) ? len - n : 0,
+		"memory buffers %llu bytes %llu huge_bytes %llu "
+		"locked_bytes %llu prefault_s %.6f numa_nodes %d\n",
+		report->buffers, report->bytes, report->huge_bytes,
+		report->locked_bytes, report->prefault_ns * 1.0e-9,
+		report->numa_nodes);
+  if (n > len) {
+    n = len;
+  }
+  return(n);
+}
@@ -0,0 +1,81 @@
+#ifndef VX_MEM_H
+#define VX_MEM_H
+
+#include <stddef.h>
+
+/* Huge page size used for alignment and rounding */
+#define VX_MEM_HUGE_SIZE (2UL << 20)
+
+/* Max NUMA nodes used for interleaving */
+#define VX_MEM_MAX_NODES 64
+
+
+/* Page backing of model buffers */
+typedef enum { VX_MEM_PAGES_DEFAULT = 0,
+	       VX_MEM_PAGES_THP,
+	       VX_MEM_PAGES_HUGE } vx_mem_pages_t;
+
+#define VX_MEM_PAGES_NUM 3
+
+/* NUMA placement of model buffers. Queries read a single copy of the
+   model, so buffers are interleaved rather than replicated per node */
+typedef enum { VX_MEM_NUMA_NONE = 0,
+	       VX_MEM_NUMA_INTERLEAVE } vx_mem_numa_t;
+
+#define VX_MEM_NUMA_NUM 2
+
+extern char *VX_MEM_PAGES_NAMES[VX_MEM_PAGES_NUM];
+extern char *VX_MEM_NUMA_NAMES[VX_MEM_NUMA_NUM];
+
+
+/* Memory backend options */
+typedef struct vx_mem_opts_t
+{
+  vx_mem_pages_t pages;
+  int lock;                  /* mlock buffers */
+  int prefault;              /* fault all pages in at allocation */
+  vx_mem_numa_t numa;
+} vx_mem_opts_t;
+
+
+/* What the backend got for the buffers allocated since the last
+   reset. A feature is only reported in 'got' if every buffer got it */
+typedef struct vx_mem_report_t
+{
+  vx_mem_opts_t requested;
+  vx_mem_opts_t got;
+  unsigned long long buffers;
+  unsigned long long bytes;
+  unsigned long long huge_bytes;     /* bytes backed by hugetlb or THP
+					pages, counted per buffer */
+  unsigned long long locked_bytes;
+  unsigned long long prefault_ns;
+  int numa_nodes;
+} vx_mem_report_t;
+
+
+/* Parse comma separated list of thp, huge, lock, prefault, interleave,
+   or 'none'. Returns 1 if an item is unknown */
+int vx_mem_parse(const char *spec, vx_mem_opts_t *opts);
+
+/* Set options of later allocations and reset the report */
+void vx_mem_set(const vx_mem_opts_t *opts);
+
+/* Allocate 'len' bytes with the current options. Default options
+   allocate with malloc, counted in the report */
+void *vx_mem_alloc(size_t len);
+
+/* Free buffer from vx_mem_alloc or malloc */
+void vx_mem_free(void *ptr);
+
+/* Report on allocations since the last vx_mem_set. THP backing is
+   measured when called */
+void vx_mem_get_report(vx_mem_report_t *report);
+
+/* Number of online NUMA nodes */
+int vx_mem_numa_nodes();
+
+/* Format report as text. Returns length */
+int vx_mem_text(const vx_mem_report_t *report, char *buf, size_t len);
+
+#endif
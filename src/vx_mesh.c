@@ -0,0 +1,854 @@
+/** vx_mesh.c - Triangle mesh loaders for GOCAD TSurf and GTS surface
+    files, used by the surface distance queries.
+
+10/2026: Initial implementation
+10/2026: Triangulated interfaces of the model interfaces.vo voxet
+10/2026: Checksums of mesh files for cache keys
+10/2026: Streaming TSurf converter to mapped binary meshes
+**/
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <libgen.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "params.h"
+#include "vx_io.h"
+#include "vx_fmt.h"
+#include "vx_mesh.h"
+#include "utils.h"
+
+
+/* TSurf parser callbacks, each returns 1 on failure. 'vertex' gives
+   the mesh index of a new vertex */
+typedef struct vx_mesh_ts_cb_t
+{
+  int (*vertex)(void *arg, const double *xyz, uint32_t *index);
+  int (*tri)(void *arg, const uint32_t *v);
+  void *arg;
+} vx_mesh_ts_cb_t;
+
+
+/* Array capacities of a mesh being loaded */
+typedef struct vx_mesh_load_t
+{
+  vx_mesh_t *mesh;
+  size_t vcap;
+  size_t tcap;
+} vx_mesh_load_t;
+
+
+/* Binary mesh magic and byte order mark */
+#define VX_MESH_MAGIC "VXMESH1"
+#define VX_MESH_ORDER 0x01020304
+
+/* Initial slots of the converter vertex hash */
+#define VX_MESH_SLOTS 4096
+
+
+/* Binary mesh header, followed by the triangles and, 8 byte aligned,
+   the vertices */
+typedef struct vx_mesh_header_t
+{
+  char magic[8];
+  uint32_t order;
+  uint32_t reserved;
+  uint64_t num_verts;
+  uint64_t num_tris;
+  uint64_t verts_offset;
+  uint64_t pad[3];
+} vx_mesh_header_t;
+
+
+/* Converter state. Vertices are hashed by cell of size 'tol', or by
+   their exact coordinates, and chained per cell through 'next' */
+typedef struct vx_mesh_conv_state_t
+{
+  FILE *fp;
+  double tol;
+  double *verts;
+  uint32_t *next;            /* next vertex of the cell + 1 */
+  size_t vcap;
+  size_t ncap;
+  int64_t *keys;             /* 3 per slot */
+  uint32_t *heads;           /* first vertex of the slot cell + 1 */
+  size_t num_slots;
+  size_t used_slots;
+  vx_mesh_conv_t stats;
+} vx_mesh_conv_state_t;
+
+
+/* Interface names, in interfaces.vo property order */
+char *VX_MESH_IFACE_NAMES[VX_MESH_IFACE_NUM] = {"topo", "base", "moho"};
+
+
+/* Grow array '*arr' of 'elem' byte elements to hold 'need' elements */
+static int vx_mesh_grow(void **arr, size_t *cap, size_t need, size_t elem)
+{
+  void *p;
+  size_t n = *cap;
+
+  if (need <= n) {
+    return(0);
+  }
+  if (n < 1024) {
+    n = 1024;
+  }
+  while (n < need) {
+    n *= 2;
+  }
+  p = realloc(*arr, n * elem);
+  if (p == NULL) {
+    return(1);
+  }
+  *arr = p;
+  *cap = n;
+  return(0);
+}
+
+
+/* Read line, dropping the rest of lines longer than the buffer.
+   Returns 0 at end of file */
+static int vx_mesh_getline(FILE *fp, char *line)
+{
+  size_t len;
+  int c;
+
+  if (fgets(line, VX_MESH_LINE, fp) == NULL) {
+    return(0);
+  }
+  len = strlen(line);
+  if ((len > 0) && (line[len - 1] != '\n')) {
+    while (((c = fgetc(fp)) != EOF) && (c != '\n')) {
+    }
+  }
+  return(1);
+}
+
+
+/* Parse up to 'n' numbers from 'str'. Returns number parsed */
+static int vx_mesh_numbers(const char *str, double *val, int n)
+{
+  char *end;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    while ((*str == ' ') || (*str == '\t')) {
+      str++;
+    }
+    val[i] = vx_parse_double(str, &end);
+    if (end == str) {
+      break;
+    }
+    str = end;
+  }
+  return(i);
+}
+
+
+/* Load mesh by file extension */
+int vx_mesh_load(const char *path, vx_mesh_t *mesh)
+{
+  const char *ext = strrchr(path, '.');
+  char vo[CMLEN];
+  int i;
+
+  if ((ext != NULL) && (strncasecmp(ext, ".vo:", 4) == 0)) {
+    for (i = 0; i < VX_MESH_IFACE_NUM; i++) {
+      if (strcasecmp(&ext[4], VX_MESH_IFACE_NAMES[i]) == 0) {
+	snprintf(vo, CMLEN, "%.*s", (int)(ext + 3 - path), path);
+	return(vx_mesh_load_voxet(vo, (vx_mesh_iface_t)i, mesh));
+      }
+    }
+    fprintf(stderr, "Unknown interface %s\n", &ext[4]);
+    return(1);
+  }
+  if ((ext != NULL) && (strcasecmp(ext, ".gts") == 0)) {
+    return(vx_mesh_load_gts(path, mesh));
+  }
+  if ((ext != NULL) && (strcasecmp(ext, ".vxm") == 0)) {
+    return(vx_mesh_map(path, mesh));
+  }
+  return(vx_mesh_load_ts(path, mesh));
+}
+
+
+/* Stream GOCAD TSurf through 'cb', counting bytes read in '*bytes' */
+static int vx_mesh_parse_ts(const char *path, vx_mesh_ts_cb_t *cb,
+			    size_t *bytes)
+{
+  FILE *fp;
+  char line[VX_MESH_LINE];
+  char *p;
+  double val[4];
+  uint32_t tri[3], index;
+  size_t mcap = 0, num_ids = 0;
+  size_t i, id, *ids = NULL;
+  int k, depth = 0, retval = 0;
+
+  fp = fopen(path, "r");
+  if (fp == NULL) {
+    fprintf(stderr, "Failed to open mesh %s\n", path);
+    return(1);
+  }
+
+  while ((retval == 0) && vx_mesh_getline(fp, line)) {
+    p = line;
+    while ((*p == ' ') || (*p == '\t')) {
+      p++;
+    }
+
+    if ((strncmp(p, "VRTX", 4) == 0) || (strncmp(p, "PVRTX", 5) == 0)) {
+      /* Vertex id and position */
+      p += (p[0] == 'P') ? 5 : 4;
+      if (vx_mesh_numbers(p, val, 4) != 4) {
+	retval = 1;
+	break;
+      }
+      id = (size_t)val[0];
+      if (vx_mesh_grow((void **)&ids, &mcap, id + 1, sizeof(size_t)) != 0) {
+	retval = 1;
+	break;
+      }
+      for (i = num_ids; i <= id; i++) {
+	ids[i] = 0;
+      }
+      if (id >= num_ids) {
+	num_ids = id + 1;
+      }
+      if (depth) {
+	val[3] = -val[3];
+      }
+      if (cb->vertex(cb->arg, &val[1], &index) != 0) {
+	retval = 1;
+	break;
+      }
+      ids[id] = (size_t)index + 1;
+
+    } else if ((strncmp(p, "ATOM", 4) == 0) ||
+	       (strncmp(p, "PATOM", 5) == 0)) {
+      /* New id for an existing vertex */
+      p += (p[0] == 'P') ? 5 : 4;
+      if ((vx_mesh_numbers(p, val, 2) != 2) || ((size_t)val[1] >= num_ids) ||
+	  (ids[(size_t)val[1]] == 0)) {
+	retval = 1;
+	break;
+      }
+      id = (size_t)val[0];
+      if (vx_mesh_grow((void **)&ids, &mcap, id + 1, sizeof(size_t)) != 0) {
+	retval = 1;
+	break;
+      }
+      for (i = num_ids; i <= id; i++) {
+	ids[i] = 0;
+      }
+      if (id >= num_ids) {
+	num_ids = id + 1;
+      }
+      ids[id] = ids[(size_t)val[1]];
+
+    } else if (strncmp(p, "TRGL", 4) == 0) {
+      if (vx_mesh_numbers(&p[4], val, 3) != 3) {
+	retval = 1;
+	break;
+      }
+      for (k = 0; k < 3; k++) {
+	if (((size_t)val[k] >= num_ids) || (ids[(size_t)val[k]] == 0)) {
+	  retval = 1;
+	  break;
+	}
+	tri[k] = ids[(size_t)val[k]] - 1;
+      }
+      if ((retval != 0) || (cb->tri(cb->arg, tri) != 0)) {
+	retval = 1;
+	break;
+      }
+
+    } else if (strncmp(p, "ZPOSITIVE", 9) == 0) {
+      depth = (strstr(p, "Depth") != NULL);
+
+    } else if (strncmp(p, "GOCAD ", 6) == 0) {
+      /* Vertex ids and orientation restart with each object */
+      num_ids = 0;
+      depth = 0;
+    }
+  }
+  if (bytes != NULL) {
+    *bytes = (size_t)ftell(fp);
+  }
+  fclose(fp);
+  free(ids);
+
+  if (retval != 0) {
+    fprintf(stderr, "Invalid vertex or triangle in %s: %s", path, line);
+  }
+  return(retval);
+}
+
+
+/* Append vertex to mesh */
+static int vx_mesh_add_vertex(void *arg, const double *xyz, uint32_t *index)
+{
+  vx_mesh_load_t *l = (vx_mesh_load_t *)arg;
+  vx_mesh_t *mesh = l->mesh;
+
+  if ((mesh->num_verts >= UINT32_MAX) ||
+      (vx_mesh_grow((void **)&(mesh->verts), &(l->vcap), mesh->num_verts + 1,
+		    3 * sizeof(double)) != 0)) {
+    return(1);
+  }
+  memcpy(&(mesh->verts[mesh->num_verts * 3]), xyz, 3 * sizeof(double));
+  *index = mesh->num_verts++;
+  return(0);
+}
+
+
+/* Append triangle to mesh */
+static int vx_mesh_add_tri(void *arg, const uint32_t *v)
+{
+  vx_mesh_load_t *l = (vx_mesh_load_t *)arg;
+  vx_mesh_t *mesh = l->mesh;
+
+  if (vx_mesh_grow((void **)&(mesh->tris), &(l->tcap), mesh->num_tris + 1,
+		   3 * sizeof(uint32_t)) != 0) {
+    return(1);
+  }
+  memcpy(&(mesh->tris[mesh->num_tris * 3]), v, 3 * sizeof(uint32_t));
+  mesh->num_tris++;
+  return(0);
+}
+
+
+/* Load GOCAD TSurf */
+int vx_mesh_load_ts(const char *path, vx_mesh_t *mesh)
+{
+  vx_mesh_load_t l;
+  vx_mesh_ts_cb_t cb = {vx_mesh_add_vertex, vx_mesh_add_tri, &l};
+
+  memset(mesh, 0, sizeof(vx_mesh_t));
+  memset(&l, 0, sizeof(vx_mesh_load_t));
+  l.mesh = mesh;
+  if (vx_mesh_parse_ts(path, &cb, NULL) != 0) {
+    vx_mesh_free(mesh);
+    return(1);
+  }
+  if (mesh->num_tris == 0) {
+    fprintf(stderr, "No triangles in %s\n", path);
+    vx_mesh_free(mesh);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Hash cell of vertex */
+static void vx_mesh_cell(double tol, const double *xyz, int64_t *cell)
+{
+  double v;
+  int k;
+
+  for (k = 0; k < 3; k++) {
+    if (tol > 0.0) {
+      cell[k] = (int64_t)floor(xyz[k] / tol);
+    } else {
+      v = xyz[k] + 0.0;      /* -0 and 0 are the same vertex */
+      memcpy(&cell[k], &v, sizeof(double));
+    }
+  }
+}
+
+
+/* Slot of 'cell', empty if the cell has no vertices */
+static size_t vx_mesh_slot(const vx_mesh_conv_state_t *c, const int64_t *cell)
+{
+  uint64_t h;
+  size_t slot;
+
+  h = (uint64_t)cell[0] * 0x9e3779b97f4a7c15ULL ^
+    (uint64_t)cell[1] * 0xc2b2ae3d27d4eb4fULL ^
+    (uint64_t)cell[2] * 0x165667b19e3779f9ULL;
+  h ^= h >> 29;
+  for (slot = h & (c->num_slots - 1); c->heads[slot] != 0;
+       slot = (slot + 1) & (c->num_slots - 1)) {
+    if (memcmp(&(c->keys[slot * 3]), cell, 3 * sizeof(int64_t)) == 0) {
+      break;
+    }
+  }
+  return(slot);
+}
+
+
+/* Resize vertex hash to 'num_slots' */
+static int vx_mesh_rehash(vx_mesh_conv_state_t *c, size_t num_slots)
+{
+  int64_t *keys = c->keys;
+  uint32_t *heads = c->heads;
+  size_t i, slot, old = c->num_slots;
+
+  c->keys = malloc(num_slots * 3 * sizeof(int64_t));
+  c->heads = calloc(num_slots, sizeof(uint32_t));
+  if ((c->keys == NULL) || (c->heads == NULL)) {
+    free(c->keys);
+    free(c->heads);
+    c->keys = keys;
+    c->heads = heads;
+    return(1);
+  }
+  c->num_slots = num_slots;
+  for (i = 0; i < old; i++) {
+    if (heads[i] != 0) {
+      slot = vx_mesh_slot(c, &keys[i * 3]);
+      memcpy(&(c->keys[slot * 3]), &keys[i * 3], 3 * sizeof(int64_t));
+      c->heads[slot] = heads[i];
+    }
+  }
+  free(keys);
+  free(heads);
+  return(0);
+}
+
+
+/* Vertex of converted mesh, merged with a vertex within 'tol' */
+static int vx_mesh_conv_vertex(void *arg, const double *xyz, uint32_t *index)
+{
+  vx_mesh_conv_state_t *c = (vx_mesh_conv_state_t *)arg;
+  int64_t cell[3], near[3];
+  const double *v;
+  double d;
+  size_t slot;
+  uint32_t i;
+  int n, k, span = (c->tol > 0.0) ? 27 : 1;
+
+  c->stats.num_in_verts++;
+  vx_mesh_cell(c->tol, xyz, cell);
+  for (n = 0; n < span; n++) {
+    for (k = 0; k < 3; k++) {
+      near[k] = cell[k] + ((span > 1) ? (n / (k == 0 ? 1 : (k == 1 ? 3 : 9))) %
+			   3 - 1 : 0);
+    }
+    slot = vx_mesh_slot(c, near);
+    for (i = c->heads[slot]; i != 0; i = c->next[i - 1]) {
+      v = &(c->verts[(size_t)(i - 1) * 3]);
+      d = (v[0] - xyz[0]) * (v[0] - xyz[0]) + (v[1] - xyz[1]) * (v[1] - xyz[1]) +
+	(v[2] - xyz[2]) * (v[2] - xyz[2]);
+      if (d <= c->tol * c->tol) {
+	*index = i - 1;
+	return(0);
+      }
+    }
+  }
+
+  /* New vertex */
+  if ((c->stats.num_verts >= UINT32_MAX - 1) ||
+      (vx_mesh_grow((void **)&(c->verts), &(c->vcap), c->stats.num_verts + 1,
+		    3 * sizeof(double)) != 0) ||
+      (vx_mesh_grow((void **)&(c->next), &(c->ncap), c->stats.num_verts + 1,
+		    sizeof(uint32_t)) != 0) ||
+      ((c->used_slots * 2 >= c->num_slots) &&
+       (vx_mesh_rehash(c, c->num_slots * 2) != 0))) {
+    return(1);
+  }
+  memcpy(&(c->verts[c->stats.num_verts * 3]), xyz, 3 * sizeof(double));
+  slot = vx_mesh_slot(c, cell);
+  if (c->heads[slot] == 0) {
+    memcpy(&(c->keys[slot * 3]), cell, 3 * sizeof(int64_t));
+    c->used_slots++;
+  }
+  c->next[c->stats.num_verts] = c->heads[slot];
+  c->heads[slot] = c->stats.num_verts + 1;
+  *index = c->stats.num_verts++;
+  return(0);
+}
+
+
+/* Triangle of converted mesh, written unless it collapsed */
+static int vx_mesh_conv_tri(void *arg, const uint32_t *v)
+{
+  vx_mesh_conv_state_t *c = (vx_mesh_conv_state_t *)arg;
+
+  if ((v[0] == v[1]) || (v[1] == v[2]) || (v[2] == v[0])) {
+    c->stats.num_degenerate++;
+    return(0);
+  }
+  if (fwrite(v, sizeof(uint32_t), 3, c->fp) != 3) {
+    return(1);
+  }
+  c->stats.num_tris++;
+  return(0);
+}
+
+
+/* Convert TSurf to binary mesh */
+int vx_mesh_convert_ts(const char *in, const char *out, double tol,
+		       vx_mesh_conv_t *stats)
+{
+  vx_mesh_conv_state_t c;
+  vx_mesh_ts_cb_t cb = {vx_mesh_conv_vertex, vx_mesh_conv_tri, &c};
+  vx_mesh_header_t h;
+  char tmp[CMLEN];
+  uint32_t pad = 0;
+  int retval = 0;
+
+  memset(&c, 0, sizeof(vx_mesh_conv_state_t));
+  memset(&h, 0, sizeof(vx_mesh_header_t));
+  c.tol = (tol > 0.0) ? tol : 0.0;
+  if (vx_mesh_rehash(&c, VX_MESH_SLOTS) != 0) {
+    return(1);
+  }
+
+  snprintf(tmp, CMLEN, "%s.%ld", out, (long)getpid());
+  c.fp = fopen(tmp, "wb");
+  if (c.fp == NULL) {
+    fprintf(stderr, "Failed to open mesh %s\n", tmp);
+    free(c.keys);
+    free(c.heads);
+    return(1);
+  }
+
+  /* Header is rewritten once the counts are known */
+  if ((fwrite(&h, sizeof(vx_mesh_header_t), 1, c.fp) != 1) ||
+      (vx_mesh_parse_ts(in, &cb, &(c.stats.bytes_in)) != 0) ||
+      (c.stats.num_tris == 0)) {
+    retval = 1;
+  }
+  if (retval == 0) {
+    memcpy(h.magic, VX_MESH_MAGIC, sizeof(h.magic));
+    h.order = VX_MESH_ORDER;
+    h.num_verts = c.stats.num_verts;
+    h.num_tris = c.stats.num_tris;
+    h.verts_offset = sizeof(vx_mesh_header_t) +
+      ((c.stats.num_tris * 3 * sizeof(uint32_t) + 7) & ~(uint64_t)7);
+    if (((c.stats.num_tris % 2 == 1) &&
+	 (fwrite(&pad, sizeof(uint32_t), 1, c.fp) != 1)) ||
+	(fwrite(c.verts, 3 * sizeof(double), c.stats.num_verts, c.fp) !=
+	 c.stats.num_verts) ||
+	(fseek(c.fp, 0, SEEK_SET) != 0) ||
+	(fwrite(&h, sizeof(vx_mesh_header_t), 1, c.fp) != 1)) {
+      retval = 1;
+    }
+  }
+  if ((fclose(c.fp) != 0) || (retval != 0) || (rename(tmp, out) != 0)) {
+    fprintf(stderr, "Failed to convert %s to %s\n", in, out);
+    remove(tmp);
+    retval = 1;
+  }
+
+  c.stats.buffer_bytes = c.vcap * 3 * sizeof(double) +
+    c.ncap * sizeof(uint32_t) +
+    c.num_slots * (3 * sizeof(int64_t) + sizeof(uint32_t));
+  if (stats != NULL) {
+    memcpy(stats, &(c.stats), sizeof(vx_mesh_conv_t));
+  }
+  free(c.verts);
+  free(c.next);
+  free(c.keys);
+  free(c.heads);
+  return(retval);
+}
+
+
+/* Map binary mesh */
+int vx_mesh_map(const char *path, vx_mesh_t *mesh)
+{
+  const vx_mesh_header_t *h;
+  struct stat st;
+  char *map;
+  size_t len;
+  int fd;
+
+  memset(mesh, 0, sizeof(vx_mesh_t));
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Failed to open mesh %s\n", path);
+    return(1);
+  }
+  if ((fstat(fd, &st) != 0) ||
+      (st.st_size < (off_t)sizeof(vx_mesh_header_t))) {
+    fprintf(stderr, "Invalid binary mesh %s\n", path);
+    close(fd);
+    return(1);
+  }
+  len = (size_t)st.st_size;
+  map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "Failed to map mesh %s\n", path);
+    return(1);
+  }
+
+  h = (const vx_mesh_header_t *)map;
+  if ((memcmp(h->magic, VX_MESH_MAGIC, sizeof(h->magic)) != 0) ||
+      (h->order != VX_MESH_ORDER) || (h->num_tris == 0) ||
+      (h->num_verts >= UINT32_MAX) || (h->num_tris >= UINT32_MAX) ||
+      (h->verts_offset != sizeof(vx_mesh_header_t) +
+       ((h->num_tris * 3 * sizeof(uint32_t) + 7) & ~(uint64_t)7)) ||
+      (len != h->verts_offset + h->num_verts * 3 * sizeof(double))) {
+    fprintf(stderr, "Invalid binary mesh %s\n", path);
+    munmap(map, len);
+    return(1);
+  }
+
+  mesh->num_verts = h->num_verts;
+  mesh->num_tris = h->num_tris;
+  mesh->tris = (uint32_t *)(map + sizeof(vx_mesh_header_t));
+  mesh->verts = (double *)(map + h->verts_offset);
+  mesh->map = map;
+  mesh->map_len = len;
+  return(0);
+}
+
+
+/* Load GTS surface. Faces are given as three edges */
+int vx_mesh_load_gts(const char *path, vx_mesh_t *mesh)
+{
+  FILE *fp;
+  char line[VX_MESH_LINE];
+  double val[3];
+  uint32_t *edges = NULL, *e[3], c;
+  size_t counts[3], num = 0;
+  int k, part = -1, retval = 0;
+
+  memset(mesh, 0, sizeof(vx_mesh_t));
+  fp = fopen(path, "r");
+  if (fp == NULL) {
+    fprintf(stderr, "Failed to open mesh %s\n", path);
+    return(1);
+  }
+
+  /* Header with vertex, edge and face counts, then one section each */
+  while ((retval == 0) && vx_mesh_getline(fp, line)) {
+    if ((line[0] == '#') || (line[0] == '\n')) {
+      continue;
+    }
+    if (part < 0) {
+      if (vx_mesh_numbers(line, val, 3) != 3) {
+	retval = 1;
+	break;
+      }
+      for (k = 0; k < 3; k++) {
+	counts[k] = (size_t)val[k];
+      }
+      mesh->verts = malloc((counts[0] + 1) * 3 * sizeof(double));
+      edges = malloc((counts[1] + 1) * 2 * sizeof(uint32_t));
+      mesh->tris = malloc((counts[2] + 1) * 3 * sizeof(uint32_t));
+      if ((mesh->verts == NULL) || (edges == NULL) || (mesh->tris == NULL)) {
+	retval = 1;
+	break;
+      }
+      part = 0;
+      num = 0;
+    } else if (part == 0) {
+      if (vx_mesh_numbers(line, &(mesh->verts[num * 3]), 3) != 3) {
+	retval = 1;
+	break;
+      }
+      num++;
+    } else if (part == 1) {
+      if ((vx_mesh_numbers(line, val, 2) != 2) || (val[0] < 1) ||
+	  (val[0] > counts[0]) || (val[1] < 1) || (val[1] > counts[0])) {
+	retval = 1;
+	break;
+      }
+      edges[num * 2] = (uint32_t)val[0] - 1;
+      edges[num * 2 + 1] = (uint32_t)val[1] - 1;
+      num++;
+    } else if (part == 2) {
+      if (vx_mesh_numbers(line, val, 3) != 3) {
+	retval = 1;
+	break;
+      }
+      for (k = 0; k < 3; k++) {
+	if ((val[k] < 1) || (val[k] > counts[1])) {
+	  retval = 1;
+	  break;
+	}
+	e[k] = &edges[((size_t)val[k] - 1) * 2];
+      }
+      if (retval != 0) {
+	break;
+      }
+
+      /* Third vertex is the end of the second edge not on the first */
+      c = ((e[1][0] == e[0][0]) || (e[1][0] == e[0][1])) ? e[1][1] : e[1][0];
+      mesh->tris[num * 3] = e[0][0];
+      mesh->tris[num * 3 + 1] = e[0][1];
+      mesh->tris[num * 3 + 2] = c;
+      num++;
+    }
+
+    /* Next section */
+    while ((part >= 0) && (part < 3) && (num == counts[part])) {
+      part++;
+      num = 0;
+    }
+  }
+  fclose(fp);
+  free(edges);
+
+  if ((retval != 0) || (part < 3) || (counts[2] == 0)) {
+    fprintf(stderr, "Invalid, truncated or empty GTS file %s\n", path);
+    vx_mesh_free(mesh);
+    return(1);
+  }
+  mesh->num_verts = counts[0];
+  mesh->num_tris = counts[2];
+  return(0);
+}
+
+
+/* Triangulate voxet interface */
+int vx_mesh_load_voxet(const char *path, vx_mesh_iface_t iface,
+		       vx_mesh_t *mesh)
+{
+  char vo[CMLEN], dir[CMLEN], fn[CMLEN];
+  float o[3], u[3], v[3], nodata = 0.0, *elev;
+  int dims[3], esize = 0;
+  size_t i, j, k, n, c;
+
+  memset(mesh, 0, sizeof(vx_mesh_t));
+  snprintf(vo, CMLEN, "%s", path);
+  snprintf(dir, CMLEN, "%s", path);
+  if (vx_io_init(vo) != 0) {
+    fprintf(stderr, "Failed to load voxet %s\n", path);
+    return(1);
+  }
+  vx_io_getvec("AXIS_O", o);
+  vx_io_getvec("AXIS_U", u);
+  vx_io_getvec("AXIS_V", v);
+  vx_io_getdim("AXIS_N ", dims);
+  vx_io_getpropname("PROP_FILE", iface + 1, fn);
+  vx_io_getpropsize("PROP_ESIZE", iface + 1, &esize);
+  vx_io_getpropval("PROP_NO_DATA_VALUE", iface + 1, &nodata);
+  vx_io_finalize();
+
+  if ((dims[0] < 2) || (dims[1] < 2) || (esize != sizeof(float))) {
+    fprintf(stderr, "Invalid interface grid in %s\n", path);
+    return(1);
+  }
+
+  /* First layer of the property is the surface elevation grid */
+  n = (size_t)dims[0] * dims[1];
+  elev = malloc(n * sizeof(float));
+  mesh->verts = malloc(n * 3 * sizeof(double));
+  mesh->tris = malloc((n - dims[1]) * 6 * sizeof(uint32_t));
+  if ((elev == NULL) || (mesh->verts == NULL) || (mesh->tris == NULL) ||
+      (vx_io_loadvolume(dirname(dir), fn, esize, n, (char *)elev) != 0)) {
+    fprintf(stderr, "Failed to load interface %s of %s\n",
+	    VX_MESH_IFACE_NAMES[iface], path);
+    free(elev);
+    vx_mesh_free(mesh);
+    return(1);
+  }
+
+  for (j = 0; j < (size_t)dims[1]; j++) {
+    for (i = 0; i < (size_t)dims[0]; i++) {
+      k = j * dims[0] + i;
+      mesh->verts[k * 3] = o[0] + u[0] * i / (dims[0] - 1);
+      mesh->verts[k * 3 + 1] = o[1] + v[1] * j / (dims[1] - 1);
+      mesh->verts[k * 3 + 2] = elev[k];
+    }
+  }
+
+  /* Two triangles per cell with data at all corners */
+  for (j = 0; j + 1 < (size_t)dims[1]; j++) {
+    for (i = 0; i + 1 < (size_t)dims[0]; i++) {
+      k = j * dims[0] + i;
+      for (c = 0; c < 4; c++) {
+	if (elev[k + (c & 1) + (c >> 1) * dims[0]] - nodata < 0.1) {
+	  break;
+	}
+      }
+      if (c < 4) {
+	continue;
+      }
+      mesh->tris[mesh->num_tris * 3] = k;
+      mesh->tris[mesh->num_tris * 3 + 1] = k + 1;
+      mesh->tris[mesh->num_tris * 3 + 2] = k + dims[0] + 1;
+      mesh->tris[mesh->num_tris * 3 + 3] = k;
+      mesh->tris[mesh->num_tris * 3 + 4] = k + dims[0] + 1;
+      mesh->tris[mesh->num_tris * 3 + 5] = k + dims[0];
+      mesh->num_tris += 2;
+    }
+  }
+  mesh->num_verts = n;
+  free(elev);
+
+  if (mesh->num_tris == 0) {
+    fprintf(stderr, "No data in interface %s of %s\n",
+	    VX_MESH_IFACE_NAMES[iface], path);
+    vx_mesh_free(mesh);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Hash of the stamps of mesh files. Voxet interfaces are read from
+   the property file of the interface, stamped after the voxet header */
+int vx_mesh_checksum(const char *path, uint64_t *sum)
+{
+  const char *ext = strrchr(path, '.');
+  char vo[CMLEN], dir[CMLEN], fn[CMLEN], prop[2 * CMLEN];
+  uint64_t h = VX_FNV_INIT;
+  int i, retval;
+
+  if ((ext == NULL) || (strncasecmp(ext, ".vo:", 4) != 0)) {
+    if (vx_file_stamp(path, &h) != 0) {
+      fprintf(stderr, "Failed to stat mesh %s\n", path);
+      return(1);
+    }
+    *sum = h;
+    return(0);
+  }
+
+  for (i = 0; i < VX_MESH_IFACE_NUM; i++) {
+    if (strcasecmp(&ext[4], VX_MESH_IFACE_NAMES[i]) == 0) {
+      break;
+    }
+  }
+  if (i == VX_MESH_IFACE_NUM) {
+    fprintf(stderr, "Unknown interface %s\n", &ext[4]);
+    return(1);
+  }
+  snprintf(vo, CMLEN, "%.*s", (int)(ext + 3 - path), path);
+  snprintf(dir, CMLEN, "%s", vo);
+  if (vx_io_init(vo) != 0) {
+    fprintf(stderr, "Failed to load voxet %s\n", vo);
+    return(1);
+  }
+  retval = vx_io_getpropname("PROP_FILE", i + 1, fn);
+  vx_io_finalize();
+  if (retval != 0) {
+    fprintf(stderr, "No property file for interface %s of %s\n",
+	    VX_MESH_IFACE_NAMES[i], vo);
+    return(1);
+  }
+  snprintf(prop, sizeof(prop), "%s/%s", dirname(dir), fn);
+  if ((vx_file_stamp(vo, &h) != 0) || (vx_file_stamp(prop, &h) != 0)) {
+    fprintf(stderr, "Failed to stat interface %s of %s\n",
+	    VX_MESH_IFACE_NAMES[i], vo);
+    return(1);
+  }
+  *sum = h;
+  return(0);
+}
+
+
+/* Free mesh */
+void vx_mesh_free(vx_mesh_t *mesh)
+{
+  if (mesh->map != NULL) {
+    munmap(mesh->map, mesh->map_len);
+  } else {
+    free(mesh->verts);
+    free(mesh->tris);
+  }
+  memset(mesh, 0, sizeof(vx_mesh_t));
+}
@@ -0,0 +1,82 @@
+#ifndef VX_MESH_H
+#define VX_MESH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Max length of a mesh file line */
+#define VX_MESH_LINE 1024
+
+/* Interface surfaces of the model interfaces.vo voxet */
+typedef enum { VX_MESH_TOPO = 0,
+	       VX_MESH_BASE,
+	       VX_MESH_MOHO } vx_mesh_iface_t;
+
+#define VX_MESH_IFACE_NUM 3
+
+extern char *VX_MESH_IFACE_NAMES[VX_MESH_IFACE_NUM];
+
+
+/* Triangle mesh. Vertices are x,y,z triplets in UTM and meters of
+   elevation, triangles are triplets of vertex indices */
+typedef struct vx_mesh_t
+{
+  size_t num_verts;
+  size_t num_tris;
+  double *verts;
+  uint32_t *tris;
+  void *map;                 /* binary mesh mapping, NULL when loaded */
+  size_t map_len;
+} vx_mesh_t;
+
+
+/* Statistics of a TSurf conversion */
+typedef struct vx_mesh_conv_t
+{
+  size_t bytes_in;
+  size_t num_in_verts;       /* vertices read */
+  size_t num_verts;          /* vertices after merging */
+  size_t num_tris;
+  size_t num_degenerate;     /* triangles dropped after merging */
+  size_t buffer_bytes;       /* size of converter buffers */
+} vx_mesh_conv_t;
+
+
+/* Load GOCAD TSurf (.ts), GTS (.gts) or binary (.vxm) mesh, by file
+   extension, or an interface of a voxet given as 'file.vo:name', eg.
+   'model/interfaces.vo:moho'. Returns 1 on failure */
+int vx_mesh_load(const char *path, vx_mesh_t *mesh);
+
+/* Load GOCAD TSurf. All TSurf objects in the file are merged, PVRTX
+   and ATOM vertices are supported and depths are converted to
+   elevation when ZPOSITIVE is Depth */
+int vx_mesh_load_ts(const char *path, vx_mesh_t *mesh);
+
+/* Load GTS surface */
+int vx_mesh_load_gts(const char *path, vx_mesh_t *mesh);
+
+/* Map binary mesh read-only */
+int vx_mesh_map(const char *path, vx_mesh_t *mesh);
+
+/* Convert GOCAD TSurf 'in' to binary mesh 'out'. Triangles are
+   streamed to the output and only vertices are kept in memory.
+   Vertices closer than 'tol' (0 for identical ones) are merged, and
+   triangles that collapse are dropped. 'stats' may be NULL. Returns 1
+   on failure */
+int vx_mesh_convert_ts(const char *in, const char *out, double tol,
+		       vx_mesh_conv_t *stats);
+
+/* Triangulate interface 'iface' of voxet 'path'. Cells with a
+   corner without data are left out */
+int vx_mesh_load_voxet(const char *path, vx_mesh_iface_t iface,
+		       vx_mesh_t *mesh);
+
+/* 64 bit checksum of the file stamps (vx_file_stamp) of mesh 'path',
+   the voxet header and the property file of the interface for voxet
+   interfaces. Returns 1 on failure */
+int vx_mesh_checksum(const char *path, uint64_t *sum);
+
+/* Free mesh arrays */
+void vx_mesh_free(vx_mesh_t *mesh);
+
+#endif
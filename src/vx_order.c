@@ -0,0 +1,279 @@
+/** vx_order.c - Space-filling curve ordering of batch queries. Points
+    are quantized over their bounding box and sorted by Morton or
+    Hilbert key, so consecutive queries touch nearby voxet cells.
+
+10/2026: Initial implementation
+**/
+
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <math.h>
+#include "vx_order.h"
+
+/* Bits sorted per radix pass */
+#define VX_ORDER_RADIX 12
+
+
+/* Curve names */
+char *VX_ORDER_NAMES[VX_ORDER_NUM] = {"none", "morton", "hilbert"};
+
+
+/* Key and input index of point */
+typedef struct vx_order_key_t
+{
+  uint64_t key;
+  size_t idx;
+} vx_order_key_t;
+
+
+/* Parse curve name. Returns 1 if unknown */
+int vx_order_parse(const char *name, vx_order_t *order)
+{
+  int i;
+
+  for (i = 0; i < VX_ORDER_NUM; i++) {
+    if (strcasecmp(name, VX_ORDER_NAMES[i]) == 0) {
+      *order = (vx_order_t)i;
+      return(0);
+    }
+  }
+  return(1);
+}
+
+
+/* Spread low 21 bits of 'v' to every third bit */
+static uint64_t vx_order_spread(unsigned int v)
+{
+  uint64_t x = v & 0x1FFFFF;
+
+  x = (x | x << 32) & 0x1F00000000FFFFULL;
+  x = (x | x << 16) & 0x1F0000FF0000FFULL;
+  x = (x | x << 8) & 0x100F00F00F00F00FULL;
+  x = (x | x << 4) & 0x10C30C30C30C30C3ULL;
+  x = (x | x << 2) & 0x1249249249249249ULL;
+  return(x);
+}
+
+
+/* Morton key of cell 'q' */
+uint64_t vx_order_morton(const unsigned int *q)
+{
+  return(vx_order_spread(q[0]) | (vx_order_spread(q[1]) << 1) |
+	 (vx_order_spread(q[2]) << 2));
+}
+
+
+/* Hilbert key of cell 'q'. The axes are transformed to the transposed
+   Hilbert index (J. Skilling, AIP Conf. Proc. 707, 2004), whose bits
+   interleave to the key */
+uint64_t vx_order_hilbert(const unsigned int *q)
+{
+  unsigned int x[3], p, b, t;
+  int i, level;
+
+  for (i = 0; i < 3; i++) {
+    x[i] = q[i] & ((1U << VX_ORDER_BITS) - 1);
+  }
+
+  /* Inverse undo, without branches on the random coordinate bits */
+  for (level = VX_ORDER_BITS - 1; level > 0; level--) {
+    p = (1U << level) - 1;
+    for (i = 0; i < 3; i++) {
+      b = 0U - ((x[i] >> level) & 1U);
+      t = (x[0] ^ x[i]) & p & ~b;
+      x[0] ^= (p & b) | t;
+      x[i] ^= t;
+    }
+  }
+
+  /* Gray encode */
+  x[1] ^= x[0];
+  x[2] ^= x[1];
+  t = 0;
+  for (level = VX_ORDER_BITS - 1; level > 0; level--) {
+    t ^= ((1U << level) - 1) & (0U - ((x[2] >> level) & 1U));
+  }
+  for (i = 0; i < 3; i++) {
+    x[i] ^= t;
+  }
+
+  /* Most significant bit of each level from x[0] */
+  return(vx_order_spread(x[2]) | (vx_order_spread(x[1]) << 1) |
+	 (vx_order_spread(x[0]) << 2));
+}
+
+
+/* Bounding box of finite coordinates, empty axes have lo > hi */
+static void vx_order_bounds(const double *xyz, size_t stride, size_t n,
+			    double *lo, double *hi)
+{
+  const double *p;
+  size_t i;
+  int a;
+
+  for (a = 0; a < 3; a++) {
+    lo[a] = HUGE_VAL;
+    hi[a] = -HUGE_VAL;
+  }
+  for (i = 0; i < n; i++) {
+    p = &xyz[i * stride];
+    for (a = 0; a < 3; a++) {
+      if (isfinite(p[a])) {
+	if (p[a] < lo[a]) {
+	  lo[a] = p[a];
+	}
+	if (p[a] > hi[a]) {
+	  hi[a] = p[a];
+	}
+      }
+    }
+  }
+}
+
+
+/* Cell scale of axes for 'bits' bits per axis */
+static void vx_order_scale(const double *lo, const double *hi, int bits,
+			   double *scale)
+{
+  int a;
+
+  for (a = 0; a < 3; a++) {
+    if (hi[a] > lo[a]) {
+      scale[a] = ldexp(1.0, bits) / (hi[a] - lo[a]);
+    } else {
+      scale[a] = 0.0;
+    }
+  }
+}
+
+
+/* Cell of point, clamped to the box. NaN falls in cell 0 */
+static void vx_order_cell(const double *p, const double *lo,
+			  const double *scale, int bits, unsigned int *q)
+{
+  double f, max = ldexp(1.0, bits) - 1.0;
+  int a;
+
+  for (a = 0; a < 3; a++) {
+    f = (p[a] - lo[a]) * scale[a];
+    if (!(f > 0.0)) {
+      q[a] = 0;
+    } else if (f >= max) {
+      q[a] = (unsigned int)max;
+    } else {
+      q[a] = (unsigned int)f;
+    }
+  }
+}
+
+
+/* Fraction of consecutive points sharing a coarse cell */
+double vx_order_coherence(const double *xyz, size_t stride, size_t n)
+{
+  double lo[3], hi[3], scale[3];
+  unsigned int q[3], prev[3];
+  size_t i, same = 0;
+  int a, dims = 0, bits;
+
+  if (n < 2) {
+    return(1.0);
+  }
+
+  vx_order_bounds(xyz, stride, n, lo, hi);
+  for (a = 0; a < 3; a++) {
+    dims += (hi[a] > lo[a]);
+  }
+  if (dims == 0) {
+    return(1.0);
+  }
+
+  /* About 8 points per cell over the occupied axes */
+  bits = (int)floor(log2(n / 8.0) / dims);
+  if (bits < 1) {
+    bits = 1;
+  } else if (bits > VX_ORDER_BITS) {
+    bits = VX_ORDER_BITS;
+  }
+  vx_order_scale(lo, hi, bits, scale);
+
+  vx_order_cell(xyz, lo, scale, bits, prev);
+  for (i = 1; i < n; i++) {
+    vx_order_cell(&xyz[i * stride], lo, scale, bits, q);
+    if ((q[0] == prev[0]) && (q[1] == prev[1]) && (q[2] == prev[2])) {
+      same++;
+    }
+    memcpy(prev, q, sizeof(prev));
+  }
+  return((double)same / (n - 1));
+}
+
+
+/* Permutation visiting the points along the curve */
+int vx_order_sort(const double *xyz, size_t stride, size_t n,
+		  vx_order_t order, size_t *perm)
+{
+  vx_order_key_t *keys, *tmp, *swap;
+  double lo[3], hi[3], scale[3];
+  unsigned int q[3];
+  size_t i, count[1 << VX_ORDER_RADIX], sum, c;
+  uint64_t mask = (1 << VX_ORDER_RADIX) - 1;
+  int shift;
+
+  if ((order == VX_ORDER_NONE) || (n < 2)) {
+    for (i = 0; i < n; i++) {
+      perm[i] = i;
+    }
+    return(0);
+  }
+
+  keys = malloc(n * sizeof(vx_order_key_t));
+  tmp = malloc(n * sizeof(vx_order_key_t));
+  if ((keys == NULL) || (tmp == NULL)) {
+    free(keys);
+    free(tmp);
+    return(1);
+  }
+
+  vx_order_bounds(xyz, stride, n, lo, hi);
+  vx_order_scale(lo, hi, VX_ORDER_BITS, scale);
+  for (i = 0; i < n; i++) {
+    vx_order_cell(&xyz[i * stride], lo, scale, VX_ORDER_BITS, q);
+    if (order == VX_ORDER_HILBERT) {
+      keys[i].key = vx_order_hilbert(q);
+    } else {
+      keys[i].key = vx_order_morton(q);
+    }
+    keys[i].idx = i;
+  }
+
+  /* Stable LSD radix sort by key digits, skipping constant digits */
+  for (shift = 0; shift < 3 * VX_ORDER_BITS; shift += VX_ORDER_RADIX) {
+    memset(count, 0, sizeof(count));
+    for (i = 0; i < n; i++) {
+      count[(keys[i].key >> shift) & mask]++;
+    }
+    if (count[(keys[0].key >> shift) & mask] == n) {
+      continue;
+    }
+    for (i = 0, sum = 0; i <= mask; i++) {
+      c = count[i];
+      count[i] = sum;
+      sum += c;
+    }
+    for (i = 0; i < n; i++) {
+      tmp[count[(keys[i].key >> shift) & mask]++] = keys[i];
+    }
+    swap = keys;
+    keys = tmp;
+    tmp = swap;
+  }
+
+  for (i = 0; i < n; i++) {
+    perm[i] = keys[i].idx;
+  }
+
+  free(keys);
+  free(tmp);
+  return(0);
+}
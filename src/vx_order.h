@@ -0,0 +1,48 @@
+#ifndef VX_ORDER_H
+#define VX_ORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bits per axis of curve keys, at most 21. 16 bits resolve a few
+   meters over the model, well below the voxet spacing */
+#define VX_ORDER_BITS 16
+
+/* Batches with fewer points are queried in input order */
+#define VX_ORDER_MIN 256
+
+/* Inputs with at least this fraction of consecutive points in the
+   same coarse cell are considered coherent and not sorted */
+#define VX_ORDER_COHERENT 0.5
+
+
+/* Space-filling curves for batch ordering */
+typedef enum { VX_ORDER_NONE = 0,
+	       VX_ORDER_MORTON,
+	       VX_ORDER_HILBERT } vx_order_t;
+
+#define VX_ORDER_NUM 3
+
+extern char *VX_ORDER_NAMES[VX_ORDER_NUM];
+
+
+/* Parse curve name. Returns 1 if unknown */
+int vx_order_parse(const char *name, vx_order_t *order);
+
+/* Morton key of cell 'q' (3 axes of VX_ORDER_BITS bits) */
+uint64_t vx_order_morton(const unsigned int *q);
+
+/* Hilbert key of cell 'q' (3 axes of VX_ORDER_BITS bits) */
+uint64_t vx_order_hilbert(const unsigned int *q);
+
+/* Fraction of consecutive points sharing a coarse cell of their
+   bounding box, with about 8 points per cell. Point i is at
+   xyz[i * stride] */
+double vx_order_coherence(const double *xyz, size_t stride, size_t n);
+
+/* Permutation 'perm' visiting the 'n' points along curve 'order'.
+   Returns 1 if out of memory */
+int vx_order_sort(const double *xyz, size_t stride, size_t n,
+		  vx_order_t order, size_t *perm);
+
+#endif
@@ -0,0 +1,92 @@
+/** vx_queue.c - Bounded blocking queue used to hand work between
+    reader, query and writer threads.
+
+10/2026: Initial implementation
+**/
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "vx_queue.h"
+
+
+/* Initialize queue holding at most 'capacity' items */
+int vx_queue_init(vx_queue_t *q, int capacity)
+{
+  if (capacity < 1) {
+    return(1);
+  }
+  q->items = malloc(capacity * sizeof(void *));
+  if (q->items == NULL) {
+    return(1);
+  }
+  q->capacity = capacity;
+  q->head = 0;
+  q->count = 0;
+  q->closed = 0;
+  pthread_mutex_init(&(q->lock), NULL);
+  pthread_cond_init(&(q->not_empty), NULL);
+  pthread_cond_init(&(q->not_full), NULL);
+  return(0);
+}
+
+
+/* Free queue resources */
+void vx_queue_free(vx_queue_t *q)
+{
+  free(q->items);
+  q->items = NULL;
+  pthread_mutex_destroy(&(q->lock));
+  pthread_cond_destroy(&(q->not_empty));
+  pthread_cond_destroy(&(q->not_full));
+}
+
+
+/* Append item, blocking while full. Returns 1 if queue is closed */
+int vx_queue_push(vx_queue_t *q, void *item)
+{
+  pthread_mutex_lock(&(q->lock));
+  while ((q->count == q->capacity) && (!q->closed)) {
+    pthread_cond_wait(&(q->not_full), &(q->lock));
+  }
+  if (q->closed) {
+    pthread_mutex_unlock(&(q->lock));
+    return(1);
+  }
+  q->items[(q->head + q->count) % q->capacity] = item;
+  q->count++;
+  pthread_cond_signal(&(q->not_empty));
+  pthread_mutex_unlock(&(q->lock));
+  return(0);
+}
+
+
+/* Remove oldest item, blocking while empty. Returns NULL once the 
+   queue is closed and drained */
+void *vx_queue_pop(vx_queue_t *q)
+{
+  void *item = NULL;
+
+  pthread_mutex_lock(&(q->lock));
+  while ((q->count == 0) && (!q->closed)) {
+    pthread_cond_wait(&(q->not_empty), &(q->lock));
+  }
+  if (q->count > 0) {
+    item = q->items[q->head];
+    q->head = (q->head + 1) % q->capacity;
+    q->count--;
+    pthread_cond_signal(&(q->not_full));
+  }
+  pthread_mutex_unlock(&(q->lock));
+  return(item);
+}
+
+
+/* Close queue, waking all waiting threads */
+void vx_queue_close(vx_queue_t *q)
+{
+  pthread_mutex_lock(&(q->lock));
+  q->closed = 1;
+  pthread_cond_broadcast(&(q->not_empty));
+  pthread_cond_broadcast(&(q->not_full));
+  pthread_mutex_unlock(&(q->lock));
+}
@@ -0,0 +1,36 @@
+#ifndef VX_QUEUE_H
+#define VX_QUEUE_H
+
+#include <pthread.h>
+
+/* Bounded blocking FIFO of pointers shared between threads */
+typedef struct vx_queue_t 
+{
+  void **items;
+  int capacity;
+  int head;
+  int count;
+  int closed;
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+} vx_queue_t;
+
+
+/* Initialize queue holding at most 'capacity' items */
+int vx_queue_init(vx_queue_t *q, int capacity);
+
+/* Free queue resources */
+void vx_queue_free(vx_queue_t *q);
+
+/* Append item, blocking while full. Returns 1 if queue is closed */
+int vx_queue_push(vx_queue_t *q, void *item);
+
+/* Remove oldest item, blocking while empty. Returns NULL once the 
+   queue is closed and drained */
+void *vx_queue_pop(vx_queue_t *q);
+
+/* Close queue, waking all waiting threads */
+void vx_queue_close(vx_queue_t *q);
+
+#endif
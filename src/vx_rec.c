@@ -0,0 +1,391 @@
+/** vx_rec.c - Packed binary records for bulk point queries. A record
+    holds a user selected subset of the vx_lite output columns. Streams
+    start with a short text header listing the fields, their types and
+    offsets, and the byte order of the values that follow.
+
+10/2026: Initial implementation
+**/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "params.h"
+#include "utils.h"
+#include "vx_sub.h"
+#include "vx_rec.h"
+
+/* Max header line length */
+#define VX_REC_LINE 256
+
+/* Max number of triplets converted per read */
+#define VX_REC_READ_CHUNK 4096
+
+
+/* Field names, match vx_lite column order */
+char *VX_REC_FIELD_NAMES[VX_REC_MAX_FIELDS] = {
+  "x", "y", "z", "utm_x", "utm_y", "elev_x", "elev_y", "topo", "mtop",
+  "base", "moho", "src", "cell_x", "cell_y", "cell_z", "tg", "vp", "vs",
+  "rho"};
+
+/* Field types, same precision as the in-memory entry */
+vx_rec_type_t VX_REC_FIELD_TYPES[VX_REC_MAX_FIELDS] = {
+  VX_REC_TYPE_F64, VX_REC_TYPE_F64, VX_REC_TYPE_F64,
+  VX_REC_TYPE_F64, VX_REC_TYPE_F64,
+  VX_REC_TYPE_F32, VX_REC_TYPE_F32,
+  VX_REC_TYPE_F32, VX_REC_TYPE_F32, VX_REC_TYPE_F32, VX_REC_TYPE_F32,
+  VX_REC_TYPE_I32,
+  VX_REC_TYPE_F32, VX_REC_TYPE_F32, VX_REC_TYPE_F32,
+  VX_REC_TYPE_F32, VX_REC_TYPE_F32, VX_REC_TYPE_F32,
+  VX_REC_TYPE_F64};
+
+char *VX_REC_TYPE_NAMES[3] = {"f32", "f64", "i32"};
+
+static int vx_rec_type_size[3] = {4, 8, 4};
+
+
+/* Swap byte order of value of size 'esize' in place */
+void vx_rec_swap(char *buf, int esize)
+{
+  int i;
+  char c;
+
+  for (i = 0; i < esize / 2; i++) {
+    c = buf[i];
+    buf[i] = buf[esize - 1 - i];
+    buf[esize - 1 - i] = c;
+  }
+}
+
+
+/* Compute offsets and record size from field list */
+static void vx_rec_layout_offsets(vx_rec_layout_t *layout)
+{
+  int i;
+
+  layout->record_size = 0;
+  for (i = 0; i < layout->num_fields; i++) {
+    layout->offsets[i] = layout->record_size;
+    layout->record_size +=
+      vx_rec_type_size[VX_REC_FIELD_TYPES[layout->fields[i]]];
+  }
+}
+
+
+/* Look up field by name */
+static int vx_rec_find_field(const char *name, vx_rec_field_t *field)
+{
+  int i;
+
+  for (i = 0; i < VX_REC_MAX_FIELDS; i++) {
+    if (strcmp(name, VX_REC_FIELD_NAMES[i]) == 0) {
+      *field = (vx_rec_field_t)i;
+      return(0);
+    }
+  }
+  return(1);
+}
+
+
+/* Parse comma separated field list (or "all") into layout */
+int vx_rec_parse_fields(const char *list, vx_byteorder_t byteorder,
+			vx_rec_layout_t *layout)
+{
+  char buf[CMLEN];
+  char *tok;
+  int i;
+
+  if ((list == NULL) || (strlen(list) >= CMLEN)) {
+    return(1);
+  }
+
+  layout->num_fields = 0;
+  layout->byteorder = byteorder;
+
+  if (strcmp(list, "all") == 0) {
+    for (i = 0; i < VX_REC_MAX_FIELDS; i++) {
+      layout->fields[i] = (vx_rec_field_t)i;
+    }
+    layout->num_fields = VX_REC_MAX_FIELDS;
+  } else {
+    strcpy(buf, list);
+    for (tok = strtok(buf, ","); tok != NULL; tok = strtok(NULL, ",")) {
+      if (layout->num_fields >= VX_REC_MAX_FIELDS) {
+	return(1);
+      }
+      if (vx_rec_find_field(tok, &(layout->fields[layout->num_fields]))
+	  != 0) {
+	fprintf(stderr, "Unknown record field %s\n", tok);
+	return(1);
+      }
+      layout->num_fields++;
+    }
+  }
+
+  if (layout->num_fields == 0) {
+    return(1);
+  }
+
+  vx_rec_layout_offsets(layout);
+  return(0);
+}
+
+
+/* Parse byte order name (lsb/msb/native) */
+int vx_rec_parse_byteorder(const char *name, vx_byteorder_t *byteorder)
+{
+  if (strcmp(name, "lsb") == 0) {
+    *byteorder = VX_BYTEORDER_LSB;
+  } else if (strcmp(name, "msb") == 0) {
+    *byteorder = VX_BYTEORDER_MSB;
+  } else if (strcmp(name, "native") == 0) {
+    *byteorder = vx_system_endian();
+  } else {
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Write self-describing header for layout */
+int vx_rec_write_header(FILE *fp, vx_rec_layout_t *layout)
+{
+  int i;
+
+  fprintf(fp, "%s %d\n", VX_REC_MAGIC, VX_REC_VERSION);
+  fprintf(fp, "byteorder %s\n",
+	  (layout->byteorder == VX_BYTEORDER_LSB) ? "lsb" : "msb");
+  fprintf(fp, "record_size %d\n", layout->record_size);
+  fprintf(fp, "num_fields %d\n", layout->num_fields);
+  for (i = 0; i < layout->num_fields; i++) {
+    fprintf(fp, "field %s %s %d\n",
+	    VX_REC_FIELD_NAMES[layout->fields[i]],
+	    VX_REC_TYPE_NAMES[VX_REC_FIELD_TYPES[layout->fields[i]]],
+	    layout->offsets[i]);
+  }
+  fprintf(fp, "src_names");
+  for (i = 0; i < 7; i++) {
+    fprintf(fp, " %s", VX_SRC_NAMES[i]);
+  }
+  fprintf(fp, "\nend\n");
+
+  if (ferror(fp)) {
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Read and validate header, filling in layout */
+int vx_rec_read_header(FILE *fp, vx_rec_layout_t *layout)
+{
+  char line[VX_REC_LINE];
+  char key[VX_REC_LINE], name[VX_REC_LINE], type[VX_REC_LINE];
+  int version, offset, size = -1, num = -1;
+
+  if ((fgets(line, VX_REC_LINE, fp) == NULL) ||
+      (sscanf(line, "%s %d", key, &version) != 2) ||
+      (strcmp(key, VX_REC_MAGIC) != 0) || (version != VX_REC_VERSION)) {
+    return(1);
+  }
+
+  layout->num_fields = 0;
+  layout->byteorder = vx_system_endian();
+  while (fgets(line, VX_REC_LINE, fp) != NULL) {
+    if (sscanf(line, "%s", key) != 1) {
+      continue;
+    }
+    if (strcmp(key, "end") == 0) {
+      vx_rec_layout_offsets(layout);
+      if ((layout->num_fields != num) || (layout->record_size != size)) {
+	return(1);
+      }
+      return(0);
+    } else if (strcmp(key, "byteorder") == 0) {
+      if ((sscanf(line, "%*s %s", name) != 1) ||
+	  (vx_rec_parse_byteorder(name, &(layout->byteorder)) != 0)) {
+	return(1);
+      }
+    } else if (strcmp(key, "record_size") == 0) {
+      sscanf(line, "%*s %d", &size);
+    } else if (strcmp(key, "num_fields") == 0) {
+      sscanf(line, "%*s %d", &num);
+    } else if (strcmp(key, "field") == 0) {
+      if ((layout->num_fields >= VX_REC_MAX_FIELDS) ||
+	  (sscanf(line, "%*s %s %s %d", name, type, &offset) != 3) ||
+	  (vx_rec_find_field(name,
+			     &(layout->fields[layout->num_fields])) != 0)) {
+	return(1);
+      }
+      layout->num_fields++;
+    }
+  }
+
+  return(1);
+}
+
+
+/* Copy value into record, swapping if needed */
+static void vx_rec_put(char *dst, const void *src, int esize, int swap)
+{
+  memcpy(dst, src, esize);
+  if (swap) {
+    vx_rec_swap(dst, esize);
+  }
+}
+
+
+/* Pack entry into a record of layout->record_size bytes */
+void vx_rec_pack(vx_rec_layout_t *layout, vx_entry_t *entry, char *buf)
+{
+  int i, swap;
+  int ival = 0;
+  float fval = 0.0;
+  double dval = 0.0;
+  vx_rec_type_t type;
+
+  swap = (layout->byteorder != vx_system_endian());
+
+  for (i = 0; i < layout->num_fields; i++) {
+    switch (layout->fields[i]) {
+    case VX_REC_X: dval = entry->coor[0]; break;
+    case VX_REC_Y: dval = entry->coor[1]; break;
+    case VX_REC_Z: dval = entry->coor[2]; break;
+    case VX_REC_UTMX: dval = entry->coor_utm[0]; break;
+    case VX_REC_UTMY: dval = entry->coor_utm[1]; break;
+    case VX_REC_ELEVX: fval = entry->elev_cell[0]; break;
+    case VX_REC_ELEVY: fval = entry->elev_cell[1]; break;
+    case VX_REC_TOPO: fval = entry->topo; break;
+    case VX_REC_MTOP: fval = entry->mtop; break;
+    case VX_REC_BASE: fval = entry->base; break;
+    case VX_REC_MOHO: fval = entry->moho; break;
+    case VX_REC_SRC: ival = (int)entry->data_src; break;
+    case VX_REC_CELLX: fval = entry->vel_cell[0]; break;
+    case VX_REC_CELLY: fval = entry->vel_cell[1]; break;
+    case VX_REC_CELLZ: fval = entry->vel_cell[2]; break;
+    case VX_REC_TAG: fval = entry->provenance; break;
+    case VX_REC_VP: fval = entry->vp; break;
+    case VX_REC_VS: fval = entry->vs; break;
+    case VX_REC_RHO: dval = entry->rho; break;
+    default: continue;
+    }
+
+    type = VX_REC_FIELD_TYPES[layout->fields[i]];
+    switch (type) {
+    case VX_REC_TYPE_F32:
+      vx_rec_put(&buf[layout->offsets[i]], &fval, 4, swap);
+      break;
+    case VX_REC_TYPE_F64:
+      vx_rec_put(&buf[layout->offsets[i]], &dval, 8, swap);
+      break;
+    case VX_REC_TYPE_I32:
+      vx_rec_put(&buf[layout->offsets[i]], &ival, 4, swap);
+      break;
+    }
+  }
+}
+
+
+/* Unpack record into entry. Fields absent from layout are untouched */
+void vx_rec_unpack(vx_rec_layout_t *layout, const char *buf,
+		   vx_entry_t *entry)
+{
+  int i, swap;
+  int ival = 0;
+  float fval = 0.0;
+  double dval = 0.0;
+
+  swap = (layout->byteorder != vx_system_endian());
+
+  for (i = 0; i < layout->num_fields; i++) {
+    switch (VX_REC_FIELD_TYPES[layout->fields[i]]) {
+    case VX_REC_TYPE_F32:
+      vx_rec_put((char *)&fval, &buf[layout->offsets[i]], 4, swap);
+      break;
+    case VX_REC_TYPE_F64:
+      vx_rec_put((char *)&dval, &buf[layout->offsets[i]], 8, swap);
+      break;
+    case VX_REC_TYPE_I32:
+      vx_rec_put((char *)&ival, &buf[layout->offsets[i]], 4, swap);
+      break;
+    }
+
+    switch (layout->fields[i]) {
+    case VX_REC_X: entry->coor[0] = dval; break;
+    case VX_REC_Y: entry->coor[1] = dval; break;
+    case VX_REC_Z: entry->coor[2] = dval; break;
+    case VX_REC_UTMX: entry->coor_utm[0] = dval; break;
+    case VX_REC_UTMY: entry->coor_utm[1] = dval; break;
+    case VX_REC_ELEVX: entry->elev_cell[0] = fval; break;
+    case VX_REC_ELEVY: entry->elev_cell[1] = fval; break;
+    case VX_REC_TOPO: entry->topo = fval; break;
+    case VX_REC_MTOP: entry->mtop = fval; break;
+    case VX_REC_BASE: entry->base = fval; break;
+    case VX_REC_MOHO: entry->moho = fval; break;
+    case VX_REC_SRC: entry->data_src = (vx_src_t)ival; break;
+    case VX_REC_CELLX: entry->vel_cell[0] = fval; break;
+    case VX_REC_CELLY: entry->vel_cell[1] = fval; break;
+    case VX_REC_CELLZ: entry->vel_cell[2] = fval; break;
+    case VX_REC_TAG: entry->provenance = fval; break;
+    case VX_REC_VP: entry->vp = fval; break;
+    case VX_REC_VS: entry->vs = fval; break;
+    case VX_REC_RHO: entry->rho = dval; break;
+    default: break;
+    }
+  }
+}
+
+
+/* Convert raw triplets already in memory */
+void vx_rec_decode_coords(const char *buf, int esize,
+			  vx_byteorder_t byteorder, double *xyz, size_t n)
+{
+  size_t i;
+  int swap;
+  char val[8];
+  float fval;
+
+  swap = (byteorder != vx_system_endian());
+
+  for (i = 0; i < n * 3; i++) {
+    memcpy(val, &buf[i * esize], esize);
+    if (swap) {
+      vx_rec_swap(val, esize);
+    }
+    if (esize == 4) {
+      memcpy(&fval, val, 4);
+      xyz[i] = fval;
+    } else {
+      memcpy(&xyz[i], val, 8);
+    }
+  }
+}
+
+
+/* Read up to 'n' raw x,y,z triplets of size 'esize' (4 or 8) in byte
+   order 'byteorder'. Returns number of triplets read */
+size_t vx_rec_read_coords(FILE *fp, int esize, vx_byteorder_t byteorder,
+			  double *xyz, size_t n)
+{
+  char buf[VX_REC_READ_CHUNK * 3 * 8];
+  size_t total = 0;
+  size_t want, got;
+
+  if ((esize != 4) && (esize != 8)) {
+    return(0);
+  }
+
+  while (total < n) {
+    want = n - total;
+    if (want > VX_REC_READ_CHUNK) {
+      want = VX_REC_READ_CHUNK;
+    }
+    got = fread(buf, 3 * esize, want, fp);
+    vx_rec_decode_coords(buf, esize, byteorder, &xyz[total * 3], got);
+    total += got;
+    if (got < want) {
+      break;
+    }
+  }
+
+  return(total);
+}
@@ -0,0 +1,93 @@
+#ifndef VX_REC_H
+#define VX_REC_H
+
+#include <stdio.h>
+#include "vx_sub.h"
+#include "utils.h"
+
+/* Max number of fields in a record */
+#define VX_REC_MAX_FIELDS 19
+
+/* Header magic */
+#define VX_REC_MAGIC "VXREC"
+#define VX_REC_VERSION 1
+
+
+/* Record fields, in the same order as the vx_lite text columns */
+typedef enum { VX_REC_X = 0,
+	       VX_REC_Y,
+	       VX_REC_Z,
+	       VX_REC_UTMX,
+	       VX_REC_UTMY,
+	       VX_REC_ELEVX,
+	       VX_REC_ELEVY,
+	       VX_REC_TOPO,
+	       VX_REC_MTOP,
+	       VX_REC_BASE,
+	       VX_REC_MOHO,
+	       VX_REC_SRC,
+	       VX_REC_CELLX,
+	       VX_REC_CELLY,
+	       VX_REC_CELLZ,
+	       VX_REC_TAG,
+	       VX_REC_VP,
+	       VX_REC_VS,
+	       VX_REC_RHO } vx_rec_field_t;
+
+
+/* Field value types */
+typedef enum { VX_REC_TYPE_F32 = 0,
+	       VX_REC_TYPE_F64,
+	       VX_REC_TYPE_I32 } vx_rec_type_t;
+
+
+/* Record layout */
+typedef struct vx_rec_layout_t
+{
+  int num_fields;
+  vx_rec_field_t fields[VX_REC_MAX_FIELDS];
+  int offsets[VX_REC_MAX_FIELDS];
+  int record_size;
+  vx_byteorder_t byteorder;
+} vx_rec_layout_t;
+
+
+/* Field names and types, indexed by vx_rec_field_t */
+extern char *VX_REC_FIELD_NAMES[VX_REC_MAX_FIELDS];
+extern vx_rec_type_t VX_REC_FIELD_TYPES[VX_REC_MAX_FIELDS];
+extern char *VX_REC_TYPE_NAMES[3];
+
+
+/* Parse comma separated field list (or "all") into layout */
+int vx_rec_parse_fields(const char *list, vx_byteorder_t byteorder,
+			vx_rec_layout_t *layout);
+
+/* Parse byte order name (lsb/msb/native) */
+int vx_rec_parse_byteorder(const char *name, vx_byteorder_t *byteorder);
+
+/* Write self-describing header for layout */
+int vx_rec_write_header(FILE *fp, vx_rec_layout_t *layout);
+
+/* Read and validate header, filling in layout */
+int vx_rec_read_header(FILE *fp, vx_rec_layout_t *layout);
+
+/* Pack entry into a record of layout->record_size bytes */
+void vx_rec_pack(vx_rec_layout_t *layout, vx_entry_t *entry, char *buf);
+
+/* Unpack record into entry. Fields absent from layout are untouched */
+void vx_rec_unpack(vx_rec_layout_t *layout, const char *buf,
+		   vx_entry_t *entry);
+
+/* Read up to 'n' raw x,y,z triplets of size 'esize' (4 or 8) in byte
+   order 'byteorder'. Returns number of triplets read */
+size_t vx_rec_read_coords(FILE *fp, int esize, vx_byteorder_t byteorder,
+			  double *xyz, size_t n);
+
+/* Convert raw triplets already in memory */
+void vx_rec_decode_coords(const char *buf, int esize,
+			  vx_byteorder_t byteorder, double *xyz, size_t n);
+
+/* Swap byte order of value of size 'esize' in place */
+void vx_rec_swap(char *buf, int esize);
+
+#endif
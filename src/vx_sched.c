@@ -0,0 +1,366 @@
+/** vx_sched.c - Work-stealing scheduler for parallel batch queries.
+    Tasks are seeded to threads by estimated cost, from the query path
+    of sampled points, and idle threads steal from the thread with the
+    most estimated work left, so expensive background and GTL regions
+    do not leave a long tail.
+
+10/2026: Initial implementation
+**/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "params.h"
+#include "vx_sub.h"
+#include "vx_stats.h"
+#include "vx_sched.h"
+
+
+/* Relative cost of each query path, indexed by vx_path_t */
+static const double vx_sched_path_cost[VX_PATH_NUM] = {1.0, 2.0, 8.0,
+						       1.0, 0.2};
+
+
+/* Range of tasks left to a thread. The owner takes tasks from the
+   head, thieves from the tail */
+typedef struct vx_sched_deque_t
+{
+  size_t head;
+  size_t tail;
+  pthread_mutex_t lock;
+} vx_sched_deque_t;
+
+
+/* Shared scheduler state */
+typedef struct vx_sched_t
+{
+  int num_threads;
+  const double *prefix;      /* cumulative task costs, NULL if equal */
+  vx_sched_deque_t *deques;
+  int (*work)(size_t task, void *arg);
+  void *arg;
+  vx_sched_thread_t *threads;
+  int retval;
+  pthread_mutex_t lock;
+} vx_sched_t;
+
+
+/* Argument of scheduler thread */
+typedef struct vx_sched_arg_t
+{
+  vx_sched_t *sched;
+  int id;
+} vx_sched_arg_t;
+
+
+/* Query task of vx_getcoord_parallel */
+typedef struct vx_sched_query_t
+{
+  vx_entry_t *entries;
+  size_t n;
+} vx_sched_query_t;
+
+
+/* Estimated cost of task range */
+static double vx_sched_range_cost(const vx_sched_t *sched, size_t head,
+				  size_t tail)
+{
+  if (sched->prefix == NULL) {
+    return((double)(tail - head));
+  }
+  return(sched->prefix[tail] - sched->prefix[head]);
+}
+
+
+/* Take next own task. Returns 1 if none is left */
+static int vx_sched_pop(vx_sched_t *sched, int id, size_t *task)
+{
+  vx_sched_deque_t *dq = &(sched->deques[id]);
+  int retval = 1;
+
+  pthread_mutex_lock(&(dq->lock));
+  if (dq->head < dq->tail) {
+    *task = dq->head++;
+    retval = 0;
+  }
+  pthread_mutex_unlock(&(dq->lock));
+  return(retval);
+}
+
+
+/* Steal last task of the thread with the most estimated work left.
+   Returns 1 if no thread has work left */
+static int vx_sched_steal(vx_sched_t *sched, int id, size_t *task)
+{
+  vx_sched_deque_t *dq;
+  double cost, best;
+  int i, victim;
+
+  while (1) {
+    victim = -1;
+    best = 0.0;
+    for (i = 0; i < sched->num_threads; i++) {
+      if (i == id) {
+	continue;
+      }
+      dq = &(sched->deques[i]);
+      pthread_mutex_lock(&(dq->lock));
+      if (dq->head < dq->tail) {
+	cost = vx_sched_range_cost(sched, dq->head, dq->tail);
+	if ((victim < 0) || (cost > best)) {
+	  victim = i;
+	  best = cost;
+	}
+      }
+      pthread_mutex_unlock(&(dq->lock));
+    }
+    if (victim < 0) {
+      return(1);
+    }
+
+    /* The victim may have run out since the scan */
+    dq = &(sched->deques[victim]);
+    pthread_mutex_lock(&(dq->lock));
+    if (dq->head < dq->tail) {
+      *task = --dq->tail;
+      pthread_mutex_unlock(&(dq->lock));
+      return(0);
+    }
+    pthread_mutex_unlock(&(dq->lock));
+  }
+}
+
+
+/* Scheduler thread */
+static void *vx_sched_thread(void *ptr)
+{
+  vx_sched_arg_t *arg = (vx_sched_arg_t *)ptr;
+  vx_sched_t *sched = arg->sched;
+  vx_sched_thread_t *th = &(sched->threads[arg->id]);
+  unsigned long long t0;
+  size_t task;
+  int retval = 0;
+
+  while (1) {
+    if (vx_sched_pop(sched, arg->id, &task) != 0) {
+      if (vx_sched_steal(sched, arg->id, &task) != 0) {
+	break;
+      }
+      th->steals++;
+    }
+    t0 = vx_stats_now();
+    retval |= sched->work(task, sched->arg);
+    th->busy_s += (vx_stats_now() - t0) * 1.0e-9;
+    th->tasks++;
+  }
+
+  if (retval != 0) {
+    pthread_mutex_lock(&(sched->lock));
+    sched->retval = 1;
+    pthread_mutex_unlock(&(sched->lock));
+  }
+  return(NULL);
+}
+
+
+/* Run tasks with work stealing */
+int vx_sched_run(size_t num_tasks, int num_threads, const double *cost,
+		 int (*work)(size_t task, void *arg), void *arg,
+		 vx_sched_report_t *report)
+{
+  vx_sched_t sched;
+  vx_sched_arg_t *args;
+  pthread_t *tids;
+  double *prefix = NULL, share;
+  unsigned long long start;
+  size_t i, t;
+  int id;
+
+  if (num_threads < 1) {
+    num_threads = 1;
+  } else if (num_threads > VX_SCHED_MAX_THREADS) {
+    num_threads = VX_SCHED_MAX_THREADS;
+  }
+  if ((size_t)num_threads > num_tasks) {
+    num_threads = (num_tasks > 0) ? (int)num_tasks : 1;
+  }
+
+  memset(&sched, 0, sizeof(vx_sched_t));
+  sched.num_threads = num_threads;
+  sched.work = work;
+  sched.arg = arg;
+  sched.deques = malloc(num_threads * sizeof(vx_sched_deque_t));
+  sched.threads = calloc(num_threads, sizeof(vx_sched_thread_t));
+  tids = malloc(num_threads * sizeof(pthread_t));
+  args = malloc(num_threads * sizeof(vx_sched_arg_t));
+  if (cost != NULL) {
+    prefix = malloc((num_tasks + 1) * sizeof(double));
+  }
+  if ((sched.deques == NULL) || (sched.threads == NULL) ||
+      (tids == NULL) || (args == NULL) ||
+      ((cost != NULL) && (prefix == NULL))) {
+    free(sched.deques);
+    free(sched.threads);
+    free(tids);
+    free(args);
+    free(prefix);
+    return(1);
+  }
+
+  /* Seed contiguous ranges of about equal estimated cost */
+  if (prefix != NULL) {
+    prefix[0] = 0.0;
+    for (i = 0; i < num_tasks; i++) {
+      prefix[i + 1] = prefix[i] + cost[i];
+    }
+    sched.prefix = prefix;
+  }
+  share = vx_sched_range_cost(&sched, 0, num_tasks) / num_threads;
+  for (id = 0, t = 0; id < num_threads; id++) {
+    sched.deques[id].head = t;
+    if (id == num_threads - 1) {
+      t = num_tasks;
+    } else {
+      while ((t < num_tasks) &&
+	     ((t == sched.deques[id].head) ||
+	      (vx_sched_range_cost(&sched, 0, t + 1) <= share * (id + 1)))) {
+	t++;
+      }
+    }
+    sched.deques[id].tail = t;
+    sched.threads[id].seeded_cost =
+      vx_sched_range_cost(&sched, sched.deques[id].head, t);
+    pthread_mutex_init(&(sched.deques[id].lock), NULL);
+  }
+  pthread_mutex_init(&(sched.lock), NULL);
+
+  /* The calling thread is thread 0 */
+  start = vx_stats_now();
+  for (id = 0; id < num_threads; id++) {
+    args[id].sched = &sched;
+    args[id].id = id;
+    if (id > 0) {
+      pthread_create(&tids[id], NULL, vx_sched_thread, &args[id]);
+    }
+  }
+  vx_sched_thread(&args[0]);
+  for (id = 1; id < num_threads; id++) {
+    pthread_join(tids[id], NULL);
+  }
+
+  if (report != NULL) {
+    report->num_threads = num_threads;
+    report->num_tasks = num_tasks;
+    report->wall_s = (vx_stats_now() - start) * 1.0e-9;
+    memcpy(report->threads, sched.threads,
+	   num_threads * sizeof(vx_sched_thread_t));
+  }
+
+  for (id = 0; id < num_threads; id++) {
+    pthread_mutex_destroy(&(sched.deques[id].lock));
+  }
+  pthread_mutex_destroy(&(sched.lock));
+  free(sched.deques);
+  free(sched.threads);
+  free(tids);
+  free(args);
+  free(prefix);
+  return(sched.retval);
+}
+
+
+/* Estimated cost of points from sampled query paths */
+double vx_sched_cost(const vx_entry_t *entries, size_t n)
+{
+  double sum = 0.0;
+  size_t i, step;
+  int k = 0;
+
+  if (n == 0) {
+    return(0.0);
+  }
+  step = (n + VX_SCHED_SAMPLES - 1) / VX_SCHED_SAMPLES;
+  for (i = step / 2; i < n; i += step) {
+    sum += vx_sched_path_cost[vx_classify(&(entries[i]))];
+    k++;
+  }
+  return(sum / k * n);
+}
+
+
+/* Query task */
+static int vx_sched_query(size_t task, void *arg)
+{
+  vx_sched_query_t *q = (vx_sched_query_t *)arg;
+  size_t start = task * VX_SCHED_CHUNK;
+  size_t len = VX_SCHED_CHUNK;
+
+  if (start + len > q->n) {
+    len = q->n - start;
+  }
+  return(vx_getcoord_batch(&(q->entries[start]), len));
+}
+
+
+/* Query array of points on several threads */
+int vx_getcoord_parallel(vx_entry_t *entries, size_t n, int num_threads,
+			 vx_sched_report_t *report)
+{
+  vx_sched_query_t q;
+  double *cost;
+  size_t num_tasks, i, len;
+  int retval;
+
+  num_tasks = (n + VX_SCHED_CHUNK - 1) / VX_SCHED_CHUNK;
+  cost = malloc((num_tasks + 1) * sizeof(double));
+  if (cost == NULL) {
+    return(1);
+  }
+  for (i = 0; i < num_tasks; i++) {
+    len = ((i + 1) * VX_SCHED_CHUNK <= n) ? VX_SCHED_CHUNK :
+      n - i * VX_SCHED_CHUNK;
+    cost[i] = vx_sched_cost(&(entries[i * VX_SCHED_CHUNK]), len);
+  }
+
+  q.entries = entries;
+  q.n = n;
+  retval = vx_sched_run(num_tasks, num_threads, cost, vx_sched_query, &q,
+			report);
+  free(cost);
+  return(retval);
+}
+
+
+/* Format per-thread utilisation */
+int vx_sched_text(const vx_sched_report_t *report, char *buf, size_t len)
+{
+  const vx_sched_thread_t *th;
+  size_t n = 0;
+  int i;
+
+#define VX_SCHED_PRINT(...) \
+  n += snprintf(&buf[n], (n < len) ? len - n : 0, __VA_ARGS__); \
+  if (n > len) n = len;
+
+  if (len == 0) {
+    return(0);
+  }
+  buf[0] = '\0';
+
+  VX_SCHED_PRINT("threads %d tasks %llu wall_s %.6f\n",
+		 report->num_threads, report->num_tasks, report->wall_s);
+  VX_SCHED_PRINT("%-6s %10s %8s %12s %10s %6s\n", "thread", "tasks",
+		 "steals", "seeded_cost", "busy_s", "util");
+  for (i = 0; i < report->num_threads; i++) {
+    th = &(report->threads[i]);
+    VX_SCHED_PRINT("%-6d %10llu %8llu %12.1f %10.6f %5.1f%%\n", i,
+		   th->tasks, th->steals, th->seeded_cost, th->busy_s,
+		   (report->wall_s > 0.0) ?
+		   100.0 * th->busy_s / report->wall_s : 0.0);
+  }
+
+#undef VX_SCHED_PRINT
+
+  return(n);
+}
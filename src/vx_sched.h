@@ -0,0 +1,60 @@
+#ifndef VX_SCHED_H
+#define VX_SCHED_H
+
+#include <stddef.h>
+#include "vx_sub.h"
+
+/* Max number of scheduler threads */
+#define VX_SCHED_MAX_THREADS 256
+
+/* Points per task of vx_getcoord_parallel */
+#define VX_SCHED_CHUNK 256
+
+/* Points sampled per task to estimate its cost */
+#define VX_SCHED_SAMPLES 4
+
+
+/* Counters of one scheduler thread */
+typedef struct vx_sched_thread_t
+{
+  unsigned long long tasks;
+  unsigned long long steals;
+  double seeded_cost;    /* estimated cost of the initial tasks */
+  double busy_s;         /* time spent in tasks */
+} vx_sched_thread_t;
+
+
+/* Scheduler run report */
+typedef struct vx_sched_report_t
+{
+  int num_threads;
+  unsigned long long num_tasks;
+  double wall_s;
+  vx_sched_thread_t threads[VX_SCHED_MAX_THREADS];
+} vx_sched_report_t;
+
+
+/* Run tasks 0 to 'num_tasks' - 1 on 'num_threads' threads, the
+   calling thread included. Each thread is seeded with a contiguous
+   range of tasks of about equal estimated 'cost' (NULL for equal
+   costs), and steals single tasks from the end of the range of the
+   thread with the most estimated work left once its own range is
+   done. Returns the OR of the 'work' return values. 'report' may be
+   NULL */
+int vx_sched_run(size_t num_tasks, int num_threads, const double *cost,
+		 int (*work)(size_t task, void *arg), void *arg,
+		 vx_sched_report_t *report);
+
+/* Estimated relative cost of querying the 'n' points 'entries', from
+   the query paths of up to VX_SCHED_SAMPLES points */
+double vx_sched_cost(const vx_entry_t *entries, size_t n);
+
+/* Query array of points on 'num_threads' threads in tasks of
+   VX_SCHED_CHUNK points. Returns 1 if any point failed */
+int vx_getcoord_parallel(vx_entry_t *entries, size_t n, int num_threads,
+			 vx_sched_report_t *report);
+
+/* Format per-thread utilisation report. Returns length */
+int vx_sched_text(const vx_sched_report_t *report, char *buf, size_t len);
+
+#endif
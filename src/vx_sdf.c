@@ -0,0 +1,454 @@
+/** vx_sdf.c - Precomputed distance grids of model surfaces. Signed
+    distance volumes and surface height grids are filled from the
+    exact vx_bvh queries, sampled by linear interpolation and cached
+    on disk with a key naming the surface file they were built from.
+
+10/2026: Initial implementation
+**/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <stdint.h>
+#include "utils.h"
+#include "vx_rec.h"
+#include "vx_sched.h"
+#include "vx_sdf.h"
+
+
+/* Magic line of grid files */
+#define VX_SDF_MAGIC "VXSDF 1\n"
+
+/* Max length of grid file header lines */
+#define VX_SDF_LINE (VX_SDF_PATH + 64)
+
+
+/* Grid kind names */
+char *VX_SDF_KIND_NAMES[VX_SDF_KIND_NUM] = {"volume", "height"};
+
+
+/* Build task */
+typedef struct vx_sdf_task_t
+{
+  vx_sdf_t *sdf;
+  const vx_bvh_t *bvh;
+} vx_sdf_task_t;
+
+
+/* Allocate grid */
+int vx_sdf_init(vx_sdf_t *sdf, vx_sdf_kind_t kind, const double *min,
+		const double *max, const double *step)
+{
+  size_t n = 1;
+  int k, axes = (kind == VX_SDF_HEIGHT) ? 2 : 3;
+
+  memset(sdf, 0, sizeof(vx_sdf_t));
+  sdf->kind = kind;
+  sdf->dims[2] = 1;
+  for (k = 0; k < axes; k++) {
+    if (!(step[k] > 0.0) || !(max[k] > min[k])) {
+      fprintf(stderr, "Invalid grid axis %d\n", k);
+      return(1);
+    }
+    sdf->origin[k] = min[k];
+    sdf->step[k] = step[k];
+    sdf->dims[k] = (size_t)floor((max[k] - min[k]) / step[k] + 0.5) + 1;
+    if (sdf->dims[k] < 2) {
+      sdf->dims[k] = 2;
+    }
+    if ((sdf->dims[k] > ((size_t)1 << 20)) || (n > SIZE_MAX / sdf->dims[k])) {
+      fprintf(stderr, "Grid too large\n");
+      return(1);
+    }
+    n *= sdf->dims[k];
+  }
+  sdf->max_err = NAN;
+  sdf->rms_err = NAN;
+
+  sdf->data = malloc(n * sizeof(float));
+  if (sdf->data == NULL) {
+    fprintf(stderr, "Failed to allocate grid of %zu nodes\n", n);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Free grid */
+void vx_sdf_free(vx_sdf_t *sdf)
+{
+  free(sdf->data);
+  memset(sdf, 0, sizeof(vx_sdf_t));
+}
+
+
+/* Fill one x row of the grid */
+static int vx_sdf_task(size_t task, void *arg)
+{
+  vx_sdf_task_t *a = (vx_sdf_task_t *)arg;
+  vx_sdf_t *sdf = a->sdf;
+  size_t i, nx = sdf->dims[0];
+  size_t j = task % sdf->dims[1], k = task / sdf->dims[1];
+  float *row = &(sdf->data[task * nx]);
+  double *xyz, *hit, *dist;
+  double y = sdf->origin[1] + j * sdf->step[1];
+
+  if (sdf->kind == VX_SDF_HEIGHT) {
+    for (i = 0; i < nx; i++) {
+      row[i] = vx_bvh_height(a->bvh, sdf->origin[0] + i * sdf->step[0], y);
+    }
+    return(0);
+  }
+
+  xyz = calloc(nx * 3, sizeof(double));
+  hit = malloc(nx * 3 * sizeof(double));
+  dist = malloc(nx * sizeof(double));
+  if ((xyz == NULL) || (hit == NULL) || (dist == NULL)) {
+    free(xyz);
+    free(hit);
+    free(dist);
+    return(1);
+  }
+  for (i = 0; i < nx; i++) {
+    xyz[i * 3] = sdf->origin[0] + i * sdf->step[0];
+    xyz[i * 3 + 1] = y;
+    xyz[i * 3 + 2] = sdf->origin[2] + k * sdf->step[2];
+  }
+  vx_bvh_closest_batch(a->bvh, xyz, nx, hit, dist, NULL);
+  for (i = 0; i < nx; i++) {
+    row[i] = (xyz[i * 3 + 2] < hit[i * 3 + 2]) ? -dist[i] : dist[i];
+  }
+  free(xyz);
+  free(hit);
+  free(dist);
+  return(0);
+}
+
+
+/* Fill grid */
+int vx_sdf_build(vx_sdf_t *sdf, const vx_bvh_t *bvh, int num_threads)
+{
+  vx_sdf_task_t arg;
+
+  arg.sdf = sdf;
+  arg.bvh = bvh;
+  if (vx_sched_run(sdf->dims[1] * sdf->dims[2], num_threads, NULL,
+		   vx_sdf_task, &arg, NULL) != 0) {
+    fprintf(stderr, "Failed to fill grid\n");
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Exact value */
+double vx_sdf_exact(vx_sdf_kind_t kind, const vx_bvh_t *bvh,
+		    const double *p)
+{
+  double hit[3], d;
+
+  if (kind == VX_SDF_HEIGHT) {
+    return(p[2] - vx_bvh_height(bvh, p[0], p[1]));
+  }
+  d = vx_bvh_closest(bvh, p, hit, NULL);
+  return((p[2] < hit[2]) ? -d : d);
+}
+
+
+/* Lower node index and weight of coordinate 'c' on axis 'k'. Returns
+   1 outside the grid */
+static inline int vx_sdf_cell(const vx_sdf_t *sdf, int k, double c,
+			      size_t *i, double *w)
+{
+  double g = (c - sdf->origin[k]) / sdf->step[k];
+
+  if (!(g >= 0.0) || (g > (double)(sdf->dims[k] - 1))) {
+    return(1);
+  }
+  *i = (size_t)g;
+  if (*i > sdf->dims[k] - 2) {
+    *i = sdf->dims[k] - 2;
+  }
+  *w = g - *i;
+  return(0);
+}
+
+
+/* Interpolated value */
+double vx_sdf_sample(const vx_sdf_t *sdf, const double *p)
+{
+  const float *c;
+  size_t i, j, k, nx = sdf->dims[0], nxy = nx * sdf->dims[1];
+  double u, v, w, lo, hi;
+
+  if (vx_sdf_cell(sdf, 0, p[0], &i, &u) || vx_sdf_cell(sdf, 1, p[1], &j, &v)) {
+    return(NAN);
+  }
+
+  if (sdf->kind == VX_SDF_HEIGHT) {
+    c = &(sdf->data[j * nx + i]);
+    lo = c[0] + u * (c[1] - c[0]);
+    hi = c[nx] + u * (c[nx + 1] - c[nx]);
+    return(p[2] - (lo + v * (hi - lo)));
+  }
+
+  if (vx_sdf_cell(sdf, 2, p[2], &k, &w)) {
+    return(NAN);
+  }
+  c = &(sdf->data[k * nxy + j * nx + i]);
+  lo = (1.0 - v) * (c[0] + u * (c[1] - c[0])) +
+    v * (c[nx] + u * (c[nx + 1] - c[nx]));
+  c += nxy;
+  hi = (1.0 - v) * (c[0] + u * (c[1] - c[0])) +
+    v * (c[nx] + u * (c[nx + 1] - c[nx]));
+  return(lo + w * (hi - lo));
+}
+
+
+/* Interpolated values of batch */
+void vx_sdf_sample_batch(const vx_sdf_t *sdf, const double *xyz, size_t n,
+			 double *val)
+{
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    val[i] = vx_sdf_sample(sdf, &xyz[i * 3]);
+  }
+}
+
+
+/* Error estimate at random points, from a fixed seed so repeated
+   builds report the same numbers */
+size_t vx_sdf_error(vx_sdf_t *sdf, const vx_bvh_t *bvh, size_t num_samples)
+{
+  uint64_t s = 0x9e3779b97f4a7c15ULL;
+  double p[3], d, max = 0.0, sum = 0.0;
+  size_t i, num = 0;
+  int k;
+
+  for (i = 0; i < num_samples; i++) {
+    for (k = 0; k < 3; k++) {
+      s ^= s << 13;
+      s ^= s >> 7;
+      s ^= s << 17;
+      p[k] = sdf->origin[k] + (s >> 11) * (1.0 / 9007199254740992.0) *
+	(sdf->dims[k] - 1) * sdf->step[k];
+    }
+    if (sdf->kind == VX_SDF_HEIGHT) {
+      p[2] = 0.0;
+    }
+    d = fabs(vx_sdf_sample(sdf, p) - vx_sdf_exact(sdf->kind, bvh, p));
+    if (isnan(d)) {
+      continue;
+    }
+    if (d > max) {
+      max = d;
+    }
+    sum += d * d;
+    num++;
+  }
+
+  sdf->max_err = (num > 0) ? max : NAN;
+  sdf->rms_err = (num > 0) ? sqrt(sum / num) : NAN;
+  return(num);
+}
+
+
+/* Save grid */
+int vx_sdf_write(const char *path, const vx_sdf_t *sdf, const char *key)
+{
+  FILE *fp;
+  size_t n = sdf->dims[0] * sdf->dims[1] * sdf->dims[2];
+  int retval = 0;
+
+  fp = fopen(path, "wb");
+  if (fp == NULL) {
+    fprintf(stderr, "Failed to open grid file %s\n", path);
+    return(1);
+  }
+  fputs(VX_SDF_MAGIC, fp);
+  fprintf(fp, "KEY %s\n", (key != NULL) ? key : "");
+  fprintf(fp, "KIND %s\n", VX_SDF_KIND_NAMES[sdf->kind]);
+  fprintf(fp, "ORIGIN %.17g %.17g %.17g\n", sdf->origin[0], sdf->origin[1],
+	  sdf->origin[2]);
+  fprintf(fp, "STEP %.17g %.17g %.17g\n", sdf->step[0], sdf->step[1],
+	  sdf->step[2]);
+  fprintf(fp, "DIMS %zu %zu %zu\n", sdf->dims[0], sdf->dims[1],
+	  sdf->dims[2]);
+  fprintf(fp, "ERROR %.17g %.17g\n", sdf->max_err, sdf->rms_err);
+  fprintf(fp, "BYTEORDER %s\n",
+	  (vx_system_endian() == VX_BYTEORDER_LSB) ? "lsb" : "msb");
+  fprintf(fp, "END\n");
+  if (fwrite(sdf->data, sizeof(float), n, fp) != n) {
+    retval = 1;
+  }
+  if ((fclose(fp) != 0) || (retval != 0)) {
+    fprintf(stderr, "Failed to write grid file %s\n", path);
+    remove(path);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Load grid */
+int vx_sdf_read(const char *path, vx_sdf_t *sdf, const char *key)
+{
+  FILE *fp;
+  char line[VX_SDF_LINE], kind[16], order[16] = "";
+  size_t i, n, len;
+  int k, fields = 0;
+
+  memset(sdf, 0, sizeof(vx_sdf_t));
+  fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return(1);
+  }
+  if ((fgets(line, sizeof(line), fp) == NULL) ||
+      (strcmp(line, VX_SDF_MAGIC) != 0)) {
+    fclose(fp);
+    return(1);
+  }
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    len = strlen(line);
+    if ((len > 0) && (line[len - 1] == '\n')) {
+      line[--len] = '\0';
+    }
+    if (strcmp(line, "END") == 0) {
+      break;
+    } else if (strncmp(line, "KEY ", 4) == 0) {
+      if ((key != NULL) && (strcmp(&line[4], key) != 0)) {
+	fclose(fp);
+	return(1);
+      }
+      fields++;
+    } else if (sscanf(line, "KIND %15s", kind) == 1) {
+      for (k = 0; k < VX_SDF_KIND_NUM; k++) {
+	if (strcmp(kind, VX_SDF_KIND_NAMES[k]) == 0) {
+	  sdf->kind = (vx_sdf_kind_t)k;
+	  fields++;
+	}
+      }
+    } else if ((sscanf(line, "ORIGIN %lf %lf %lf", &sdf->origin[0],
+		       &sdf->origin[1], &sdf->origin[2]) == 3) ||
+	       (sscanf(line, "STEP %lf %lf %lf", &sdf->step[0],
+		       &sdf->step[1], &sdf->step[2]) == 3) ||
+	       (sscanf(line, "DIMS %zu %zu %zu", &sdf->dims[0],
+		       &sdf->dims[1], &sdf->dims[2]) == 3) ||
+	       (sscanf(line, "ERROR %lf %lf", &sdf->max_err,
+		       &sdf->rms_err) == 2) ||
+	       (sscanf(line, "BYTEORDER %15s", order) == 1)) {
+      fields++;
+    }
+  }
+
+  if ((fields != 7) || (sdf->dims[0] < 2) || (sdf->dims[1] < 2) ||
+      (sdf->dims[0] > ((size_t)1 << 20)) || (sdf->dims[1] > ((size_t)1 << 20)) ||
+      (sdf->dims[2] > ((size_t)1 << 20)) ||
+      ((sdf->kind == VX_SDF_VOLUME) ? (sdf->dims[2] < 2) :
+       (sdf->dims[2] != 1))) {
+    fprintf(stderr, "Invalid grid file %s\n", path);
+    fclose(fp);
+    memset(sdf, 0, sizeof(vx_sdf_t));
+    return(1);
+  }
+
+  n = sdf->dims[0] * sdf->dims[1] * sdf->dims[2];
+  sdf->data = malloc(n * sizeof(float));
+  if ((sdf->data == NULL) || (fread(sdf->data, sizeof(float), n, fp) != n)) {
+    fprintf(stderr, "Failed to read grid file %s\n", path);
+    fclose(fp);
+    vx_sdf_free(sdf);
+    return(1);
+  }
+  fclose(fp);
+
+  if (strcmp(order, (vx_system_endian() == VX_BYTEORDER_LSB) ?
+	     "lsb" : "msb") != 0) {
+    for (i = 0; i < n; i++) {
+      vx_rec_swap((char *)&(sdf->data[i]), sizeof(float));
+    }
+  }
+  return(0);
+}
+
+
+/* Cache key of spec, with the stamps of the surface files */
+int vx_sdf_key(const vx_sdf_spec_t *spec, char *key, size_t len)
+{
+  uint64_t sum;
+
+  if (vx_mesh_checksum(spec->source, &sum) != 0) {
+    return(1);
+  }
+  if (snprintf(key, len,
+	       "%s files=%016llx %s min=%.17g,%.17g,%.17g "
+	       "max=%.17g,%.17g,%.17g step=%.17g,%.17g,%.17g", spec->source,
+	       (unsigned long long)sum, VX_SDF_KIND_NAMES[spec->kind],
+	       spec->min[0], spec->min[1], spec->min[2], spec->max[0],
+	       spec->max[1], spec->max[2], spec->step[0], spec->step[1],
+	       spec->step[2]) >= (int)len) {
+    fprintf(stderr, "Cache key of %s too long\n", spec->source);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Cached grid of spec */
+int vx_sdf_open(const vx_sdf_spec_t *spec, const char *cache,
+		vx_sdf_t *sdf, int *cached)
+{
+  char key[VX_SDF_LINE];
+  vx_mesh_t mesh;
+  vx_bvh_t bvh;
+  double min[3], max[3];
+  int k, retval;
+
+  if (cached != NULL) {
+    *cached = 0;
+  }
+  if (vx_sdf_key(spec, key, sizeof(key)) != 0) {
+    return(1);
+  }
+  if ((cache != NULL) && (vx_sdf_read(cache, sdf, key) == 0)) {
+    if (cached != NULL) {
+      *cached = 1;
+    }
+    return(0);
+  }
+
+  if (vx_mesh_load(spec->source, &mesh) != 0) {
+    return(1);
+  }
+  retval = vx_bvh_build(&mesh, &bvh);
+  vx_mesh_free(&mesh);
+  if (retval != 0) {
+    return(1);
+  }
+
+  for (k = 0; k < 3; k++) {
+    min[k] = spec->min[k];
+    max[k] = spec->max[k];
+    if (max[k] <= min[k]) {
+      min[k] = bvh.nodes[0].min[k];
+      max[k] = bvh.nodes[0].max[k];
+    }
+  }
+  retval = vx_sdf_init(sdf, spec->kind, min, max, spec->step);
+  if (retval == 0) {
+    retval = vx_sdf_build(sdf, &bvh, spec->num_threads);
+  }
+  if (retval == 0) {
+    vx_sdf_error(sdf, &bvh, spec->num_samples);
+    if ((cache != NULL) && (vx_sdf_write(cache, sdf, key) != 0)) {
+      fprintf(stderr, "Grid of %s not cached\n", spec->source);
+    }
+  } else {
+    vx_sdf_free(sdf);
+  }
+  vx_bvh_free(&bvh);
+  return(retval);
+}
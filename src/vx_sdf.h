@@ -0,0 +1,99 @@
+#ifndef VX_SDF_H
+#define VX_SDF_H
+
+#include <stddef.h>
+#include "vx_mesh.h"
+#include "vx_bvh.h"
+
+/* Max length of source paths and cache keys */
+#define VX_SDF_PATH 1024
+
+/* Default number of random points of error estimates */
+#define VX_SDF_SAMPLES 10000
+
+
+/* Grid kinds */
+typedef enum { VX_SDF_VOLUME = 0,
+	       VX_SDF_HEIGHT } vx_sdf_kind_t;
+
+#define VX_SDF_KIND_NUM 2
+
+extern char *VX_SDF_KIND_NAMES[VX_SDF_KIND_NUM];
+
+
+/* Sampled distance grid. Volumes hold the signed distance to the
+   surface at each node, positive where the node is above its closest
+   point. Height grids hold the surface elevation at each x, y node
+   (dims[2] is 1) and sample to the height above the surface */
+typedef struct vx_sdf_t
+{
+  vx_sdf_kind_t kind;
+  double origin[3];
+  double step[3];
+  size_t dims[3];
+  double max_err;            /* estimated errors, NaN if unknown */
+  double rms_err;
+  float *data;               /* x fastest, NaN where undefined */
+} vx_sdf_t;
+
+
+/* Grid of a surface. Axes with max <= min span the bounding box of
+   the surface */
+typedef struct vx_sdf_spec_t
+{
+  vx_sdf_kind_t kind;
+  char source[VX_SDF_PATH];  /* surface, as accepted by vx_mesh_load */
+  double min[3];
+  double max[3];
+  double step[3];
+  size_t num_samples;        /* points of the error estimate, 0 for none */
+  int num_threads;
+} vx_sdf_spec_t;
+
+
+/* Allocate grid of 'kind' covering 'min' to 'max' with node spacing
+   'step'. Returns 1 on failure */
+int vx_sdf_init(vx_sdf_t *sdf, vx_sdf_kind_t kind, const double *min,
+		const double *max, const double *step);
+
+/* Free grid */
+void vx_sdf_free(vx_sdf_t *sdf);
+
+/* Fill grid from surface 'bvh' on 'num_threads' threads. Returns 1
+   on failure */
+int vx_sdf_build(vx_sdf_t *sdf, const vx_bvh_t *bvh, int num_threads);
+
+/* Exact value at 'p' of a grid of 'kind' over surface 'bvh' */
+double vx_sdf_exact(vx_sdf_kind_t kind, const vx_bvh_t *bvh,
+		    const double *p);
+
+/* Value at 'p' by trilinear (bilinear for height grids) interpolation.
+   Returns NaN outside the grid */
+double vx_sdf_sample(const vx_sdf_t *sdf, const double *p);
+
+/* Values of 'n' points 'xyz' */
+void vx_sdf_sample_batch(const vx_sdf_t *sdf, const double *xyz, size_t n,
+			 double *val);
+
+/* Estimate max and rms error of the grid against 'bvh' at
+   'num_samples' random points. Returns number of points compared */
+size_t vx_sdf_error(vx_sdf_t *sdf, const vx_bvh_t *bvh, size_t num_samples);
+
+/* Save grid to 'path', tagged with 'key'. Returns 1 on failure */
+int vx_sdf_write(const char *path, const vx_sdf_t *sdf, const char *key);
+
+/* Load grid saved with 'key' (NULL for any) from 'path'. Returns 1
+   on failure or if the keys differ */
+int vx_sdf_read(const char *path, vx_sdf_t *sdf, const char *key);
+
+/* Cache key of 'spec', with the vx_mesh_checksum of the source */
+int vx_sdf_key(const vx_sdf_spec_t *spec, char *key, size_t len);
+
+/* Grid of 'spec', loaded from file 'cache' if it was built from the
+   same spec and source, otherwise built and saved there. 'cache' may
+   be NULL. '*cached' (may be NULL) tells if it was loaded. Returns 1
+   on failure */
+int vx_sdf_open(const vx_sdf_spec_t *spec, const char *cache,
+		vx_sdf_t *sdf, int *cached);
+
+#endif
@@ -0,0 +1,193 @@
+/**
+    vx_sdfgen - Build signed distance volumes or height grids of model
+    surfaces, cache them on disk and sample them at input points.
+    Accepts Geographic Coordinates or UTM Zone 11 coordinates.
+
+    10/2026: Initial implementation
+**/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <getopt.h>
+#include "params.h"
+#include "vx_sub.h"
+#include "vx_fmt.h"
+#include "vx_sdf.h"
+
+
+/* Default node spacing, meters */
+#define VX_SDFGEN_STEP_XY 1000.0
+#define VX_SDFGEN_STEP_Z 250.0
+
+/* Max length of input line */
+#define VX_SDFGEN_LINE 1024
+
+
+/* Usage function */
+void usage() {
+  printf("     vx_sdfgen - (c) Harvard University, SCEC\n");
+  printf("Build a signed distance volume or a height grid of a model surface,\n");
+  printf("cache it in a grid file and optionally sample it at points read\n");
+  printf("from stdin. The grid file is reused while the surface and the grid\n");
+  printf("settings are unchanged.\n\n");
+  printf("\tusage: vx_sdfgen -s surface -o gridfile [-k volume/height] [-r x1,y1,z1,x2,y2,z2] [-g dx,dy,dz] [-n samples] [-t threads] [-q] < file.in\n\n");
+  printf("Flags:\n");
+  printf("\t-s surface: .ts or .gts file, or interface of a voxet as\n");
+  printf("\t   interfaces.vo:topo, interfaces.vo:base or interfaces.vo:moho.\n");
+  printf("\t-o grid file to load or build.\n");
+  printf("\t-k volume of signed distances (default), or height grid of\n");
+  printf("\t   vertical distances above the surface.\n");
+  printf("\t-r region in UTM meters (default is the surface bounding box).\n");
+  printf("\t-g node spacing in meters (default is %.0f,%.0f,%.0f).\n",
+	 VX_SDFGEN_STEP_XY, VX_SDFGEN_STEP_XY, VX_SDFGEN_STEP_Z);
+  printf("\t-n random points of the error estimate (default is %d).\n",
+	 VX_SDF_SAMPLES);
+  printf("\t-t number of threads (default is 1).\n");
+  printf("\t-q sample the grid at X Y Z points read from stdin.\n\n");
+  printf("Output format is:\n");
+  printf("\tX Y Z value\n\n");
+  printf("Distances are positive above the surface. Points outside the grid\n");
+  printf("and nodes without surface are reported as nan.\n\n");
+  printf("Version: %s\n\n", VERSION);
+  exit (0);
+}
+
+
+/* Sample grid at stdin points */
+int sample_points(const vx_sdf_t *sdf)
+{
+  char line[VX_SDFGEN_LINE], out[VX_SDFGEN_LINE], *p, *end;
+  double xyz[3], utm[3];
+  int k, len;
+
+  while (fgets(line, sizeof(line), stdin) != NULL) {
+    p = line;
+    for (k = 0; k < 3; k++) {
+      xyz[k] = vx_parse_double(p, &end);
+      if (end == p) {
+	break;
+      }
+      p = end;
+    }
+    if (k < 3) {
+      continue;
+    }
+
+    memcpy(utm, xyz, 3 * sizeof(double));
+    if ((xyz[0] < 360.) && (fabs(xyz[1]) < 90.)) {
+      vx_geo2utm(xyz, utm);
+    }
+
+    len = 0;
+    for (k = 0; k < 3; k++) {
+      len += vx_fmt_fixed(&out[len], xyz[k], 0, (k < 2) ? 4 : 2);
+      out[len++] = ' ';
+    }
+    len += vx_fmt_fixed(&out[len], vx_sdf_sample(sdf, utm), 0, 2);
+    out[len++] = '\n';
+    if (fwrite(out, 1, len, stdout) != (size_t)len) {
+      fprintf(stderr, "Failed to write output\n");
+      return(1);
+    }
+  }
+  return(0);
+}
+
+
+int main (int argc, char *argv[])
+{
+  vx_sdf_spec_t spec;
+  vx_sdf_t sdf;
+  char gridfile[CMLEN];
+  int query = False;
+  int cached = 0;
+  int opt, k, retval;
+
+  memset(&spec, 0, sizeof(vx_sdf_spec_t));
+  spec.kind = VX_SDF_VOLUME;
+  spec.step[0] = spec.step[1] = VX_SDFGEN_STEP_XY;
+  spec.step[2] = VX_SDFGEN_STEP_Z;
+  spec.num_samples = VX_SDF_SAMPLES;
+  spec.num_threads = 1;
+  strcpy(gridfile, "");
+
+  /* Parse options */
+  while ((opt = getopt(argc, argv, "g:k:n:o:qr:s:t:h")) != -1) {
+    switch (opt) {
+    case 'g':
+      if (sscanf(optarg, "%lf,%lf,%lf", &spec.step[0], &spec.step[1],
+		 &spec.step[2]) < 2) {
+	fprintf(stderr, "Invalid node spacing %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'k':
+      for (k = 0; k < VX_SDF_KIND_NUM; k++) {
+	if (strcmp(optarg, VX_SDF_KIND_NAMES[k]) == 0) {
+	  break;
+	}
+      }
+      if (k == VX_SDF_KIND_NUM) {
+	fprintf(stderr, "Invalid grid kind %s\n", optarg);
+	exit(1);
+      }
+      spec.kind = (vx_sdf_kind_t)k;
+      break;
+    case 'n':
+      spec.num_samples = (size_t)atol(optarg);
+      break;
+    case 'o':
+      snprintf(gridfile, CMLEN, "%s", optarg);
+      break;
+    case 'q':
+      query = True;
+      break;
+    case 'r':
+      if (sscanf(optarg, "%lf,%lf,%lf,%lf,%lf,%lf", &spec.min[0],
+		 &spec.min[1], &spec.min[2], &spec.max[0], &spec.max[1],
+		 &spec.max[2]) != 6) {
+	fprintf(stderr, "Invalid region %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 's':
+      snprintf(spec.source, VX_SDF_PATH, "%s", optarg);
+      break;
+    case 't':
+      spec.num_threads = atoi(optarg);
+      if (spec.num_threads < 1) {
+	fprintf(stderr, "Invalid thread count %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'h':
+      usage();
+      break;
+    default: /* '?' */
+      usage();
+    }
+  }
+  if ((strlen(spec.source) == 0) || (strlen(gridfile) == 0)) {
+    usage();
+  }
+
+  if (vx_sdf_open(&spec, gridfile, &sdf, &cached) != 0) {
+    fprintf(stderr, "Failed to build grid of %s\n", spec.source);
+    return(1);
+  }
+  fprintf(stderr, "%s: %s grid of %zux%zux%zu nodes, %s\n", gridfile,
+	  VX_SDF_KIND_NAMES[sdf.kind], sdf.dims[0], sdf.dims[1], sdf.dims[2],
+	  cached ? "cached" : "built");
+  fprintf(stderr, "Estimated error: max %.3f m, rms %.3f m\n",
+	  sdf.max_err, sdf.rms_err);
+
+  retval = 0;
+  if (query) {
+    retval = sample_points(&sdf);
+  }
+  vx_sdf_free(&sdf);
+  return(retval);
+}
@@ -0,0 +1,344 @@
+/** vx_serve.c - Message framing for the vx_served query daemon.
+    Clients and server exchange fixed size headers followed by a
+    payload over a local Unix domain socket.
+
+10/2026: Initial implementation
+**/
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "vx_sub.h"
+#include "vx_serve.h"
+
+
+/* Resolve socket path: explicit path, $VX_SERVED_SOCKET, or
+   /tmp/vx_served.<uid>.sock */
+int vx_serve_socket_path(const char *override, char *path)
+{
+  const char *env;
+  int len;
+
+  env = getenv(VX_SERVE_ENV);
+  if (override != NULL) {
+    len = snprintf(path, VX_SERVE_MAX_PATH, "%s", override);
+  } else if ((env != NULL) && (strlen(env) > 0)) {
+    len = snprintf(path, VX_SERVE_MAX_PATH, "%s", env);
+  } else {
+    len = snprintf(path, VX_SERVE_MAX_PATH, "/tmp/vx_served.%d.sock",
+		   (int)getuid());
+  }
+  if ((len < 0) || (len >= VX_SERVE_MAX_PATH)) {
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Connect to server. Returns socket or -1 */
+int vx_serve_connect(const char *path)
+{
+  struct sockaddr_un addr;
+  int fd;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    return(-1);
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return(-1);
+  }
+  if ((connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+      (vx_serve_check_peer(fd) != 0)) {
+    close(fd);
+    return(-1);
+  }
+  return(fd);
+}
+
+
+/* Check the process on the other end of 'fd' runs as this user, so
+   a socket planted in /tmp by someone else is not trusted */
+int vx_serve_check_peer(int fd)
+{
+  struct ucred cred;
+  socklen_t len = sizeof(cred);
+
+  if ((getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) ||
+      (cred.uid != getuid())) {
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Read exactly 'len' bytes */
+int vx_serve_read(int fd, void *buf, size_t len)
+{
+  char *p = buf;
+  ssize_t got;
+
+  while (len > 0) {
+    got = read(fd, p, len);
+    if (got < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return(1);
+    }
+    if (got == 0) {
+      return(1);
+    }
+    p += got;
+    len -= got;
+  }
+  return(0);
+}
+
+
+/* Write exactly 'len' bytes */
+int vx_serve_write(int fd, const void *buf, size_t len)
+{
+  const char *p = buf;
+  ssize_t put;
+
+  while (len > 0) {
+    put = send(fd, p, len, MSG_NOSIGNAL);
+    if (put < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return(1);
+    }
+    p += put;
+    len -= put;
+  }
+  return(0);
+}
+
+
+/* Send request header and payload */
+int vx_serve_send_request(int fd, vx_serve_req_t *req, const void *payload)
+{
+  req->magic = VX_SERVE_MAGIC;
+  req->entry_size = sizeof(vx_entry_t);
+  if (vx_serve_write(fd, req, sizeof(vx_serve_req_t)) != 0) {
+    return(1);
+  }
+  if ((req->len > 0) && (vx_serve_write(fd, payload, req->len) != 0)) {
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Send response header and payload */
+int vx_serve_send_response(int fd, vx_serve_status_t status,
+			   uint32_t count, const void *payload,
+			   uint64_t len)
+{
+  vx_serve_resp_t resp;
+
+  memset(&resp, 0, sizeof(resp));
+  resp.magic = VX_SERVE_MAGIC;
+  resp.status = status;
+  resp.count = count;
+  resp.len = len;
+  if (vx_serve_write(fd, &resp, sizeof(vx_serve_resp_t)) != 0) {
+    return(1);
+  }
+  if ((len > 0) && (vx_serve_write(fd, payload, len) != 0)) {
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Read response header, checking magic and status */
+int vx_serve_read_response(int fd, vx_serve_resp_t *resp)
+{
+  if ((vx_serve_read(fd, resp, sizeof(vx_serve_resp_t)) != 0) ||
+      (resp->magic != VX_SERVE_MAGIC)) {
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Discard 'len' bytes of payload */
+int vx_serve_skip(int fd, uint64_t len)
+{
+  char buf[256];
+  size_t n;
+
+  while (len > 0) {
+    n = (len > sizeof(buf)) ? sizeof(buf) : len;
+    if (vx_serve_read(fd, buf, n) != 0) {
+      return(1);
+    }
+    len -= n;
+  }
+  return(0);
+}
+
+
+/* Client: check server has the model in 'modeldir' loaded. The
+   path is resolved here, the server only accepts absolute paths */
+int vx_serve_hello(int fd, const char *modeldir)
+{
+  vx_serve_req_t req;
+  vx_serve_resp_t resp;
+  char path[PATH_MAX];
+
+  if (realpath(modeldir, path) == NULL) {
+    return(1);
+  }
+  memset(&req, 0, sizeof(req));
+  req.op = VX_SERVE_HELLO;
+  req.len = strlen(path);
+  if ((vx_serve_send_request(fd, &req, path) != 0) ||
+      (vx_serve_read_response(fd, &resp) != 0) ||
+      (vx_serve_skip(fd, resp.len) != 0)) {
+    return(1);
+  }
+  return(resp.status != VX_SERVE_OK);
+}
+
+
+/* Client: query 'n' points with given settings */
+int vx_serve_query(int fd, vx_zmode_t zmode, int flags,
+		   vx_serve_point_t *points, size_t n, vx_entry_t *entries)
+{
+  vx_serve_req_t req;
+  vx_serve_resp_t resp;
+
+  if (n > VX_SERVE_MAX_POINTS) {
+    return(1);
+  }
+  memset(&req, 0, sizeof(req));
+  req.op = VX_SERVE_QUERY;
+  req.zmode = zmode;
+  req.flags = flags;
+  req.count = n;
+  req.len = n * sizeof(vx_serve_point_t);
+  if ((vx_serve_send_request(fd, &req, points) != 0) ||
+      (vx_serve_read_response(fd, &resp) != 0)) {
+    return(1);
+  }
+  if ((resp.status != VX_SERVE_OK) || (resp.count != n) ||
+      (resp.len != n * sizeof(vx_entry_t))) {
+    vx_serve_skip(fd, resp.len);
+    return(1);
+  }
+  return(vx_serve_read(fd, entries, resp.len));
+}
+
+
+/* Client: send STATS or STOP, reply text copied to buf */
+int vx_serve_command(int fd, vx_serve_op_t op, char *buf, size_t len)
+{
+  vx_serve_req_t req;
+  vx_serve_resp_t resp;
+  size_t n;
+
+  memset(&req, 0, sizeof(req));
+  req.op = op;
+  if ((vx_serve_send_request(fd, &req, NULL) != 0) ||
+      (vx_serve_read_response(fd, &resp) != 0)) {
+    return(1);
+  }
+  n = (resp.len < len - 1) ? resp.len : len - 1;
+  if ((vx_serve_read(fd, buf, n) != 0) ||
+      (vx_serve_skip(fd, resp.len - n) != 0)) {
+    return(1);
+  }
+  buf[n] = '\0';
+  return(resp.status != VX_SERVE_OK);
+}
+
+
+/* Histogram bucket of 'us' microseconds */
+static int vx_serve_hist_bucket(double us)
+{
+  uint64_t u;
+  int e = 0;
+  int b;
+
+  if (!(us > 0.0)) {
+    return(0);
+  }
+  if (us >= 1.0e18) {
+    return(VX_SERVE_HIST - 1);
+  }
+  u = (uint64_t)us;
+  if (u < VX_SERVE_HIST_SUB) {
+    return((int)u);
+  }
+
+  /* Power of two and linear sub-bucket below it */
+  while ((u >> (e + 1)) != 0) {
+    e++;
+  }
+  b = VX_SERVE_HIST_SUB * (e - 3) + (int)(u >> (e - 4)) - VX_SERVE_HIST_SUB;
+  return((b < VX_SERVE_HIST) ? b : VX_SERVE_HIST - 1);
+}
+
+
+/* Add a latency of 'us' microseconds to histogram */
+void vx_serve_hist_add(vx_serve_hist_t *hist, double us)
+{
+  hist->count[vx_serve_hist_bucket(us)]++;
+  hist->total++;
+}
+
+
+/* Latency percentile 'p' (0..1) in microseconds, interpolated within
+   the bucket. Returns 0 for an empty histogram */
+double vx_serve_hist_percentile(const vx_serve_hist_t *hist, double p)
+{
+  double rank, lo, width;
+  long sum = 0;
+  int b, e;
+
+  if (hist->total == 0) {
+    return(0.0);
+  }
+  rank = p * hist->total;
+  for (b = 0; b < VX_SERVE_HIST - 1; b++) {
+    if ((hist->count[b] > 0) && (sum + hist->count[b] >= rank)) {
+      break;
+    }
+    sum += hist->count[b];
+  }
+
+  /* Bucket bounds */
+  if (b < VX_SERVE_HIST_SUB) {
+    lo = b;
+    width = 1.0;
+  } else {
+    e = b / VX_SERVE_HIST_SUB + 3;
+    width = (double)((uint64_t)1 << (e - 4));
+    lo = (VX_SERVE_HIST_SUB + b % VX_SERVE_HIST_SUB) * width;
+  }
+  if (hist->count[b] == 0) {
+    return(lo);
+  }
+  rank = (rank - sum) / hist->count[b];
+  if (rank < 0.0) {
+    rank = 0.0;
+  }
+  return(lo + width * rank);
+}
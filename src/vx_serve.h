@@ -0,0 +1,133 @@
+#ifndef VX_SERVE_H
+#define VX_SERVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "vx_sub.h"
+
+/* Message magic "VXS1" */
+#define VX_SERVE_MAGIC 0x56585331
+
+/* Max points in a single query request */
+#define VX_SERVE_MAX_POINTS 1048576
+
+/* Max length of socket path */
+#define VX_SERVE_MAX_PATH 108
+
+/* Environment variable overriding the default socket path */
+#define VX_SERVE_ENV "VX_SERVED_SOCKET"
+
+/* Latency histogram: values below VX_SERVE_HIST_SUB us in unit
+   buckets, above that VX_SERVE_HIST_SUB linear sub-buckets per power
+   of two, so a bucket spans at most 1/VX_SERVE_HIST_SUB of its value */
+#define VX_SERVE_HIST_SUB 16
+#define VX_SERVE_HIST (VX_SERVE_HIST_SUB * 32)
+
+/* Query flags */
+#define VX_SERVE_GTL 1
+#define VX_SERVE_SCEC 2
+
+
+/* Request operations */
+typedef enum { VX_SERVE_HELLO = 1,
+	       VX_SERVE_QUERY,
+	       VX_SERVE_STATS,
+	       VX_SERVE_STOP } vx_serve_op_t;
+
+
+/* Response status */
+typedef enum { VX_SERVE_OK = 0,
+	       VX_SERVE_ERROR } vx_serve_status_t;
+
+
+/* Request header. Values are in host byte order, the socket is local.
+   HELLO carries the client model directory, QUERY 'count' points */
+typedef struct vx_serve_req_t
+{
+  uint32_t magic;
+  uint32_t op;
+  uint32_t zmode;
+  uint32_t flags;
+  uint32_t count;
+  uint32_t entry_size;
+  uint64_t len;
+} vx_serve_req_t;
+
+
+/* Response header. QUERY answers carry 'count' vx_entry_t */
+typedef struct vx_serve_resp_t
+{
+  uint32_t magic;
+  uint32_t status;
+  uint32_t count;
+  uint32_t pad;
+  uint64_t len;
+} vx_serve_resp_t;
+
+
+/* Latency histogram in microseconds */
+typedef struct vx_serve_hist_t
+{
+  long count[VX_SERVE_HIST];
+  long total;
+} vx_serve_hist_t;
+
+
+/* Query point */
+typedef struct vx_serve_point_t
+{
+  double coor[3];
+  int32_t coor_type;
+  int32_t pad;
+} vx_serve_point_t;
+
+
+/* Resolve socket path: explicit path, $VX_SERVED_SOCKET, or
+   /tmp/vx_served.<uid>.sock */
+int vx_serve_socket_path(const char *override, char *path);
+
+/* Connect to server. Returns socket or -1, also when the server
+   runs as another user */
+int vx_serve_connect(const char *path);
+
+/* Check peer of 'fd' runs as this user. Returns 1 if not */
+int vx_serve_check_peer(int fd);
+
+/* Read/write exactly 'len' bytes */
+int vx_serve_read(int fd, void *buf, size_t len);
+int vx_serve_write(int fd, const void *buf, size_t len);
+
+/* Send request header and payload */
+int vx_serve_send_request(int fd, vx_serve_req_t *req,
+			  const void *payload);
+
+/* Send response header and payload */
+int vx_serve_send_response(int fd, vx_serve_status_t status,
+			   uint32_t count, const void *payload,
+			   uint64_t len);
+
+/* Read response header, checking magic */
+int vx_serve_read_response(int fd, vx_serve_resp_t *resp);
+
+/* Discard 'len' bytes of payload */
+int vx_serve_skip(int fd, uint64_t len);
+
+/* Add a latency of 'us' microseconds to histogram */
+void vx_serve_hist_add(vx_serve_hist_t *hist, double us);
+
+/* Latency percentile 'p' (0..1) in microseconds, interpolated within
+   the bucket. Returns 0 for an empty histogram */
+double vx_serve_hist_percentile(const vx_serve_hist_t *hist, double p);
+
+/* Client: check server has the model in 'modeldir' loaded. Sends
+   the resolved path of 'modeldir' */
+int vx_serve_hello(int fd, const char *modeldir);
+
+/* Client: query 'n' points with given settings */
+int vx_serve_query(int fd, vx_zmode_t zmode, int flags,
+		   vx_serve_point_t *points, size_t n, vx_entry_t *entries);
+
+/* Client: send STATS or STOP, reply text copied to buf */
+int vx_serve_command(int fd, vx_serve_op_t op, char *buf, size_t len);
+
+#endif
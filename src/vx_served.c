@@ -0,0 +1,588 @@
+/**
+    vx_served - Query daemon that loads CVM-H once and answers batched
+    binary point queries from local clients over a Unix domain socket.
+
+    10/2026: Initial implementation
+    10/2026: Requests are queried with vx_getcoord_batch
+    10/2026: Added -M to choose the memory backend of the model
+**/
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "params.h"
+#include "vx_sub.h"
+#include "vx_queue.h"
+#include "vx_serve.h"
+#include "vx_stats.h"
+
+
+/* Default number of worker threads */
+#define VX_SERVED_WORKERS 4
+
+/* Max reply text */
+#define VX_SERVED_TEXT 8192
+
+
+/* Latency and throughput counters */
+typedef struct vx_served_stats_t
+{
+  double start;
+  long connections;
+  long requests;
+  long queries;
+  long points;
+  long errors;
+  double latency_sum;
+  double latency_max;
+  vx_serve_hist_t hist;
+  pthread_mutex_t lock;
+} vx_served_stats_t;
+
+
+/* Query settings shared by all requests in flight. The model keeps
+   z mode, GTL and background handler as global state, so requests
+   with different settings take turns */
+typedef struct vx_served_gate_t
+{
+  int active;
+  int pending;
+  vx_zmode_t zmode;
+  int flags;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+} vx_served_gate_t;
+
+
+/* Server state */
+static char model_path[PATH_MAX];
+static char socket_path[VX_SERVE_MAX_PATH];
+static int listen_fd = -1;
+static volatile int stopping = False;
+static vx_served_stats_t stats;
+static vx_served_gate_t gate;
+static vx_queue_t conn_q;
+
+extern char *optarg;
+extern int optind, opterr, optopt;
+
+
+/* Usage function */
+void usage() {
+  printf("     vx_served - (c) Harvard University, SCEC\n");
+  printf("Query daemon for CVM-H. Loads the model once and serves batched\n");
+  printf("binary queries to local clients over a Unix domain socket.\n");
+  printf("vx_lite uses a running server automatically.\n\n");
+  printf("\tusage: vx_served [-m dir] [-p socket] [-t threads] [-M backend] [-x stats/stop]\n\n");
+  printf("Flags:\n");
+  printf("\t-m directory containing model files (default is '.').\n");
+  printf("\t-p socket path (default is $%s or\n", VX_SERVE_ENV);
+  printf("\t   /tmp/vx_served.<uid>.sock).\n");
+  printf("\t-t number of worker threads (default is %d).\n",
+	 VX_SERVED_WORKERS);
+  printf("\t-M comma separated memory backend options of the model\n");
+  printf("\t   buffers: thp or huge pages, lock, prefault, interleave\n");
+  printf("\t   over NUMA nodes (default is none). The options obtained\n");
+  printf("\t   are printed at startup.\n");
+  printf("\t-x send a command to a running server: 'stats' prints latency\n");
+  printf("\t   and throughput counters, plus query timers and hit counters\n");
+  printf("\t   in builds configured with --enable-stats. 'stop' shuts the\n");
+  printf("\t   server down.\n\n");
+  printf("Version: %s\n\n", VERSION);
+  exit (0);
+}
+
+
+/* Current time in seconds */
+double get_time()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9);
+}
+
+
+/* Remove socket on termination */
+void handle_signal(int sig)
+{
+  unlink(socket_path);
+  _exit(0);
+}
+
+
+/* Wait until the model is configured for the given settings */
+void gate_enter(vx_zmode_t zmode, int flags)
+{
+  int waited = False;
+
+  pthread_mutex_lock(&(gate.lock));
+  while ((gate.active > 0) &&
+	 ((gate.zmode != zmode) || (gate.flags != flags) ||
+	  ((gate.pending > 0) && (!waited)))) {
+    /* Let requests waiting for other settings go first */
+    if (!waited) {
+      gate.pending++;
+      waited = True;
+    }
+    pthread_cond_wait(&(gate.cond), &(gate.lock));
+  }
+  if (waited) {
+    gate.pending--;
+  }
+
+  if ((gate.active == 0) &&
+      ((gate.zmode != zmode) || (gate.flags != flags))) {
+    vx_setzmode(zmode);
+    vx_setgtl((flags & VX_SERVE_GTL) ? True : False);
+    if (flags & VX_SERVE_SCEC) {
+      vx_register_scec();
+    } else {
+      vx_register_bkg(NULL);
+    }
+    gate.zmode = zmode;
+    gate.flags = flags;
+  }
+  gate.active++;
+  pthread_mutex_unlock(&(gate.lock));
+}
+
+
+/* Release settings */
+void gate_leave()
+{
+  pthread_mutex_lock(&(gate.lock));
+  gate.active--;
+  if (gate.active == 0) {
+    pthread_cond_broadcast(&(gate.cond));
+  }
+  pthread_mutex_unlock(&(gate.lock));
+}
+
+
+/* Record a finished request */
+void stats_add(vx_serve_op_t op, long points, double latency, int error)
+{
+  pthread_mutex_lock(&(stats.lock));
+  stats.requests++;
+  if (error) {
+    stats.errors++;
+  }
+  if ((op == VX_SERVE_QUERY) && (!error)) {
+    stats.queries++;
+    stats.points += points;
+    stats.latency_sum += latency;
+    if (latency > stats.latency_max) {
+      stats.latency_max = latency;
+    }
+    vx_serve_hist_add(&(stats.hist), latency * 1.0e6);
+  }
+  pthread_mutex_unlock(&(stats.lock));
+}
+
+
+/* Format counters as "name value" lines */
+int stats_text(char *buf, size_t len)
+{
+  vx_stats_t qstats;
+  vx_mem_report_t mem;
+  double uptime;
+  int n;
+
+  pthread_mutex_lock(&(stats.lock));
+  uptime = get_time() - stats.start;
+  n = snprintf(buf, len,
+	       "model %s\n"
+	       "uptime_s %.3f\n"
+	       "connections %ld\n"
+	       "requests %ld\n"
+	       "queries %ld\n"
+	       "points %ld\n"
+	       "errors %ld\n"
+	       "latency_mean_us %.1f\n"
+	       "latency_p50_us %.0f\n"
+	       "latency_p99_us %.0f\n"
+	       "latency_max_us %.1f\n"
+	       "points_per_s %.1f\n"
+	       "queries_per_s %.3f\n",
+	       model_path, uptime, stats.connections, stats.requests,
+	       stats.queries, stats.points, stats.errors,
+	       (stats.queries > 0) ?
+	       stats.latency_sum * 1.0e6 / stats.queries : 0.0,
+	       vx_serve_hist_percentile(&(stats.hist), 0.5),
+	       vx_serve_hist_percentile(&(stats.hist), 0.99),
+	       stats.latency_max * 1.0e6,
+	       (uptime > 0.0) ? stats.points / uptime : 0.0,
+	       (uptime > 0.0) ? stats.queries / uptime : 0.0);
+  pthread_mutex_unlock(&(stats.lock));
+
+  /* Memory backend of the model */
+  if ((n >= 0) && ((size_t)n < len) && (vx_get_mem_report(&mem) == 0)) {
+    n += vx_mem_text(&mem, &buf[n], len - n);
+  }
+
+  /* Library timers and hit counters when compiled in */
+  if ((n >= 0) && ((size_t)n < len) && vx_stats_enabled()) {
+    vx_get_stats(&qstats);
+    n += vx_stats_text(&qstats, &buf[n], len - n);
+  }
+  return(((n < 0) || ((size_t)n < len)) ? n : (int)len - 1);
+}
+
+
+/* Answer a query request */
+int serve_query(int fd, vx_serve_req_t *req, vx_serve_point_t **points,
+		vx_entry_t **entries, size_t *cap)
+{
+  void *p;
+  size_t i;
+
+  if ((req->count > VX_SERVE_MAX_POINTS) ||
+      (req->entry_size != sizeof(vx_entry_t)) ||
+      (req->len != req->count * sizeof(vx_serve_point_t)) ||
+      (req->zmode > VX_ZMODE_ELEVOFF) ||
+      (req->flags & ~(VX_SERVE_GTL | VX_SERVE_SCEC))) {
+    vx_serve_skip(fd, req->len);
+    vx_serve_send_response(fd, VX_SERVE_ERROR, 0, NULL, 0);
+    return(1);
+  }
+
+  if (req->count > *cap) {
+    p = realloc(*points, req->count * sizeof(vx_serve_point_t));
+    if (p != NULL) {
+      *points = p;
+      p = realloc(*entries, req->count * sizeof(vx_entry_t));
+    }
+    if (p == NULL) {
+      vx_serve_skip(fd, req->len);
+      vx_serve_send_response(fd, VX_SERVE_ERROR, 0, NULL, 0);
+      return(1);
+    }
+    *entries = p;
+    *cap = req->count;
+  }
+  if (vx_serve_read(fd, *points, req->len) != 0) {
+    return(1);
+  }
+
+  gate_enter(req->zmode, req->flags);
+  for (i = 0; i < req->count; i++) {
+    memcpy((*entries)[i].coor, (*points)[i].coor, sizeof(double) * 3);
+    (*entries)[i].coor_type = (*points)[i].coor_type;
+  }
+  vx_getcoord_batch(*entries, req->count);
+  gate_leave();
+
+  return(vx_serve_send_response(fd, VX_SERVE_OK, req->count, *entries,
+				req->count * sizeof(vx_entry_t)));
+}
+
+
+/* Answer all requests on one connection */
+void serve_connection(int fd)
+{
+  vx_serve_req_t req;
+  vx_serve_point_t *points = NULL;
+  vx_entry_t *entries = NULL;
+  size_t cap = 0;
+  char text[VX_SERVED_TEXT];
+  char hello[PATH_MAX];
+  char client_path[PATH_MAX];
+  double start;
+  int err;
+
+  while (vx_serve_read(fd, &req, sizeof(vx_serve_req_t)) == 0) {
+    start = get_time();
+    if (req.magic != VX_SERVE_MAGIC) {
+      stats_add(req.op, 0, 0.0, True);
+      break;
+    }
+
+    switch (req.op) {
+    case VX_SERVE_HELLO:
+      /* Only accept clients wanting the loaded model, by absolute
+	 path so that it does not depend on the server directory */
+      err = True;
+      if ((req.len < PATH_MAX) &&
+	  (vx_serve_read(fd, hello, req.len) == 0)) {
+	hello[req.len] = '\0';
+	if ((req.entry_size == sizeof(vx_entry_t)) && (hello[0] == '/') &&
+	    (realpath(hello, client_path) != NULL) &&
+	    (strcmp(client_path, model_path) == 0)) {
+	  err = False;
+	}
+      }
+      vx_serve_send_response(fd, (err ? VX_SERVE_ERROR : VX_SERVE_OK),
+			     0, model_path, strlen(model_path));
+      break;
+    case VX_SERVE_QUERY:
+      err = serve_query(fd, &req, &points, &entries, &cap);
+      break;
+    case VX_SERVE_STATS:
+      vx_serve_skip(fd, req.len);
+      err = vx_serve_send_response(fd, VX_SERVE_OK, 0, text,
+				   stats_text(text, sizeof(text)));
+      break;
+    case VX_SERVE_STOP:
+      vx_serve_skip(fd, req.len);
+      stats_text(text, sizeof(text));
+      vx_serve_send_response(fd, VX_SERVE_OK, 0, text, strlen(text));
+      stopping = True;
+      shutdown(listen_fd, SHUT_RDWR);
+      err = False;
+      break;
+    default:
+      vx_serve_skip(fd, req.len);
+      vx_serve_send_response(fd, VX_SERVE_ERROR, 0, NULL, 0);
+      err = True;
+      break;
+    }
+
+    stats_add(req.op, req.count, get_time() - start, err);
+  }
+
+  free(points);
+  free(entries);
+  close(fd);
+}
+
+
+/* Worker thread: serve connections from the accept queue */
+void *worker(void *arg)
+{
+  int *fd;
+
+  while ((fd = vx_queue_pop(&conn_q)) != NULL) {
+    serve_connection(*fd);
+    free(fd);
+  }
+  return(NULL);
+}
+
+
+/* Create listening socket, owner access only */
+int open_socket(const char *path)
+{
+  struct sockaddr_un addr;
+  mode_t mask;
+  int fd;
+
+  /* Refuse to replace a live server, remove a stale socket */
+  fd = vx_serve_connect(path);
+  if (fd >= 0) {
+    close(fd);
+    fprintf(stderr, "A server is already listening on %s\n", path);
+    return(-1);
+  }
+  unlink(path);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("socket");
+    return(-1);
+  }
+  mask = umask(0077);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    perror("bind");
+    umask(mask);
+    close(fd);
+    return(-1);
+  }
+  umask(mask);
+  if (listen(fd, 64) != 0) {
+    perror("listen");
+    close(fd);
+    return(-1);
+  }
+  return(fd);
+}
+
+
+/* Send command to a running server and print reply */
+int send_command(const char *path, const char *cmd)
+{
+  char text[VX_SERVED_TEXT];
+  vx_serve_op_t op;
+  int fd;
+
+  if (strcasecmp(cmd, "stats") == 0) {
+    op = VX_SERVE_STATS;
+  } else if (strcasecmp(cmd, "stop") == 0) {
+    op = VX_SERVE_STOP;
+  } else {
+    fprintf(stderr, "Invalid command %s\n", cmd);
+    return(1);
+  }
+
+  fd = vx_serve_connect(path);
+  if (fd < 0) {
+    fprintf(stderr, "No server listening on %s\n", path);
+    return(1);
+  }
+  if (vx_serve_command(fd, op, text, sizeof(text)) != 0) {
+    fprintf(stderr, "Command failed\n");
+    close(fd);
+    return(1);
+  }
+  printf("%s", text);
+  close(fd);
+  return(0);
+}
+
+
+int main (int argc, char *argv[])
+{
+  char modeldir[CMLEN];
+  char *path = NULL;
+  char *cmd = NULL;
+  char text[VX_SERVED_TEXT];
+  int num_threads = VX_SERVED_WORKERS;
+  pthread_t *workers;
+  vx_mem_opts_t mem;
+  vx_mem_report_t report;
+  int opt, fd, i;
+  int *conn;
+
+  strcpy(modeldir, ".");
+  memset(&mem, 0, sizeof(vx_mem_opts_t));
+
+  /* Parse options */
+  while ((opt = getopt(argc, argv, "m:p:t:M:x:h")) != -1) {
+    switch (opt) {
+    case 'm':
+      strcpy(modeldir, optarg);
+      break;
+    case 'M':
+      if (vx_mem_parse(optarg, &mem) != 0) {
+	fprintf(stderr, "Invalid memory backend %s\n", optarg);
+	usage();
+	exit(1);
+      }
+      break;
+    case 'p':
+      path = optarg;
+      break;
+    case 't':
+      num_threads = atoi(optarg);
+      if (num_threads < 1) {
+	fprintf(stderr, "Invalid thread count %s\n", optarg);
+	usage();
+	exit(1);
+      }
+      break;
+    case 'x':
+      cmd = optarg;
+      break;
+    case 'h':
+      usage();
+      exit(0);
+      break;
+    default: /* '?' */
+      usage();
+      exit(1);
+    }
+  }
+
+  if (vx_serve_socket_path(path, socket_path) != 0) {
+    fprintf(stderr, "Socket path too long\n");
+    exit(1);
+  }
+  if (cmd != NULL) {
+    return(send_command(socket_path, cmd));
+  }
+
+  if (realpath(modeldir, model_path) == NULL) {
+    fprintf(stderr, "Invalid model directory %s\n", modeldir);
+    exit(1);
+  }
+
+  /* Perform setup */
+  vx_setmem(&mem);
+  if (vx_setup(modeldir) != 0) {
+    fprintf(stderr, "Failed to init vx\n");
+    exit(1);
+  }
+  vx_setzmode(VX_ZMODE_ELEVOFF);
+  vx_setgtl(True);
+
+  memset(&stats, 0, sizeof(stats));
+  pthread_mutex_init(&(stats.lock), NULL);
+  memset(&gate, 0, sizeof(gate));
+  gate.zmode = VX_ZMODE_ELEVOFF;
+  gate.flags = VX_SERVE_GTL;
+  pthread_mutex_init(&(gate.lock), NULL);
+  pthread_cond_init(&(gate.cond), NULL);
+
+  listen_fd = open_socket(socket_path);
+  if (listen_fd < 0) {
+    exit(1);
+  }
+  signal(SIGINT, handle_signal);
+  signal(SIGTERM, handle_signal);
+  signal(SIGPIPE, SIG_IGN);
+
+  /* Start worker pool */
+  if (vx_queue_init(&conn_q, num_threads * 4) != 0) {
+    fprintf(stderr, "Failed to allocate connection queue\n");
+    exit(1);
+  }
+  workers = malloc(num_threads * sizeof(pthread_t));
+  if (workers == NULL) {
+    fprintf(stderr, "Failed to allocate workers\n");
+    exit(1);
+  }
+  for (i = 0; i < num_threads; i++) {
+    pthread_create(&workers[i], NULL, worker, NULL);
+  }
+
+  fprintf(stderr, "Serving %s on %s with %d threads\n", model_path,
+	  socket_path, num_threads);
+  vx_get_mem_report(&report);
+  vx_mem_text(&report, text, sizeof(text));
+  fprintf(stderr, "%s", text);
+  stats.start = get_time();
+
+  /* Accept connections until stopped */
+  while (!stopping) {
+    fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+    conn = malloc(sizeof(int));
+    if (conn == NULL) {
+      close(fd);
+      continue;
+    }
+    *conn = fd;
+    pthread_mutex_lock(&(stats.lock));
+    stats.connections++;
+    pthread_mutex_unlock(&(stats.lock));
+    vx_queue_push(&conn_q, conn);
+  }
+
+  unlink(socket_path);
+  close(listen_fd);
+  stats_text(text, sizeof(text));
+  fprintf(stderr, "%s", text);
+
+  /* Workers may still be answering clients, so the model is left
+     loaded and released on exit */
+  return 0;
+}
@@ -0,0 +1,438 @@
+/** vx_site.c - Site metrics of model columns: time-averaged shear
+    velocity of the top 30 m and depths to the 1.0 and 2.5 km/s Vs
+    isosurfaces, and layered profiles. Columns are walked from the
+    surface down with depth queries. Voxet values are constant within a
+    cell, so the walk steps from cell to cell; GTL and background values
+    vary with depth and are integrated adaptively, searched by bisection
+    or split into layers of bounded velocity change.
+
+10/2026: Initial implementation
+10/2026: Layered profiles
+**/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "vx_sub.h"
+#include "vx_stack.h"
+#include "vx_sched.h"
+#include "vx_site.h"
+
+
+/* Longest step over depth dependent values, m */
+#define VX_SITE_STEP 100.0
+
+/* Offset past a cell boundary of the next query, m */
+#define VX_SITE_EPS 1.0e-3
+
+/* Relative tolerance and max levels of the Vs30 integration */
+#define VX_SITE_RTOL 1.0e-6
+#define VX_SITE_LEVELS 10
+
+
+/* Column walk state */
+typedef struct vx_site_walk_t
+{
+  vx_site_t *site;
+  const vx_stack_t *stack;
+  double step;               /* longest step that skips no voxet cell */
+  float surface;
+  int invalid;               /* a sample had no Vs */
+} vx_site_walk_t;
+
+
+/* Column sample. Properties are constant from 'depth' to 'end' */
+typedef struct vx_site_sample_t
+{
+  double depth;
+  double vs;
+  double end;
+  double vp;
+  double rho;
+  float provenance;
+} vx_site_sample_t;
+
+
+/* Parallel task */
+typedef struct vx_site_task_t
+{
+  vx_site_t *sites;
+  size_t n;
+  const vx_site_opts_t *opts;
+} vx_site_task_t;
+
+
+/* Default search settings */
+void vx_site_defaults(vx_site_opts_t *opts)
+{
+  opts->tol = VX_SITE_TOL;
+  opts->max_depth = VX_SITE_MAX_DEPTH;
+  opts->vel_tol = VX_SITE_VEL_TOL;
+}
+
+
+/* Query column at 'depth'. Returns 1 on failure */
+static int vx_site_query(vx_site_walk_t *w, double depth,
+			 vx_site_sample_t *s)
+{
+  const vx_volume_t *vol;
+  vx_entry_t entry;
+  double half = 0.0, step, elev, bottom = 0.0;
+  int i;
+
+  memset(&entry, 0, sizeof(vx_entry_t));
+  entry.coor[0] = w->site->coor[0];
+  entry.coor[1] = w->site->coor[1];
+  entry.coor[2] = depth;
+  entry.coor_type = w->site->coor_type;
+  w->site->num_queries++;
+  if (vx_getcoord_zmode(&entry, VX_ZMODE_DEPTH) != 0) {
+    return(1);
+  }
+
+  s->depth = depth;
+  s->vs = entry.vs;
+  s->end = depth;
+  s->vp = entry.vp;
+  s->rho = entry.rho;
+  s->provenance = entry.provenance;
+  if (!(entry.vs > 0.0)) {
+    w->invalid = True;
+    return(0);
+  }
+
+  /* Voxet values hold to the bottom of the cell, found as by
+     vx_stack_find */
+  elev = w->surface - depth;
+  for (i = 0; (w->stack != NULL) && (i < w->stack->num_vols); i++) {
+    vol = &(w->stack->vols[i]);
+    step = vol->step[2];
+    if ((vol->src == entry.data_src) && (step != 0.0) &&
+	((half == 0.0) || (fabs(step) / 2.0 < half))) {
+      half = fabs(step) / 2.0;
+      bottom = vol->a.O[2] + round((elev - vol->a.O[2]) / step) * step -
+	half;
+    }
+  }
+  if (half > 0.0) {
+    s->end = fmin(fmax(w->surface - bottom, depth), depth + w->step);
+  }
+  return(0);
+}
+
+
+/* Slowness at 'depth' */
+static double vx_site_slowness(vx_site_walk_t *w, double depth, int *err)
+{
+  vx_site_sample_t s;
+
+  if (vx_site_query(w, depth, &s) != 0) {
+    *err = 1;
+    return(0.0);
+  }
+  return((s.vs > 0.0) ? 1.0 / s.vs : 0.0);
+}
+
+
+/* Adaptive Simpson integral of slowness over 'a' to 'b' */
+static double vx_site_simpson(vx_site_walk_t *w, double a, double b,
+			      double fa, double fm, double fb, double whole,
+			      double tol, int levels, int *err)
+{
+  double m = (a + b) / 2.0, flm, frm, left, right;
+
+  flm = vx_site_slowness(w, (a + m) / 2.0, err);
+  frm = vx_site_slowness(w, (m + b) / 2.0, err);
+  left = (m - a) / 6.0 * (fa + 4.0 * flm + fm);
+  right = (b - m) / 6.0 * (fm + 4.0 * frm + fb);
+  if ((levels <= 0) || (*err != 0) ||
+      (fabs(left + right - whole) <= 15.0 * tol)) {
+    return(left + right + (left + right - whole) / 15.0);
+  }
+  return(vx_site_simpson(w, a, m, fa, flm, fm, left, tol / 2.0, levels - 1,
+			 err) +
+	 vx_site_simpson(w, m, b, fm, frm, fb, right, tol / 2.0, levels - 1,
+			 err));
+}
+
+
+/* Time-averaged shear velocity over the top VX_SITE_VS30_DEPTH */
+static int vx_site_vs30(vx_site_walk_t *w, double *vs30)
+{
+  vx_site_sample_t s;
+  double d = 0.0, t = 0.0, e, fa, fm, fb, whole;
+  int boundary = False, err = 0;
+
+  while ((d < VX_SITE_VS30_DEPTH) && (err == 0)) {
+    if (vx_site_query(w, boundary ? d + VX_SITE_EPS : d, &s) != 0) {
+      return(1);
+    }
+    if (w->invalid) {
+      break;
+    }
+    if (s.end > s.depth) {
+      /* Constant over the rest of the cell */
+      e = fmin(s.end, VX_SITE_VS30_DEPTH);
+      t += (e - d) / s.vs;
+      boundary = True;
+    } else {
+      e = fmin(d + w->step, VX_SITE_VS30_DEPTH);
+      fa = 1.0 / s.vs;
+      fm = vx_site_slowness(w, (d + e) / 2.0, &err);
+      fb = vx_site_slowness(w, e, &err);
+      whole = (e - d) / 6.0 * (fa + 4.0 * fm + fb);
+      t += vx_site_simpson(w, d, e, fa, fm, fb, whole,
+			   VX_SITE_RTOL * whole, VX_SITE_LEVELS, &err);
+      boundary = False;
+    }
+    d = e;
+  }
+  if (err != 0) {
+    return(1);
+  }
+
+  *vs30 = ((w->invalid) || !(t > 0.0)) ? NAN : VX_SITE_VS30_DEPTH / t;
+  return(0);
+}
+
+
+/* Narrow the depth of the first Vs above 'vs' from 'lo' (below) and
+   'hi' (above) to 'tol' */
+static int vx_site_bisect(vx_site_walk_t *w, double vs, double lo, double hi,
+			  double tol, double *z)
+{
+  vx_site_sample_t s;
+  double m;
+
+  while (hi - lo > tol) {
+    m = (lo + hi) / 2.0;
+    if (vx_site_query(w, m, &s) != 0) {
+      return(1);
+    }
+    if (s.vs >= vs) {
+      hi = m;
+    } else {
+      lo = fmin(s.end, hi);
+    }
+  }
+  *z = hi;
+  return(0);
+}
+
+
+/* Depths of the first Vs reaching VX_SITE_VS_Z1 and VX_SITE_VS_Z25 */
+static int vx_site_isosurfaces(vx_site_walk_t *w, const vx_site_opts_t *opts,
+			       double *z)
+{
+  const double vs[2] = {VX_SITE_VS_Z1, VX_SITE_VS_Z25};
+  vx_site_sample_t s, prev;
+  double d = 0.0;
+  int k, boundary = False, left = 2;
+
+  z[0] = z[1] = NAN;
+  memset(&prev, 0, sizeof(vx_site_sample_t));
+  while ((left > 0) && (d <= opts->max_depth)) {
+    if (vx_site_query(w, boundary ? d + VX_SITE_EPS : d, &s) != 0) {
+      return(1);
+    }
+    for (k = 0; k < 2; k++) {
+      if (isnan(z[k]) && (s.vs >= vs[k])) {
+	if (s.depth == 0.0) {
+	  z[k] = 0.0;
+	} else if (vx_site_bisect(w, vs[k], fmin(prev.end, s.depth), s.depth,
+				  opts->tol, &z[k]) != 0) {
+	  return(1);
+	}
+	left--;
+      }
+    }
+
+    /* Skip to the next cell or step */
+    boundary = (s.end > s.depth);
+    d = boundary ? s.end : s.depth + w->step;
+    memcpy(&prev, &s, sizeof(vx_site_sample_t));
+  }
+  return(0);
+}
+
+
+/* Compute metrics of site */
+int vx_site_metrics(vx_site_t *site, const vx_site_opts_t *opts)
+{
+  vx_site_opts_t defaults;
+  vx_site_walk_t w;
+  double coor[3], z[2];
+  int i;
+
+  site->vs30 = site->z1 = site->z25 = NAN;
+  site->num_queries = 0;
+  if (opts == NULL) {
+    vx_site_defaults(&defaults);
+    opts = &defaults;
+  }
+
+  memset(&w, 0, sizeof(vx_site_walk_t));
+  w.site = site;
+  w.stack = vx_get_stack();
+  w.step = VX_SITE_STEP;
+  for (i = 0; (w.stack != NULL) && (i < w.stack->num_vols); i++) {
+    w.step = fmin(w.step, fabs(w.stack->vols[i].step[2]));
+  }
+
+  coor[0] = site->coor[0];
+  coor[1] = site->coor[1];
+  coor[2] = 0.0;
+  vx_getsurface(coor, site->coor_type, &(w.surface));
+  if (w.surface < -90000.0) {
+    return(1);
+  }
+
+  if ((vx_site_vs30(&w, &(site->vs30)) != 0) ||
+      (vx_site_isosurfaces(&w, opts, z) != 0)) {
+    site->vs30 = NAN;
+    return(1);
+  }
+  site->z1 = z[0];
+  site->z25 = z[1];
+  return(0);
+}
+
+
+/* Velocities of 'a' and 'b' differ by at most 'tol' */
+static int vx_site_close(const vx_site_sample_t *a, const vx_site_sample_t *b,
+			 double tol)
+{
+  return((fabs(a->vp - b->vp) <= tol) && (fabs(a->vs - b->vs) <= tol));
+}
+
+
+/* Append layer of sample 's' from 'top' unless it equals the 'last'
+   layer. Layers past 'cap' are counted only. Returns number of layers */
+static int vx_site_layer(vx_layer_t *layers, int n, int cap, vx_layer_t *last,
+			 double top, const vx_site_sample_t *s)
+{
+  if ((n > 0) && (last->vp == (float)s->vp) && (last->vs == (float)s->vs) &&
+      (last->rho == s->rho) && (last->provenance == s->provenance)) {
+    return(n);
+  }
+  last->top = top;
+  last->vp = s->vp;
+  last->vs = s->vs;
+  last->rho = s->rho;
+  last->provenance = s->provenance;
+  if (n < cap) {
+    layers[n] = *last;
+  }
+  return(n + 1);
+}
+
+
+/* Layered profile of site column */
+int vx_site_profile(vx_site_t *site, const vx_site_opts_t *opts,
+		    vx_layer_t *layers, int cap)
+{
+  vx_site_opts_t defaults;
+  vx_site_walk_t w;
+  vx_site_sample_t s, t, m;
+  vx_layer_t last;
+  double coor[3], d = 0.0, e, lo, hi;
+  int i, n = 0, boundary = False;
+
+  site->num_queries = 0;
+  if (opts == NULL) {
+    vx_site_defaults(&defaults);
+    opts = &defaults;
+  }
+
+  memset(&w, 0, sizeof(vx_site_walk_t));
+  w.site = site;
+  w.stack = vx_get_stack();
+  w.step = VX_SITE_STEP;
+  for (i = 0; (w.stack != NULL) && (i < w.stack->num_vols); i++) {
+    w.step = fmin(w.step, fabs(w.stack->vols[i].step[2]));
+  }
+
+  coor[0] = site->coor[0];
+  coor[1] = site->coor[1];
+  coor[2] = 0.0;
+  vx_getsurface(coor, site->coor_type, &(w.surface));
+  if (w.surface < -90000.0) {
+    return(-1);
+  }
+
+  memset(&last, 0, sizeof(vx_layer_t));
+  while (d < opts->max_depth) {
+    if (vx_site_query(&w, boundary ? d + VX_SITE_EPS : d, &s) != 0) {
+      return(-1);
+    }
+    if (s.end > s.depth) {
+      /* Constant over the rest of the cell */
+      e = fmin(s.end, opts->max_depth);
+      n = vx_site_layer(layers, n, cap, &last, d, &s);
+      boundary = True;
+      d = e;
+      continue;
+    }
+
+    /* Longest step over which the velocities stay within tolerance,
+       narrowed by bisection to the depth resolution */
+    e = fmin(d + w.step, opts->max_depth);
+    if (vx_site_query(&w, e, &t) != 0) {
+      return(-1);
+    }
+    if (!vx_site_close(&s, &t, opts->vel_tol)) {
+      lo = d;
+      hi = e;
+      while (hi - lo > opts->tol) {
+	if (vx_site_query(&w, (lo + hi) / 2.0, &t) != 0) {
+	  return(-1);
+	}
+	if (vx_site_close(&s, &t, opts->vel_tol)) {
+	  lo = (lo + hi) / 2.0;
+	} else {
+	  hi = (lo + hi) / 2.0;
+	}
+      }
+      e = fmin(fmax(lo, d + opts->tol), opts->max_depth);
+    }
+
+    /* Layer takes the values of its middle */
+    if (vx_site_query(&w, (d + e) / 2.0, &m) != 0) {
+      return(-1);
+    }
+    n = vx_site_layer(layers, n, cap, &last, d, &m);
+    boundary = False;
+    d = e;
+  }
+  return(n);
+}
+
+
+/* Task of vx_site_metrics_parallel */
+static int vx_site_task(size_t task, void *arg)
+{
+  vx_site_task_t *t = (vx_site_task_t *)arg;
+  size_t i, end = (task + 1) * VX_SITE_CHUNK;
+  int retval = 0;
+
+  for (i = task * VX_SITE_CHUNK; (i < end) && (i < t->n); i++) {
+    retval |= vx_site_metrics(&(t->sites[i]), t->opts);
+  }
+  return(retval);
+}
+
+
+/* Metrics of sites on several threads */
+int vx_site_metrics_parallel(vx_site_t *sites, size_t n,
+			     const vx_site_opts_t *opts, int num_threads,
+			     vx_sched_report_t *report)
+{
+  vx_site_task_t t;
+
+  t.sites = sites;
+  t.n = n;
+  t.opts = opts;
+  return(vx_sched_run((n + VX_SITE_CHUNK - 1) / VX_SITE_CHUNK, num_threads,
+		      NULL, vx_site_task, &t, report));
+}
@@ -0,0 +1,89 @@
+#ifndef VX_SITE_H
+#define VX_SITE_H
+
+#include <stddef.h>
+#include "vx_sub.h"
+#include "vx_sched.h"
+
+/* Depth of the time-averaged shear velocity, m */
+#define VX_SITE_VS30_DEPTH 30.0
+
+/* Vs of the Z1.0 and Z2.5 isosurfaces, m/s */
+#define VX_SITE_VS_Z1 1000.0
+#define VX_SITE_VS_Z25 2500.0
+
+/* Default depth resolution of the isosurface search, m */
+#define VX_SITE_TOL 1.0
+
+/* Default max depth of the isosurface search, m */
+#define VX_SITE_MAX_DEPTH 15000.0
+
+/* Default max change of Vp and Vs within a profile layer over depth
+   dependent values, m/s */
+#define VX_SITE_VEL_TOL 10.0
+
+/* Sites per task of vx_site_metrics_parallel */
+#define VX_SITE_CHUNK 16
+
+
+/* Site metrics of the model column below a point. Columns are read
+   with vx_getcoord in depth mode, so the GTL and background settings
+   apply as for point queries */
+typedef struct vx_site_t
+{
+  double coor[2];
+  vx_coord_t coor_type;
+  double vs30;               /* m/s, NaN if undefined */
+  double z1;                 /* depth to Vs 1.0 km/s, NaN if not reached */
+  double z25;                /* depth to Vs 2.5 km/s, NaN if not reached */
+  int num_queries;
+} vx_site_t;
+
+
+/* Search settings */
+typedef struct vx_site_opts_t
+{
+  double tol;                /* depth resolution of z1 and z25 */
+  double max_depth;          /* depth searched for z1 and z25, and
+				bottom of profiles */
+  double vel_tol;            /* max Vp and Vs change in profile layers */
+} vx_site_opts_t;
+
+
+/* Profile layer. Properties hold from 'top' (depth below the surface)
+   down to the top of the next layer */
+typedef struct vx_layer_t
+{
+  double top;
+  float vp;
+  float vs;
+  double rho;
+  float provenance;
+} vx_layer_t;
+
+
+/* Default search settings */
+void vx_site_defaults(vx_site_opts_t *opts);
+
+/* Compute metrics of 'site' at its coordinates. 'opts' may be NULL
+   for the defaults. Returns 1 if the column could not be queried */
+int vx_site_metrics(vx_site_t *site, const vx_site_opts_t *opts);
+
+/* Layered profile of the column below 'site' from the surface down to
+   'opts->max_depth', with adjacent equal layers merged. Voxet cells
+   give exact layers; depth dependent stretches (GTL, background) are
+   cut into layers over which Vp and Vs change by at most
+   'opts->vel_tol', no thinner than 'opts->tol', holding the values of
+   their middle. Writes up to 'cap' layers. Returns the number of
+   layers of the profile, which may exceed 'cap', or -1 if the column
+   could not be queried */
+int vx_site_profile(vx_site_t *site, const vx_site_opts_t *opts,
+		    vx_layer_t *layers, int cap);
+
+/* Metrics of 'n' sites on 'num_threads' threads, in tasks of
+   VX_SITE_CHUNK sites. Returns 1 if any site failed */
+int vx_site_metrics_parallel(vx_site_t *sites, size_t n,
+			     const vx_site_opts_t *opts, int num_threads,
+			     vx_sched_report_t *report);
+
+#endif
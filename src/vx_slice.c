@@ -4,6 +4,8 @@
     Accepts Geographic Coordinates or UTM Zone 11 coordinates.
 
     01/2011: PES: Initial implementation
+    10/2026: Format output with vx_fmt instead of fprintf
+    10/2026: Added --stats
 **/
 
 
@@ -16,14 +18,25 @@
 #include <getopt.h>
 #include "params.h"
 #include "vx_sub.h"
+#include "vx_fmt.h"
+#include "vx_stats.h"
 
 
 /* Global variables */
 #define DEFAULT_GRIDSIZE 0.1
 
+/* Size of statistics report */
+#define VX_SLICE_STATS 8192
+
 extern char *optarg;
 extern int optind, opterr, optopt;
 
+/* Long options */
+static struct option long_options[] = {
+  {"stats", no_argument, NULL, 'S'},
+  {NULL, 0, NULL, 0}
+};
+
 
 /* Usage function */
 void usage() {
@@ -32,14 +45,16 @@ void usage() {
   printf("grid within the specified region at the specified depth/elev. Accepts\n");
   printf("geographic/UTM coordinates for the geographic region. Outputs gridded\n");
   printf("data suitable for plotting in MATLAB or GMT.\n\n");
-  printf("\tusage: vx_slice [-g] [-s] [-m dir] [-z dep/elev/off] [-r gridsize] [-f outfile] -- <x1> <y1> <x2> <y2> <z> <value>\n\n");
+  printf("\tusage: vx_slice [-g] [-s] [-m dir] [-z dep/elev/off] [-r gridsize] [-f outfile] [--stats] -- <x1> <y1> <x2> <y2> <z> <value>\n\n");
   printf("Flags:\n");
   printf("\t-g disable GTL (default is on).\n");
   printf("\t-s directs use of SCEC 1D background and topo.\n");
   printf("\t-m directory containing model files (default is '.').\n");
   printf("\t-z directs use of dep/elev/off for Z column.\n");
   printf("\t-r flag is gridsize in degrees/meters. Defaults to 0.1.\n");
-  printf("\t-f flag specifies filename to save x,y,z values. Otherwise stdout is used.\n\n");
+  printf("\t-f flag specifies filename to save x,y,z values. Otherwise stdout is used.\n");
+  printf("\t--stats print query timers and hit counters to stderr\n");
+  printf("\t   (requires a build configured with --enable-stats).\n\n");
 
   printf("Arguments:\n");
   printf("\t<x1> <y1> is SW corner of region to extract in geo/utm coords\n");
@@ -73,12 +88,19 @@ int main (int argc, char *argv[])
   int num_x, num_y;
   int i, j;
   FILE *lf = stdout;
+  double val;
+  char line[VX_FMT_MAX_LEN * 2];
+  int show_stats = False;
+  vx_stats_t stats;
+  char stats_text[VX_SLICE_STATS];
+  int len;
 
   zmode = VX_ZMODE_ELEVOFF;
   strcpy(modeldir, ".");
 
    /* Parse options */
-  while ((opt = getopt(argc, argv, "gm:sz:hf:r:")) != -1) {
+  while ((opt = getopt_long(argc, argv, "gm:sz:hf:r:", long_options, 
+			    NULL)) != -1) {
     switch (opt) {
     case 'g':
       use_gtl = False;
@@ -89,6 +111,9 @@ int main (int argc, char *argv[])
     case 's':
       use_scec = True;
       break;
+    case 'S':
+      show_stats = True;
+      break;
     case 'z':
       if (strcasecmp(optarg, "dep") == 0) {
         zmode = VX_ZMODE_DEPTH;
@@ -223,15 +248,24 @@ int main (int argc, char *argv[])
       vx_getcoord(&entry);
 
       if (strcmp(value_type, "vp") == 0) {
-	fprintf(lf, "%d %d %f\n", i, j, entry.vp);
+	val = entry.vp;
       } else if (strcmp(value_type, "vs") == 0) {
-	fprintf(lf, "%d %d %f\n", i, j, entry.vs);
+	val = entry.vs;
       } else if (strcmp(value_type, "rho") == 0) {
-	fprintf(lf, "%d %d %f\n", i, j, entry.rho);
+	val = entry.rho;
       } else {
-	fprintf(lf, "%d %d %f\n", i, j, -99999.0);
+	val = -99999.0;
       }
 
+      /* Same as "%d %d %f\n" */
+      len = vx_fmt_int(line, i);
+      line[len++] = ' ';
+      len += vx_fmt_int(&line[len], j);
+      line[len++] = ' ';
+      len += vx_fmt_fixed(&line[len], val, 0, 6);
+      line[len++] = '\n';
+      fwrite(line, 1, len, lf);
+
     }
   }
   
@@ -239,6 +273,12 @@ int main (int argc, char *argv[])
     fclose(lf);
   }
 
+  if (show_stats) {
+    vx_get_stats(&stats);
+    vx_stats_text(&stats, stats_text, sizeof(stats_text));
+    fputs(stats_text, stderr);
+  }
+
   /* Perform cleanup */
   vx_cleanup();
 
@@ -0,0 +1,510 @@
+/** vx_stack.c - Stack of nested voxets with priorities. The voxets
+    are listed in a manifest in the model directory and a coarse map
+    of the voxet owning each region is built at load time, so a point
+    is resolved with a single map lookup regardless of the number of
+    voxets. Map cells crossed by a voxet boundary fall back to checking
+    the voxets in priority order.
+
+10/2026: Initial implementation
+10/2026: Voxet buffers allocated through the vx_mem backends
+**/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include "params.h"
+#include "voxet.h"
+#include "vx_io.h"
+#include "vx_sub.h"
+#include "vx_mem.h"
+#include "vx_stack.h"
+
+/* Relative margin in cell widths when classifying map cells */
+#define VX_STACK_EPS 1.0e-6
+
+/* Classification of a map cell against a voxet */
+#define VX_STACK_OUT 0
+#define VX_STACK_IN 1
+#define VX_STACK_PART 2
+
+
+/* Number of cells in voxet with dimensions 'n', or 0 if the
+   dimensions are invalid or the volume exceeds the address space */
+size_t vx_volume_cells(int *n, const char *name)
+{
+  size_t cells;
+
+  if ((n[0] <= 0) || (n[1] <= 0) || (n[2] <= 0)) {
+    fprintf(stderr, "Invalid %s voxet dimensions %d %d %d\n",
+	    name, n[0], n[1], n[2]);
+    return(0);
+  }
+  cells = (size_t)n[0] * (size_t)n[1];
+  if (cells > SIZE_MAX / sizeof(float) / (size_t)n[2]) {
+    fprintf(stderr, "%s voxet with %d x %d x %d cells is too large\n",
+	    name, n[0], n[1], n[2]);
+    return(0);
+  }
+  return(cells * n[2]);
+}
+
+
+/* Add voxet to stack, keeping the stack ordered by decreasing
+   priority. Voxets of equal priority keep their manifest order */
+static int vx_stack_add(vx_stack_t *stack, const char *name,
+			const char *header, int priority, vx_src_t src)
+{
+  vx_volume_t *vol;
+  int i;
+
+  if (stack->num_vols >= VX_STACK_MAX) {
+    fprintf(stderr, "Too many voxets in stack, max is %d\n", VX_STACK_MAX);
+    return(1);
+  }
+
+  for (i = stack->num_vols; i > 0; i--) {
+    if (stack->vols[i-1].priority >= priority) {
+      break;
+    }
+    stack->vols[i] = stack->vols[i-1];
+  }
+
+  vol = &(stack->vols[i]);
+  memset(vol, 0, sizeof(vx_volume_t));
+  snprintf(vol->name, CMLEN, "%s", name);
+  snprintf(vol->header, CMLEN, "%s", header);
+  vol->priority = priority;
+  vol->src = src;
+  stack->num_vols++;
+  return(0);
+}
+
+
+/* Read manifest from model directory, or set up the default HR, LR
+   and CM stack if there is none */
+int vx_stack_read_manifest(const char *data_dir, vx_stack_t *stack)
+{
+  char path[CMLEN];
+  char line[CMLEN];
+  char name[CMLEN], header[CMLEN], src[CMLEN];
+  int priority, lineno = 0;
+  vx_src_t s;
+  FILE *fp;
+
+  memset(stack, 0, sizeof(vx_stack_t));
+
+  snprintf(path, CMLEN, "%s/%s", data_dir, VX_STACK_MANIFEST);
+  fp = fopen(path, "r");
+  if (fp == NULL) {
+    if ((vx_stack_add(stack, "HR", "CVM_HR.vo", 3, VX_SRC_HR) != 0) ||
+	(vx_stack_add(stack, "LR", "CVM_LR.vo", 2, VX_SRC_LR) != 0) ||
+	(vx_stack_add(stack, "CM", "CVM_CM.vo", 1, VX_SRC_CM) != 0)) {
+      return(1);
+    }
+    return(0);
+  }
+
+  while (fgets(line, CMLEN, fp) != NULL) {
+    lineno++;
+    if ((line[strspn(line, " \t\r\n")] == '\0') ||
+	(line[strspn(line, " \t")] == '#')) {
+      continue;
+    }
+    if (sscanf(line, "%s %s %d %s", name, header, &priority, src) != 4) {
+      fprintf(stderr, "Invalid voxet entry at line %d of %s\n",
+	      lineno, path);
+      fclose(fp);
+      return(1);
+    }
+    if (strcmp(src, "hr") == 0) {
+      s = VX_SRC_HR;
+    } else if (strcmp(src, "lr") == 0) {
+      s = VX_SRC_LR;
+    } else if (strcmp(src, "cm") == 0) {
+      s = VX_SRC_CM;
+    } else {
+      fprintf(stderr, "Invalid voxet source '%s' at line %d of %s\n",
+	      src, lineno, path);
+      fclose(fp);
+      return(1);
+    }
+    if (vx_stack_add(stack, name, header, priority, s) != 0) {
+      fclose(fp);
+      return(1);
+    }
+  }
+  fclose(fp);
+
+  if (stack->num_vols == 0) {
+    fprintf(stderr, "No voxets listed in %s\n", path);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Read property 'num' of the current voxet header and load it */
+static int vx_stack_load_prop(const char *data_dir, vx_volume_t *vol,
+			      int num, const char *name,
+			      struct property *p, char **buf)
+{
+  size_t ncells;
+
+  ncells = vx_volume_cells(vol->a.N, vol->name);
+  if (ncells == 0) {
+    return(1);
+  }
+
+  /* Element size and no data value default to float and -99999 */
+  sprintf(p->NAME, "%s", name);
+  p->ESIZE = 4;
+  p->NO_DATA_VALUE = -99999.0;
+  if (vx_io_getpropname("PROP_FILE", num, p->FN) != 0) {
+    fprintf(stderr, "Failed to read %s %s property\n", vol->name, name);
+    return(1);
+  }
+  vx_io_getpropsize("PROP_ESIZE", num, &(p->ESIZE));
+  vx_io_getpropval("PROP_NO_DATA_VALUE", num, &(p->NO_DATA_VALUE));
+
+  *buf = (char *)vx_mem_alloc(ncells * p->ESIZE);
+  if (*buf == NULL) {
+    fprintf(stderr, "Failed to allocate %s %s buffer\n", vol->name, name);
+    return(1);
+  }
+  if (vx_io_loadvolume(data_dir, p->FN, p->ESIZE, ncells, *buf) != 0) {
+    fprintf(stderr, "Failed to load %s %s volume\n", vol->name, name);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Load header and properties of voxet */
+static int vx_stack_load_volume(const char *data_dir, vx_volume_t *vol)
+{
+  char path[CMLEN];
+  struct axis *a = &(vol->a);
+
+  snprintf(path, CMLEN, "%s/%s", data_dir, vol->header);
+  if (vx_io_init(path) != 0) {
+    fprintf(stderr, "Failed to load %s param file %s. Check that the model path is correct.\n", vol->name, path);
+    return(1);
+  }
+
+  vx_io_getvec("AXIS_O", a->O);
+  vx_io_getvec("AXIS_U", a->U);
+  vx_io_getvec("AXIS_V", a->V);
+  vx_io_getvec("AXIS_W", a->W);
+  vx_io_getvec("AXIS_MIN", a->MIN);
+  vx_io_getvec("AXIS_MAX", a->MAX);
+  vx_io_getdim("AXIS_N", a->N);
+
+  if ((a->N[0] < 2) || (a->N[1] < 2) || (a->N[2] < 2)) {
+    fprintf(stderr, "%s voxet needs at least 2 nodes per axis\n",
+	    vol->name);
+    vx_io_finalize();
+    return(1);
+  }
+
+  if ((vx_stack_load_prop(data_dir, vol, 1, "vp",
+			  &(vol->vp_p), &(vol->vp)) != 0) ||
+      (vx_stack_load_prop(data_dir, vol, 2, "tag",
+			  &(vol->tag_p), &(vol->tag)) != 0) ||
+      (vx_stack_load_prop(data_dir, vol, 3, "vs",
+			  &(vol->vs_p), &(vol->vs)) != 0)) {
+    vx_io_finalize();
+    return(1);
+  }
+  vx_io_finalize();
+
+  vol->step[0] = a->U[0]/(a->N[0]-1);
+  vol->step[1] = a->V[1]/(a->N[1]-1);
+  vol->step[2] = a->W[2]/(a->N[2]-1);
+  if ((vol->step[0] == 0.0) || (vol->step[1] == 0.0) ||
+      (vol->step[2] == 0.0)) {
+    fprintf(stderr, "%s voxet has zero node spacing\n", vol->name);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Read manifest, load all voxets and build the priority map */
+int vx_stack_load(const char *data_dir, vx_stack_t *stack)
+{
+  int i;
+
+  if (vx_stack_read_manifest(data_dir, stack) != 0) {
+    return(1);
+  }
+
+  for (i = 0; i < stack->num_vols; i++) {
+    if (vx_stack_load_volume(data_dir, &(stack->vols[i])) != 0) {
+      vx_stack_free(stack);
+      return(1);
+    }
+  }
+
+  if (vx_stack_build_map(stack) != 0) {
+    vx_stack_free(stack);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Free voxet buffers and priority map */
+void vx_stack_free(vx_stack_t *stack)
+{
+  int i;
+
+  for (i = 0; i < stack->num_vols; i++) {
+    vx_mem_free(stack->vols[i].vp);
+    vx_mem_free(stack->vols[i].tag);
+    vx_mem_free(stack->vols[i].vs);
+    stack->vols[i].vp = stack->vols[i].tag = stack->vols[i].vs = NULL;
+  }
+  free(stack->map);
+  stack->map = NULL;
+  stack->num_vols = 0;
+}
+
+
+/* Range of coordinates along axis 'i' that round to a node of the
+   voxet */
+static void vx_stack_extent(const vx_volume_t *vol, int i,
+			    double *lo, double *hi)
+{
+  double a, b;
+
+  a = vol->a.O[i] - 0.5 * vol->step[i];
+  b = vol->a.O[i] + (vol->a.N[i] - 0.5) * vol->step[i];
+  *lo = (a < b) ? a : b;
+  *hi = (a < b) ? b : a;
+}
+
+
+/* Classify map cells along axis 'i' against voxet. Cells are inside
+   if every point rounds to a node with the same arithmetic as the
+   voxet lookup, outside if none does */
+static void vx_stack_classify(const vx_stack_t *stack,
+			      const vx_volume_t *vol, int i,
+			      unsigned char *cls)
+{
+  double c0, c1, f0, f1, t;
+  double eps = VX_STACK_EPS;
+  int k;
+
+  for (k = 0; k < stack->map_n[i]; k++) {
+    c0 = stack->map_o[i] + k * stack->map_step[i];
+    c1 = c0 + stack->map_step[i];
+    f0 = (c0 - vol->a.O[i])/vol->step[i];
+    f1 = (c1 - vol->a.O[i])/vol->step[i];
+    if (f0 > f1) {
+      t = f0; f0 = f1; f1 = t;
+    }
+    if ((f1 < -0.5 - eps) || (f0 > vol->a.N[i] - 0.5 + eps)) {
+      cls[k] = VX_STACK_OUT;
+    } else if ((f0 > -0.5 + eps) && (f1 < vol->a.N[i] - 0.5 - eps)) {
+      cls[k] = VX_STACK_IN;
+    } else {
+      cls[k] = VX_STACK_PART;
+    }
+  }
+}
+
+
+/* Build priority map of loaded stack. The map spans all voxets with
+   cells of twice the finest node spacing, coarsened until the map fits
+   in VX_STACK_MAP_MAX cells */
+int vx_stack_build_map(vx_stack_t *stack)
+{
+  unsigned char *cls[VX_STACK_MAX][3];
+  unsigned char c, owner;
+  double lo[3], hi[3], a, b, s;
+  size_t ncells, pos;
+  int i, j, k, v, n[3], axis;
+
+  free(stack->map);
+  stack->map = NULL;
+  if (stack->num_vols == 0) {
+    return(1);
+  }
+
+  stack->simd_ok = True;
+  for (v = 0; v < stack->num_vols; v++) {
+    if ((stack->vols[v].vp_p.ESIZE != sizeof(float)) ||
+	(stack->vols[v].vs_p.ESIZE != sizeof(float)) ||
+	(stack->vols[v].tag_p.ESIZE != sizeof(float))) {
+      stack->simd_ok = False;
+    }
+  }
+
+  /* Bounding box and finest spacing */
+  for (i = 0; i < 3; i++) {
+    for (v = 0; v < stack->num_vols; v++) {
+      vx_stack_extent(&(stack->vols[v]), i, &a, &b);
+      s = 2.0 * fabs(stack->vols[v].step[i]);
+      if ((v == 0) || (a < lo[i])) lo[i] = a;
+      if ((v == 0) || (b > hi[i])) hi[i] = b;
+      if ((v == 0) || (s < stack->map_step[i])) stack->map_step[i] = s;
+    }
+  }
+
+  /* Coarsen longest axis until map is small enough, pad by a cell */
+  while (1) {
+    ncells = 1;
+    axis = 0;
+    for (i = 0; i < 3; i++) {
+      stack->map_n[i] = (int)ceil((hi[i] - lo[i]) / stack->map_step[i]) + 2;
+      ncells *= stack->map_n[i];
+      if (stack->map_n[i] > stack->map_n[axis]) {
+	axis = i;
+      }
+    }
+    if (ncells <= VX_STACK_MAP_MAX) {
+      break;
+    }
+    stack->map_step[axis] *= 2.0;
+  }
+  for (i = 0; i < 3; i++) {
+    stack->map_o[i] = lo[i] - stack->map_step[i];
+  }
+
+  /* Padded so batch lookups may read 4 bytes at any cell */
+  stack->map = malloc(ncells + 4);
+  if (stack->map == NULL) {
+    fprintf(stderr, "Failed to allocate voxet priority map\n");
+    return(1);
+  }
+
+  /* Per axis classification of map cells against each voxet */
+  memset(cls, 0, sizeof(cls));
+  for (v = 0; v < stack->num_vols; v++) {
+    for (i = 0; i < 3; i++) {
+      cls[v][i] = malloc(stack->map_n[i]);
+      if (cls[v][i] == NULL) {
+	fprintf(stderr, "Failed to allocate voxet priority map\n");
+	for (v = 0; v < stack->num_vols; v++) {
+	  for (i = 0; i < 3; i++) {
+	    free(cls[v][i]);
+	  }
+	}
+	free(stack->map);
+	stack->map = NULL;
+	return(1);
+      }
+      vx_stack_classify(stack, &(stack->vols[v]), i, cls[v][i]);
+    }
+  }
+
+  /* Owner is the first voxet covering the whole cell, provided no
+     higher priority voxet touches it */
+  n[0] = stack->map_n[0];
+  n[1] = stack->map_n[1];
+  n[2] = stack->map_n[2];
+  pos = 0;
+  for (k = 0; k < n[2]; k++) {
+    for (j = 0; j < n[1]; j++) {
+      for (i = 0; i < n[0]; i++) {
+	owner = VX_STACK_NONE;
+	for (v = 0; v < stack->num_vols; v++) {
+	  c = cls[v][0][i];
+	  if ((c == VX_STACK_OUT) || (cls[v][1][j] == VX_STACK_OUT) ||
+	      (cls[v][2][k] == VX_STACK_OUT)) {
+	    continue;
+	  }
+	  if ((c == VX_STACK_IN) && (cls[v][1][j] == VX_STACK_IN) &&
+	      (cls[v][2][k] == VX_STACK_IN)) {
+	    owner = v;
+	  } else {
+	    owner = VX_STACK_MIXED;
+	  }
+	  break;
+	}
+	stack->map[pos++] = owner;
+      }
+    }
+  }
+
+  for (v = 0; v < stack->num_vols; v++) {
+    for (i = 0; i < 3; i++) {
+      free(cls[v][i]);
+    }
+  }
+  return(0);
+}
+
+
+/* Voxel indices of point in voxet, returns True if inside */
+static inline int vx_stack_index(const vx_volume_t *vol,
+				 const double *utm, int *gcoor)
+{
+  gcoor[0]=round((utm[0]-vol->a.O[0])/vol->step[0]);
+  gcoor[1]=round((utm[1]-vol->a.O[1])/vol->step[1]);
+  gcoor[2]=round((utm[2]-vol->a.O[2])/vol->step[2]);
+
+  return(gcoor[0]>=0&&gcoor[1]>=0&&gcoor[2]>=0&&
+	 gcoor[0]<vol->a.N[0]&&gcoor[1]<vol->a.N[1]&&gcoor[2]<vol->a.N[2]);
+}
+
+
+/* Same as vx_stack_find, checking the voxets in turn */
+int vx_stack_search(const vx_stack_t *stack, const double *utm, int *gcoor)
+{
+  int v;
+
+  for (v = 0; v < stack->num_vols; v++) {
+    if (vx_stack_index(&(stack->vols[v]), utm, gcoor)) {
+      return(v);
+    }
+  }
+  return(-1);
+}
+
+
+/* Index of highest priority voxet containing UTM point 'utm', or -1.
+   Voxel indices are returned in 'gcoor' */
+int vx_stack_find(const vx_stack_t *stack, const double *utm, int *gcoor)
+{
+  double f[3];
+  int i, owner;
+
+  for (i = 0; i < 3; i++) {
+    f[i] = (utm[i] - stack->map_o[i]) / stack->map_step[i];
+    if (!((f[i] >= 0.0) && (f[i] < stack->map_n[i]))) {
+      return(-1);
+    }
+  }
+
+  owner = stack->map[((size_t)((int)f[2]) * stack->map_n[1] + (int)f[1]) *
+		     stack->map_n[0] + (int)f[0]];
+  if (owner == VX_STACK_NONE) {
+    return(-1);
+  }
+  if ((owner != VX_STACK_MIXED) &&
+      (vx_stack_index(&(stack->vols[owner]), utm, gcoor))) {
+    return(owner);
+  }
+  return(vx_stack_search(stack, utm, gcoor));
+}
+
+
+/* Fraction of map cells resolved to a single voxet or none */
+double vx_stack_map_resolved(const vx_stack_t *stack)
+{
+  size_t i, n, mixed = 0;
+
+  if (stack->map == NULL) {
+    return(0.0);
+  }
+  n = (size_t)stack->map_n[0] * stack->map_n[1] * stack->map_n[2];
+  for (i = 0; i < n; i++) {
+    if (stack->map[i] == VX_STACK_MIXED) {
+      mixed++;
+    }
+  }
+  return(1.0 - (double)mixed / n);
+}
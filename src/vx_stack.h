@@ -0,0 +1,127 @@
+#ifndef VX_STACK_H
+#define VX_STACK_H
+
+#include <stddef.h>
+#include "params.h"
+#include "voxet.h"
+#include "vx_sub.h"
+
+/* Voxet manifest in the model directory. Each line lists a voxet as
+   'name header priority source', e.g. 'HR CVM_HR.vo 3 hr'. Without a
+   manifest the HR, LR and CM voxets are used */
+#define VX_STACK_MANIFEST "voxets.conf"
+
+/* Max number of voxets in stack */
+#define VX_STACK_MAX 32
+
+/* Max cells in priority map */
+#define VX_STACK_MAP_MAX 4194304
+
+/* Priority map values besides a voxet index */
+#define VX_STACK_NONE 0xFF
+#define VX_STACK_MIXED 0xFE
+
+
+/* Voxet with vp, tag and vs properties */
+typedef struct vx_volume_t
+{
+  char name[CMLEN];
+  char header[CMLEN];
+  int priority;
+  vx_src_t src;
+  struct axis a;
+  float step[3];
+  struct property vp_p;
+  struct property tag_p;
+  struct property vs_p;
+  char *vp;
+  char *tag;
+  char *vs;
+} vx_volume_t;
+
+
+/* Voxets ordered by decreasing priority, and a coarse map of the
+   voxet owning each map cell */
+typedef struct vx_stack_t
+{
+  int num_vols;
+  vx_volume_t vols[VX_STACK_MAX];
+
+  double map_o[3];
+  double map_step[3];
+  int map_n[3];
+  unsigned char *map;
+
+  /* True if all properties are floats, required by the SIMD lookups */
+  int simd_ok;
+} vx_stack_t;
+
+
+/* Batch lookup implementations */
+typedef enum { VX_SIMD_SCALAR = 0,
+	       VX_SIMD_AVX2,
+	       VX_SIMD_AVX512 } vx_simd_t;
+
+#define VX_SIMD_NUM 3
+
+extern char *VX_SIMD_NAMES[VX_SIMD_NUM];
+
+
+/* Number of cells in voxet with dimensions 'n', or 0 if the
+   dimensions are invalid or the volume exceeds the address space */
+size_t vx_volume_cells(int *n, const char *name);
+
+/* Read manifest from model directory, or set up the default HR, LR
+   and CM stack if there is none */
+int vx_stack_read_manifest(const char *data_dir, vx_stack_t *stack);
+
+/* Read manifest, load all voxets and build the priority map */
+int vx_stack_load(const char *data_dir, vx_stack_t *stack);
+
+/* Build priority map of loaded stack */
+int vx_stack_build_map(vx_stack_t *stack);
+
+/* Free voxet buffers and priority map */
+void vx_stack_free(vx_stack_t *stack);
+
+/* Index of highest priority voxet containing UTM point 'utm', or -1.
+   Voxel indices are returned in 'gcoor' */
+int vx_stack_find(const vx_stack_t *stack, const double *utm, int *gcoor);
+
+/* Same as vx_stack_find, checking the voxets in turn */
+int vx_stack_search(const vx_stack_t *stack, const double *utm, int *gcoor);
+
+/* Fraction of map cells resolved to a single voxet or none */
+double vx_stack_map_resolved(const vx_stack_t *stack);
+
+/* Best batch lookup implementation supported by the CPU */
+vx_simd_t vx_simd_detect();
+
+/* Select batch lookup implementation 'simd', the best one by default.
+   Process wide, used to compare implementations. Returns 1 if 'simd'
+   is not supported by the CPU */
+int vx_simd_select(vx_simd_t simd);
+
+/* Batch lookup implementation selected */
+vx_simd_t vx_simd_selected();
+
+/* Look up 'n' points 'utm', stored x, y, z per point, with batch
+   implementation 'simd'. The owner voxet of each point is returned in
+   'vol' as by vx_stack_find. For points inside a voxet the voxel
+   indices are returned in 'gcoor' (3 per point) and the properties in
+   'vp', 'vs' and 'tag', other points leave them unchanged. Returns 1 if
+   'simd' is not supported by the CPU */
+int vx_stack_lookup_simd(const vx_stack_t *stack, vx_simd_t simd,
+			 const double *utm, size_t n, int *vol, int *gcoor,
+			 float *vp, float *vs, float *tag);
+
+/* Same as vx_stack_lookup_simd with the selected implementation. Used by
+   vx_getcoord_batch for the points of each chunk */
+void vx_stack_lookup_batch(const vx_stack_t *stack, const double *utm,
+			   size_t n, int *vol, int *gcoor,
+			   float *vp, float *vs, float *tag);
+
+/* Stack loaded by vx_setup, or NULL */
+const vx_stack_t *vx_get_stack();
+
+#endif
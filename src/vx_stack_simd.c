@@ -0,0 +1,422 @@
+/** vx_stack_simd.c - Batch voxet lookups with AVX2 and AVX-512. Each
+    lane finds its owner voxet in the priority map, computes the voxel
+    indices with the same double precision arithmetic and round half
+    away from zero as vx_stack_find, and gathers vp, vs and tag. Lanes
+    in mixed map cells are finished by the scalar lookup. The
+    implementation is chosen at run time from the CPU features.
+
+10/2026: Initial implementation
+**/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "params.h"
+#include "voxet.h"
+#include "vx_sub.h"
+#include "vx_stack.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VX_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+/* 2^52, adding it to a non-negative integer below 2^52 stored as a
+   double puts the integer in the low mantissa bits */
+#define VX_SIMD_MAGIC 4503599627370496.0
+
+
+/* Implementation names */
+char *VX_SIMD_NAMES[VX_SIMD_NUM] = {"scalar", "avx2", "avx512"};
+
+/* Detected implementation */
+static pthread_once_t vx_simd_once = PTHREAD_ONCE_INIT;
+static vx_simd_t vx_simd_best = VX_SIMD_SCALAR;
+
+/* Implementation used by batch lookups */
+static vx_simd_t vx_simd_use = VX_SIMD_SCALAR;
+
+
+/* Byte offset of voxel */
+size_t voxbytepos(int *, int *, int);
+
+
+/* Detect CPU features */
+static void vx_simd_init()
+{
+#ifdef VX_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2")) {
+    vx_simd_best = VX_SIMD_AVX512;
+  } else if (__builtin_cpu_supports("avx2")) {
+    vx_simd_best = VX_SIMD_AVX2;
+  }
+#endif
+  vx_simd_use = vx_simd_best;
+}
+
+
+/* Best batch lookup implementation supported by the CPU */
+vx_simd_t vx_simd_detect()
+{
+  pthread_once(&vx_simd_once, vx_simd_init);
+  return(vx_simd_best);
+}
+
+
+/* Select implementation used by batch lookups */
+int vx_simd_select(vx_simd_t simd)
+{
+  if ((simd > vx_simd_detect()) || (simd < VX_SIMD_SCALAR)) {
+    return(1);
+  }
+  vx_simd_use = simd;
+  return(0);
+}
+
+
+/* Implementation used by batch lookups */
+vx_simd_t vx_simd_selected()
+{
+  pthread_once(&vx_simd_once, vx_simd_init);
+  return(vx_simd_use);
+}
+
+
+/* Scalar lookup of one point */
+static void vx_stack_lookup_point(const vx_stack_t *stack, const double *utm,
+				  int *vol, int *gcoor,
+				  float *vp, float *vs, float *tag)
+{
+  const vx_volume_t *v;
+  size_t pos;
+  int g[3];
+
+  *vol = vx_stack_find(stack, utm, g);
+  if (*vol >= 0) {
+    v = &(stack->vols[*vol]);
+    pos = voxbytepos(g, (int *)v->a.N, v->vp_p.ESIZE);
+    memcpy(vp, &v->vp[pos], v->vp_p.ESIZE);
+    memcpy(vs, &v->vs[pos], v->vs_p.ESIZE);
+    memcpy(tag, &v->tag[pos], v->tag_p.ESIZE);
+    memcpy(gcoor, g, sizeof(int) * 3);
+  }
+}
+
+
+/* Scalar lookup of points 'start' to 'end' */
+static void vx_stack_lookup_scalar(const vx_stack_t *stack,
+				   const double *utm, size_t start,
+				   size_t end, int *vol, int *gcoor,
+				   float *vp, float *vs, float *tag)
+{
+  size_t i;
+
+  for (i = start; i < end; i++) {
+    vx_stack_lookup_point(stack, &utm[i * 3], &vol[i], &gcoor[i * 3],
+			  &vp[i], &vs[i], &tag[i]);
+  }
+}
+
+
+#ifdef VX_SIMD_X86
+
+/* Store results of lanes, finishing mixed lanes with the scalar
+   lookup. 'inside' and 'mixed' are lane bit masks */
+static void vx_stack_store_lanes(const vx_stack_t *stack,
+				 const double *utm, size_t i, int lanes,
+				 int inside, int mixed, const int *own,
+				 const int *g, const float *val,
+				 int *vol, int *gcoor,
+				 float *vp, float *vs, float *tag)
+{
+  int l;
+
+  for (l = 0; l < lanes; l++) {
+    if (mixed & (1 << l)) {
+      vx_stack_lookup_point(stack, &utm[(i + l) * 3], &vol[i + l],
+			    &gcoor[(i + l) * 3], &vp[i + l], &vs[i + l],
+			    &tag[i + l]);
+    } else if (inside & (1 << l)) {
+      vol[i + l] = own[l];
+      gcoor[(i + l) * 3] = g[l];
+      gcoor[(i + l) * 3 + 1] = g[lanes + l];
+      gcoor[(i + l) * 3 + 2] = g[2 * lanes + l];
+      vp[i + l] = val[l];
+      vs[i + l] = val[lanes + l];
+      tag[i + l] = val[2 * lanes + l];
+    } else {
+      vol[i + l] = -1;
+    }
+  }
+}
+
+
+/* Round half away from zero, as round() */
+__attribute__((target("avx2")))
+static inline __m256d vx_round_avx2(__m256d x)
+{
+  __m256d t, d, s, m;
+
+  t = _mm256_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+  d = _mm256_sub_pd(x, t);
+  d = _mm256_andnot_pd(_mm256_set1_pd(-0.0), d);
+  m = _mm256_cmp_pd(d, _mm256_set1_pd(0.5), _CMP_GE_OQ);
+  s = _mm256_or_pd(_mm256_and_pd(x, _mm256_set1_pd(-0.0)),
+		   _mm256_set1_pd(1.0));
+  return(_mm256_add_pd(t, _mm256_and_pd(m, s)));
+}
+
+
+/* Four points per iteration */
+__attribute__((target("avx2")))
+static void vx_stack_lookup_avx2(const vx_stack_t *stack, const double *utm,
+				 size_t n, int *vol, int *gcoor,
+				 float *vp, float *vs, float *tag)
+{
+  const vx_volume_t *v0 = &(stack->vols[0]);
+  const __m128i stride = _mm_setr_epi32(0, 3, 6, 9);
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d magic = _mm256_set1_pd(VX_SIMD_MAGIC);
+  const __m256i to32 = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+  const char *props[3] = {(const char *)&v0->vp, (const char *)&v0->vs,
+			  (const char *)&v0->tag};
+  __m256d p[3], t[3], f, x, o, s, nn[3], inmap, inside, offd;
+  __m256i off, base;
+  __m128i fi[3], idx, own, vidx, m32, valid, mixed;
+  __m128 val;
+  int g[12], ownl[4];
+  float vals[12];
+  size_t i;
+  int a, in, mx;
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    /* Map cell of each lane */
+    inmap = _mm256_cmp_pd(zero, zero, _CMP_EQ_OQ);
+    for (a = 0; a < 3; a++) {
+      p[a] = _mm256_i32gather_pd(&utm[i * 3 + a], stride, 8);
+      f = _mm256_div_pd(_mm256_sub_pd(p[a],
+				      _mm256_set1_pd(stack->map_o[a])),
+			_mm256_set1_pd(stack->map_step[a]));
+      inmap = _mm256_and_pd(inmap, _mm256_cmp_pd(f, zero, _CMP_GE_OQ));
+      inmap = _mm256_and_pd(inmap,
+			    _mm256_cmp_pd(f, _mm256_set1_pd(stack->map_n[a]),
+					  _CMP_LT_OQ));
+      fi[a] = _mm256_cvttpd_epi32(_mm256_and_pd(f, inmap));
+    }
+    m32 = _mm256_castsi256_si128(
+      _mm256_permutevar8x32_epi32(_mm256_castpd_si256(inmap), to32));
+    idx = _mm_add_epi32(fi[0], _mm_mullo_epi32(
+			  _mm_set1_epi32(stack->map_n[0]),
+			  _mm_add_epi32(fi[1], _mm_mullo_epi32(
+					  _mm_set1_epi32(stack->map_n[1]),
+					  fi[2]))));
+    own = _mm_and_si128(_mm_i32gather_epi32((const int *)stack->map, idx, 1),
+			_mm_set1_epi32(0xFF));
+    own = _mm_blendv_epi8(_mm_set1_epi32(VX_STACK_NONE), own, m32);
+    valid = _mm_cmplt_epi32(own, _mm_set1_epi32(VX_STACK_MIXED));
+    mixed = _mm_cmpeq_epi32(own, _mm_set1_epi32(VX_STACK_MIXED));
+    own = _mm_and_si128(own, valid);
+    _mm_storeu_si128((__m128i *)ownl, own);
+
+    /* Voxel indices in owner */
+    vidx = _mm_mullo_epi32(own, _mm_set1_epi32(sizeof(vx_volume_t)));
+    inside = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(valid));
+    for (a = 0; a < 3; a++) {
+      o = _mm256_cvtps_pd(_mm_i32gather_ps(&v0->a.O[a], vidx, 1));
+      s = _mm256_cvtps_pd(_mm_i32gather_ps(&v0->step[a], vidx, 1));
+      nn[a] = _mm256_cvtepi32_pd(_mm_i32gather_epi32(&v0->a.N[a], vidx, 1));
+      x = _mm256_div_pd(_mm256_sub_pd(p[a], o), s);
+      t[a] = vx_round_avx2(x);
+      inside = _mm256_and_pd(inside, _mm256_cmp_pd(t[a], zero, _CMP_GE_OQ));
+      inside = _mm256_and_pd(inside, _mm256_cmp_pd(t[a], nn[a], _CMP_LT_OQ));
+    }
+    for (a = 0; a < 3; a++) {
+      t[a] = _mm256_and_pd(t[a], inside);
+      _mm_storeu_si128((__m128i *)&g[a * 4], _mm256_cvttpd_epi32(t[a]));
+    }
+
+    /* Element offsets, exact in double below 2^52 */
+    offd = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(
+					 _mm256_mul_pd(t[2], nn[1]), t[1]),
+				       nn[0]), t[0]);
+    off = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(offd, magic)),
+			   _mm256_castpd_si256(magic));
+    off = _mm256_slli_epi64(off, 2);
+
+    /* Gather properties through per lane buffer addresses */
+    m32 = _mm256_castsi256_si128(
+      _mm256_permutevar8x32_epi32(_mm256_castpd_si256(inside), to32));
+    for (a = 0; a < 3; a++) {
+      base = _mm256_mask_i32gather_epi64(_mm256_setzero_si256(),
+					 (const long long *)props[a], vidx,
+					 _mm256_castpd_si256(inside), 1);
+      val = _mm256_mask_i64gather_ps(_mm_setzero_ps(), (const float *)0,
+				     _mm256_add_epi64(base, off),
+				     _mm_castsi128_ps(m32), 1);
+      _mm_storeu_ps(&vals[a * 4], val);
+    }
+
+    in = _mm256_movemask_pd(inside);
+    mx = _mm_movemask_ps(_mm_castsi128_ps(mixed)) |
+      (_mm_movemask_ps(_mm_castsi128_ps(valid)) & ~in);
+    vx_stack_store_lanes(stack, utm, i, 4, in, mx, ownl, g, vals,
+			 vol, gcoor, vp, vs, tag);
+  }
+
+  vx_stack_lookup_scalar(stack, utm, i, n, vol, gcoor, vp, vs, tag);
+}
+
+
+/* Eight points per iteration */
+__attribute__((target("avx512f,avx2")))
+static void vx_stack_lookup_avx512(const vx_stack_t *stack,
+				   const double *utm, size_t n,
+				   int *vol, int *gcoor,
+				   float *vp, float *vs, float *tag)
+{
+  const vx_volume_t *v0 = &(stack->vols[0]);
+  const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+  const __m512d zero = _mm512_setzero_pd();
+  const __m512d half = _mm512_set1_pd(0.5);
+  const __m512d one = _mm512_set1_pd(1.0);
+  const __m512d magic = _mm512_set1_pd(VX_SIMD_MAGIC);
+  const char *props[3] = {(const char *)&v0->vp, (const char *)&v0->vs,
+			  (const char *)&v0->tag};
+  __m512d p[3], t[3], f, x, d, o, s, nn[3], offd;
+  __m512i off, base;
+  __m256i fi[3], idx, own, vidx;
+  __m256 val;
+  __mmask8 inmap, inside, valid, mixed, up;
+  int g[24], ownl[8];
+  float vals[24];
+  size_t i;
+  int a;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    /* Map cell of each lane */
+    inmap = 0xFF;
+    for (a = 0; a < 3; a++) {
+      p[a] = _mm512_i32gather_pd(stride, &utm[i * 3 + a], 8);
+      f = _mm512_div_pd(_mm512_sub_pd(p[a],
+				      _mm512_set1_pd(stack->map_o[a])),
+			_mm512_set1_pd(stack->map_step[a]));
+      inmap &= _mm512_cmp_pd_mask(f, zero, _CMP_GE_OQ);
+      inmap &= _mm512_cmp_pd_mask(f, _mm512_set1_pd(stack->map_n[a]),
+				  _CMP_LT_OQ);
+      fi[a] = _mm512_cvttpd_epi32(_mm512_maskz_mov_pd(inmap, f));
+    }
+    idx = _mm256_add_epi32(fi[0], _mm256_mullo_epi32(
+			     _mm256_set1_epi32(stack->map_n[0]),
+			     _mm256_add_epi32(fi[1], _mm256_mullo_epi32(
+						_mm256_set1_epi32(stack->map_n[1]),
+						fi[2]))));
+    own = _mm256_and_si256(_mm256_i32gather_epi32((const int *)stack->map,
+						  idx, 1),
+			   _mm256_set1_epi32(0xFF));
+    own = _mm512_castsi512_si256(
+      _mm512_mask_mov_epi32(_mm512_set1_epi32(VX_STACK_NONE), inmap,
+			    _mm512_castsi256_si512(own)));
+    valid = _mm512_cmplt_epi32_mask(_mm512_castsi256_si512(own),
+				    _mm512_set1_epi32(VX_STACK_MIXED)) & 0xFF;
+    mixed = _mm512_cmpeq_epi32_mask(_mm512_castsi256_si512(own),
+				    _mm512_set1_epi32(VX_STACK_MIXED)) & 0xFF;
+    own = _mm512_castsi512_si256(
+      _mm512_maskz_mov_epi32(valid, _mm512_castsi256_si512(own)));
+    _mm256_storeu_si256((__m256i *)ownl, own);
+
+    /* Voxel indices in owner */
+    vidx = _mm256_mullo_epi32(own, _mm256_set1_epi32(sizeof(vx_volume_t)));
+    inside = valid;
+    for (a = 0; a < 3; a++) {
+      o = _mm512_cvtps_pd(_mm256_i32gather_ps(&v0->a.O[a], vidx, 1));
+      s = _mm512_cvtps_pd(_mm256_i32gather_ps(&v0->step[a], vidx, 1));
+      nn[a] = _mm512_cvtepi32_pd(_mm256_i32gather_epi32(&v0->a.N[a],
+							 vidx, 1));
+      x = _mm512_div_pd(_mm512_sub_pd(p[a], o), s);
+
+      /* Round half away from zero */
+      t[a] = _mm512_roundscale_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+      d = _mm512_abs_pd(_mm512_sub_pd(x, t[a]));
+      up = _mm512_cmp_pd_mask(d, half, _CMP_GE_OQ);
+      t[a] = _mm512_mask_add_pd(t[a], up &
+				_mm512_cmp_pd_mask(x, zero, _CMP_GT_OQ),
+				t[a], one);
+      t[a] = _mm512_mask_sub_pd(t[a], up &
+				_mm512_cmp_pd_mask(x, zero, _CMP_LT_OQ),
+				t[a], one);
+
+      inside &= _mm512_cmp_pd_mask(t[a], zero, _CMP_GE_OQ);
+      inside &= _mm512_cmp_pd_mask(t[a], nn[a], _CMP_LT_OQ);
+    }
+    for (a = 0; a < 3; a++) {
+      t[a] = _mm512_maskz_mov_pd(inside, t[a]);
+      _mm256_storeu_si256((__m256i *)&g[a * 8], _mm512_cvttpd_epi32(t[a]));
+    }
+
+    /* Element offsets, exact in double below 2^52 */
+    offd = _mm512_add_pd(_mm512_mul_pd(_mm512_add_pd(
+					 _mm512_mul_pd(t[2], nn[1]), t[1]),
+				       nn[0]), t[0]);
+    off = _mm512_sub_epi64(_mm512_castpd_si512(_mm512_add_pd(offd, magic)),
+			   _mm512_castpd_si512(magic));
+    off = _mm512_slli_epi64(off, 2);
+
+    /* Gather properties through per lane buffer addresses */
+    for (a = 0; a < 3; a++) {
+      base = _mm512_mask_i32gather_epi64(_mm512_setzero_si512(), inside,
+					 vidx, props[a], 1);
+      val = _mm512_mask_i64gather_ps(_mm256_setzero_ps(), inside,
+				     _mm512_add_epi64(base, off),
+				     (const float *)0, 1);
+      _mm256_storeu_ps(&vals[a * 8], val);
+    }
+
+    vx_stack_store_lanes(stack, utm, i, 8, inside, mixed | (valid & ~inside),
+			 ownl, g, vals, vol, gcoor, vp, vs, tag);
+  }
+
+  vx_stack_lookup_scalar(stack, utm, i, n, vol, gcoor, vp, vs, tag);
+}
+
+#endif
+
+
+/* Look up points with batch implementation 'simd' */
+int vx_stack_lookup_simd(const vx_stack_t *stack, vx_simd_t simd,
+			 const double *utm, size_t n, int *vol, int *gcoor,
+			 float *vp, float *vs, float *tag)
+{
+  if ((simd > vx_simd_detect()) || (simd < VX_SIMD_SCALAR)) {
+    return(1);
+  }
+  if ((stack->simd_ok != True) || (stack->map == NULL)) {
+    simd = VX_SIMD_SCALAR;
+  }
+
+  switch (simd) {
+#ifdef VX_SIMD_X86
+  case VX_SIMD_AVX512:
+    vx_stack_lookup_avx512(stack, utm, n, vol, gcoor, vp, vs, tag);
+    break;
+  case VX_SIMD_AVX2:
+    vx_stack_lookup_avx2(stack, utm, n, vol, gcoor, vp, vs, tag);
+    break;
+#endif
+  default:
+    vx_stack_lookup_scalar(stack, utm, 0, n, vol, gcoor, vp, vs, tag);
+    break;
+  }
+  return(0);
+}
+
+
+/* Look up points with the selected implementation */
+void vx_stack_lookup_batch(const vx_stack_t *stack, const double *utm,
+			   size_t n, int *vol, int *gcoor,
+			   float *vp, float *vs, float *tag)
+{
+  vx_stack_lookup_simd(stack, vx_simd_selected(), utm, n, vol, gcoor,
+		       vp, vs, tag);
+}
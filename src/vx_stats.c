@@ -0,0 +1,202 @@
+/** vx_stats.c - Query statistics: per-stage call counts and times, and
+    hit counts by data source and provenance. Each thread updates its
+    own counters, which are summed on request.
+
+10/2026: Initial implementation
+**/
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include "params.h"
+#include "vx_sub.h"
+#include "vx_stats.h"
+
+
+/* Stage labels */
+char *VX_STAGE_NAMES[VX_STAGE_NUM] = {"query", "geo2utm", "topo",
+				      "surface", "modeltop", "cascade",
+				      "bkg", "gtl"};
+
+/* Provenance labels, last is out of range */
+static char *vx_stats_prov_names[VX_STATS_NUM_PROV] = {
+  "none", "mantle", "tomo", "basin", "air", "basin_gtl", "extrap_tomo",
+  "water", "basement_gtl", "bb_trans_outer", "air_outer",
+  "filled_mantle", "filled_crust", "extrap_mantle", "backgnd", "gtl",
+  "other"};
+
+/* Counters of all threads */
+static vx_stats_t *vx_stats_list = NULL;
+static pthread_mutex_t vx_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread vx_stats_t *vx_stats_local = NULL;
+
+
+/* Returns True if the library was built with VX_ENABLE_STATS */
+int vx_stats_enabled()
+{
+#ifdef VX_ENABLE_STATS
+  return(True);
+#else
+  return(False);
+#endif
+}
+
+
+/* Monotonic clock in nanoseconds */
+unsigned long long vx_stats_now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+
+/* Counters of calling thread, registered on first use. Counters of
+   finished threads are kept so their totals remain visible */
+vx_stats_t *vx_stats_thread()
+{
+  static vx_stats_t dummy;
+
+  if (vx_stats_local == NULL) {
+    vx_stats_local = calloc(1, sizeof(vx_stats_t));
+    if (vx_stats_local == NULL) {
+      return(&dummy);
+    }
+    pthread_mutex_lock(&vx_stats_lock);
+    vx_stats_local->next = vx_stats_list;
+    vx_stats_list = vx_stats_local;
+    pthread_mutex_unlock(&vx_stats_lock);
+  }
+  return(vx_stats_local);
+}
+
+
+/* Sum counters over all threads into 'stats'. Counters of running
+   threads are read without locking and may be slightly behind */
+int vx_get_stats(vx_stats_t *stats)
+{
+  vx_stats_t *s;
+  int i;
+
+  memset(stats, 0, sizeof(vx_stats_t));
+  if (!vx_stats_enabled()) {
+    return(1);
+  }
+
+  pthread_mutex_lock(&vx_stats_lock);
+  for (s = vx_stats_list; s != NULL; s = s->next) {
+    for (i = 0; i < VX_STAGE_NUM; i++) {
+      stats->calls[i] += s->calls[i];
+      stats->nsec[i] += s->nsec[i];
+    }
+    for (i = 0; i < VX_STATS_NUM_SRC; i++) {
+      stats->src_hits[i] += s->src_hits[i];
+      stats->cascade_hits[i] += s->cascade_hits[i];
+    }
+    for (i = 0; i < VX_STATS_NUM_PROV; i++) {
+      stats->prov_hits[i] += s->prov_hits[i];
+    }
+    for (i = 0; i < VX_STATS_NUM_PATH; i++) {
+      stats->path_points[i] += s->path_points[i];
+      stats->path_nsec[i] += s->path_nsec[i];
+    }
+    stats->surface_iter += s->surface_iter;
+    stats->surface_limit += s->surface_limit;
+    stats->modeltop_iter += s->modeltop_iter;
+    stats->modeltop_limit += s->modeltop_limit;
+    stats->gtl_requery += s->gtl_requery;
+    stats->gtl_applied += s->gtl_applied;
+    stats->batch_sorted += s->batch_sorted;
+    stats->batch_coherent += s->batch_coherent;
+    stats->failed += s->failed;
+  }
+  pthread_mutex_unlock(&vx_stats_lock);
+  return(0);
+}
+
+
+/* Reset counters of all threads */
+void vx_reset_stats()
+{
+  vx_stats_t *s, *next;
+
+  pthread_mutex_lock(&vx_stats_lock);
+  for (s = vx_stats_list; s != NULL; s = s->next) {
+    next = s->next;
+    memset(s, 0, sizeof(vx_stats_t));
+    s->next = next;
+  }
+  pthread_mutex_unlock(&vx_stats_lock);
+}
+
+
+/* Format statistics as text report. Returns length */
+int vx_stats_text(vx_stats_t *stats, char *buf, size_t len)
+{
+  size_t n = 0;
+  int i;
+
+#define VX_STATS_PRINT(...) \
+  n += snprintf(&buf[n], (n < len) ? len - n : 0, __VA_ARGS__); \
+  if (n > len) n = len;
+
+  if (len == 0) {
+    return(0);
+  }
+  buf[0] = '\0';
+  if (!vx_stats_enabled()) {
+    VX_STATS_PRINT("Statistics not available, "
+		   "rebuild with --enable-stats\n");
+    return(n);
+  }
+
+  VX_STATS_PRINT("%-10s %12s %14s %10s\n", "stage", "calls", "total_ms",
+		 "ns/call");
+  for (i = 0; i < VX_STAGE_NUM; i++) {
+    VX_STATS_PRINT("%-10s %12llu %14.3f %10.1f\n", VX_STAGE_NAMES[i],
+		   stats->calls[i], stats->nsec[i] * 1.0e-6,
+		   (stats->calls[i] > 0) ?
+		   (double)stats->nsec[i] / stats->calls[i] : 0.0);
+  }
+
+  VX_STATS_PRINT("%-10s %12s %12s\n", "source", "results", "cascade");
+  for (i = 0; i < VX_STATS_NUM_SRC; i++) {
+    VX_STATS_PRINT("%-10s %12llu %12llu\n", VX_SRC_NAMES[i],
+		   stats->src_hits[i], stats->cascade_hits[i]);
+  }
+
+  VX_STATS_PRINT("%-14s %12s\n", "provenance", "results");
+  for (i = 0; i < VX_STATS_NUM_PROV; i++) {
+    if (stats->prov_hits[i] > 0) {
+      VX_STATS_PRINT("%-14s %12llu\n", vx_stats_prov_names[i],
+		     stats->prov_hits[i]);
+    }
+  }
+
+  VX_STATS_PRINT("%-10s %12s %10s\n", "path", "points", "ns/point");
+  for (i = 0; i < VX_STATS_NUM_PATH; i++) {
+    VX_STATS_PRINT("%-10s %12llu %10.1f\n", VX_PATH_NAMES[i],
+		   stats->path_points[i],
+		   (stats->path_points[i] > 0) ?
+		   (double)stats->path_nsec[i] / stats->path_points[i] : 0.0);
+  }
+
+  VX_STATS_PRINT("surface_iter %llu\n", stats->surface_iter);
+  VX_STATS_PRINT("surface_max_iter_elev %llu\n", stats->surface_limit);
+  VX_STATS_PRINT("modeltop_iter %llu\n", stats->modeltop_iter);
+  VX_STATS_PRINT("modeltop_max_iter_elev %llu\n", stats->modeltop_limit);
+  VX_STATS_PRINT("gtl_requery %llu\n", stats->gtl_requery);
+  VX_STATS_PRINT("gtl_applied %llu\n", stats->gtl_applied);
+  VX_STATS_PRINT("batch_sorted %llu\n", stats->batch_sorted);
+  VX_STATS_PRINT("batch_coherent %llu\n", stats->batch_coherent);
+  VX_STATS_PRINT("failed %llu\n", stats->failed);
+
+#undef VX_STATS_PRINT
+
+  return(n);
+}
@@ -0,0 +1,107 @@
+#ifndef VX_STATS_H
+#define VX_STATS_H
+
+#include <stddef.h>
+
+/* Number of data sources and provenance tags counted. Provenance
+   values outside the vx_prov_t range are counted in the last bin */
+#define VX_STATS_NUM_SRC 7
+#define VX_STATS_NUM_PROV 17
+
+/* Number of query paths counted by batch classification */
+#define VX_STATS_NUM_PATH 5
+
+
+/* Timed query stages. Times are inclusive, the surface and model top
+   stages contain the cascade lookups they trigger */
+typedef enum { VX_STAGE_QUERY = 0,
+	       VX_STAGE_GEO2UTM,
+	       VX_STAGE_TOPO,
+	       VX_STAGE_SURFACE,
+	       VX_STAGE_MODELTOP,
+	       VX_STAGE_CASCADE,
+	       VX_STAGE_BKG,
+	       VX_STAGE_GTL,
+	       VX_STAGE_NUM } vx_stage_t;
+
+
+/* Query counters and timers */
+typedef struct vx_stats_t
+{
+  unsigned long long calls[VX_STAGE_NUM];
+  unsigned long long nsec[VX_STAGE_NUM];
+
+  /* Final data source and provenance of vx_getcoord results */
+  unsigned long long src_hits[VX_STATS_NUM_SRC];
+  unsigned long long prov_hits[VX_STATS_NUM_PROV];
+
+  /* Voxet answering each cascade lookup, nr when none did */
+  unsigned long long cascade_hits[VX_STATS_NUM_SRC];
+
+  /* Surface/model top search iterations, and searches that hit
+     MAX_ITER_ELEV */
+  unsigned long long surface_iter;
+  unsigned long long surface_limit;
+  unsigned long long modeltop_iter;
+  unsigned long long modeltop_limit;
+
+  /* Points requeried below the GTL transition, and points changed
+     by the GTL */
+  unsigned long long gtl_requery;
+  unsigned long long gtl_applied;
+
+  /* Batches sorted along the curve, and batches left in input order
+     because they were coherent */
+  unsigned long long batch_sorted;
+  unsigned long long batch_coherent;
+
+  /* Points and time of each query path in classified batches */
+  unsigned long long path_points[VX_STATS_NUM_PATH];
+  unsigned long long path_nsec[VX_STATS_NUM_PATH];
+
+  /* Failed vx_getcoord calls */
+  unsigned long long failed;
+
+  struct vx_stats_t *next;
+} vx_stats_t;
+
+
+/* Stage names, indexed by vx_stage_t */
+extern char *VX_STAGE_NAMES[VX_STAGE_NUM];
+
+
+/* Returns True if the library was built with VX_ENABLE_STATS */
+int vx_stats_enabled();
+
+/* Sum counters over all threads into 'stats'. Returns 1 if statistics
+   are not compiled in */
+int vx_get_stats(vx_stats_t *stats);
+
+/* Reset counters of all threads */
+void vx_reset_stats();
+
+/* Format statistics as text report. Returns length */
+int vx_stats_text(vx_stats_t *stats, char *buf, size_t len);
+
+/* Per-thread counters and monotonic clock, used by the macros below */
+vx_stats_t *vx_stats_thread();
+unsigned long long vx_stats_now();
+
+
+/* Instrumentation macros, compiled out unless VX_ENABLE_STATS is set */
+#ifdef VX_ENABLE_STATS
+#define VX_STATS_TIMER(t) unsigned long long t = vx_stats_now()
+#define VX_STATS_STOP(stage, t) do { \
+    vx_stats_t *vx_st_ = vx_stats_thread(); \
+    vx_st_->calls[stage]++; \
+    vx_st_->nsec[stage] += vx_stats_now() - (t); } while (0)
+#define VX_STATS_COUNT(field) (vx_stats_thread()->field++)
+#define VX_STATS_ADD(field, n) (vx_stats_thread()->field += (n))
+#else
+#define VX_STATS_TIMER(t)
+#define VX_STATS_STOP(stage, t) do { } while (0)
+#define VX_STATS_COUNT(field) do { } while (0)
+#define VX_STATS_ADD(field, n) do { } while (0)
+#endif
+
+#endif
@@ -5,11 +5,24 @@
 01/2010: PES: Derived from original VX interface, vx.c. 
               Added Vs30 Derived GTL, 1D background, smoothing
 07/2011: PES: Extracted io into separate module from vx_sub.c
+10/2026: Made queries safe to call from multiple threads
+10/2026: Added optional per-stage timers and hit counters (VX_ENABLE_STATS)
+10/2026: 64-bit cell counts and byte offsets for volumes over 2 GB
+10/2026: Voxets loaded as a stack from the model manifest
+10/2026: Query path compiled into kernels selected by the settings
+10/2026: Batch queries look up voxets with vx_stack_lookup_batch
+10/2026: Optional space-filling curve ordering of batch queries
+10/2026: Optional classification of batch points by query path
+10/2026: Model buffers allocated through the vx_mem backends
+10/2026: Queries with a Z mode chosen per call, for column walks
+10/2026: Topo grid geometry exported for surface maps
 **/
 
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
 #include "params.h"
 #include "coor_para.h"
 #include "voxet.h"
@@ -20,6 +33,10 @@
 #include "utils.h"
 #include "vx_io.h"
 #include "vx_sub.h"
+#include "vx_stats.h"
+#include "vx_stack.h"
+#include "vx_order.h"
+#include "vx_mem.h"
 
 /* Smoothing parameters for SCEC 1D */
 #define SCEC_SMOOTH_DIST 50.0 // km
@@ -28,11 +45,20 @@
 #define ELEV_EPSILON 0.01
 #define MAX_ITER_ELEV 4
 
+/* Batches with fewer points are not classified by path */
+#define VX_CLASSIFY_MIN 64
+
+
+/* gctp unit factor for degrees to radians */
+#define VX_DEG_TO_RAD .0174532925199433
+
 
 /* Function declarations */
 void gctp();
-int voxbytepos(int *, int* ,int);
+long utmfor(double lon, double lat, double *x, double *y);
+size_t voxbytepos(int *, int* ,int);
 double calc_rho(float vp, vx_src_t data_src);
+static void vx_select_kernel();
 
 /* User-defined background model function pointer */
 int (*callback_bkg)(vx_entry_t *entry, vx_request_t req_type) = NULL;
@@ -41,6 +67,10 @@ int (*callback_bkg)(vx_entry_t *entry, vx_request_t req_type) = NULL;
 static int is_setup = False;
 vx_zmode_t vx_zmode = VX_ZMODE_ELEV;
 int vx_use_gtl = True;
+static vx_order_t vx_order = VX_ORDER_NONE;
+static int vx_use_classify = False;
+static vx_mem_opts_t vx_mem = {VX_MEM_PAGES_DEFAULT, False, False,
+			       VX_MEM_NUMA_NONE};
 struct axis lr_a, mr_a, hr_a, cm_a, to_a;
 struct property p0,p1,p2,p3,p4,p5,p6,p7,p8,p9,p10,p11,p12,p13;
 float step_to[3], step_lr[3], step_hr[3], step_cm[3];
@@ -60,14 +90,81 @@ static char *hrtbuffer = NULL;
 static char *lrvsbuffer = NULL;
 static char *hrvsbuffer = NULL;
 
+/* Voxet stack */
+static vx_stack_t vx_stack;
+
 /* Data source labels */
 char *VX_SRC_NAMES[7] = {"nr", "hr", "lr", "cm", "to", "bk", "gt"};
 
+/* Query path labels */
+char *VX_PATH_NAMES[VX_PATH_NUM] = {"core", "gtl", "bkg", "air", "nr"};
+
+/* One-time initialization of the gctp UTM projection state */
+static pthread_once_t vx_utm_once = PTHREAD_ONCE_INIT;
+
+
+/* Initialize gctp for geographic to UTM Zone 11 conversion */
+static void vx_utm_init()
+{
+  double SP[2], SPUTM[2];
+
+  SP[0] = -118.0;
+  SP[1] = 34.0;
+  gctp(SP,&insys,&inzone,inparm,&inunit,&indatum,&ipr,efile,&jpr,efile,
+       SPUTM,&outsys,&outzone,inparm,&outunit,&outdatum,
+       file27, file83,&iflg);
+}
+
+
+/* Convert geographic coordinates to UTM Zone 11. gctp keeps its 
+   projection parameters in static storage and reinitializes them on
+   each call, so it is called only once to set up the projection. The 
+   UTM forward transform is then evaluated directly, which yields the 
+   same result as gctp and is safe to use from multiple threads. */
+void vx_geo2utm(double *geo, double *utm)
+{
+  VX_STATS_TIMER(t);
+
+  pthread_once(&vx_utm_once, vx_utm_init);
+  utmfor(geo[0] * VX_DEG_TO_RAD, geo[1] * VX_DEG_TO_RAD, &utm[0], &utm[1]);
+  VX_STATS_STOP(VX_STAGE_GEO2UTM, t);
+}
+
+
+/* Point legacy voxet state of data source 'src' at the first voxet of
+   the stack with that source */
+static int vx_setup_source(vx_src_t src, struct axis *a, float *step,
+			   struct property *vp_p, struct property *tag_p,
+			   struct property *vs_p, char **vp, char **tag,
+			   char **vs)
+{
+  vx_volume_t *vol;
+  int i;
+
+  for (i = 0; i < vx_stack.num_vols; i++) {
+    vol = &(vx_stack.vols[i]);
+    if (vol->src == src) {
+      *a = vol->a;
+      memcpy(step, vol->step, sizeof(float) * 3);
+      *vp_p = vol->vp_p;
+      *tag_p = vol->tag_p;
+      *vs_p = vol->vs_p;
+      *vp = vol->vp;
+      *tag = vol->tag;
+      *vs = vol->vs;
+      return(0);
+    }
+  }
+
+  fprintf(stderr, "No %s voxet in model\n", VX_SRC_NAMES[src]);
+  return(1);
+}
+
 
 /* Setup function to be called prior to querying points */
 int vx_setup(const char *data_dir)
 {
-  int NCells;
+  size_t NCells;
   int n;
   char gtlpath[CMLEN];
 
@@ -82,224 +179,29 @@ int vx_setup(const char *data_dir)
 
   sprintf(gtlpath, "%s/%s", data_dir, DEFAULT_GTL_FILE);
 
-  char LR_PAR[CMLEN];
-  sprintf(LR_PAR, "%s/CVM_LR.vo", data_dir);
-  
-  char HR_PAR[CMLEN];
-  sprintf(HR_PAR, "%s/CVM_HR.vo", data_dir);
-  
-  char CM_PAR[CMLEN];
-  sprintf(CM_PAR, "%s/CVM_CM.vo", data_dir);
-
   char TO_PAR[CMLEN];
   sprintf(TO_PAR, "%s/interfaces.vo", data_dir);
 
 
-  /**** First we load the LowRes File****/
-  if (vx_io_init(LR_PAR) != 0) {
-    fprintf(stderr, "Failed to load LR param file %s. Check that the model path is correct.\n", LR_PAR);
-    return(1);
-  }
-  vx_io_getvec("AXIS_O",lr_a.O);
-  vx_io_getvec("AXIS_U",lr_a.U);
-  vx_io_getvec("AXIS_V",lr_a.V);
-  vx_io_getvec("AXIS_W",lr_a.W);
-  vx_io_getvec("AXIS_MIN",lr_a.MIN);
-  vx_io_getvec("AXIS_MAX",lr_a.MAX);
-  vx_io_getdim("AXIS_N",lr_a.N);
-
-  /** AP: AXIS_MIN and AXIS_MAX are currently not used and need to be 0
-      0 0 and 1 1 1, respectively, in the .vo file. The AXIS_UVW would
-      need to be adjusted accordingly in the .vo file.
-  **/
-
-  NCells=lr_a.N[0]*lr_a.N[1]*lr_a.N[2];
-  sprintf(p0.NAME,"vint");
-  vx_io_getpropname("PROP_FILE",1,p0.FN);
-  vx_io_getpropsize("PROP_ESIZE",1,&p0.ESIZE);
-  vx_io_getpropval("PROP_NO_DATA_VALUE",1,&p0.NO_DATA_VALUE);
-
-  lrbuffer=(char *)malloc(NCells*p0.ESIZE);
-  if (lrbuffer == NULL) {
-    fprintf(stderr, "Failed to allocate LR Vp buffer\n");
-    return(1);
-  }
-  if (vx_io_loadvolume(data_dir, p0.FN,
-		       p0.ESIZE,NCells,lrbuffer) != 0) {
-    fprintf(stderr, "Failed to load LR Vp volume\n");
-    return(1);
-  }
-
-  // and the tags
-  sprintf(p7.NAME,"tag");
-  vx_io_getpropname("PROP_FILE",2,p7.FN);
-  vx_io_getpropsize("PROP_ESIZE",2,&p7.ESIZE);
-  vx_io_getpropval("PROP_NO_DATA_VALUE",2,&p7.NO_DATA_VALUE);
-
-  lrtbuffer=(char *)malloc(NCells*p7.ESIZE);
-  if (lrtbuffer == NULL) {
-    fprintf(stderr, "Failed to allocate LR tag buffer\n");
-    return(1);
-  }
-  if (vx_io_loadvolume(data_dir, p7.FN,
-		       p7.ESIZE,NCells,lrtbuffer) != 0) {
-    fprintf(stderr, "Failed to load LR tag volume\n");
-    return(1);
-  }
-
-  // and vs
-  sprintf(p11.NAME,"vs");
-  vx_io_getpropname("PROP_FILE",3,p11.FN);
-  vx_io_getpropsize("PROP_ESIZE",3,&p11.ESIZE);
-  vx_io_getpropval("PROP_NO_DATA_VALUE",3,&p11.NO_DATA_VALUE);
-
-  lrvsbuffer=(char *)malloc(NCells*p11.ESIZE);
-  if (lrvsbuffer == NULL) {
-    fprintf(stderr, "Failed to allocate LR Vs buffer\n");
-    return(1);
-  }
-  if (vx_io_loadvolume(data_dir, p11.FN,
-		       p11.ESIZE,NCells,lrvsbuffer) != 0) {
-    fprintf(stderr, "Failed to load LR Vs volume\n");
-    return(1);
-  }
-  vx_io_finalize();
-
-  /**** Now we load the HighRes File *****/
-  if (vx_io_init(HR_PAR) != 0) {
-    fprintf(stderr, "Failed to load HR param file %s\n", HR_PAR);
-    return(1);
-  }
-
-  vx_io_getvec("AXIS_O",hr_a.O);
-  vx_io_getvec("AXIS_U",hr_a.U);
-  vx_io_getvec("AXIS_V",hr_a.V);
-  vx_io_getvec("AXIS_W",hr_a.W);
-  vx_io_getvec("AXIS_MIN",hr_a.MIN);
-  vx_io_getvec("AXIS_MAX",hr_a.MAX);
-  vx_io_getdim("AXIS_N ",hr_a.N);
-
-  NCells=hr_a.N[0]*hr_a.N[1]*hr_a.N[2];
-
-  sprintf(p1.NAME,"vint");
-  vx_io_getpropname("PROP_FILE",1,p2.FN);
-  vx_io_getpropsize("PROP_ESIZE",1,&p2.ESIZE);
-  vx_io_getpropval("PROP_NO_DATA_VALUE",1,&p2.NO_DATA_VALUE);
-
-  hrbuffer=(char *)malloc(NCells*p2.ESIZE);
-  if (hrbuffer == NULL) {
-    fprintf(stderr, "Failed to allocate HR Vp file\n");
-    return(1);
-  }
-  if (vx_io_loadvolume(data_dir, p2.FN,
-		       p2.ESIZE,NCells,hrbuffer) != 0) {
-    fprintf(stderr, "Failed to load HR Vp volume\n");
-    return(1);
-  }
-
-  // and the tags
-  sprintf(p9.NAME,"tag");
-  vx_io_getpropname("PROP_FILE",2,p9.FN);
-  vx_io_getpropsize("PROP_ESIZE",2,&p9.ESIZE);
-  vx_io_getpropval("PROP_NO_DATA_VALUE",2,&p9.NO_DATA_VALUE);
-
-  hrtbuffer=(char *)malloc(NCells*p9.ESIZE);
-  if (hrtbuffer == NULL) {
-    fprintf(stderr, "Failed to allocate HR tag file\n");
-    return(1);
-  }
-  if (vx_io_loadvolume(data_dir, p9.FN,
-		       p9.ESIZE,NCells,hrtbuffer) != 0) {
-    fprintf(stderr, "Failed to load HR tag volume\n");
-    return(1);
-  }
-
-  // and vs
-  sprintf(p12.NAME,"vs");
-  vx_io_getpropname("PROP_FILE",3,p12.FN);
-  vx_io_getpropsize("PROP_ESIZE",3,&p12.ESIZE);
-  vx_io_getpropval("PROP_NO_DATA_VALUE",3,&p12.NO_DATA_VALUE);
-
-  hrvsbuffer=(char *)malloc(NCells*p12.ESIZE);
-  if (hrvsbuffer == NULL) {
-    fprintf(stderr, "Failed to allocate HR Vs file\n");
-    return(1);
-  }
-  if (vx_io_loadvolume(data_dir, p12.FN,
-		       p12.ESIZE,NCells,hrvsbuffer) != 0) {
-    fprintf(stderr, "Failed to load HR Vs volume\n");
-    return(1);
-  }
-
-  vx_io_finalize();
+  /* Buffers below are allocated with the requested backend */
+  vx_mem_set(&vx_mem);
 
-  /**** Now we load the CrustMantle File *****/
-  if (vx_io_init(CM_PAR) != 0) {
-    fprintf(stderr, "Failed to load CM param file %s\n", CM_PAR);
+  /**** First we load the voxet stack ****/
+  if (vx_stack_load(data_dir, &vx_stack) != 0) {
     return(1);
   }
 
-  vx_io_getvec("AXIS_O",cm_a.O);
-  vx_io_getvec("AXIS_U",cm_a.U);
-  vx_io_getvec("AXIS_V",cm_a.V);
-  vx_io_getvec("AXIS_W",cm_a.W);
-  vx_io_getvec("AXIS_MIN",cm_a.MIN);
-  vx_io_getvec("AXIS_MAX",cm_a.MAX);
-  vx_io_getdim("AXIS_N ",cm_a.N);
-
-  NCells=cm_a.N[0]*cm_a.N[1]*cm_a.N[2];
-  sprintf(p3.NAME,"cvp");
-  vx_io_getpropname("PROP_FILE",1,p3.FN);
-  vx_io_getpropsize("PROP_ESIZE",1,&p3.ESIZE);
-  vx_io_getpropval("PROP_NO_DATA_VALUE",1,&p3.NO_DATA_VALUE);
-
-  cmbuffer=(char *)malloc(NCells*p3.ESIZE);
-  if (cmbuffer == NULL) {
-    fprintf(stderr, "Failed to allocate CM Vp buffer\n");
-    return(1);
-  }
-  if (vx_io_loadvolume(data_dir, p3.FN, 
-		       p3.ESIZE, NCells, cmbuffer) != 0) {
-    fprintf(stderr, "Failed to load CM Vp volume\n");
+  /* Legacy HR, LR and CM state is the first voxet of each source */
+  if (vx_setup_source(VX_SRC_HR, &hr_a, step_hr, &p2, &p9, &p12,
+		      &hrbuffer, &hrtbuffer, &hrvsbuffer) ||
+      vx_setup_source(VX_SRC_LR, &lr_a, step_lr, &p0, &p7, &p11,
+		      &lrbuffer, &lrtbuffer, &lrvsbuffer) ||
+      vx_setup_source(VX_SRC_CM, &cm_a, step_cm, &p3, &p8, &p10,
+		      &cmbuffer, &cmtbuffer, &cmvsbuffer)) {
+    vx_stack_free(&vx_stack);
     return(1);
   }
 
-  // and the flags
-  sprintf(p8.NAME,"tag");
-  vx_io_getpropname("PROP_FILE",2,p8.FN);
-  vx_io_getpropsize("PROP_ESIZE",2,&p8.ESIZE);
-  vx_io_getpropval("PROP_NO_DATA_VALUE",2,&p8.NO_DATA_VALUE);
-
-  cmtbuffer=(char *)malloc(NCells*p8.ESIZE);
-  if (cmtbuffer == NULL) {
-    fprintf(stderr, "Failed to allocate CM tag buffer\n");
-    return(1);
-  }
-  if (vx_io_loadvolume(data_dir, p8.FN, 
-		       p8.ESIZE, NCells, cmtbuffer) != 0) {
-    fprintf(stderr, "Failed to load CM tag volume\n");
-    return(1);
-  }
-
-  // and vs
-  sprintf(p10.NAME,"cvs");
-  vx_io_getpropname("PROP_FILE",3,p10.FN);
-  vx_io_getpropsize("PROP_ESIZE",3,&p10.ESIZE);
-  vx_io_getpropval("PROP_NO_DATA_VALUE",3,&p10.NO_DATA_VALUE);
-
-  cmvsbuffer=(char *)malloc(NCells*p10.ESIZE);
-  if (cmvsbuffer == NULL) {
-    fprintf(stderr, "Failed to allocate CM Vs buffer\n");
-    return(1);
-  }
-  if (vx_io_loadvolume(data_dir, p10.FN, 
-		       p10.ESIZE, NCells, cmvsbuffer) != 0) {
-    fprintf(stderr, "Failed to load CM Vs volume\n");
-    return(1);
-  }
-
-  vx_io_finalize();
-
   /**** Now we load the topo, moho, base, model top File *****/
   if (vx_io_init(TO_PAR) != 0) {
     fprintf(stderr, "Failed to load topo param file %s\n", TO_PAR);
@@ -314,7 +216,11 @@ int vx_setup(const char *data_dir)
   vx_io_getvec("AXIS_MAX",to_a.MAX);
   vx_io_getdim("AXIS_N ",to_a.N);
 
-  NCells=to_a.N[0]*to_a.N[1]*to_a.N[2];
+  NCells=vx_volume_cells(to_a.N, "topo");
+  if (NCells == 0) {
+    vx_io_finalize();
+    return(1);
+  }
 
   // topo
   sprintf(p4.NAME,"topo_dem");
@@ -322,7 +228,7 @@ int vx_setup(const char *data_dir)
   vx_io_getpropsize("PROP_ESIZE",1,&p4.ESIZE);
   vx_io_getpropval("PROP_NO_DATA_VALUE",1,&p4.NO_DATA_VALUE);
 
-  tobuffer=(char *)malloc(NCells*p4.ESIZE);
+  tobuffer=(char *)vx_mem_alloc(NCells*p4.ESIZE);
   if (tobuffer == NULL) {
     fprintf(stderr, "Failed to allocate topo dem buffer\n");
     return(1);
@@ -339,7 +245,7 @@ int vx_setup(const char *data_dir)
   vx_io_getpropsize("PROP_ESIZE",3,&p5.ESIZE);
   vx_io_getpropval("PROP_NO_DATA_VALUE",3,&p5.NO_DATA_VALUE);
 
-  mobuffer=(char *)malloc(NCells*p5.ESIZE);
+  mobuffer=(char *)vx_mem_alloc(NCells*p5.ESIZE);
   if (mobuffer == NULL) {
     fprintf(stderr, "Failed to allocate topo moho buffer\n");
     return(1);
@@ -356,7 +262,7 @@ int vx_setup(const char *data_dir)
   vx_io_getpropsize("PROP_ESIZE",2,&p6.ESIZE);
   vx_io_getpropval("PROP_NO_DATA_VALUE",2,&p6.NO_DATA_VALUE);
 
-  babuffer=(char *)malloc(NCells*p6.ESIZE);
+  babuffer=(char *)vx_mem_alloc(NCells*p6.ESIZE);
   if (babuffer == NULL) {
     fprintf(stderr, "Failed to allocate topo basement buffer\n");
     return(1);
@@ -373,7 +279,7 @@ int vx_setup(const char *data_dir)
   vx_io_getpropsize("PROP_ESIZE",4,&p13.ESIZE);
   vx_io_getpropval("PROP_NO_DATA_VALUE",4,&p13.NO_DATA_VALUE);
 
-  mtopbuffer=(char *)malloc(NCells*p13.ESIZE);
+  mtopbuffer=(char *)vx_mem_alloc(NCells*p13.ESIZE);
   if (mtopbuffer == NULL) {
     fprintf(stderr, "Failed to allocate topo modeltop buffer\n");
     return(1);
@@ -391,17 +297,6 @@ int vx_setup(const char *data_dir)
   step_to[1]=to_a.V[1]/(to_a.N[1]-1);
   step_to[2]=0.0;
 
-  step_lr[0]=lr_a.U[0]/(lr_a.N[0]-1);
-  step_lr[1]=lr_a.V[1]/(lr_a.N[1]-1);
-  step_lr[2]=lr_a.W[2]/(lr_a.N[2]-1);
-  
-  step_hr[0]=hr_a.U[0]/(hr_a.N[0]-1);
-  step_hr[1]=hr_a.V[1]/(hr_a.N[1]-1);
-  step_hr[2]=hr_a.W[2]/(hr_a.N[2]-1);
-  
-  step_cm[0]=cm_a.U[0]/(cm_a.N[0]-1);
-  step_cm[1]=cm_a.V[1]/(cm_a.N[1]-1);
-  step_cm[2]=cm_a.W[2]/(cm_a.N[2]-1);
 
   // Load GTL
   if (gtl_setup(gtlpath) != 0) {
@@ -410,6 +305,7 @@ int vx_setup(const char *data_dir)
   }
 
   is_setup = True;
+  vx_select_kernel();
 
   return(0);
 }
@@ -422,31 +318,36 @@ int vx_cleanup()
     return(1);
   }
 
-  free(hrbuffer);
-  free(lrbuffer);
-  free(cmbuffer);
-  free(tobuffer);
-  free(mobuffer);
-  free(babuffer);
-  free(mtopbuffer);
-
-  free(lrtbuffer);
-  free(cmtbuffer);
-  free(cmvsbuffer);
-  free(hrtbuffer);
-  free(lrvsbuffer);
-  free(hrvsbuffer);
+  vx_stack_free(&vx_stack);
+  vx_mem_free(tobuffer);
+  vx_mem_free(mobuffer);
+  vx_mem_free(babuffer);
+  vx_mem_free(mtopbuffer);
 
   vx_zmode = VX_ZMODE_ELEV;
   vx_use_gtl = True;
+  vx_order = VX_ORDER_NONE;
+  vx_use_classify = False;
+  memset(&vx_mem, 0, sizeof(vx_mem_opts_t));
   is_setup = False;
 
   callback_bkg = NULL;
+  vx_select_kernel();
 
   return(0);
 }
 
 
+/* Stack loaded by vx_setup, or NULL */
+const vx_stack_t *vx_get_stack()
+{
+  if (is_setup != True) {
+    return(NULL);
+  }
+  return(&vx_stack);
+}
+
+
 /* Return current CVM-H version */
 int vx_version(char *version)
 {
@@ -463,6 +364,7 @@ int vx_version(char *version)
 /* Set query mode: elevation, elevation offset, depth */
 int vx_setzmode(vx_zmode_t m) {
   vx_zmode = m;
+  vx_select_kernel();
   return(0);
 }
 
@@ -470,6 +372,46 @@ int vx_setzmode(vx_zmode_t m) {
 /* Enable/disable GTL (default is enabled) */
 int vx_setgtl(int flag) {
   vx_use_gtl = flag;
+  vx_select_kernel();
+  return(0);
+}
+
+
+/* Set curve along which batch queries are evaluated */
+int vx_setorder(vx_order_t order) {
+  if ((order < VX_ORDER_NONE) || (order >= VX_ORDER_NUM)) {
+    return(1);
+  }
+  vx_order = order;
+  return(0);
+}
+
+
+/* Set memory backend of the next setup */
+int vx_setmem(const vx_mem_opts_t *opts) {
+  if ((opts->pages < VX_MEM_PAGES_DEFAULT) ||
+      (opts->pages >= VX_MEM_PAGES_NUM) ||
+      (opts->numa < VX_MEM_NUMA_NONE) || (opts->numa >= VX_MEM_NUMA_NUM)) {
+    return(1);
+  }
+  vx_mem = *opts;
+  return(0);
+}
+
+
+/* Report on memory backend of the loaded model */
+int vx_get_mem_report(vx_mem_report_t *report) {
+  if (!is_setup) {
+    return(1);
+  }
+  vx_mem_get_report(report);
+  return(0);
+}
+
+
+/* Enable/disable grouping of batch points by query path */
+int vx_setclassify(int flag) {
+  vx_use_classify = flag;
   return(0);
 }
 
@@ -477,7 +419,210 @@ int vx_setgtl(int flag) {
 /* Query material properties and topography at desired point. 
    Coordinates may be Geo or UTM */
 int vx_getcoord(vx_entry_t *entry) {
+#ifdef VX_ENABLE_STATS
+  int retval, prov;
+  VX_STATS_TIMER(t);
+
+  retval = vx_getcoord_private(entry, True);
+  VX_STATS_STOP(VX_STAGE_QUERY, t);
+  if (retval != 0) {
+    VX_STATS_COUNT(failed);
+  }
+  if ((entry != NULL) && (entry->data_src >= VX_SRC_NR) && 
+      (entry->data_src <= VX_SRC_GT)) {
+    VX_STATS_COUNT(src_hits[entry->data_src]);
+    prov = (int)entry->provenance;
+    if ((prov < 0) || (prov >= VX_STATS_NUM_PROV - 1) || 
+	(prov != entry->provenance)) {
+      prov = VX_STATS_NUM_PROV - 1;
+    }
+    VX_STATS_COUNT(prov_hits[prov]);
+  }
+  return(retval);
+#else
   return(vx_getcoord_private(entry, True));
+#endif
+}
+
+
+/* Points per chunk of the batch kernels */
+#define VX_KERNEL_CHUNK 64
+
+/* Names of the kernel steps */
+#define VX_KERNEL_CAT2(a, b) a##b
+#define VX_KERNEL_CAT(a, b) VX_KERNEL_CAT2(a, b)
+
+
+/* Kernel state between locating a point and finishing the query */
+typedef struct vx_kernel_state_t
+{
+  double incoor[3];          /* input coordinates, restored at the end */
+  double elev;
+  double depth;
+  float surface;
+  int do_bkg;
+  int cascade;               /* True if looked up in the voxet stack */
+} vx_kernel_state_t;
+
+
+/* Voxet stack lookup of a point by a batch */
+typedef struct vx_kernel_hit_t
+{
+  int vol;
+  int gcoor[3];
+  float vp;
+  float vs;
+  float tag;
+} vx_kernel_hit_t;
+
+
+/* Core kernel, requeried by the GTL step of the others */
+static int vx_kernel_core(vx_entry_t *entry);
+
+
+/* Query kernels. Each is vx_kernel.h compiled for one configuration,
+   so the query path has no branches on settings that are fixed for a
+   run. The core kernel skips Z mode, background model and GTL and is
+   used for internal requeries, the generic kernel reads the settings
+   at each call */
+#define VX_KERNEL_NAME vx_kernel_core
+#define VX_KERNEL_ENHANCED False
+#define VX_KERNEL_ZMODE VX_ZMODE_ELEV
+#define VX_KERNEL_GTL False
+#define VX_KERNEL_BKG False
+#include "vx_kernel.h"
+
+#define VX_KERNEL_NAME vx_kernel_generic
+#define VX_KERNEL_ENHANCED True
+#define VX_KERNEL_ZMODE vx_zmode
+#define VX_KERNEL_GTL (vx_use_gtl == True)
+#define VX_KERNEL_BKG (callback_bkg != NULL)
+#include "vx_kernel.h"
+
+#define VX_KERNEL_NAME vx_kernel_elev_nogtl_nobkg
+#define VX_KERNEL_ENHANCED True
+#define VX_KERNEL_ZMODE VX_ZMODE_ELEV
+#define VX_KERNEL_GTL False
+#define VX_KERNEL_BKG False
+#include "vx_kernel.h"
+
+#define VX_KERNEL_NAME vx_kernel_elev_nogtl_bkg
+#define VX_KERNEL_ENHANCED True
+#define VX_KERNEL_ZMODE VX_ZMODE_ELEV
+#define VX_KERNEL_GTL False
+#define VX_KERNEL_BKG True
+#include "vx_kernel.h"
+
+#define VX_KERNEL_NAME vx_kernel_elev_gtl_nobkg
+#define VX_KERNEL_ENHANCED True
+#define VX_KERNEL_ZMODE VX_ZMODE_ELEV
+#define VX_KERNEL_GTL True
+#define VX_KERNEL_BKG False
+#include "vx_kernel.h"
+
+#define VX_KERNEL_NAME vx_kernel_elev_gtl_bkg
+#define VX_KERNEL_ENHANCED True
+#define VX_KERNEL_ZMODE VX_ZMODE_ELEV
+#define VX_KERNEL_GTL True
+#define VX_KERNEL_BKG True
+#include "vx_kernel.h"
+
+#define VX_KERNEL_NAME vx_kernel_dep_nogtl_nobkg
+#define VX_KERNEL_ENHANCED True
+#define VX_KERNEL_ZMODE VX_ZMODE_DEPTH
+#define VX_KERNEL_GTL False
+#define VX_KERNEL_BKG False
+#include "vx_kernel.h"
+
+#define VX_KERNEL_NAME vx_kernel_dep_nogtl_bkg
+#define VX_KERNEL_ENHANCED True
+#define VX_KERNEL_ZMODE VX_ZMODE_DEPTH
+#define VX_KERNEL_GTL False
+#define VX_KERNEL_BKG True
+#include "vx_kernel.h"
+
+#define VX_KERNEL_NAME vx_kernel_dep_gtl_nobkg
+#define VX_KERNEL_ENHANCED True
+#define VX_KERNEL_ZMODE VX_ZMODE_DEPTH
+#define VX_KERNEL_GTL True
+#define VX_KERNEL_BKG False
+#include "vx_kernel.h"
+
+#define VX_KERNEL_NAME vx_kernel_dep_gtl_bkg
+#define VX_KERNEL_ENHANCED True
+#define VX_KERNEL_ZMODE VX_ZMODE_DEPTH
+#define VX_KERNEL_GTL True
+#define VX_KERNEL_BKG True
+#include "vx_kernel.h"
+
+#define VX_KERNEL_NAME vx_kernel_off_nogtl_nobkg
+#define VX_KERNEL_ENHANCED True
+#define VX_KERNEL_ZMODE VX_ZMODE_ELEVOFF
+#define VX_KERNEL_GTL False
+#define VX_KERNEL_BKG False
+#include "vx_kernel.h"
+
+#define VX_KERNEL_NAME vx_kernel_off_nogtl_bkg
+#define VX_KERNEL_ENHANCED True
+#define VX_KERNEL_ZMODE VX_ZMODE_ELEVOFF
+#define VX_KERNEL_GTL False
+#define VX_KERNEL_BKG True
+#include "vx_kernel.h"
+
+#define VX_KERNEL_NAME vx_kernel_off_gtl_nobkg
+#define VX_KERNEL_ENHANCED True
+#define VX_KERNEL_ZMODE VX_ZMODE_ELEVOFF
+#define VX_KERNEL_GTL True
+#define VX_KERNEL_BKG False
+#include "vx_kernel.h"
+
+#define VX_KERNEL_NAME vx_kernel_off_gtl_bkg
+#define VX_KERNEL_ENHANCED True
+#define VX_KERNEL_ZMODE VX_ZMODE_ELEVOFF
+#define VX_KERNEL_GTL True
+#define VX_KERNEL_BKG True
+#include "vx_kernel.h"
+
+
+/* Kernels by Z mode, GTL and background model */
+static int (*vx_kernels[3][2][2])(vx_entry_t *entry) = {
+  {{vx_kernel_elev_nogtl_nobkg, vx_kernel_elev_nogtl_bkg},
+   {vx_kernel_elev_gtl_nobkg, vx_kernel_elev_gtl_bkg}},
+  {{vx_kernel_dep_nogtl_nobkg, vx_kernel_dep_nogtl_bkg},
+   {vx_kernel_dep_gtl_nobkg, vx_kernel_dep_gtl_bkg}},
+  {{vx_kernel_off_nogtl_nobkg, vx_kernel_off_nogtl_bkg},
+   {vx_kernel_off_gtl_nobkg, vx_kernel_off_gtl_bkg}}};
+
+/* Batch kernels of the same configurations */
+static int (*vx_kernel_batches[3][2][2])(vx_entry_t *entries,
+					 const size_t *order, size_t start,
+					 size_t end) = {
+  {{vx_kernel_elev_nogtl_nobkg_batch, vx_kernel_elev_nogtl_bkg_batch},
+   {vx_kernel_elev_gtl_nobkg_batch, vx_kernel_elev_gtl_bkg_batch}},
+  {{vx_kernel_dep_nogtl_nobkg_batch, vx_kernel_dep_nogtl_bkg_batch},
+   {vx_kernel_dep_gtl_nobkg_batch, vx_kernel_dep_gtl_bkg_batch}},
+  {{vx_kernel_off_nogtl_nobkg_batch, vx_kernel_off_nogtl_bkg_batch},
+   {vx_kernel_off_gtl_nobkg_batch, vx_kernel_off_gtl_bkg_batch}}};
+
+/* Kernel of current configuration */
+static int (*vx_kernel)(vx_entry_t *entry) = vx_kernel_elev_gtl_nobkg;
+static int (*vx_kernel_batch)(vx_entry_t *entries, const size_t *order,
+			      size_t start, size_t end) =
+  vx_kernel_elev_gtl_nobkg_batch;
+
+
+/* Select kernel of current Z mode, GTL and background settings */
+static void vx_select_kernel()
+{
+  if ((vx_zmode >= VX_ZMODE_ELEV) && (vx_zmode <= VX_ZMODE_ELEVOFF)) {
+    vx_kernel = vx_kernels[vx_zmode][vx_use_gtl == True]
+      [callback_bkg != NULL];
+    vx_kernel_batch = vx_kernel_batches[vx_zmode][vx_use_gtl == True]
+      [callback_bkg != NULL];
+  } else {
+    vx_kernel = vx_kernel_generic;
+    vx_kernel_batch = vx_kernel_generic_batch;
+  }
 }
 
 
@@ -486,221 +631,239 @@ int vx_getcoord(vx_entry_t *entry) {
    depth/offset query modes.
 */ 
 int vx_getcoord_private(vx_entry_t *entry, int enhanced) {
-  int j;
-  double SP[2],SPUTM[2];
-  int gcoor[3];
-  int do_bkg = False;
-  float surface, mtop;
-  double elev, depth, zt, topo_gap;
-  double incoor[3];
-
-  /* Initialize variables */
-  elev = 0.0;
-  depth = 0.0;
-  zt = 0.0;
-  topo_gap = 0.0;
+  if (enhanced == True) {
+    return(vx_kernel(entry));
+  }
+  return(vx_kernel_core(entry));
+}
 
 
-  /* Proceed only if setup has been performed */
-  if ((entry == NULL) || (is_setup != True)) {
+/* Query with Z mode 'zmode' and the current GTL and background
+   settings */
+int vx_getcoord_zmode(vx_entry_t *entry, vx_zmode_t zmode) {
+  if ((zmode < VX_ZMODE_ELEV) || (zmode > VX_ZMODE_ELEVOFF)) {
     return(1);
   }
+  return(vx_kernels[zmode][vx_use_gtl == True][callback_bkg != NULL](entry));
+}
+
+
+/* Query with the settings read at each call, for testing kernels */
+int vx_getcoord_generic(vx_entry_t *entry) {
+  return(vx_kernel_generic(entry));
+}
+
+
+/* Evaluation order of batch along the current curve, or NULL to
+   query in input order. Coherent inputs such as grids and profiles
+   are left in input order. Geographic points are sorted by their UTM
+   coordinates */
+static size_t *vx_order_batch(vx_entry_t *entries, size_t n) {
+  double *utm;
+  size_t *perm, i;
+
+  if ((vx_order == VX_ORDER_NONE) || (n < VX_ORDER_MIN)) {
+    return(NULL);
+  }
+  if (vx_order_coherence(entries[0].coor,
+			 sizeof(vx_entry_t) / sizeof(double),
+			 n) >= VX_ORDER_COHERENT) {
+    VX_STATS_COUNT(batch_coherent);
+    return(NULL);
+  }
+
+  perm = malloc(n * sizeof(size_t));
+  utm = malloc(n * 3 * sizeof(double));
+  if ((perm == NULL) || (utm == NULL)) {
+    free(perm);
+    free(utm);
+    return(NULL);
+  }
+  for (i = 0; i < n; i++) {
+    if (entries[i].coor_type == VX_COORD_GEO) {
+      vx_geo2utm(entries[i].coor, &utm[i * 3]);
+      utm[i * 3 + 2] = entries[i].coor[2];
+    } else {
+      memcpy(&utm[i * 3], entries[i].coor, sizeof(double) * 3);
+    }
+  }
+  if (vx_order_sort(utm, 3, n, vx_order, perm) != 0) {
+    free(perm);
+    perm = NULL;
+  } else {
+    VX_STATS_COUNT(batch_sorted);
+  }
+  free(utm);
+  return(perm);
+}
 
-  /* Make copy of original input coordinates */
-  memcpy(incoor, entry->coor, sizeof(double) * 3);
 
-  /* Initialize entry structure */
-  vx_init_entry(entry);
+/* Estimate query path of entry from the topo grid and the voxet
+   coverage, without the surface search of the full query */
+vx_path_t vx_classify(const vx_entry_t *entry) {
+  double utm[3], elev;
+  float topo, mtop;
+  int gcoor[3];
+  size_t pos;
+
+  if ((entry == NULL) || (is_setup != True)) {
+    return(VX_PATH_NR);
+  }
 
-  /* Generate UTM coords */
   switch (entry->coor_type) {
   case VX_COORD_GEO:
-    
-    SP[0]=entry->coor[0];
-    SP[1]=entry->coor[1];
-    
-    gctp(SP,&insys,&inzone,inparm,&inunit,&indatum,&ipr,efile,&jpr,efile,
-	 SPUTM,&outsys,&outzone,inparm,&outunit,&outdatum,
-	 file27, file83,&iflg);
-    
-    entry->coor_utm[0]=SPUTM[0];
-    entry->coor_utm[1]=SPUTM[1];
-    entry->coor_utm[2]=entry->coor[2];
+    vx_geo2utm((double *)entry->coor, utm);
     break;
   case VX_COORD_UTM:
-    entry->coor_utm[0]=entry->coor[0];
-    entry->coor_utm[1]=entry->coor[1];
-    entry->coor_utm[2]=entry->coor[2];
+    utm[0] = entry->coor[0];
+    utm[1] = entry->coor[1];
     break;
   default:
-    return(1);
+    return(VX_PATH_NR);
     break;
   }
+  if (!(utm[1] < 10000000)) {
+    return(VX_PATH_NR);
+  }
 
-  /* Now we have UTM Zone 11 */
-  /*** Prevent all to obvious bad coordinates from being displayed */
-  if (entry->coor_utm[1] < 10000000) {
-     
-    // we start with the elevations; the voxet does not have a vertical 
-    // dimension
-    gcoor[0]=round((entry->coor_utm[0]-to_a.O[0])/step_to[0]);
-    gcoor[1]=round((entry->coor_utm[1]-to_a.O[1])/step_to[1]);
-    gcoor[2]=0;
-    
-    //check if inside
-    if(gcoor[0]>=0&&gcoor[1]>=0&&
-       gcoor[0]<to_a.N[0]&&gcoor[1]<to_a.N[1]) {	      
-      entry->elev_cell[0]= to_a.O[0]+gcoor[0]*step_to[0];
-      entry->elev_cell[1]= to_a.O[1]+gcoor[1]*step_to[1];
-      j=voxbytepos(gcoor,to_a.N,p4.ESIZE);
-      memcpy(&(entry->topo), &tobuffer[j], p4.ESIZE);
-      memcpy(&(entry->mtop), &mtopbuffer[j], p4.ESIZE);
-      memcpy(&(entry->base), &babuffer[j], p4.ESIZE);
-      memcpy(&(entry->moho), &mobuffer[j], p4.ESIZE);
-      if (((entry->topo - p0.NO_DATA_VALUE < 0.1) || 
-	   (entry->mtop - p0.NO_DATA_VALUE < 0.1))) {
-	do_bkg = True;
-      }
-    } else {
-      do_bkg = True;
-    }
+  /* Topo and model top at the point, as in the first query stage */
+  gcoor[0] = round((utm[0] - to_a.O[0]) / step_to[0]);
+  gcoor[1] = round((utm[1] - to_a.O[1]) / step_to[1]);
+  gcoor[2] = 0;
+  if ((gcoor[0] < 0) || (gcoor[1] < 0) ||
+      (gcoor[0] >= to_a.N[0]) || (gcoor[1] >= to_a.N[1])) {
+    return((callback_bkg != NULL) ? VX_PATH_BKG : VX_PATH_NR);
+  }
+  pos = voxbytepos(gcoor, to_a.N, p4.ESIZE);
+  memcpy(&topo, &tobuffer[pos], p4.ESIZE);
+  memcpy(&mtop, &mtopbuffer[pos], p4.ESIZE);
+  if ((topo - p0.NO_DATA_VALUE < 0.1) || (mtop - p0.NO_DATA_VALUE < 0.1)) {
+    return((callback_bkg != NULL) ? VX_PATH_BKG : VX_PATH_NR);
+  }
 
-    /* Convert depth/offset Z coordinate to elevation */
-    if (enhanced == True) {
-      elev = entry->coor_utm[2];
-      vx_getsurface(entry->coor, entry->coor_type, &surface);
-      if (surface < -90000.0) {
-	return(1);
-      }
-      switch (vx_zmode) {
-      case VX_ZMODE_ELEV:
-	break;
-      case VX_ZMODE_DEPTH:
-	entry->coor[2] = surface - elev;
-	entry->coor_utm[2] = entry->coor[2];
-	break;
-      case VX_ZMODE_ELEVOFF:
-	entry->coor[2] = surface + elev;
-	entry->coor_utm[2] = entry->coor[2];
-	break;
-      default:
-	return(1);
-	break;
-      }
-      depth = surface - entry->coor_utm[2];
-    }
+  /* Elevation with the topo standing in for the surface */
+  switch (vx_zmode) {
+  case VX_ZMODE_DEPTH:
+    elev = topo - entry->coor[2];
+    break;
+  case VX_ZMODE_ELEVOFF:
+    elev = topo + entry->coor[2];
+    break;
+  default:
+    elev = entry->coor[2];
+    break;
+  }
+  if (elev > topo) {
+    return(VX_PATH_AIR);
+  }
 
-    if ((do_bkg == False) || ((do_bkg == True) && (callback_bkg == NULL)) || 
-	(enhanced == False)) {
-      /* AP: this calculates the cell numbers from the coordinates and 
-	 the grid spacing. The -1 is necessary to do the counting 
-	 correctly. The rounding is necessary because the data are cell 
-	 centered, eg. they are valid half a cell width away from the 
-	 data point */
-
-      /* Extract vp/vs */      
-      gcoor[0]=round((entry->coor_utm[0]-hr_a.O[0])/step_hr[0]);
-      gcoor[1]=round((entry->coor_utm[1]-hr_a.O[1])/step_hr[1]);
-      gcoor[2]=round((entry->coor_utm[2]-hr_a.O[2])/step_hr[2]);
-      
-      if(gcoor[0]>=0&&gcoor[1]>=0&&gcoor[2]>=0&&
-	 gcoor[0]<hr_a.N[0]&&gcoor[1]<hr_a.N[1]&&gcoor[2]<hr_a.N[2]) {
-	/* AP: And here are the cell centers*/
-	entry->vel_cell[0]= hr_a.O[0]+gcoor[0]*step_hr[0];
-	entry->vel_cell[1]= hr_a.O[1]+gcoor[1]*step_hr[1];
-	entry->vel_cell[2]= hr_a.O[2]+gcoor[2]*step_hr[2];
-	j=voxbytepos(gcoor,hr_a.N,p2.ESIZE);
-	memcpy(&(entry->provenance), &hrtbuffer[j], p0.ESIZE);
-	memcpy(&(entry->vp), &hrbuffer[j], p2.ESIZE);
-	memcpy(&(entry->vs), &hrvsbuffer[j], p2.ESIZE);
-	entry->data_src = VX_SRC_HR;
-      } else {	  
-	gcoor[0]=round((entry->coor_utm[0]-lr_a.O[0])/step_lr[0]);
-	gcoor[1]=round((entry->coor_utm[1]-lr_a.O[1])/step_lr[1]);
-	gcoor[2]=round((entry->coor_utm[2]-lr_a.O[2])/step_lr[2]);
-	
-	if(gcoor[0]>=0&&gcoor[1]>=0&&gcoor[2]>=0&&
-	   gcoor[0]<lr_a.N[0]&&gcoor[1]<lr_a.N[1]&&gcoor[2]<lr_a.N[2]) {
-	  /* AP: And here are the cell centers*/
-	  entry->vel_cell[0]= lr_a.O[0]+gcoor[0]*step_lr[0];
-	  entry->vel_cell[1]= lr_a.O[1]+gcoor[1]*step_lr[1];
-	  entry->vel_cell[2]= lr_a.O[2]+gcoor[2]*step_lr[2];
-	  j=voxbytepos(gcoor,lr_a.N,p0.ESIZE);
-	  memcpy(&(entry->provenance), &lrtbuffer[j], p0.ESIZE);
-	  memcpy(&(entry->vp), &lrbuffer[j], p0.ESIZE);
-	  memcpy(&(entry->vs), &lrvsbuffer[j], p0.ESIZE);
-	  entry->data_src = VX_SRC_LR;
-	} else {   
-	  gcoor[0]=round((entry->coor_utm[0]-cm_a.O[0])/step_cm[0]);
-	  gcoor[1]=round((entry->coor_utm[1]-cm_a.O[1])/step_cm[1]);
-	  gcoor[2]=round((entry->coor_utm[2]-cm_a.O[2])/step_cm[2]);
-	  
-	  /** AP: check if inside CM voxet; the uppermost layer of 
-	      CM overlaps with the lowermost of LR, may need to be 
-	      ignored but is not.
-	  **/
-	  if(gcoor[0]>=0&&gcoor[1]>=0&&gcoor[2]>=0&&
-	     gcoor[0]<cm_a.N[0]&&gcoor[1]<cm_a.N[1]&&gcoor[2]<(cm_a.N[2])) {
-	    //**** lower crust and mantle voxet *****//
-	    entry->vel_cell[0]= cm_a.O[0]+gcoor[0]*step_cm[0];
-	    entry->vel_cell[1]= cm_a.O[1]+gcoor[1]*step_cm[1];
-	    entry->vel_cell[2]= cm_a.O[2]+gcoor[2]*step_cm[2];
-	    j=voxbytepos(gcoor,cm_a.N,p3.ESIZE);
-	    memcpy(&(entry->provenance), &cmtbuffer[j], p0.ESIZE);
-	    memcpy(&(entry->vp), &cmbuffer[j], p3.ESIZE);
-	    memcpy(&(entry->vs), &cmvsbuffer[j], p3.ESIZE);
-	    entry->data_src = VX_SRC_CM;
-	  } else {
-	    do_bkg = True;
-	  }
-	}
-      }
-    }
+  utm[2] = elev;
+  if (vx_stack_find(&vx_stack, utm, gcoor) < 0) {
+    return((callback_bkg != NULL) ? VX_PATH_BKG : VX_PATH_NR);
+  }
+  if ((vx_use_gtl == True) &&
+      (elev > topo - gtl_get_adj_transition(topo - mtop))) {
+    return(VX_PATH_GTL);
+  }
+  return(VX_PATH_CORE);
+}
 
-    if ((enhanced == True) && (do_bkg == True) && (callback_bkg != NULL)) {
-      /* background model */
-      if (callback_bkg(entry, VX_REQUEST_ALL) != 0) {
-	/* Restore original input coords */
-	memcpy(entry->coor, incoor, sizeof(double) * 3);
-	return(1);
-      }
-    } else {
-      /* Compute rho */
-      entry->rho = calc_rho(entry->vp, entry->data_src);
 
-      if ((do_bkg == False) && (enhanced == True) && (vx_use_gtl == True)) {
+/* Group evaluation order 'order' (NULL for input order) by path,
+   keeping the order within each path. Points per path are returned
+   in 'counts'. Returns NULL if classification is disabled */
+static size_t *vx_classify_batch(vx_entry_t *entries, size_t n,
+				 const size_t *order, size_t *counts) {
+  unsigned char *path;
+  size_t *paths, start[VX_PATH_NUM], i, j;
+  int p;
 
-	/* Compute gap between surface and mtop */
-	vx_model_top(entry->coor, entry->coor_type, &mtop, True);
-	if (mtop - p0.NO_DATA_VALUE > 0.1) {
-	  topo_gap = surface - mtop;
-	} else {
-	  topo_gap = 0.0;
-	}
+  if ((vx_use_classify != True) || (n < VX_CLASSIFY_MIN)) {
+    return(NULL);
+  }
 
-	/* Requery at fixed zt depth if point below trans zone */
-	zt = gtl_get_adj_transition(topo_gap);
-	if ((entry->coor[2] > surface - zt) && (entry->coor[2] <= surface)) {
-	  entry->coor[2] = surface - zt;
-	  entry->coor_utm[2] = surface - zt;
-	  vx_getcoord_private(entry, False);
-	  entry->coor[2] = elev;
-	  entry->coor_utm[2] = elev;
-	  
-	  // We are inside core CVM-H model. Apply GTL
-	  if (vx_apply_gtl_entry(entry, depth, topo_gap) != 0) {
-	    /* Restore original input coords */
-	    memcpy(entry->coor, incoor, sizeof(double) * 3);
-	    return(1);
-	  }
-	}
-      }
-    }
+  paths = malloc(n * sizeof(size_t));
+  path = malloc(n);
+  if ((paths == NULL) || (path == NULL)) {
+    free(paths);
+    free(path);
+    return(NULL);
   }
 
-  /* Restore original input coords */
-  memcpy(entry->coor, incoor, sizeof(double) * 3);
-  return(0);
+  memset(counts, 0, VX_PATH_NUM * sizeof(size_t));
+  for (i = 0; i < n; i++) {
+    path[i] = vx_classify(&(entries[i]));
+    counts[path[i]]++;
+  }
+  for (p = 0, j = 0; p < VX_PATH_NUM; p++) {
+    start[p] = j;
+    j += counts[p];
+  }
+  for (i = 0; i < n; i++) {
+    j = (order != NULL) ? order[i] : i;
+    paths[start[path[j]]++] = j;
+  }
+
+  free(path);
+  return(paths);
+}
+
+
+/* Query points 'start' to 'end' of evaluation order 'order' (NULL for
+   input order). When a SIMD stack lookup is selected the batch kernel
+   looks up the voxets of each chunk together. Builds with stats query
+   point by point so that every query is timed and counted */
+static int vx_batch_range(vx_entry_t *entries, const size_t *order,
+			  size_t start, size_t end) {
+  int retval = 0;
+  size_t i;
+#ifndef VX_ENABLE_STATS
+  int (*kernel)(vx_entry_t *entry) = vx_kernel;
+
+  if ((vx_stack.simd_ok == True) && (vx_stack.map != NULL) &&
+      (vx_simd_selected() != VX_SIMD_SCALAR)) {
+    return(vx_kernel_batch(entries, order, start, end));
+  }
+#endif
+
+  for (i = start; i < end; i++) {
+#ifdef VX_ENABLE_STATS
+    retval |= vx_getcoord(&(entries[(order != NULL) ? order[i] : i]));
+#else
+    retval |= kernel(&(entries[(order != NULL) ? order[i] : i]));
+#endif
+  }
+  return(retval);
+}
+
+
+/* Query array of points, returns 1 if any point failed. The kernel
+   is looked up once for the whole array. With an ordering set, the
+   points are evaluated along the curve, and with classification
+   enabled the points of each path are evaluated together. Results
+   stay in place */
+int vx_getcoord_batch(vx_entry_t *entries, size_t n) {
+  size_t counts[VX_PATH_NUM], *order, *paths, start = 0;
+  int p, retval = 0;
+
+  order = vx_order_batch(entries, n);
+  paths = vx_classify_batch(entries, n, order, counts);
+  if (paths == NULL) {
+    retval = vx_batch_range(entries, order, 0, n);
+    free(order);
+    return(retval);
+  }
+
+  for (p = 0; p < VX_PATH_NUM; p++) {
+    VX_STATS_TIMER(t_path);
+    retval |= vx_batch_range(entries, paths, start, start + counts[p]);
+    VX_STATS_ADD(path_points[p], counts[p]);
+    VX_STATS_ADD(path_nsec[p], vx_stats_now() - t_path);
+    start += counts[p];
+  }
+  free(order);
+  free(paths);
+  return(retval);
 }
 
 
@@ -726,11 +889,15 @@ int vx_apply_gtl_entry(vx_entry_t *entry, double depth, double topo_gap) {
   gtlentry.rho = entry->rho;
 
   /* Query GTL and perform interpolation */
-  if (gtl_interp(&gtlentry, &updated) != 0) {
+  VX_STATS_TIMER(t);
+  i = gtl_interp(&gtlentry, &updated);
+  VX_STATS_STOP(VX_STAGE_GTL, t);
+  if (i != 0) {
     return(1);
   }
 
   if (updated) {
+    VX_STATS_COUNT(gtl_applied);
  
     /* Replace entry with GTL results */
     for (i = 0; i < 3; i++) {
@@ -750,7 +917,7 @@ int vx_apply_gtl_entry(vx_entry_t *entry, double depth, double topo_gap) {
 /* Get raw voxel information at the supplied voxel volume coordinates */
 void vx_getvoxel(vx_voxel_t *voxel) {
   int gcoor[3];
-  int j;
+  size_t j;
 
   /* Proceed only if setup has been performed */
   if ((voxel == NULL) || (is_setup != True)) {
@@ -831,6 +998,23 @@ void vx_getvoxel(vx_voxel_t *voxel) {
 }
 
 
+/* Geometry of topo grid */
+int vx_get_surface_grid(double *origin, double *step, int *dims)
+{
+  int i;
+
+  if (is_setup != True) {
+    return(1);
+  }
+  for (i = 0; i < 2; i++) {
+    origin[i] = to_a.O[i];
+    step[i] = step_to[i];
+    dims[i] = to_a.N[i];
+  }
+  return(0);
+}
+
+
 /* Query elevation of free surface at point 'coor' */
 void vx_getsurface(double *coor, vx_coord_t coor_type, float *surface)
 {
@@ -846,9 +1030,10 @@ int vx_getsurface_private(double *coor, vx_coord_t coor_type,
 {
   int gcoor[3];
   double SP[2],SPUTM[2];
-  int j;
+  size_t j;
   vx_entry_t entry;
   int do_bkg = False;
+  VX_STATS_TIMER(t);
 
   *surface = p0.NO_DATA_VALUE;
 
@@ -866,9 +1051,7 @@ int vx_getsurface_private(double *coor, vx_coord_t coor_type,
     SP[0]=entry.coor[0];
     SP[1]=entry.coor[1];
     
-    gctp(SP,&insys,&inzone,inparm,&inunit,&indatum,&ipr,efile,&jpr,efile,
-	 SPUTM,&outsys,&outzone,inparm,&outunit,&outdatum,
-	 file27, file83,&iflg);
+    vx_geo2utm(SP, SPUTM);
     
     entry.coor_utm[0]=SPUTM[0];
     entry.coor_utm[1]=SPUTM[1];
@@ -932,10 +1115,12 @@ int vx_getsurface_private(double *coor, vx_coord_t coor_type,
 	entry.coor[2] = *surface;
 	while (!flag) {
 	  if (num_iter > MAX_ITER_ELEV) {
+	    VX_STATS_COUNT(surface_limit);
 	    *surface = p0.NO_DATA_VALUE;
 	    flag = 1;
 	  }
 	  num_iter = num_iter + 1;
+	  VX_STATS_COUNT(surface_iter);
 	  vx_getcoord_private(&entry, False);
 	  if ((entry.vp < 0.0) || (entry.vs < 0.0)) {
 	    switch (entry.data_src) {
@@ -969,13 +1154,16 @@ int vx_getsurface_private(double *coor, vx_coord_t coor_type,
 
   if (do_bkg) {
     if ((!exclude_bkg) && (callback_bkg != NULL)) {
+      VX_STATS_TIMER(t_bkg);
       callback_bkg(&entry, VX_REQUEST_TOPO);
+      VX_STATS_STOP(VX_STAGE_BKG, t_bkg);
       *surface = entry.topo;
     } else {
       *surface = p0.NO_DATA_VALUE;
     }
   }
 
+  VX_STATS_STOP(VX_STAGE_SURFACE, t);
   return(0);
 }
 
@@ -987,9 +1175,10 @@ void vx_model_top(double *coor, vx_coord_t coor_type,
 {
   int gcoor[3];
   double SP[2],SPUTM[2];
-  int j;
+  size_t j;
   vx_entry_t entry;
   int do_bkg = False;
+  VX_STATS_TIMER(t);
 
   *surface = p0.NO_DATA_VALUE;
 
@@ -1007,9 +1196,7 @@ void vx_model_top(double *coor, vx_coord_t coor_type,
     SP[0]=entry.coor[0];
     SP[1]=entry.coor[1];
     
-    gctp(SP,&insys,&inzone,inparm,&inunit,&indatum,&ipr,efile,&jpr,efile,
-	 SPUTM,&outsys,&outzone,inparm,&outunit,&outdatum,
-	 file27, file83,&iflg);
+    vx_geo2utm(SP, SPUTM);
     
     entry.coor_utm[0]=SPUTM[0];
     entry.coor_utm[1]=SPUTM[1];
@@ -1055,10 +1242,12 @@ void vx_model_top(double *coor, vx_coord_t coor_type,
       entry.coor[2] = *surface;
       while (!flag) {
 	if (num_iter > MAX_ITER_ELEV) {
+	  VX_STATS_COUNT(modeltop_limit);
 	  *surface = p0.NO_DATA_VALUE;
 	  flag = 1;
 	}
 	num_iter = num_iter + 1;
+	VX_STATS_COUNT(modeltop_iter);
 	vx_getcoord_private(&entry, False);
 	if ((entry.vp < 0.0) || (entry.vs < 0.0)) {
 	  switch (entry.data_src) {
@@ -1089,7 +1278,9 @@ void vx_model_top(double *coor, vx_coord_t coor_type,
 
   if (do_bkg) {
     if ((!exclude_bkg) && (callback_bkg != NULL)) {
+      VX_STATS_TIMER(t_bkg);
       callback_bkg(&entry, VX_REQUEST_TOPO);
+      VX_STATS_STOP(VX_STAGE_BKG, t_bkg);
       if (entry.topo > entry.mtop) {
 	*surface = entry.mtop - ELEV_EPSILON;
       } else {
@@ -1100,6 +1291,7 @@ void vx_model_top(double *coor, vx_coord_t coor_type,
     }
   }
 
+  VX_STATS_STOP(VX_STAGE_MODELTOP, t);
   return;
 }
 
@@ -1109,6 +1301,7 @@ int vx_register_bkg( int (*backgrnd)(vx_entry_t *entry,
 				     vx_request_t req_type) )
 {
   callback_bkg = backgrnd;
+  vx_select_kernel();
   return(0);
 }
 
@@ -1122,6 +1315,7 @@ int vx_register_scec()
   }
 
   callback_bkg = vx_scec_1d;
+  vx_select_kernel();
   return(0);
 }
 
@@ -1772,6 +1966,7 @@ int vx_scec_1d(vx_entry_t *entry, vx_request_t req_type)
 void vx_voxel_at_coord(vx_entry_t *entry, vx_voxel_t *voxel)
 {
   int j;
+  size_t pos;
   int model_coor[3]; // x,y,z of closest voxel in volume
   int model_max[3]; // max size x,y,z of volume
   double gcoor[3]; // coord of point wrt volume
@@ -1826,25 +2021,25 @@ void vx_voxel_at_coord(vx_entry_t *entry, vx_voxel_t *voxel)
   }
 
   /* Calc index byte offset in volume */
-  j = voxbytepos(model_coor, model_max, esize);
+  pos = voxbytepos(model_coor, model_max, esize);
 
   /* Get vp/vs for closest voxel */
   switch (entry->data_src) {
   case VX_SRC_TO:
-    memcpy(&(voxel->topo), &tobuffer[j], p4.ESIZE);
-    memcpy(&(voxel->mtop), &mtopbuffer[j], p4.ESIZE);
-    memcpy(&(voxel->base), &babuffer[j], p4.ESIZE);
-    memcpy(&(voxel->moho), &mobuffer[j], p4.ESIZE);
+    memcpy(&(voxel->topo), &tobuffer[pos], p4.ESIZE);
+    memcpy(&(voxel->mtop), &mtopbuffer[pos], p4.ESIZE);
+    memcpy(&(voxel->base), &babuffer[pos], p4.ESIZE);
+    memcpy(&(voxel->moho), &mobuffer[pos], p4.ESIZE);
   case VX_SRC_LR:
-    memcpy(&(voxel->vp), &lrbuffer[j], p0.ESIZE);
-    memcpy(&(voxel->vs), &lrvsbuffer[j], p0.ESIZE);
-    memcpy(&(voxel->provenance), &lrtbuffer[j], p0.ESIZE);
+    memcpy(&(voxel->vp), &lrbuffer[pos], p0.ESIZE);
+    memcpy(&(voxel->vs), &lrvsbuffer[pos], p0.ESIZE);
+    memcpy(&(voxel->provenance), &lrtbuffer[pos], p0.ESIZE);
     voxel->rho = calc_rho(voxel->vp, entry->data_src);
     break;
   case VX_SRC_CM:
-    memcpy(&(voxel->vp), &cmbuffer[j], p3.ESIZE);
-    memcpy(&(voxel->vs), &cmvsbuffer[j], p3.ESIZE);
-    memcpy(&(voxel->provenance), &cmtbuffer[j], p3.ESIZE);
+    memcpy(&(voxel->vp), &cmbuffer[pos], p3.ESIZE);
+    memcpy(&(voxel->vs), &cmvsbuffer[pos], p3.ESIZE);
+    memcpy(&(voxel->provenance), &cmtbuffer[pos], p3.ESIZE);
     voxel->rho = calc_rho(voxel->vp, entry->data_src);
     break;
   default:
@@ -1865,6 +2060,7 @@ void vx_voxel_at_coord(vx_entry_t *entry, vx_voxel_t *voxel)
 void vx_closest_voxel_to_coord(vx_entry_t *entry, vx_voxel_t *voxel)
 {
   int j;
+  size_t pos;
   int model_coor[3]; // x,y,z of closest voxel in volume
   int model_max[3]; // max size x,y,z of volume
   double gcoor[3]; // coord of point wrt volume
@@ -1922,25 +2118,25 @@ void vx_closest_voxel_to_coord(vx_entry_t *entry, vx_voxel_t *voxel)
   }
 
   /* Calc index byte offset in volume */
-  j = voxbytepos(model_coor, model_max, esize);
+  pos = voxbytepos(model_coor, model_max, esize);
 
   /* Get vp/vs for closest voxel */
   switch (entry->data_src) {
   case VX_SRC_TO:
-    memcpy(&(voxel->topo), &tobuffer[j], p4.ESIZE);
-    memcpy(&(voxel->mtop), &mtopbuffer[j], p4.ESIZE);
-    memcpy(&(voxel->base), &babuffer[j], p4.ESIZE);
-    memcpy(&(voxel->moho), &mobuffer[j], p4.ESIZE);
+    memcpy(&(voxel->topo), &tobuffer[pos], p4.ESIZE);
+    memcpy(&(voxel->mtop), &mtopbuffer[pos], p4.ESIZE);
+    memcpy(&(voxel->base), &babuffer[pos], p4.ESIZE);
+    memcpy(&(voxel->moho), &mobuffer[pos], p4.ESIZE);
   case VX_SRC_LR:
-    memcpy(&(voxel->vp), &lrbuffer[j], p0.ESIZE);
-    memcpy(&(voxel->vs), &lrvsbuffer[j], p0.ESIZE);
-    memcpy(&(voxel->provenance), &lrtbuffer[j], p0.ESIZE);
+    memcpy(&(voxel->vp), &lrbuffer[pos], p0.ESIZE);
+    memcpy(&(voxel->vs), &lrvsbuffer[pos], p0.ESIZE);
+    memcpy(&(voxel->provenance), &lrtbuffer[pos], p0.ESIZE);
     voxel->rho = calc_rho(voxel->vp, entry->data_src);
     break;
   case VX_SRC_CM:
-    memcpy(&(voxel->vp), &cmbuffer[j], p3.ESIZE);
-    memcpy(&(voxel->vs), &cmvsbuffer[j], p3.ESIZE);
-    memcpy(&(voxel->provenance), &cmtbuffer[j], p3.ESIZE);
+    memcpy(&(voxel->vp), &cmbuffer[pos], p3.ESIZE);
+    memcpy(&(voxel->vs), &cmvsbuffer[pos], p3.ESIZE);
+    memcpy(&(voxel->provenance), &cmtbuffer[pos], p3.ESIZE);
     voxel->rho = calc_rho(voxel->vp, entry->data_src);
     break;
   default:
@@ -2022,10 +2218,10 @@ void vx_dist_point_to_voxel(vx_entry_t *entry, vx_voxel_t *voxel,
 
 /* Get voxel byte offset position by the index values 'ic'
    and datatype size 'esize' */
-int voxbytepos(int *ic,int *gs,int esize) {
-  int pos;
+size_t voxbytepos(int *ic,int *gs,int esize) {
+  size_t pos;
 
-  pos=(gs[0]*gs[1]*(ic[2])+gs[0]*(ic[1])+ic[0])*esize;
+  pos=(((size_t)gs[1]*ic[2]+ic[1])*gs[0]+ic[0])*esize;
   return pos;
 }
 
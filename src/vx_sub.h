@@ -1,6 +1,10 @@
 #ifndef VX_SUB_H
 #define VX_SUB_H
 
+#include <stddef.h>
+#include "vx_order.h"
+#include "vx_mem.h"
+
 extern char *VX_SRC_NAMES[7];
 
 typedef enum { VX_SRC_NR = 0, 
@@ -17,6 +21,17 @@ typedef enum { VX_ZMODE_ELEV = 0,
 
 typedef enum { VX_COORD_GEO = 0, VX_COORD_UTM } vx_coord_t;
 
+/* Query paths of batch classification */
+typedef enum { VX_PATH_CORE = 0,
+	       VX_PATH_GTL,
+	       VX_PATH_BKG,
+	       VX_PATH_AIR,
+	       VX_PATH_NR } vx_path_t;
+
+#define VX_PATH_NUM 5
+
+extern char *VX_PATH_NAMES[VX_PATH_NUM];
+
 
 typedef enum { VX_REQUEST_ALL = 0, 
 	       VX_REQUEST_TOPO, 
@@ -100,6 +115,13 @@ typedef struct vx_bkg_t
 /* Initializer */
 int vx_setup(const char* data_dir);
 
+/* Memory backend of the model buffers loaded by the next vx_setup
+   (default is malloc). Options the system refuses are dropped */
+int vx_setmem(const vx_mem_opts_t *opts);
+
+/* Report on the memory backend of the loaded model */
+int vx_get_mem_report(vx_mem_report_t *report);
+
 /* Cleanup function to free resources and restore state */
 int vx_cleanup();
 
@@ -112,9 +134,27 @@ int vx_setzmode(vx_zmode_t m);
 /* Enable/disable GTL (default is enabled) */
 int vx_setgtl(int flag);
 
-/* Retrieve data point in LatLon or UTM */
+/* Evaluate batch queries along a space-filling curve (default is
+   none). Results are returned in input order */
+int vx_setorder(vx_order_t order);
+
+/* Enable/disable grouping the points of batch queries by query path
+   (default is disabled). Results are unchanged */
+int vx_setclassify(int flag);
+
+/* Retrieve data point in LatLon or UTM. Safe to call concurrently
+   from multiple threads once setup is complete, provided any 
+   registered background handler is also thread safe. */
 int vx_getcoord(vx_entry_t *entry);
 
+/* Retrieve data point with a Z coordinate of mode 'zmode' instead of
+   the mode set with vx_setzmode. GTL and background apply as for
+   vx_getcoord */
+int vx_getcoord_zmode(vx_entry_t *entry, vx_zmode_t zmode);
+
+/* Retrieve array of data points, returns 1 if any point failed */
+int vx_getcoord_batch(vx_entry_t *entries, size_t n);
+
 /* Register user-defined background model handler */
 int vx_register_bkg( int (*backgrnd)(vx_entry_t *entry, 
 				      vx_request_t req_type) );
@@ -133,17 +173,32 @@ void vx_init_voxel(vx_voxel_t *voxel);
 /* Retrieve data point by referencing voxel index position */
 void vx_getvoxel(vx_voxel_t *voxel);
 
+/* Density from the vp of a voxet of source 'data_src' */
+double calc_rho(float vp, vx_src_t data_src);
+
+/* Origin, node spacing and node counts in UTM of the topo grid
+   loaded by vx_setup. Returns 1 if no model is set up */
+int vx_get_surface_grid(double *origin, double *step, int *dims);
+
 /* Retrieve true surface elev at data point */
 void vx_getsurface(double *coor, vx_coord_t coor_type, float *surface);
 
+/* Convert geographic coordinates to UTM Zone 11 (thread safe) */
+void vx_geo2utm(double *geo, double *utm);
+
 /* Predefined SCEC bkg/topo handler */
 int vx_scec_1d(vx_entry_t *entry, vx_request_t req_type);
 
 /* Apply GTL to data point */
 int vx_apply_gtl_entry(vx_entry_t *entry, double depth, double topo_gap);
 
+/* Query path of data point, estimated from the topo grid and voxet
+   coverage */
+vx_path_t vx_classify(const vx_entry_t *entry);
+
 /* Retrieve data point in LatLon or UTM */
 int vx_getcoord_private(vx_entry_t *entry, int enhanced);
+int vx_getcoord_generic(vx_entry_t *entry);
 int vx_getsurface_private(double *coor, vx_coord_t coor_type, 
 			  float *surface, int exclude_bkg);
 void vx_model_top(double *coor, vx_coord_t coor_type, 
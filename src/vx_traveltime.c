@@ -0,0 +1,240 @@
+/**
+    vx_traveltime - Compute P or S travel time grids from stations by
+    solving the eikonal equation on slowness sampled from the model.
+    Accepts Geographic Coordinates or UTM Zone 11 coordinates for the
+    stations.
+
+    10/2026: Initial implementation
+**/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <getopt.h>
+#include "params.h"
+#include "vx_sub.h"
+#include "vx_fmt.h"
+#include "vx_stats.h"
+#include "vx_tt.h"
+
+
+/* Default node spacing, meters */
+#define VX_TRAVELTIME_STEP_XY 1000.0
+#define VX_TRAVELTIME_STEP_Z 500.0
+
+/* Max length of input line and station name */
+#define VX_TRAVELTIME_LINE 1024
+#define VX_TRAVELTIME_NAME 64
+
+
+/* Usage function */
+void usage() {
+  printf("     vx_traveltime - (c) Harvard University, SCEC\n");
+  printf("Sample the P or S slowness of the model on a regular grid and\n");
+  printf("compute the first arrival travel times from each station read\n");
+  printf("from stdin by fast sweeping. One travel time grid file is written\n");
+  printf("per station.\n\n");
+  printf("\tusage: vx_traveltime -r x1,y1,z1,x2,y2,z2 [-d dx,dy,dz] [-p P/S] [-m dir] [-g] [-s] [-o prefix] [-e tol] [-i iter] [-t threads] < file.in\n\n");
+  printf("Flags:\n");
+  printf("\t-r grid region in UTM meters, z is elevation.\n");
+  printf("\t-d node spacing in meters (default is %.0f,%.0f,%.0f).\n",
+	 VX_TRAVELTIME_STEP_XY, VX_TRAVELTIME_STEP_XY, VX_TRAVELTIME_STEP_Z);
+  printf("\t-p phase, P or S (default is P).\n");
+  printf("\t-m directory containing model files (default is '.').\n");
+  printf("\t-g disable GTL (default is on).\n");
+  printf("\t-s directs use of SCEC 1D background and topo.\n");
+  printf("\t-o prefix of the output files (default is none).\n");
+  printf("\t-e convergence tolerance in s (default is %g).\n", VX_TT_TOL);
+  printf("\t-i max sweep iterations (default is %d).\n", VX_TT_MAX_ITER);
+  printf("\t-t number of threads (default is 1).\n\n");
+  printf("Input format is:\n");
+  printf("\tX Y Z [name]\n\n");
+  printf("with Z the station elevation in m. Stations without a name are\n");
+  printf("numbered from 0. Travel times of station 'name' are written to\n");
+  printf("'prefix'name.phase.vxt: a text header ending with END, followed\n");
+  printf("by float times in s, x fastest, inf at nodes not reached.\n\n");
+  printf("Version: %s\n\n", VERSION);
+  exit (0);
+}
+
+
+/* Solve and save the travel times of stdin stations */
+int run_stations(vx_tt_t *tt, const char *prefix, double tol, int max_iter,
+		 int num_threads)
+{
+  char line[VX_TRAVELTIME_LINE], name[VX_TRAVELTIME_NAME];
+  char path[VX_TRAVELTIME_LINE + VX_TRAVELTIME_NAME], *p, *end;
+  double xyz[3], utm[3], solve_s = 0.0;
+  unsigned long long start;
+  int k, num = 0, retval = 0;
+
+  while (fgets(line, sizeof(line), stdin) != NULL) {
+    p = line;
+    for (k = 0; k < 3; k++) {
+      xyz[k] = vx_parse_double(p, &end);
+      if (end == p) {
+	break;
+      }
+      p = end;
+    }
+    if (k < 3) {
+      continue;
+    }
+    if (sscanf(p, "%63s", name) != 1) {
+      snprintf(name, sizeof(name), "%d", num);
+    }
+
+    memcpy(utm, xyz, 3 * sizeof(double));
+    if ((xyz[0] < 360.) && (fabs(xyz[1]) < 90.)) {
+      vx_geo2utm(xyz, utm);
+    }
+
+    start = vx_stats_now();
+    if (vx_tt_solve(tt, utm, tol, max_iter, num_threads) != 0) {
+      fprintf(stderr, "%s: failed to solve travel times\n", name);
+      retval = 1;
+      num++;
+      continue;
+    }
+    solve_s += (vx_stats_now() - start) * 1.0e-9;
+    snprintf(path, sizeof(path), "%s%s.%s.vxt", prefix, name,
+	     VX_TT_PHASE_NAMES[tt->phase]);
+    if (vx_tt_write(path, tt) != 0) {
+      retval = 1;
+    }
+    fprintf(stderr, "%s: %d iterations, last change %.2e s, %.3f s\n", path,
+	    tt->iterations, tt->change, (vx_stats_now() - start) * 1.0e-9);
+    num++;
+  }
+
+  if (num > 0) {
+    fprintf(stderr, "%d stations solved in %.3f s, %.2f Mnodes/s\n", num,
+	    solve_s, (solve_s > 0.0) ? num * (double)tt->dims[0] *
+	    tt->dims[1] * tt->dims[2] * 1.0e-6 / solve_s : 0.0);
+  }
+  return(retval);
+}
+
+
+int main (int argc, char *argv[])
+{
+  vx_tt_t tt;
+  vx_tt_phase_t phase = VX_TT_P;
+  char modeldir[CMLEN], prefix[CMLEN];
+  double min[3], max[3], step[3], tol = VX_TT_TOL;
+  int use_gtl = True;
+  int use_scec = False;
+  int have_region = False;
+  int max_iter = VX_TT_MAX_ITER;
+  int num_threads = 1;
+  unsigned long long start;
+  int opt, k, retval;
+
+  strcpy(modeldir, ".");
+  strcpy(prefix, "");
+  step[0] = step[1] = VX_TRAVELTIME_STEP_XY;
+  step[2] = VX_TRAVELTIME_STEP_Z;
+
+  /* Parse options */
+  while ((opt = getopt(argc, argv, "d:e:gi:m:o:p:r:st:h")) != -1) {
+    switch (opt) {
+    case 'd':
+      if (sscanf(optarg, "%lf,%lf,%lf", &step[0], &step[1], &step[2]) != 3) {
+	fprintf(stderr, "Invalid node spacing %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'e':
+      tol = atof(optarg);
+      if (!(tol > 0.0)) {
+	fprintf(stderr, "Invalid tolerance %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'g':
+      use_gtl = False;
+      break;
+    case 'i':
+      max_iter = atoi(optarg);
+      if (max_iter < 1) {
+	fprintf(stderr, "Invalid iteration count %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'm':
+      snprintf(modeldir, CMLEN, "%s", optarg);
+      break;
+    case 'o':
+      snprintf(prefix, CMLEN, "%s", optarg);
+      break;
+    case 'p':
+      for (k = 0; k < VX_TT_PHASE_NUM; k++) {
+	if (strcmp(optarg, VX_TT_PHASE_NAMES[k]) == 0) {
+	  break;
+	}
+      }
+      if (k == VX_TT_PHASE_NUM) {
+	fprintf(stderr, "Invalid phase %s\n", optarg);
+	exit(1);
+      }
+      phase = (vx_tt_phase_t)k;
+      break;
+    case 'r':
+      if (sscanf(optarg, "%lf,%lf,%lf,%lf,%lf,%lf", &min[0], &min[1],
+		 &min[2], &max[0], &max[1], &max[2]) != 6) {
+	fprintf(stderr, "Invalid region %s\n", optarg);
+	exit(1);
+      }
+      have_region = True;
+      break;
+    case 's':
+      use_scec = True;
+      break;
+    case 't':
+      num_threads = atoi(optarg);
+      if (num_threads < 1) {
+	fprintf(stderr, "Invalid thread count %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'h':
+      usage();
+      break;
+    default: /* '?' */
+      usage();
+    }
+  }
+  if (!have_region) {
+    usage();
+  }
+
+  if (vx_tt_init(&tt, min, max, step) != 0) {
+    return(1);
+  }
+
+  start = vx_stats_now();
+  if (vx_setup(modeldir) != 0) {
+    fprintf(stderr, "Failed to init vx\n");
+    vx_tt_free(&tt);
+    return(1);
+  }
+  if (use_scec) {
+    vx_register_scec();
+  }
+  vx_setgtl(use_gtl);
+  retval = vx_tt_slowness(&tt, phase, num_threads);
+  vx_cleanup();
+  if (retval != 0) {
+    vx_tt_free(&tt);
+    return(1);
+  }
+  fprintf(stderr, "%s slowness of %zux%zux%zu nodes sampled in %.3f s\n",
+	  VX_TT_PHASE_NAMES[phase], tt.dims[0], tt.dims[1], tt.dims[2],
+	  (vx_stats_now() - start) * 1.0e-9);
+
+  retval = run_stations(&tt, prefix, tol, max_iter, num_threads);
+  vx_tt_free(&tt);
+  return(retval);
+}
@@ -0,0 +1,90 @@
+/**
+    vx_ts2mesh - Convert a GOCAD TSurf surface to a binary mesh that
+    cvmdst and the vx_mesh API map directly from disk. Replaces the
+    ts2gts awk and GTS cleanup pipeline.
+
+    10/2026: Initial implementation
+**/
+
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "params.h"
+#include "vx_mesh.h"
+#include "vx_stats.h"
+
+
+/* Usage function */
+void usage() {
+  printf("     vx_ts2mesh - (c) Harvard University, SCEC\n");
+  printf("Convert a GOCAD TSurf surface to a binary .vxm mesh. Repeated\n");
+  printf("vertices are merged and collapsed triangles dropped.\n\n");
+  printf("\tusage: vx_ts2mesh [-e tolerance] [-q] surface.ts mesh.vxm\n\n");
+  printf("Flags:\n");
+  printf("\t-e merge vertices closer than tolerance, in meters (default is\n");
+  printf("\t   0, only identical vertices are merged).\n");
+  printf("\t-q do not report statistics.\n\n");
+  printf("Version: %s\n\n", VERSION);
+  exit (0);
+}
+
+
+int main (int argc, char *argv[])
+{
+  vx_mesh_conv_t stats;
+  struct rusage usage_info;
+  unsigned long long start;
+  double tol = 0.0, secs;
+  int quiet = False;
+  int opt;
+
+  /* Parse options */
+  while ((opt = getopt(argc, argv, "e:qh")) != -1) {
+    switch (opt) {
+    case 'e':
+      tol = atof(optarg);
+      if (tol < 0.0) {
+	fprintf(stderr, "Invalid tolerance %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'q':
+      quiet = True;
+      break;
+    case 'h':
+      usage();
+      break;
+    default: /* '?' */
+      usage();
+    }
+  }
+  if (argc - optind != 2) {
+    usage();
+  }
+
+  start = vx_stats_now();
+  if (vx_mesh_convert_ts(argv[optind], argv[optind + 1], tol, &stats) != 0) {
+    fprintf(stderr, "Failed to convert %s\n", argv[optind]);
+    return(1);
+  }
+  secs = (vx_stats_now() - start) * 1.0e-9;
+
+  if (!quiet) {
+    getrusage(RUSAGE_SELF, &usage_info);
+    fprintf(stderr, "%s: %zu vertices (%zu read), %zu triangles, "
+	    "%zu collapsed\n", argv[optind + 1], stats.num_verts,
+	    stats.num_in_verts, stats.num_tris, stats.num_degenerate);
+    fprintf(stderr, "Read %.1f MB in %.3f s (%.1f MB/s)\n",
+	    stats.bytes_in / 1.0e6, secs,
+	    (secs > 0.0) ? stats.bytes_in / 1.0e6 / secs : 0.0);
+    fprintf(stderr, "Buffers %.1f MB, max resident %.1f MB\n",
+	    stats.buffer_bytes / 1.0e6, usage_info.ru_maxrss / 1.0e3);
+  }
+  return(0);
+}
@@ -0,0 +1,562 @@
+/** vx_tt.c - First arrival travel times on a regular grid, solved
+    from the eikonal equation by fast sweeping over slowness sampled
+    from the model. Sweeps run over blocks of nodes; the blocks on
+    each diagonal plane of the block grid have no upwind dependencies
+    on each other and are swept in parallel.
+
+10/2026: Initial implementation
+**/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include "params.h"
+#include "vx_rec.h"
+#include "vx_sched.h"
+#include "vx_tt.h"
+
+
+/* Magic line of travel time files */
+#define VX_TT_MAGIC "VXTT 1\n"
+
+/* Max length of travel time file header lines */
+#define VX_TT_LINE 1024
+
+
+/* Phase names */
+char *VX_TT_PHASE_NAMES[VX_TT_PHASE_NUM] = {"P", "S"};
+
+
+/* Sweep of the blocks of one diagonal plane */
+typedef struct vx_tt_task_t
+{
+  vx_tt_t *tt;
+  int dir;                   /* bits 0-2 set to sweep x, y, z downwards */
+  double w[3];               /* inverse squared node spacing */
+  size_t *blocks;            /* block indices of each task */
+  double *change;            /* max change of each task */
+} vx_tt_task_t;
+
+
+/* Allocate grid */
+int vx_tt_init(vx_tt_t *tt, const double *min, const double *max,
+	       const double *step)
+{
+  size_t n = 1;
+  int k;
+
+  memset(tt, 0, sizeof(vx_tt_t));
+  for (k = 0; k < 3; k++) {
+    if (!(step[k] > 0.0) || !(max[k] > min[k])) {
+      fprintf(stderr, "Invalid grid axis %d\n", k);
+      return(1);
+    }
+    tt->origin[k] = min[k];
+    tt->step[k] = step[k];
+    tt->dims[k] = (size_t)floor((max[k] - min[k]) / step[k] + 0.5) + 1;
+    if (tt->dims[k] < 2) {
+      tt->dims[k] = 2;
+    }
+    if ((tt->dims[k] > ((size_t)1 << 20)) || (n > SIZE_MAX / tt->dims[k])) {
+      fprintf(stderr, "Grid too large\n");
+      return(1);
+    }
+    n *= tt->dims[k];
+  }
+  tt->change = NAN;
+
+  tt->slow = malloc(n * sizeof(float));
+  tt->time = malloc(n * sizeof(float));
+  if ((tt->slow == NULL) || (tt->time == NULL)) {
+    fprintf(stderr, "Failed to allocate grid of %zu nodes\n", n);
+    vx_tt_free(tt);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Free grid */
+void vx_tt_free(vx_tt_t *tt)
+{
+  free(tt->slow);
+  free(tt->time);
+  memset(tt, 0, sizeof(vx_tt_t));
+}
+
+
+/* Sample one x row of slowness */
+static int vx_tt_slow_task(size_t task, void *arg)
+{
+  vx_tt_t *tt = (vx_tt_t *)arg;
+  size_t i, nx = tt->dims[0];
+  float *slow = &(tt->slow[task * nx]);
+  vx_entry_t entry;
+  double v;
+
+  for (i = 0; i < nx; i++) {
+    memset(&entry, 0, sizeof(vx_entry_t));
+    entry.coor[0] = tt->origin[0] + i * tt->step[0];
+    entry.coor[1] = tt->origin[1] + (task % tt->dims[1]) * tt->step[1];
+    entry.coor[2] = tt->origin[2] + (task / tt->dims[1]) * tt->step[2];
+    entry.coor_type = VX_COORD_UTM;
+    slow[i] = INFINITY;
+    if (vx_getcoord_zmode(&entry, VX_ZMODE_ELEV) == 0) {
+      v = (tt->phase == VX_TT_P) ? entry.vp : entry.vs;
+      if (v > 0.0) {
+	slow[i] = 1.0 / v;
+      }
+    }
+  }
+  return(0);
+}
+
+
+/* Sample slowness */
+int vx_tt_slowness(vx_tt_t *tt, vx_tt_phase_t phase, int num_threads)
+{
+  tt->phase = phase;
+  if (vx_sched_run(tt->dims[1] * tt->dims[2], num_threads, NULL,
+		   vx_tt_slow_task, tt, NULL) != 0) {
+    fprintf(stderr, "Failed to sample slowness\n");
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Godunov upwind solution of the eikonal equation at a node with
+   slowness 's', from the smaller neighbour time 'a' along each axis
+   of weight 'w' (inverse squared spacing). Axes are added in order of
+   their times while the solution stays above them */
+static inline double vx_tt_godunov(const double *a_in, const double *w_in,
+				   double s)
+{
+  double a[3], w[3], x, sw, sa, saa, d, t;
+  int n, m;
+
+  memcpy(a, a_in, 3 * sizeof(double));
+  memcpy(w, w_in, 3 * sizeof(double));
+  for (n = 1; n < 3; n++) {
+    for (m = n; (m > 0) && (a[m] < a[m - 1]); m--) {
+      x = a[m];
+      a[m] = a[m - 1];
+      a[m - 1] = x;
+      x = w[m];
+      w[m] = w[m - 1];
+      w[m - 1] = x;
+    }
+  }
+
+  /* One axis */
+  t = a[0] + s / sqrt(w[0]);
+  if (!(t > a[1])) {
+    return(t);
+  }
+
+  sw = w[0];
+  sa = w[0] * a[0];
+  saa = w[0] * a[0] * a[0];
+  for (n = 1; (n < 3) && (t > a[n]); n++) {
+    sw += w[n];
+    sa += w[n] * a[n];
+    saa += w[n] * a[n] * a[n];
+    d = sa * sa - sw * (saa - s * s);
+    if (d < 0.0) {
+      break;
+    }
+    t = (sa + sqrt(d)) / sw;
+  }
+  return(t);
+}
+
+
+/* Update node i, j, k with axis weights 'w'. Returns the decrease of
+   its time */
+static inline double vx_tt_update(vx_tt_t *tt, const double *w, size_t i,
+				  size_t j, size_t k)
+{
+  size_t nx = tt->dims[0], nxy = nx * tt->dims[1];
+  size_t pos = (k * tt->dims[1] + j) * nx + i;
+  float *t = tt->time;
+  double a[3], s = tt->slow[pos];
+  float v;
+
+  if (!(s < INFINITY)) {
+    return(0.0);
+  }
+  a[0] = (i > 0) ? t[pos - 1] : INFINITY;
+  if ((i + 1 < nx) && (t[pos + 1] < a[0])) {
+    a[0] = t[pos + 1];
+  }
+  a[1] = (j > 0) ? t[pos - nx] : INFINITY;
+  if ((j + 1 < tt->dims[1]) && (t[pos + nx] < a[1])) {
+    a[1] = t[pos + nx];
+  }
+  a[2] = (k > 0) ? t[pos - nxy] : INFINITY;
+  if ((k + 1 < tt->dims[2]) && (t[pos + nxy] < a[2])) {
+    a[2] = t[pos + nxy];
+  }
+  if (!(a[0] < INFINITY) && !(a[1] < INFINITY) && !(a[2] < INFINITY)) {
+    return(0.0);
+  }
+
+  v = (float)vx_tt_godunov(a, w, s);
+  if (v < t[pos]) {
+    s = (double)t[pos] - v;
+    t[pos] = v;
+    return(s);
+  }
+  return(0.0);
+}
+
+
+/* Sweep one block in the order of the sweep direction */
+static int vx_tt_sweep_task(size_t task, void *arg)
+{
+  vx_tt_task_t *a = (vx_tt_task_t *)arg;
+  vx_tt_t *tt = a->tt;
+  size_t lo[3], len[3], n[3], i, j, k;
+  double change = 0.0, d;
+  int m;
+
+  for (m = 0; m < 3; m++) {
+    lo[m] = a->blocks[task * 3 + m] * VX_TT_BLOCK;
+    len[m] = tt->dims[m] - lo[m];
+    if (len[m] > VX_TT_BLOCK) {
+      len[m] = VX_TT_BLOCK;
+    }
+  }
+
+  for (n[2] = 0; n[2] < len[2]; n[2]++) {
+    k = (a->dir & 4) ? lo[2] + len[2] - 1 - n[2] : lo[2] + n[2];
+    for (n[1] = 0; n[1] < len[1]; n[1]++) {
+      j = (a->dir & 2) ? lo[1] + len[1] - 1 - n[1] : lo[1] + n[1];
+      for (n[0] = 0; n[0] < len[0]; n[0]++) {
+	i = (a->dir & 1) ? lo[0] + len[0] - 1 - n[0] : lo[0] + n[0];
+	d = vx_tt_update(tt, a->w, i, j, k);
+	if (d > change) {
+	  change = d;
+	}
+      }
+    }
+  }
+  a->change[task] = change;
+  return(0);
+}
+
+
+/* Straight ray times from the source to the nodes around it, with
+   the mean of the source and node slowness */
+static int vx_tt_source(vx_tt_t *tt, const double *source)
+{
+  size_t c[3], lo[3], hi[3], i[3], pos;
+  double f, d, best = INFINITY, s = INFINITY;
+  int k, m;
+
+  for (k = 0; k < 3; k++) {
+    f = (source[k] - tt->origin[k]) / tt->step[k];
+    if (!(f >= 0.0) || (f > tt->dims[k] - 1)) {
+      fprintf(stderr, "Source %.2f %.2f %.2f outside the grid\n",
+	      source[0], source[1], source[2]);
+      return(1);
+    }
+    c[k] = (size_t)f;
+    if (c[k] > tt->dims[k] - 2) {
+      c[k] = tt->dims[k] - 2;
+    }
+    lo[k] = (c[k] + 1 > VX_TT_INIT) ? c[k] + 1 - VX_TT_INIT : 0;
+    hi[k] = c[k] + VX_TT_INIT;
+    if (hi[k] > tt->dims[k] - 1) {
+      hi[k] = tt->dims[k] - 1;
+    }
+  }
+
+  /* Source slowness from the closest corner of its cell with velocity */
+  for (m = 0; m < 8; m++) {
+    d = 0.0;
+    for (k = 0; k < 3; k++) {
+      i[k] = c[k] + ((m >> k) & 1);
+      f = tt->origin[k] + i[k] * tt->step[k] - source[k];
+      d += f * f;
+    }
+    pos = (i[2] * tt->dims[1] + i[1]) * tt->dims[0] + i[0];
+    if ((tt->slow[pos] < INFINITY) && (d < best)) {
+      best = d;
+      s = tt->slow[pos];
+    }
+  }
+  if (!(s < INFINITY)) {
+    fprintf(stderr, "Source %.2f %.2f %.2f has no velocity\n",
+	    source[0], source[1], source[2]);
+    return(1);
+  }
+
+  for (i[2] = lo[2]; i[2] <= hi[2]; i[2]++) {
+    for (i[1] = lo[1]; i[1] <= hi[1]; i[1]++) {
+      for (i[0] = lo[0]; i[0] <= hi[0]; i[0]++) {
+	pos = (i[2] * tt->dims[1] + i[1]) * tt->dims[0] + i[0];
+	if (tt->slow[pos] < INFINITY) {
+	  d = 0.0;
+	  for (k = 0; k < 3; k++) {
+	    f = tt->origin[k] + i[k] * tt->step[k] - source[k];
+	    d += f * f;
+	  }
+	  tt->time[pos] = sqrt(d) * 0.5 * (s + tt->slow[pos]);
+	}
+      }
+    }
+  }
+  return(0);
+}
+
+
+/* Solve travel times. Each iteration sweeps the grid in the eight
+   axis directions. The nodes of a block are swept in order and the
+   blocks of diagonal plane L (sum of block indices counted along the
+   sweep) only depend on planes L - 1 and L + 1, so the times are the
+   same as those of a plain sweep whatever the number of threads */
+int vx_tt_solve(vx_tt_t *tt, const double *source, double tol,
+		int max_iter, int num_threads)
+{
+  vx_tt_task_t arg;
+  size_t nb[3], b[3], n, num, level, levels, pos;
+  double change;
+  int dir, k, retval = 0;
+
+  n = tt->dims[0] * tt->dims[1] * tt->dims[2];
+  for (pos = 0; pos < n; pos++) {
+    tt->time[pos] = INFINITY;
+  }
+  memcpy(tt->source, source, 3 * sizeof(double));
+  tt->iterations = 0;
+  tt->change = NAN;
+  if (vx_tt_source(tt, source) != 0) {
+    return(1);
+  }
+
+  for (k = 0; k < 3; k++) {
+    nb[k] = (tt->dims[k] + VX_TT_BLOCK - 1) / VX_TT_BLOCK;
+    arg.w[k] = 1.0 / (tt->step[k] * tt->step[k]);
+  }
+  levels = nb[0] + nb[1] + nb[2] - 2;
+  arg.tt = tt;
+  arg.blocks = malloc(nb[0] * nb[1] * 3 * sizeof(size_t));
+  arg.change = malloc(nb[0] * nb[1] * sizeof(double));
+  if ((arg.blocks == NULL) || (arg.change == NULL)) {
+    fprintf(stderr, "Failed to allocate sweep tasks\n");
+    free(arg.blocks);
+    free(arg.change);
+    return(1);
+  }
+
+  while ((tt->iterations < max_iter) && (retval == 0)) {
+    change = 0.0;
+    for (dir = 0; (dir < 8) && (retval == 0); dir++) {
+      arg.dir = dir;
+      for (level = 0; (level < levels) && (retval == 0); level++) {
+
+	/* Blocks of the plane, b counted along the sweep */
+	num = 0;
+	for (b[0] = 0; b[0] < nb[0]; b[0]++) {
+	  for (b[1] = 0; b[1] < nb[1]; b[1]++) {
+	    if ((b[0] + b[1] > level) || (level - b[0] - b[1] >= nb[2])) {
+	      continue;
+	    }
+	    b[2] = level - b[0] - b[1];
+	    for (k = 0; k < 3; k++) {
+	      arg.blocks[num * 3 + k] = (dir & (1 << k)) ?
+		nb[k] - 1 - b[k] : b[k];
+	    }
+	    num++;
+	  }
+	}
+
+	retval = vx_sched_run(num, num_threads, NULL, vx_tt_sweep_task,
+			      &arg, NULL);
+	for (pos = 0; pos < num; pos++) {
+	  if (arg.change[pos] > change) {
+	    change = arg.change[pos];
+	  }
+	}
+      }
+    }
+    tt->iterations++;
+    tt->change = change;
+    if (change < tol) {
+      break;
+    }
+  }
+
+  free(arg.blocks);
+  free(arg.change);
+  if (retval != 0) {
+    fprintf(stderr, "Failed to sweep travel times\n");
+  }
+  return(retval);
+}
+
+
+/* Interpolated travel time */
+double vx_tt_time(const vx_tt_t *tt, const double *p)
+{
+  size_t c[3], pos, nx = tt->dims[0], nxy = nx * tt->dims[1];
+  double f, t[3], w, v = 0.0;
+  int k, m;
+
+  for (k = 0; k < 3; k++) {
+    f = (p[k] - tt->origin[k]) / tt->step[k];
+    if (!(f >= 0.0) || (f > tt->dims[k] - 1)) {
+      return(NAN);
+    }
+    c[k] = (size_t)f;
+    if (c[k] > tt->dims[k] - 2) {
+      c[k] = tt->dims[k] - 2;
+    }
+    t[k] = f - c[k];
+  }
+
+  for (m = 0; m < 8; m++) {
+    pos = (c[2] + ((m >> 2) & 1)) * nxy + (c[1] + ((m >> 1) & 1)) * nx +
+      c[0] + (m & 1);
+    if (!(tt->time[pos] < INFINITY)) {
+      break;
+    }
+    w = 1.0;
+    for (k = 0; k < 3; k++) {
+      w *= ((m >> k) & 1) ? t[k] : 1.0 - t[k];
+    }
+    v += w * tt->time[pos];
+  }
+  if (m == 8) {
+    return(v);
+  }
+
+  pos = (c[2] + (t[2] >= 0.5)) * nxy + (c[1] + (t[1] >= 0.5)) * nx +
+    c[0] + (t[0] >= 0.5);
+  return(tt->time[pos]);
+}
+
+
+/* Save travel times to a temporary file renamed into place */
+int vx_tt_write(const char *path, const vx_tt_t *tt)
+{
+  char tmp[VX_TT_LINE];
+  FILE *fp;
+  size_t n = tt->dims[0] * tt->dims[1] * tt->dims[2];
+  int retval = 0;
+
+  snprintf(tmp, sizeof(tmp), "%s.%ld", path, (long)getpid());
+  fp = fopen(tmp, "wb");
+  if (fp == NULL) {
+    fprintf(stderr, "Failed to open travel time file %s\n", tmp);
+    return(1);
+  }
+  fputs(VX_TT_MAGIC, fp);
+  fprintf(fp, "PHASE %s\n", VX_TT_PHASE_NAMES[tt->phase]);
+  fprintf(fp, "SOURCE %.17g %.17g %.17g\n", tt->source[0], tt->source[1],
+	  tt->source[2]);
+  fprintf(fp, "ORIGIN %.17g %.17g %.17g\n", tt->origin[0], tt->origin[1],
+	  tt->origin[2]);
+  fprintf(fp, "STEP %.17g %.17g %.17g\n", tt->step[0], tt->step[1],
+	  tt->step[2]);
+  fprintf(fp, "DIMS %zu %zu %zu\n", tt->dims[0], tt->dims[1], tt->dims[2]);
+  fprintf(fp, "BYTEORDER %s\n",
+	  (vx_system_endian() == VX_BYTEORDER_LSB) ? "lsb" : "msb");
+  fprintf(fp, "END\n");
+  if (fwrite(tt->time, sizeof(float), n, fp) != n) {
+    retval = 1;
+  }
+  if ((fclose(fp) != 0) || (retval != 0) || (rename(tmp, path) != 0)) {
+    fprintf(stderr, "Failed to write travel time file %s\n", path);
+    remove(tmp);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Load travel times */
+int vx_tt_read(const char *path, vx_tt_t *tt)
+{
+  FILE *fp;
+  char line[VX_TT_LINE], phase[16] = "", order[16] = "";
+  size_t i, n, len;
+  int k, fields = 0;
+
+  memset(tt, 0, sizeof(vx_tt_t));
+  fp = fopen(path, "rb");
+  if (fp == NULL) {
+    fprintf(stderr, "Failed to open travel time file %s\n", path);
+    return(1);
+  }
+  if ((fgets(line, sizeof(line), fp) == NULL) ||
+      (strcmp(line, VX_TT_MAGIC) != 0)) {
+    fprintf(stderr, "Invalid travel time file %s\n", path);
+    fclose(fp);
+    return(1);
+  }
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    len = strlen(line);
+    if ((len > 0) && (line[len - 1] == '\n')) {
+      line[--len] = '\0';
+    }
+    if (strcmp(line, "END") == 0) {
+      break;
+    } else if ((sscanf(line, "PHASE %15s", phase) == 1) ||
+	       (sscanf(line, "SOURCE %lf %lf %lf", &tt->source[0],
+		       &tt->source[1], &tt->source[2]) == 3) ||
+	       (sscanf(line, "ORIGIN %lf %lf %lf", &tt->origin[0],
+		       &tt->origin[1], &tt->origin[2]) == 3) ||
+	       (sscanf(line, "STEP %lf %lf %lf", &tt->step[0],
+		       &tt->step[1], &tt->step[2]) == 3) ||
+	       (sscanf(line, "DIMS %zu %zu %zu", &tt->dims[0],
+		       &tt->dims[1], &tt->dims[2]) == 3) ||
+	       (sscanf(line, "BYTEORDER %15s", order) == 1)) {
+      fields++;
+    }
+  }
+
+  for (k = 0; k < VX_TT_PHASE_NUM; k++) {
+    if (strcmp(phase, VX_TT_PHASE_NAMES[k]) == 0) {
+      tt->phase = (vx_tt_phase_t)k;
+      break;
+    }
+  }
+  n = 1;
+  for (i = 0; i < 3; i++) {
+    if ((tt->dims[i] < 2) || (tt->dims[i] > ((size_t)1 << 20)) ||
+	!(tt->step[i] > 0.0)) {
+      break;
+    }
+    n *= tt->dims[i];
+  }
+  if ((fields != 6) || (k == VX_TT_PHASE_NUM) || (i < 3)) {
+    fprintf(stderr, "Invalid travel time file %s\n", path);
+    fclose(fp);
+    memset(tt, 0, sizeof(vx_tt_t));
+    return(1);
+  }
+
+  tt->change = NAN;
+  tt->time = malloc(n * sizeof(float));
+  if ((tt->time == NULL) || (fread(tt->time, sizeof(float), n, fp) != n)) {
+    fprintf(stderr, "Failed to read travel time file %s\n", path);
+    fclose(fp);
+    vx_tt_free(tt);
+    return(1);
+  }
+  fclose(fp);
+
+  if (strcmp(order, (vx_system_endian() == VX_BYTEORDER_LSB) ?
+	     "lsb" : "msb") != 0) {
+    for (i = 0; i < n; i++) {
+      vx_rec_swap((char *)&(tt->time[i]), sizeof(float));
+    }
+  }
+  return(0);
+}
@@ -0,0 +1,81 @@
+#ifndef VX_TT_H
+#define VX_TT_H
+
+#include <stddef.h>
+#include "vx_sub.h"
+
+/* Default convergence tolerance of the sweeps, s */
+#define VX_TT_TOL 1.0e-5
+
+/* Default max number of sweep iterations */
+#define VX_TT_MAX_ITER 50
+
+/* Nodes per axis of the blocks swept by one task */
+#define VX_TT_BLOCK 16
+
+/* Half width in nodes of the box of straight ray times around the
+   source */
+#define VX_TT_INIT 4
+
+
+/* Phases */
+typedef enum { VX_TT_P = 0,
+	       VX_TT_S } vx_tt_phase_t;
+
+#define VX_TT_PHASE_NUM 2
+
+extern char *VX_TT_PHASE_NAMES[VX_TT_PHASE_NUM];
+
+
+/* Travel time grid of one source over a regular UTM grid, with the
+   slowness it was solved on. Nodes are stored x fastest, z is
+   elevation. Nodes without velocity (air, water for S, outside the
+   model) have infinite slowness and are never reached */
+typedef struct vx_tt_t
+{
+  vx_tt_phase_t phase;
+  double origin[3];          /* UTM x, y and elevation of node 0 */
+  double step[3];
+  size_t dims[3];
+  double source[3];          /* UTM of the source of 'time' */
+  int iterations;            /* sweep iterations of the last solve */
+  double change;             /* max change of the last iteration, s */
+  float *slow;               /* s/m, inf without velocity. NULL if read */
+  float *time;               /* s, inf where not reached */
+} vx_tt_t;
+
+
+/* Allocate grid covering 'min' to 'max' with node spacing 'step'.
+   Returns 1 on failure */
+int vx_tt_init(vx_tt_t *tt, const double *min, const double *max,
+	       const double *step);
+
+/* Free grid */
+void vx_tt_free(vx_tt_t *tt);
+
+/* Sample the slowness of 'phase' at the nodes from the model set up
+   with vx_setup, with the current GTL and background settings, on
+   'num_threads' threads. Returns 1 on failure */
+int vx_tt_slowness(vx_tt_t *tt, vx_tt_phase_t phase, int num_threads);
+
+/* Solve the eikonal equation for the travel times from UTM point
+   'source' by fast sweeping, on 'num_threads' threads, until the
+   times change by less than 'tol' or after 'max_iter' iterations.
+   Results do not depend on the number of threads. Returns 1 if the
+   source is outside the grid or has no velocity around it */
+int vx_tt_solve(vx_tt_t *tt, const double *source, double tol,
+		int max_iter, int num_threads);
+
+/* Travel time at UTM point 'p' by trilinear interpolation. Cells with
+   a node not reached give the closest node value. Returns NaN outside
+   the grid */
+double vx_tt_time(const vx_tt_t *tt, const double *p);
+
+/* Save travel times to 'path'. Returns 1 on failure */
+int vx_tt_write(const char *path, const vx_tt_t *tt);
+
+/* Load travel times from 'path', without slowness. Returns 1 on
+   failure */
+int vx_tt_read(const char *path, vx_tt_t *tt);
+
+#endif
@@ -0,0 +1,215 @@
+/**
+    vx_vs30 - Site metrics from CVM-H columns: Vs30 and the depths to
+    the 1.0 and 2.5 km/s Vs isosurfaces. Accepts Geographic
+    Coordinates or UTM Zone 11 coordinates.
+
+    10/2026: Initial implementation
+**/
+
+
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <getopt.h>
+#include "params.h"
+#include "vx_sub.h"
+#include "vx_fmt.h"
+#include "vx_stats.h"
+#include "vx_site.h"
+
+
+/* Sites per block */
+#define VX_VS30_BLOCK 4096
+
+/* Max length of input and output lines */
+#define VX_VS30_LINE 1024
+
+
+/* Usage function */
+void usage() {
+  printf("     vx_vs30 - (c) Harvard University, SCEC\n");
+  printf("Compute site metrics from the model columns below X Y points\n");
+  printf("read from stdin: the time-averaged shear velocity of the top\n");
+  printf("%.0f m and the depths to the Vs %.1f and %.1f km/s isosurfaces.\n",
+	 VX_SITE_VS30_DEPTH, VX_SITE_VS_Z1 / 1000.0, VX_SITE_VS_Z25 / 1000.0);
+  printf("Columns are queried as vx_lite -z dep queries them.\n\n");
+  printf("\tusage: vx_vs30 [-g] [-s] [-m dir] [-r tol] [-d depth] [-t threads] [-v] < file.in\n\n");
+  printf("Flags:\n");
+  printf("\t-g disable GTL (default is on).\n");
+  printf("\t-s directs use of SCEC 1D background and topo.\n");
+  printf("\t-m directory containing model files (default is '.').\n");
+  printf("\t-r depth resolution of the isosurfaces in m (default is %.1f).\n",
+	 VX_SITE_TOL);
+  printf("\t-d max depth searched for the isosurfaces in m (default is\n");
+  printf("\t   %.0f).\n", VX_SITE_MAX_DEPTH);
+  printf("\t-t number of threads (default is 1).\n");
+  printf("\t-v report queries per site and run time to stderr.\n\n");
+  printf("Output format is:\n");
+  printf("\tX Y vs30 z1.0 z2.5\n\n");
+  printf("Depths are in m below the surface, nan where the isosurface is\n");
+  printf("not reached. Sites outside the model are reported as nan.\n\n");
+  printf("Version: %s\n\n", VERSION);
+  exit (0);
+}
+
+
+/* Read up to 'cap' X Y sites. Lines without two numbers are skipped */
+size_t read_sites(vx_site_t *sites, size_t cap)
+{
+  char line[VX_VS30_LINE], *p, *end;
+  double xy[2];
+  size_t n = 0;
+  int k;
+
+  while ((n < cap) && (fgets(line, sizeof(line), stdin) != NULL)) {
+    p = line;
+    for (k = 0; k < 2; k++) {
+      xy[k] = vx_parse_double(p, &end);
+      if (end == p) {
+	break;
+      }
+      p = end;
+    }
+    if (k < 2) {
+      continue;
+    }
+
+    memset(&(sites[n]), 0, sizeof(vx_site_t));
+    sites[n].coor[0] = xy[0];
+    sites[n].coor[1] = xy[1];
+    if ((xy[0] < 360.) && (fabs(xy[1]) < 90.)) {
+      sites[n].coor_type = VX_COORD_GEO;
+    } else {
+      sites[n].coor_type = VX_COORD_UTM;
+    }
+    n++;
+  }
+  return(n);
+}
+
+
+/* Write metrics of 'n' sites */
+int write_sites(const vx_site_t *sites, size_t n)
+{
+  char out[VX_VS30_LINE];
+  size_t i;
+  int len;
+
+  for (i = 0; i < n; i++) {
+    len = vx_fmt_fixed(out, sites[i].coor[0], 0, 4);
+    out[len++] = ' ';
+    len += vx_fmt_fixed(&out[len], sites[i].coor[1], 0, 4);
+    out[len++] = ' ';
+    len += vx_fmt_fixed(&out[len], sites[i].vs30, 0, 2);
+    out[len++] = ' ';
+    len += vx_fmt_fixed(&out[len], sites[i].z1, 0, 2);
+    out[len++] = ' ';
+    len += vx_fmt_fixed(&out[len], sites[i].z25, 0, 2);
+    out[len++] = '\n';
+    if (fwrite(out, 1, len, stdout) != (size_t)len) {
+      fprintf(stderr, "Failed to write output\n");
+      return(1);
+    }
+  }
+  return(0);
+}
+
+
+int main (int argc, char *argv[])
+{
+  vx_site_opts_t opts;
+  vx_site_t *sites;
+  char modeldir[CMLEN];
+  int use_gtl = True;
+  int use_scec = False;
+  int verbose = False;
+  int num_threads = 1;
+  unsigned long long start, queries = 0, total = 0;
+  size_t n, i;
+  int opt, retval = 0;
+
+  vx_site_defaults(&opts);
+  strcpy(modeldir, ".");
+
+  /* Parse options */
+  while ((opt = getopt(argc, argv, "d:gm:r:st:vh")) != -1) {
+    switch (opt) {
+    case 'd':
+      opts.max_depth = atof(optarg);
+      if (!(opts.max_depth > 0.0)) {
+	fprintf(stderr, "Invalid max depth %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'g':
+      use_gtl = False;
+      break;
+    case 'm':
+      snprintf(modeldir, CMLEN, "%s", optarg);
+      break;
+    case 'r':
+      opts.tol = atof(optarg);
+      if (!(opts.tol > 0.0)) {
+	fprintf(stderr, "Invalid resolution %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 's':
+      use_scec = True;
+      break;
+    case 't':
+      num_threads = atoi(optarg);
+      if (num_threads < 1) {
+	fprintf(stderr, "Invalid thread count %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'v':
+      verbose = True;
+      break;
+    case 'h':
+      usage();
+      break;
+    default: /* '?' */
+      usage();
+    }
+  }
+
+  /* Perform setup */
+  if (vx_setup(modeldir) != 0) {
+    fprintf(stderr, "Failed to init vx\n");
+    exit(1);
+  }
+  if (use_scec) {
+    vx_register_scec();
+  }
+  vx_setgtl(use_gtl);
+
+  sites = malloc(VX_VS30_BLOCK * sizeof(vx_site_t));
+  if (sites == NULL) {
+    fprintf(stderr, "Failed to allocate sites\n");
+    exit(1);
+  }
+
+  start = vx_stats_now();
+  while ((retval == 0) && ((n = read_sites(sites, VX_VS30_BLOCK)) > 0)) {
+    /* Sites outside the model are written as nan */
+    vx_site_metrics_parallel(sites, n, &opts, num_threads, NULL);
+    retval = write_sites(sites, n);
+    for (i = 0; i < n; i++) {
+      queries += sites[i].num_queries;
+    }
+    total += n;
+  }
+  if (verbose) {
+    fprintf(stderr, "%llu sites, %.1f queries per site, %.3f s\n", total,
+	    (total > 0) ? (double)queries / total : 0.0,
+	    (vx_stats_now() - start) * 1.0e-9);
+  }
+
+  free(sites);
+  vx_cleanup();
+  return(retval);
+}
@@ -0,0 +1,499 @@
+/** genmodel.c - Synthetic CVM-H model generator. Writes the voxet
+    headers, big endian property files and little endian GTL files
+    read by vx_setup, from analytic surfaces and velocity functions.
+    Files are written in fixed size chunks so grids of any size can
+    be generated with constant memory.
+
+    10/2026: Initial implementation
+**/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "utils.h"
+#include "vs30_gtl.h"
+#include "genmodel.h"
+
+/* Nodes per write chunk */
+#define GENMODEL_CHUNK 262144
+
+/* Max properties in a single file group */
+#define GENMODEL_MAX_PROP 4
+
+/* Max path length */
+#define GENMODEL_PATH 1024
+
+/* Max file name length */
+#define GENMODEL_NAME 256
+
+/* Voxet tags, as in vx_prov_t */
+#define GENMODEL_TAG_MANTLE 1.0
+#define GENMODEL_TAG_TOMO 2.0
+#define GENMODEL_TAG_BASIN 3.0
+#define GENMODEL_TAG_AIR 4.0
+#define GENMODEL_TAG_WATER 7.0
+
+
+/* Property sampler, fills one value per property */
+typedef void (*genmodel_sample_t)(const genmodel_t *model,
+				  double x, double y, double z,
+				  float *vals);
+
+
+/* Default model: Southern California sized voxets with an offshore
+   region, two basins and a topo gap */
+void genmodel_defaults(genmodel_t *model)
+{
+  genmodel_grid_t lr = {{300000.0, 3700000.0, -15000.0},
+			{2000.0, 2000.0, 200.0}, {101, 101, 101}};
+  genmodel_grid_t hr = {{350000.0, 3750000.0, -6000.0},
+			{500.0, 500.0, 100.0}, {101, 101, 76}};
+  genmodel_grid_t cm = {{250000.0, 3650000.0, -60000.0},
+			{10000.0, 10000.0, 1000.0}, {31, 31, 46}};
+  genmodel_grid_t topo = {{300000.0, 3700000.0, 0.0},
+			  {1000.0, 1000.0, 0.0}, {201, 201, 1}};
+  genmodel_grid_t gtl = {{320000.0, 3720000.0, 0.0},
+			 {1000.0, 1000.0, 0.0}, {121, 161, 1}};
+  genmodel_basin_t basins[2] = {{{375000.0, 3775000.0},
+				 {15000.0, 10000.0}, 5000.0},
+				{{430000.0, 3730000.0},
+				 {10000.0, 10000.0}, 2500.0}};
+
+  memset(model, 0, sizeof(genmodel_t));
+  model->lr = lr;
+  model->hr = hr;
+  model->cm = cm;
+  model->topo = topo;
+  model->gtl = gtl;
+
+  model->coast_x = 330000.0;
+  model->coast_drift = 0.3;
+
+  model->gap[0] = 470000.0;
+  model->gap[1] = 500000.0;
+  model->gap[2] = 3870000.0;
+  model->gap[3] = 3900000.0;
+
+  model->moho = -30000.0;
+
+  model->num_basins = 2;
+  memcpy(model->basins, basins, sizeof(basins));
+}
+
+
+/* Scale node spacing of one grid by 1/factor */
+static int genmodel_scale_grid(genmodel_grid_t *grid, double factor)
+{
+  double extent;
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    if (grid->n[i] < 2) {
+      continue;
+    }
+    extent = grid->step[i] * (grid->n[i] - 1);
+    grid->step[i] /= factor;
+    if (extent / grid->step[i] + 1.5 > 2147483647.0) {
+      return(1);
+    }
+    grid->n[i] = (int)floor(extent / grid->step[i] + 0.5) + 1;
+    if (grid->n[i] < 2) {
+      return(1);
+    }
+  }
+  return(0);
+}
+
+
+/* Scale node counts of all grids by 'factor' per axis, keeping
+   extents fixed. Returns 1 if a grid would have fewer than 2 nodes */
+int genmodel_scale(genmodel_t *model, double factor)
+{
+  if (factor <= 0.0) {
+    return(1);
+  }
+  if ((genmodel_scale_grid(&model->lr, factor) != 0) ||
+      (genmodel_scale_grid(&model->hr, factor) != 0) ||
+      (genmodel_scale_grid(&model->cm, factor) != 0) ||
+      (genmodel_scale_grid(&model->topo, factor) != 0) ||
+      (genmodel_scale_grid(&model->gtl, factor) != 0)) {
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Number of nodes in grid */
+static size_t genmodel_cells(const genmodel_grid_t *grid)
+{
+  return((size_t)grid->n[0] * (size_t)grid->n[1] * (size_t)grid->n[2]);
+}
+
+
+/* Total number of bytes written by genmodel_write */
+size_t genmodel_size(const genmodel_t *model)
+{
+  return((genmodel_cells(&model->lr) + genmodel_cells(&model->hr) +
+	  genmodel_cells(&model->cm)) * 3 * sizeof(float) +
+	 genmodel_cells(&model->topo) * 4 * sizeof(float) +
+	 genmodel_cells(&model->gtl) * sizeof(float));
+}
+
+
+/* Depth of basin sediments below the surface */
+static double genmodel_basin_depth(const genmodel_t *model,
+				   double x, double y)
+{
+  double u, v, r, d, depth = 0.0;
+  int i;
+
+  for (i = 0; i < model->num_basins; i++) {
+    u = (x - model->basins[i].center[0]) / model->basins[i].radius[0];
+    v = (y - model->basins[i].center[1]) / model->basins[i].radius[1];
+    r = u * u + v * v;
+    if (r < 1.0) {
+      d = model->basins[i].depth * (1.0 - r) * (1.0 - r);
+      if (d > depth) {
+	depth = d;
+      }
+    }
+  }
+  return(depth);
+}
+
+
+/* Ground or sea floor elevation, ignoring the gap */
+static double genmodel_surface(const genmodel_t *model, double x, double y)
+{
+  double coast, elev, d;
+
+  coast = model->coast_x + model->coast_drift * (y - model->topo.origin[1]);
+  if (x < coast) {
+    /* Continental shelf and slope */
+    elev = -20.0 - (coast - x) * 0.03;
+    if (elev < -2500.0) {
+      elev = -2500.0;
+    }
+  } else {
+    /* Coastal plain rising to ranges inland */
+    elev = (x - coast) * 0.01 +
+      600.0 * pow(sin((x - coast) / 40000.0), 2.0) *
+      (1.0 + 0.5 * cos(y / 17000.0));
+  }
+
+  /* Basins are flat at the surface */
+  d = genmodel_basin_depth(model, x, y) / 500.0;
+  if (elev > 0.0) {
+    elev *= 1.0 - 0.75 * ((d > 1.0) ? 1.0 : d);
+  }
+  return(elev);
+}
+
+
+/* Topo elevation, no data inside the gap */
+double genmodel_topo(const genmodel_t *model, double x, double y)
+{
+  if ((x >= model->gap[0]) && (x <= model->gap[1]) &&
+      (y >= model->gap[2]) && (y <= model->gap[3])) {
+    return(GENMODEL_NO_DATA);
+  }
+  return(genmodel_surface(model, x, y));
+}
+
+
+/* Basement elevation */
+double genmodel_base(const genmodel_t *model, double x, double y)
+{
+  return(genmodel_surface(model, x, y) -
+	 genmodel_basin_depth(model, x, y));
+}
+
+
+/* Moho elevation */
+static double genmodel_moho(const genmodel_t *model, double x, double y)
+{
+  return(model->moho + 2000.0 * sin(x / 40000.0) * cos(y / 50000.0));
+}
+
+
+/* Voxel values at a point: air above the surface, water above the sea
+   floor, sediments down to the basement, crust and mantle */
+int genmodel_voxel(const genmodel_t *model, double x, double y, double z,
+		   float *vp, float *vs, float *tag)
+{
+  double surface, base, moho, v;
+
+  surface = genmodel_surface(model, x, y);
+  base = surface - genmodel_basin_depth(model, x, y);
+  moho = genmodel_moho(model, x, y);
+
+  if ((z > surface) && (z > 0.0)) {
+    *vp = *vs = GENMODEL_NO_DATA;
+    *tag = GENMODEL_TAG_AIR;
+  } else if (z > surface) {
+    *vp = 1480.0;
+    *vs = GENMODEL_NO_DATA;
+    *tag = GENMODEL_TAG_WATER;
+  } else if (z > base) {
+    v = 1700.0 + (surface - z) * 0.6;
+    *vp = (v > 4500.0) ? 4500.0 : v;
+    *vs = *vp / 2.2;
+    *tag = GENMODEL_TAG_BASIN;
+  } else if (z > moho) {
+    *vp = 5600.0 - z * 0.04 +
+      150.0 * sin(x / 9000.0) * cos(y / 11000.0);
+    *vs = *vp / 1.73;
+    *tag = GENMODEL_TAG_TOMO;
+  } else {
+    *vp = 7800.0 + (moho - z) * 0.003;
+    *vs = *vp / 1.77;
+    *tag = GENMODEL_TAG_MANTLE;
+  }
+  return(0);
+}
+
+
+/* Voxet sampler: vp, tag, vs */
+static void genmodel_sample_voxet(const genmodel_t *model,
+				  double x, double y, double z,
+				  float *vals)
+{
+  genmodel_voxel(model, x, y, z, &vals[0], &vals[2], &vals[1]);
+}
+
+
+/* Interfaces sampler: topo, base, moho, model top */
+static void genmodel_sample_surfaces(const genmodel_t *model,
+				     double x, double y, double z,
+				     float *vals)
+{
+  vals[0] = genmodel_topo(model, x, y);
+  vals[1] = genmodel_base(model, x, y);
+  vals[2] = genmodel_moho(model, x, y);
+  vals[3] = vals[0];
+}
+
+
+/* GTL sampler: Vs30 lowered over basins and near the coast */
+static void genmodel_sample_vs30(const genmodel_t *model,
+				 double x, double y, double z,
+				 float *vals)
+{
+  double d, coast, vs30;
+
+  d = genmodel_basin_depth(model, x, y) / 1500.0;
+  vs30 = 760.0 - 480.0 * ((d > 1.0) ? 1.0 : d);
+  coast = model->coast_x + model->coast_drift * (y - model->topo.origin[1]);
+  if ((x > coast) && (x - coast < 5000.0)) {
+    vs30 = fmin(vs30, 300.0 + (x - coast) * 0.09);
+  }
+  vals[0] = vs30;
+}
+
+
+/* Write grid nodes in x fastest order, one file per property */
+static int genmodel_write_grid(const genmodel_t *model, const char *dir,
+			       const genmodel_grid_t *grid,
+			       const char **files, int nprop,
+			       genmodel_sample_t sample,
+			       vx_byteorder_t byteorder)
+{
+  FILE *fp[GENMODEL_MAX_PROP];
+  float *buf[GENMODEL_MAX_PROP];
+  float vals[GENMODEL_MAX_PROP];
+  char path[GENMODEL_PATH];
+  unsigned char *c, t;
+  size_t cells, i, n, k;
+  int p, ix, iy, iz, swap, retval = 0;
+
+  swap = (vx_system_endian() != byteorder);
+  for (p = 0; p < nprop; p++) {
+    snprintf(path, GENMODEL_PATH, "%s/%s", dir, files[p]);
+    fp[p] = fopen(path, "wb");
+    buf[p] = malloc(GENMODEL_CHUNK * sizeof(float));
+    if ((fp[p] == NULL) || (buf[p] == NULL)) {
+      fprintf(stderr, "Failed to open %s\n", path);
+      retval = 1;
+    }
+  }
+
+  cells = genmodel_cells(grid);
+  ix = iy = iz = 0;
+  for (i = 0; (i < cells) && (retval == 0); i += n) {
+    n = (cells - i < GENMODEL_CHUNK) ? cells - i : GENMODEL_CHUNK;
+    for (k = 0; k < n; k++) {
+      sample(model,
+	     grid->origin[0] + ix * grid->step[0],
+	     grid->origin[1] + iy * grid->step[1],
+	     grid->origin[2] + iz * grid->step[2], vals);
+      for (p = 0; p < nprop; p++) {
+	buf[p][k] = vals[p];
+      }
+      if (++ix == grid->n[0]) {
+	ix = 0;
+	if (++iy == grid->n[1]) {
+	  iy = 0;
+	  iz++;
+	}
+      }
+    }
+
+    for (p = 0; p < nprop; p++) {
+      if (swap) {
+	for (k = 0; k < n; k++) {
+	  c = (unsigned char *)&buf[p][k];
+	  t = c[0]; c[0] = c[3]; c[3] = t;
+	  t = c[1]; c[1] = c[2]; c[2] = t;
+	}
+      }
+      if (fwrite(buf[p], sizeof(float), n, fp[p]) != n) {
+	fprintf(stderr, "Failed to write %s/%s\n", dir, files[p]);
+	retval = 1;
+	break;
+      }
+    }
+  }
+
+  for (p = 0; p < nprop; p++) {
+    if ((fp[p] != NULL) && (fclose(fp[p]) != 0)) {
+      retval = 1;
+    }
+    free(buf[p]);
+  }
+  return(retval);
+}
+
+
+/* Write voxet header */
+static int genmodel_write_vo(const char *dir, const char *name,
+			     const genmodel_grid_t *grid,
+			     const char **props, const char **files,
+			     int nprop)
+{
+  FILE *fp;
+  char path[GENMODEL_PATH];
+  int p;
+
+  snprintf(path, GENMODEL_PATH, "%s/%s", dir, name);
+  fp = fopen(path, "w");
+  if (fp == NULL) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    return(1);
+  }
+
+  fprintf(fp, "GOCAD Voxet 1\n");
+  fprintf(fp, "HEADER {\nname:%s\n}\n", name);
+  fprintf(fp, "AXIS_O %f %f %f\n", grid->origin[0], grid->origin[1],
+	  grid->origin[2]);
+  fprintf(fp, "AXIS_U %f 0 0\n", grid->step[0] * (grid->n[0] - 1));
+  fprintf(fp, "AXIS_V 0 %f 0\n", grid->step[1] * (grid->n[1] - 1));
+  fprintf(fp, "AXIS_W 0 0 %f\n", grid->step[2] * (grid->n[2] - 1));
+  fprintf(fp, "AXIS_MIN 0 0 0\n");
+  fprintf(fp, "AXIS_MAX 1 1 1\n");
+  fprintf(fp, "AXIS_N %d %d %d\n", grid->n[0], grid->n[1], grid->n[2]);
+  fprintf(fp, "AXIS_TYPE even even even\n");
+  for (p = 0; p < nprop; p++) {
+    fprintf(fp, "\nPROPERTY %d %s\n", p + 1, props[p]);
+    fprintf(fp, "PROP_ESIZE %d 4\n", p + 1);
+    fprintf(fp, "PROP_ETYPE %d IEEE\n", p + 1);
+    fprintf(fp, "PROP_NO_DATA_VALUE %d %f\n", p + 1, GENMODEL_NO_DATA);
+    fprintf(fp, "PROP_FILE %d %s\n", p + 1, files[p]);
+  }
+  fprintf(fp, "END\n");
+
+  if (fclose(fp) != 0) {
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Write GTL header */
+static int genmodel_write_hdr(const char *dir, const genmodel_grid_t *grid)
+{
+  FILE *fp;
+  char path[GENMODEL_PATH];
+
+  snprintf(path, GENMODEL_PATH, "%s/%s.hdr", dir, DEFAULT_GTL_FILE);
+  fp = fopen(path, "w");
+  if (fp == NULL) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    return(1);
+  }
+
+  fprintf(fp, "# Synthetic Vs30 map\n");
+  fprintf(fp, "x0=%f\n", grid->origin[0]);
+  fprintf(fp, "x1=%f\n", grid->origin[0] + grid->step[0] * (grid->n[0] - 1));
+  fprintf(fp, "y0=%f\n", grid->origin[1]);
+  fprintf(fp, "y1=%f\n", grid->origin[1] + grid->step[1] * (grid->n[1] - 1));
+  fprintf(fp, "dsize=4\n");
+  fprintf(fp, "spacing=%f\n", grid->step[0]);
+  fprintf(fp, "nodata=%f\n", GENMODEL_NO_DATA);
+
+  if (fclose(fp) != 0) {
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Write voxet 'name' sampled on 'grid' to header name.vo and property
+   files name_vp@@, name_tag@@ and name_vs@@ */
+int genmodel_write_voxet(const genmodel_t *model, const char *dir,
+			 const char *name, const genmodel_grid_t *grid)
+{
+  const char *vprops[3] = {"vp", "tag", "vs"};
+  char files[3][GENMODEL_NAME];
+  const char *fp[3];
+  char header[GENMODEL_NAME];
+  int p;
+
+  for (p = 0; p < 3; p++) {
+    snprintf(files[p], GENMODEL_NAME, "%s_%s@@", name, vprops[p]);
+    fp[p] = files[p];
+  }
+  snprintf(header, GENMODEL_NAME, "%s.vo", name);
+
+  if ((genmodel_write_vo(dir, header, grid, vprops, fp, 3) != 0) ||
+      (genmodel_write_grid(model, dir, grid, fp, 3,
+			   genmodel_sample_voxet, VX_BYTEORDER_MSB) != 0)) {
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Write model files to directory 'dir', which must exist */
+int genmodel_write(const genmodel_t *model, const char *dir)
+{
+  const char *sprops[4] = {"topo", "base", "moho", "modeltop"};
+  const char *sfiles[4] = {"topo_dem@@", "base@@", "moho@@", "model_top@@"};
+  const char *gfiles[1] = {DEFAULT_GTL_FILE ".mdl"};
+
+  /* Spacing in the GTL header applies to both axes */
+  if (model->gtl.step[0] != model->gtl.step[1]) {
+    fprintf(stderr, "GTL spacing must be equal in x and y\n");
+    return(1);
+  }
+
+  if ((genmodel_write_voxet(model, dir, "CVM_LR", &model->lr) != 0) ||
+      (genmodel_write_voxet(model, dir, "CVM_HR", &model->hr) != 0) ||
+      (genmodel_write_voxet(model, dir, "CVM_CM", &model->cm) != 0)) {
+    return(1);
+  }
+  if ((genmodel_write_vo(dir, "interfaces.vo", &model->topo,
+			 sprops, sfiles, 4) != 0) ||
+      (genmodel_write_grid(model, dir, &model->topo, sfiles, 4,
+			   genmodel_sample_surfaces,
+			   VX_BYTEORDER_MSB) != 0)) {
+    return(1);
+  }
+  if ((genmodel_write_hdr(dir, &model->gtl) != 0) ||
+      (genmodel_write_grid(model, dir, &model->gtl, gfiles, 1,
+			   genmodel_sample_vs30, VX_BYTEORDER_LSB) != 0)) {
+    return(1);
+  }
+
+  return(0);
+}
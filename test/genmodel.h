@@ -0,0 +1,83 @@
+#ifndef GENMODEL_H
+#define GENMODEL_H
+
+#include <stddef.h>
+
+/* No data value written to all property files */
+#define GENMODEL_NO_DATA -99999.0
+
+/* Max number of basins */
+#define GENMODEL_MAX_BASINS 8
+
+
+/* Regular grid: origin, node spacing and node counts in UTM. Surface
+   grids have a single z node */
+typedef struct genmodel_grid_t
+{
+  double origin[3];
+  double step[3];
+  int n[3];
+} genmodel_grid_t;
+
+
+/* Sedimentary basin: elliptical bowl centred at (x,y) */
+typedef struct genmodel_basin_t
+{
+  double center[2];
+  double radius[2];
+  double depth;
+} genmodel_basin_t;
+
+
+/* Synthetic model definition */
+typedef struct genmodel_t
+{
+  genmodel_grid_t lr;
+  genmodel_grid_t hr;
+  genmodel_grid_t cm;
+  genmodel_grid_t topo;
+  genmodel_grid_t gtl;
+
+  /* Coastline x at topo origin y, and its drift in x per m of y.
+     Sea floor lies west of the coast */
+  double coast_x;
+  double coast_drift;
+
+  /* Box where topo and model top are no data, x0 x1 y0 y1 */
+  double gap[4];
+
+  /* Moho elevation */
+  double moho;
+
+  int num_basins;
+  genmodel_basin_t basins[GENMODEL_MAX_BASINS];
+} genmodel_t;
+
+
+/* Default model: Southern California sized voxets with an offshore
+   region, two basins and a topo gap */
+void genmodel_defaults(genmodel_t *model);
+
+/* Scale node counts of all grids by 'factor' per axis, keeping
+   extents fixed. Returns 1 if a grid would have fewer than 2 nodes */
+int genmodel_scale(genmodel_t *model, double factor);
+
+/* Total number of bytes written by genmodel_write */
+size_t genmodel_size(const genmodel_t *model);
+
+/* Write model files to directory 'dir', which must exist */
+int genmodel_write(const genmodel_t *model, const char *dir);
+
+/* Write voxet 'name' sampled on 'grid' to header name.vo and property
+   files name_vp@@, name_tag@@ and name_vs@@. Names are limited to 11
+   characters by the property file names of the model loader */
+int genmodel_write_voxet(const genmodel_t *model, const char *dir,
+			 const char *name, const genmodel_grid_t *grid);
+
+/* Model values at a point, as written to the files */
+double genmodel_topo(const genmodel_t *model, double x, double y);
+double genmodel_base(const genmodel_t *model, double x, double y);
+int genmodel_voxel(const genmodel_t *model, double x, double y, double z,
+		   float *vp, float *vs, float *tag);
+
+#endif
@@ -0,0 +1,305 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "vx_sub.h"
+#include "genmodel.h"
+#include "unittest_defs.h"
+#include "test_genmodel.h"
+
+/* Node scale of test model */
+#define TEST_GENMODEL_SCALE 0.5
+
+/* Node stride of voxet checks */
+#define TEST_GENMODEL_STRIDE 3
+
+
+/* Test model and its directory */
+static genmodel_t test_model;
+static char test_model_dir[256];
+
+
+/* Generate model directory */
+int test_genmodel_create(char *dir, double scale, genmodel_t *model)
+{
+  genmodel_t defaults;
+
+  if (model == NULL) {
+    model = &defaults;
+  }
+  if (mkdtemp(dir) == NULL) {
+    fprintf(stderr, "Failed to create model directory\n");
+    return(1);
+  }
+  genmodel_defaults(model);
+  if ((genmodel_scale(model, scale) != 0) ||
+      (genmodel_write(model, dir) != 0)) {
+    fprintf(stderr, "Failed to generate model\n");
+    test_genmodel_remove(dir);
+    return(1);
+  }
+  return(0);
+}
+
+
+/* Remove generated model directory */
+int test_genmodel_remove(const char *dir)
+{
+  DIR *dp;
+  struct dirent *de;
+  char path[512];
+
+  dp = opendir(dir);
+  if (dp == NULL) {
+    return(1);
+  }
+  while ((de = readdir(dp)) != NULL) {
+    if (de->d_name[0] != '.') {
+      snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+      unlink(path);
+    }
+  }
+  closedir(dp);
+  return(rmdir(dir));
+}
+
+
+/* Query node of a voxet and compare with the generated values. Points
+   in the topo gap have no surface and are not found. Returns the tag,
+   or -1 on mismatch */
+int test_genmodel_node(const genmodel_grid_t *grid, int i, int j, int k,
+		       vx_src_t src)
+{
+  vx_entry_t entry;
+  float vp, vs, tag;
+
+  vx_init_entry(&entry);
+  entry.coor_type = VX_COORD_UTM;
+  entry.coor[0] = grid->origin[0] + i * grid->step[0];
+  entry.coor[1] = grid->origin[1] + j * grid->step[1];
+  entry.coor[2] = grid->origin[2] + k * grid->step[2];
+  genmodel_voxel(&test_model, entry.coor[0], entry.coor[1], entry.coor[2],
+		 &vp, &vs, &tag);
+  if (genmodel_topo(&test_model, entry.coor[0], entry.coor[1]) ==
+      GENMODEL_NO_DATA) {
+    src = VX_SRC_NR;
+    tag = vp = vs = GENMODEL_NO_DATA;
+  }
+
+  vx_getcoord(&entry);
+  if ((entry.data_src != src) || (entry.provenance != tag) ||
+      (entry.vp != vp) || (entry.vs != vs)) {
+    fprintf(stderr, "Node %f %f %f: src %d tag %f vp %f vs %f, "
+	    "expected src %d tag %f vp %f vs %f\n",
+	    entry.coor[0], entry.coor[1], entry.coor[2],
+	    entry.data_src, entry.provenance, entry.vp, entry.vs,
+	    src, tag, vp, vs);
+    return(-1);
+  }
+  return((tag < 0.0) ? VX_PROV_NONE : (int)tag);
+}
+
+
+int test_genmodel_voxets()
+{
+  genmodel_grid_t *hr = &test_model.hr;
+  genmodel_grid_t *lr = &test_model.lr;
+  genmodel_grid_t *cm = &test_model.cm;
+  int counts[VX_PROV_GTL + 1];
+  double x, y;
+  int i, j, k, tag;
+
+  printf("Test: voxet nodes match the generated values\n");
+
+  if (test_assert_int(vx_setup(test_model_dir), 0) != 0) {
+    return(1);
+  }
+  vx_setgtl(False);
+  memset(counts, 0, sizeof(counts));
+
+  /* HR nodes */
+  for (k = 0; k < hr->n[2]; k += TEST_GENMODEL_STRIDE) {
+    for (j = 0; j < hr->n[1]; j += TEST_GENMODEL_STRIDE) {
+      for (i = 0; i < hr->n[0]; i += TEST_GENMODEL_STRIDE) {
+	tag = test_genmodel_node(hr, i, j, k, VX_SRC_HR);
+	if (tag < 0) {
+	  return(1);
+	}
+	counts[tag]++;
+      }
+    }
+  }
+
+  /* LR nodes outside the HR voxet */
+  for (k = 0; k < lr->n[2]; k += TEST_GENMODEL_STRIDE) {
+    for (j = 0; j < lr->n[1]; j += TEST_GENMODEL_STRIDE) {
+      for (i = 0; i < lr->n[0]; i += TEST_GENMODEL_STRIDE) {
+	x = lr->origin[0] + i * lr->step[0];
+	y = lr->origin[1] + j * lr->step[1];
+	if ((x > hr->origin[0] - hr->step[0]) &&
+	    (x < hr->origin[0] + hr->n[0] * hr->step[0]) &&
+	    (y > hr->origin[1] - hr->step[1]) &&
+	    (y < hr->origin[1] + hr->n[1] * hr->step[1])) {
+	  continue;
+	}
+	tag = test_genmodel_node(lr, i, j, k, VX_SRC_LR);
+	if (tag < 0) {
+	  return(1);
+	}
+	counts[tag]++;
+      }
+    }
+  }
+
+  /* CM nodes below the LR voxet, inside the topo footprint */
+  for (k = 0; k < cm->n[2] - 1; k++) {
+    if (cm->origin[2] + k * cm->step[2] > lr->origin[2] - lr->step[2]) {
+      break;
+    }
+    for (j = 0; j < cm->n[1]; j++) {
+      for (i = 0; i < cm->n[0]; i++) {
+	x = cm->origin[0] + i * cm->step[0];
+	y = cm->origin[1] + j * cm->step[1];
+	if ((x < lr->origin[0]) || (y < lr->origin[1]) ||
+	    (x > lr->origin[0] + (lr->n[0] - 1) * lr->step[0]) ||
+	    (y > lr->origin[1] + (lr->n[1] - 1) * lr->step[1])) {
+	  continue;
+	}
+	tag = test_genmodel_node(cm, i, j, k, VX_SRC_CM);
+	if (tag < 0) {
+	  return(1);
+	}
+	counts[tag]++;
+      }
+    }
+  }
+
+  vx_cleanup();
+
+  /* All features present */
+  if ((test_assert_int(counts[VX_PROV_MANTLE] > 0, 1) != 0) ||
+      (test_assert_int(counts[VX_PROV_TOMO] > 0, 1) != 0) ||
+      (test_assert_int(counts[VX_PROV_BASIN] > 0, 1) != 0) ||
+      (test_assert_int(counts[VX_PROV_AIR] > 0, 1) != 0) ||
+      (test_assert_int(counts[VX_PROV_WATER] > 0, 1) != 0) ||
+      (test_assert_int(counts[VX_PROV_NONE] > 0, 1) != 0)) {
+    return(1);
+  }
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int test_genmodel_surfaces()
+{
+  genmodel_grid_t *to = &test_model.topo;
+  vx_entry_t entry;
+  int i, j, gap = 0, sea = 0;
+  float topo;
+
+  printf("Test: interfaces match the generated surfaces\n");
+
+  if (test_assert_int(vx_setup(test_model_dir), 0) != 0) {
+    return(1);
+  }
+  vx_setgtl(False);
+
+  for (j = 0; j < to->n[1]; j += TEST_GENMODEL_STRIDE) {
+    for (i = 0; i < to->n[0]; i += TEST_GENMODEL_STRIDE) {
+      vx_init_entry(&entry);
+      entry.coor_type = VX_COORD_UTM;
+      entry.coor[0] = to->origin[0] + i * to->step[0];
+      entry.coor[1] = to->origin[1] + j * to->step[1];
+      entry.coor[2] = -20000.0;
+      vx_getcoord(&entry);
+
+      topo = genmodel_topo(&test_model, entry.coor[0], entry.coor[1]);
+      if ((test_assert_float(entry.topo, topo) != 0) ||
+	  (test_assert_float(entry.mtop, topo) != 0) ||
+	  (test_assert_float(entry.base,
+			     genmodel_base(&test_model, entry.coor[0],
+					   entry.coor[1])) != 0)) {
+	return(1);
+      }
+      if (topo == GENMODEL_NO_DATA) {
+	gap++;
+      } else if (topo < 0.0) {
+	sea++;
+      }
+    }
+  }
+
+  vx_cleanup();
+
+  if ((test_assert_int(gap > 0, 1) != 0) ||
+      (test_assert_int(sea > 0, 1) != 0)) {
+    return(1);
+  }
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int suite_genmodel(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_genmodel");
+  suite.num_tests = 2;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Generate test model */
+  strcpy(test_model_dir, "/tmp/vx_genmodel.XXXXXX");
+  if (test_genmodel_create(test_model_dir, TEST_GENMODEL_SCALE,
+			   &test_model) != 0) {
+    return(1);
+  }
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_genmodel_voxets()");
+  suite.tests[0].test_func = &test_genmodel_voxets;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_genmodel_surfaces()");
+  suite.tests[1].test_func = &test_genmodel_surfaces;
+  suite.tests[1].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    test_genmodel_remove(test_model_dir);
+    return(1);
+  }
+  test_genmodel_remove(test_model_dir);
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+  return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef TEST_GENMODEL_H
+#define TEST_GENMODEL_H
+
+#include "genmodel.h"
+
+/* Generate the default model scaled by 'scale' in a new directory
+   made from mkdtemp template 'dir', returning its parameters in
+   'model' (may be NULL). The directory is removed on failure. Returns
+   1 on failure */
+int test_genmodel_create(char *dir, double scale, genmodel_t *model);
+
+/* Remove generated model directory */
+int test_genmodel_remove(const char *dir);
+
+int suite_genmodel(const char *xmldir);
+
+#endif
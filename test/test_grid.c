@@ -150,6 +150,63 @@ int test_vx_lite_grid_offset()
 }
 
 
+int test_vx_lite_grid_gen()
+{
+  char outfile[256];
+  char reffile[256];
+  char runpath[128];
+  char modelflag[128];
+  char currentdir[128];
+  int status;
+  pid_t pid;
+
+  printf("Test: vx_lite executable w/ generated grid in emulation mode\n");
+
+  /* Save current directory */
+  getcwd(currentdir, 128);
+
+  snprintf(outfile, sizeof(outfile), "%s/%s", currentdir,
+	   "test-vx-lite-grid-extract-gen.out");
+  snprintf(reffile, sizeof(reffile), "%s/%s", currentdir,
+	   "./ref/test-extract-vxlite.ref");
+  snprintf(runpath, sizeof(runpath), "%s/vx_lite", BIN_DIR);
+  snprintf(modelflag, sizeof(modelflag), "-m%s", MODEL_DIR);
+
+  /* Same points as inputs/test-grid.in */
+  pid = fork();
+  if (pid == -1) {
+    perror("fork");
+    return(1);
+  } else if (pid == 0) {
+    if ((freopen("/dev/null", "r", stdin) == NULL) ||
+	(freopen(outfile, "w", stdout) == NULL)) {
+      exit(1);
+    }
+    execl(runpath, runpath, "-n", modelflag, "-z", "elev", "--grid",
+	  "-120.5,-113.5,0.2,31.0,36.6,0.2,1000,-30000,-250", (char *)0);
+    perror("execl"); /* shall never get to here */
+    exit(1);
+  }
+  waitpid(pid, &status, 0);
+  if ((test_assert_int(WIFEXITED(status), 1) != 0) ||
+      (test_assert_int(WEXITSTATUS(status), 0) != 0)) {
+    printf("vx_lite failure\n");
+    unlink(outfile);
+    return(1);
+  }
+
+  /* Perform diff btw outfile and ref */
+  if (test_assert_file(outfile, reffile) != 0) {
+    return(1);
+  }
+
+  unlink(outfile);
+
+  printf("PASS\n");
+  return(0);
+}
+
+
 int suite_grid(const char *xmldir)
 {
   suite_t suite;
@@ -158,7 +215,7 @@ int suite_grid(const char *xmldir)
 
   /* Setup test suite */
   strcpy(suite.suite_name, "suite_grid");
-  suite.num_tests = 4;
+  suite.num_tests = 5;
   suite.tests = malloc(suite.num_tests * sizeof(test_t));
   if (suite.tests == NULL) {
     fprintf(stderr, "Failed to alloc test structure\n");
@@ -183,6 +240,10 @@ int suite_grid(const char *xmldir)
   suite.tests[3].test_func = &test_vx_lite_grid_offset;
   suite.tests[3].elapsed_time = 0.0;
 
+  strcpy(suite.tests[4].test_name, "test_vx_lite_grid_gen");
+  suite.tests[4].test_func = &test_vx_lite_grid_gen;
+  suite.tests[4].elapsed_time = 0.0;
+
   if (test_run_suite(&suite) != 0) {
     fprintf(stderr, "Failed to execute tests\n");
     return(1);
@@ -0,0 +1,454 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <unistd.h>
+#include "vx_mesh.h"
+#include "vx_bvh.h"
+#include "unittest_defs.h"
+#include "test_vx_bvh.h"
+
+/* CVM-H Moho surface distributed with the model */
+#define TEST_BVH_MOHO "../model/tsurf/CVMH_Moho64.ts"
+#define TEST_BVH_MOHO_VERTS 8100
+#define TEST_BVH_MOHO_TRIS 15840
+
+/* Random query points */
+#define TEST_BVH_POINTS 2000
+
+/* Distance tolerance, meters */
+#define TEST_BVH_TOL 1.0e-6
+
+
+/* Random coordinate in [lo, hi) */
+double test_bvh_rand(double lo, double hi)
+{
+  return(lo + (hi - lo) * (rand() / (RAND_MAX + 1.0)));
+}
+
+
+/* Write 'text' to a new temporary file named after 'ext' */
+int test_bvh_write(char *path, const char *ext, const char *text)
+{
+  FILE *fp;
+  int fd;
+
+  sprintf(path, "/tmp/vx_bvh.XXXXXX%s", ext);
+  fd = mkstemps(path, strlen(ext));
+  if (fd < 0) {
+    return(1);
+  }
+  fp = fdopen(fd, "w");
+  if (fp == NULL) {
+    close(fd);
+    return(1);
+  }
+  fputs(text, fp);
+  fclose(fp);
+  return(0);
+}
+
+
+/* Distance from 'p' to closest point of all mesh triangles */
+double test_bvh_brute(const vx_mesh_t *mesh, const double *p)
+{
+  double q[3], d, best = INFINITY;
+  const uint32_t *t;
+  size_t i;
+
+  for (i = 0; i < mesh->num_tris; i++) {
+    t = &(mesh->tris[i * 3]);
+    vx_bvh_closest_tri(p, &(mesh->verts[t[0] * 3]), &(mesh->verts[t[1] * 3]),
+		       &(mesh->verts[t[2] * 3]), q);
+    d = sqrt((p[0] - q[0]) * (p[0] - q[0]) + (p[1] - q[1]) * (p[1] - q[1]) +
+	     (p[2] - q[2]) * (p[2] - q[2]));
+    if (d < best) {
+      best = d;
+    }
+  }
+  return(best);
+}
+
+
+int test_bvh_load()
+{
+  vx_mesh_t mesh;
+  char path[256];
+  int retval = 0;
+
+  /* Two objects, depths, property vertices and atoms */
+  const char *ts =
+    "GOCAD TSurf 1\nHEADER {\nname:a\n}\nTFACE\n"
+    "VRTX 1 0 0 10\nVRTX 2 100 0 10\nVRTX 3 0 100 10\nTRGL 1 2 3\n"
+    "END\n"
+    "GOCAD TSurf 1\nGOCAD_ORIGINAL_COORDINATE_SYSTEM\n"
+    "ZPOSITIVE Depth\nEND_ORIGINAL_COORDINATE_SYSTEM\nTFACE\n"
+    "PVRTX 1 0 0 500 7.5\nPVRTX 2 100 0 500 7.5\nATOM 3 2\n"
+    "PVRTX 4 0 100 500 7.5\nTRGL 1 3 4\nEND\n";
+
+  /* Unit square of two faces */
+  const char *gts =
+    "4 5 2 GtsSurface GtsFace GtsEdge GtsVertex\n"
+    "0 0 0\n1 0 0\n1 1 0\n0 1 0\n"
+    "1 2\n2 3\n3 1\n3 4\n4 1\n"
+    "1 2 3\n3 4 5\n";
+
+  printf("Test: TSurf and GTS meshes load\n");
+
+  if (test_bvh_write(path, ".ts", ts) != 0) {
+    return(1);
+  }
+  if ((test_assert_int(vx_mesh_load(path, &mesh), 0) != 0) ||
+      (test_assert_int((int)mesh.num_verts, 6) != 0) ||
+      (test_assert_int((int)mesh.num_tris, 2) != 0) ||
+      (test_assert_int((int)mesh.tris[4], 4) != 0) ||
+      (test_assert_double(mesh.verts[2], 10.0) != 0) ||
+      (test_assert_double(mesh.verts[5 * 3 + 2], -500.0) != 0)) {
+    retval = 1;
+  }
+  vx_mesh_free(&mesh);
+  unlink(path);
+
+  if ((retval == 0) && (test_bvh_write(path, ".gts", gts) == 0)) {
+    if ((test_assert_int(vx_mesh_load(path, &mesh), 0) != 0) ||
+	(test_assert_int((int)mesh.num_verts, 4) != 0) ||
+	(test_assert_int((int)mesh.num_tris, 2) != 0) ||
+	(test_assert_int((int)mesh.tris[3], 2) != 0) ||
+	(test_assert_int((int)mesh.tris[4], 0) != 0) ||
+	(test_assert_int((int)mesh.tris[5], 3) != 0)) {
+      retval = 1;
+    }
+    vx_mesh_free(&mesh);
+    unlink(path);
+
+    /* Truncated face section */
+    test_bvh_write(path, ".gts", "4 5 2\n0 0 0\n1 0 0\n");
+    if (test_assert_int(vx_mesh_load(path, &mesh), 1) != 0) {
+      retval = 1;
+    }
+    unlink(path);
+  }
+
+  if ((retval == 0) &&
+      ((test_assert_int(vx_mesh_load(TEST_BVH_MOHO, &mesh), 0) != 0) ||
+       (test_assert_int((int)mesh.num_verts, TEST_BVH_MOHO_VERTS) != 0) ||
+       (test_assert_int((int)mesh.num_tris, TEST_BVH_MOHO_TRIS) != 0))) {
+    retval = 1;
+  }
+  vx_mesh_free(&mesh);
+
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_bvh_closest()
+{
+  vx_mesh_t mesh;
+  vx_bvh_t bvh;
+  double *xyz, *hit, *dist, *phit, *pdist;
+  double p[3], q[3], d;
+  uint32_t *tri;
+  int i, retval = 0;
+
+  printf("Test: closest points match a brute force search\n");
+
+  if (test_assert_int(vx_mesh_load(TEST_BVH_MOHO, &mesh), 0) != 0) {
+    return(1);
+  }
+  if (test_assert_int(vx_bvh_build(&mesh, &bvh), 0) != 0) {
+    vx_mesh_free(&mesh);
+    return(1);
+  }
+
+  xyz = malloc(TEST_BVH_POINTS * 3 * sizeof(double));
+  hit = malloc(TEST_BVH_POINTS * 3 * sizeof(double));
+  phit = malloc(TEST_BVH_POINTS * 3 * sizeof(double));
+  dist = malloc(TEST_BVH_POINTS * sizeof(double));
+  pdist = malloc(TEST_BVH_POINTS * sizeof(double));
+  tri = malloc(TEST_BVH_POINTS * sizeof(uint32_t));
+
+  /* Points in and around the model region */
+  srand(2718);
+  for (i = 0; i < TEST_BVH_POINTS; i++) {
+    xyz[i * 3] = test_bvh_rand(0.0, 800000.0);
+    xyz[i * 3 + 1] = test_bvh_rand(3400000.0, 4100000.0);
+    xyz[i * 3 + 2] = test_bvh_rand(-80000.0, 5000.0);
+  }
+
+  for (i = 0; (i < TEST_BVH_POINTS) && (retval == 0); i++) {
+    d = vx_bvh_closest(&bvh, &xyz[i * 3], q, &tri[0]);
+    if ((test_assert_int(fabs(d - test_bvh_brute(&mesh, &xyz[i * 3])) <
+			 TEST_BVH_TOL, 1) != 0) ||
+	(test_assert_int(tri[0] < mesh.num_tris, 1) != 0)) {
+      retval = 1;
+    }
+  }
+
+  /* Batch and threaded queries give the single point results */
+  vx_bvh_closest_batch(&bvh, xyz, TEST_BVH_POINTS, hit, dist, tri);
+  if ((retval == 0) &&
+      (test_assert_int(vx_bvh_closest_parallel(&bvh, xyz, TEST_BVH_POINTS,
+					       phit, pdist, NULL, 4), 0) != 0)) {
+    retval = 1;
+  }
+  for (i = 0; (i < TEST_BVH_POINTS) && (retval == 0); i++) {
+    d = vx_bvh_closest(&bvh, &xyz[i * 3], q, NULL);
+    if ((test_assert_int(fabs(d - dist[i]) < TEST_BVH_TOL, 1) != 0) ||
+	(test_assert_int(fabs(d - pdist[i]) < TEST_BVH_TOL, 1) != 0) ||
+	(test_assert_int(fabs(hit[i * 3 + 2] - phit[i * 3 + 2]) <
+			 TEST_BVH_TOL, 1) != 0)) {
+      retval = 1;
+    }
+  }
+
+  /* Points that are not finite have no closest point */
+  p[0] = NAN;
+  p[1] = 3700000.0;
+  p[2] = 0.0;
+  if ((retval == 0) && (test_assert_int(isnan(vx_bvh_closest(&bvh, p, q,
+								&tri[0])),
+					1) != 0)) {
+    retval = 1;
+  }
+
+  free(xyz);
+  free(hit);
+  free(phit);
+  free(dist);
+  free(pdist);
+  free(tri);
+  vx_bvh_free(&bvh);
+  vx_mesh_free(&mesh);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_bvh_cache()
+{
+  vx_bvh_t built, mapped;
+  char cache[256];
+  double p[3], q[3], r[3];
+  uint64_t sum;
+  int i, fd, cached, retval = 0;
+
+  printf("Test: cached hierarchies give the built results\n");
+
+  strcpy(cache, "/tmp/vx_bvh.XXXXXX");
+  fd = mkstemp(cache);
+  if (fd < 0) {
+    return(1);
+  }
+  close(fd);
+
+  /* Empty cache file is rebuilt, then mapped */
+  if ((test_assert_int(vx_bvh_load(TEST_BVH_MOHO, cache, &built, &cached),
+		       0) != 0) ||
+      (test_assert_int(cached, 0) != 0) ||
+      (test_assert_int(built.map == NULL, 1) != 0)) {
+    unlink(cache);
+    return(1);
+  }
+  if ((test_assert_int(vx_bvh_load(TEST_BVH_MOHO, cache, &mapped, &cached),
+		       0) != 0) ||
+      (test_assert_int(cached, 1) != 0)) {
+    vx_bvh_free(&built);
+    unlink(cache);
+    return(1);
+  }
+  if ((test_assert_int((int)mapped.num_nodes, (int)built.num_nodes) != 0) ||
+      (test_assert_int(memcmp(mapped.ids, built.ids,
+			      built.num_tris * sizeof(uint32_t)), 0) != 0)) {
+    retval = 1;
+  }
+
+  srand(1414);
+  for (i = 0; (i < TEST_BVH_POINTS) && (retval == 0); i++) {
+    p[0] = test_bvh_rand(0.0, 800000.0);
+    p[1] = test_bvh_rand(3400000.0, 4100000.0);
+    p[2] = test_bvh_rand(-80000.0, 5000.0);
+    if ((test_assert_double(vx_bvh_closest(&mapped, p, q, NULL),
+			    vx_bvh_closest(&built, p, r, NULL)) != 0) ||
+	(test_assert_int(memcmp(q, r, sizeof(q)), 0) != 0) ||
+	(test_assert_double(vx_bvh_height(&mapped, p[0], p[1]),
+			    vx_bvh_height(&built, p[0], p[1])) != 0)) {
+      retval = 1;
+    }
+  }
+  vx_bvh_free(&mapped);
+
+  /* Other checksums and truncated files are not mapped */
+  vx_mesh_checksum(TEST_BVH_MOHO, &sum);
+  if ((retval == 0) &&
+      ((test_assert_int(vx_bvh_map(&mapped, cache, sum + 1), 1) != 0) ||
+       (test_assert_int(truncate(cache, 1000), 0) != 0) ||
+       (test_assert_int(vx_bvh_map(&mapped, cache, sum), 1) != 0))) {
+    retval = 1;
+  }
+
+  vx_bvh_free(&built);
+  unlink(cache);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_mesh_convert()
+{
+  vx_mesh_t ts, mesh;
+  vx_mesh_conv_t stats;
+  vx_bvh_t built, mapped;
+  char path[256], out[256];
+  double p[3], q[3], r[3];
+  int i, fd, retval = 0;
+
+  printf("Test: binary meshes give the TSurf results\n");
+
+  strcpy(out, "/tmp/vx_bvh.XXXXXX");
+  fd = mkstemp(out);
+  if (fd < 0) {
+    return(1);
+  }
+  close(fd);
+
+  if ((test_assert_int(vx_mesh_convert_ts(TEST_BVH_MOHO, out, 0.0, &stats),
+		       0) != 0) ||
+      (test_assert_int((int)stats.num_verts, TEST_BVH_MOHO_VERTS) != 0) ||
+      (test_assert_int((int)stats.num_tris, TEST_BVH_MOHO_TRIS) != 0) ||
+      (test_assert_int(vx_mesh_map(out, &mesh), 0) != 0)) {
+    unlink(out);
+    return(1);
+  }
+  if ((test_assert_int(vx_mesh_load(TEST_BVH_MOHO, &ts), 0) != 0) ||
+      (test_assert_int(mesh.map != NULL, 1) != 0) ||
+      (test_assert_int((int)mesh.num_tris, TEST_BVH_MOHO_TRIS) != 0) ||
+      (test_assert_int(memcmp(mesh.tris, ts.tris,
+			      ts.num_tris * 3 * sizeof(uint32_t)), 0) != 0) ||
+      (test_assert_int(memcmp(mesh.verts, ts.verts,
+			      ts.num_verts * 3 * sizeof(double)), 0) != 0)) {
+    vx_mesh_free(&mesh);
+    unlink(out);
+    return(1);
+  }
+  vx_bvh_build(&ts, &built);
+  vx_bvh_build(&mesh, &mapped);
+
+  srand(1515);
+  for (i = 0; (i < TEST_BVH_POINTS) && (retval == 0); i++) {
+    p[0] = test_bvh_rand(0.0, 800000.0);
+    p[1] = test_bvh_rand(3400000.0, 4100000.0);
+    p[2] = test_bvh_rand(-80000.0, 5000.0);
+    if ((test_assert_double(vx_bvh_closest(&mapped, p, q, NULL),
+			    vx_bvh_closest(&built, p, r, NULL)) != 0) ||
+	(test_assert_int(memcmp(q, r, sizeof(q)), 0) != 0)) {
+      retval = 1;
+    }
+  }
+  vx_bvh_free(&mapped);
+  vx_bvh_free(&built);
+  vx_mesh_free(&mesh);
+  vx_mesh_free(&ts);
+  unlink(out);
+
+  /* Vertices within tolerance are merged and collapsed triangles
+     dropped */
+  if ((retval == 0) &&
+      ((test_bvh_write(path, ".ts",
+		       "GOCAD TSurf 1\nTFACE\nVRTX 1 0 0 0\nVRTX 2 10 0 0\n"
+		       "VRTX 3 0 10 0\nVRTX 4 0.01 0 0\nVRTX 5 10 10 0\n"
+		       "TRGL 1 2 3\nTRGL 4 5 2\nTRGL 1 4 3\nEND\n") != 0) ||
+       (test_assert_int(vx_mesh_convert_ts(path, out, 0.1, &stats), 0) != 0) ||
+       (test_assert_int((int)stats.num_verts, 4) != 0) ||
+       (test_assert_int((int)stats.num_tris, 2) != 0) ||
+       (test_assert_int((int)stats.num_degenerate, 1) != 0) ||
+       (test_assert_int(vx_mesh_map(out, &mesh), 0) != 0) ||
+       (test_assert_int((int)mesh.tris[3], 0) != 0))) {
+    retval = 1;
+  }
+  vx_mesh_free(&mesh);
+  unlink(path);
+  unlink(out);
+
+  /* Truncated meshes are not mapped */
+  if ((retval == 0) &&
+      ((test_assert_int(vx_mesh_convert_ts(TEST_BVH_MOHO, out, 0.0, NULL),
+			0) != 0) ||
+       (test_assert_int(truncate(out, 1000), 0) != 0) ||
+       (test_assert_int(vx_mesh_map(out, &mesh), 1) != 0))) {
+    retval = 1;
+  }
+  unlink(out);
+
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int suite_vx_bvh(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_bvh");
+  suite.num_tests = 4;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_bvh_load()");
+  suite.tests[0].test_func = &test_bvh_load;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_bvh_closest()");
+  suite.tests[1].test_func = &test_bvh_closest;
+  suite.tests[1].elapsed_time = 0.0;
+
+  strcpy(suite.tests[2].test_name, "test_bvh_cache()");
+  suite.tests[2].test_func = &test_bvh_cache;
+  suite.tests[2].elapsed_time = 0.0;
+
+  strcpy(suite.tests[3].test_name, "test_mesh_convert()");
+  suite.tests[3].test_func = &test_mesh_convert;
+  suite.tests[3].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    return(1);
+  }
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+  return 0;
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_VX_BVH_H
+#define TEST_VX_BVH_H
+
+int suite_vx_bvh(const char *xmldir);
+
+#endif
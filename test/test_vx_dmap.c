@@ -0,0 +1,324 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include "vx_sub.h"
+#include "vx_site.h"
+#include "vx_dmap.h"
+#include "genmodel.h"
+#include "unittest_defs.h"
+#include "test_genmodel.h"
+#include "test_vx_dmap.h"
+
+/* Node scale of test model */
+#define TEST_DMAP_SCALE 0.5
+
+/* Nodes compared with direct queries */
+#define TEST_DMAP_NODES 40
+
+/* Threads of map builds */
+#define TEST_DMAP_THREADS 4
+
+
+/* Test model and its directory */
+static genmodel_t test_model;
+static char test_model_dir[256];
+
+
+/* Random node index below 'n' */
+size_t test_dmap_rand(size_t n)
+{
+  return((size_t)(n * (rand() / (RAND_MAX + 1.0))));
+}
+
+
+/* Map value of node i, j */
+double test_dmap_node(const vx_dmap_t *map, vx_dmap_layer_t layer,
+		      size_t i, size_t j)
+{
+  return(map->data[(layer * map->dims[1] + j) * map->dims[0] + i]);
+}
+
+
+/* Values agree, NaN included */
+int test_dmap_equal(double a, double b, double tol)
+{
+  if (isnan(a) || isnan(b)) {
+    return(test_assert_int(isnan(a) && isnan(b), 1));
+  }
+  return(test_assert_int(fabs(a - b) <= tol, 1));
+}
+
+
+int test_dmap_build()
+{
+  vx_dmap_spec_t spec;
+  vx_dmap_t map;
+  vx_site_t site;
+  char cache[512];
+  double coor[2], lo, hi, v;
+  float surface;
+  size_t i, j, n;
+  int cached, k, retval = 0;
+
+  printf("Test: depth maps match column queries at the nodes\n");
+
+  vx_dmap_defaults(&spec, test_model_dir);
+  spec.num_threads = TEST_DMAP_THREADS;
+  snprintf(cache, sizeof(cache), "%s/maps.vxd", test_model_dir);
+  if ((test_assert_int(vx_dmap_open(&spec, cache, &map, &cached), 0) != 0) ||
+      (test_assert_int(cached, 0) != 0)) {
+    return(1);
+  }
+  if (test_assert_int(vx_setup(test_model_dir), 0) != 0) {
+    vx_dmap_free(&map);
+    return(1);
+  }
+  vx_setgtl(spec.use_gtl);
+
+  srand(24680);
+  for (n = 0; (n < TEST_DMAP_NODES) && (retval == 0); n++) {
+    i = test_dmap_rand(map.dims[0]);
+    j = test_dmap_rand(map.dims[1]);
+    coor[0] = map.origin[0] + i * map.step[0];
+    coor[1] = map.origin[1] + j * map.step[1];
+
+    memset(&site, 0, sizeof(vx_site_t));
+    site.coor[0] = coor[0];
+    site.coor[1] = coor[1];
+    site.coor_type = VX_COORD_UTM;
+    vx_site_metrics(&site, &(spec.site));
+    vx_getsurface(coor, VX_COORD_UTM, &surface);
+    v = (surface > -90000.0) ?
+      surface - (float)genmodel_base(&test_model, coor[0], coor[1]) : NAN;
+
+    if ((test_dmap_equal(test_dmap_node(&map, VX_DMAP_Z1, i, j), site.z1,
+			 1.0e-3) != 0) ||
+	(test_dmap_equal(test_dmap_node(&map, VX_DMAP_Z25, i, j), site.z25,
+			 1.0e-3) != 0) ||
+	(test_dmap_equal(test_dmap_node(&map, VX_DMAP_BASE, i, j), v,
+			 1.0e-2) != 0)) {
+      printf("Node %zu %zu: z1 %.2f/%.2f z2.5 %.2f/%.2f base %.2f/%.2f\n",
+	     i, j, test_dmap_node(&map, VX_DMAP_Z1, i, j), site.z1,
+	     test_dmap_node(&map, VX_DMAP_Z25, i, j), site.z25,
+	     test_dmap_node(&map, VX_DMAP_BASE, i, j), v);
+      retval = 1;
+      break;
+    }
+    v = test_dmap_node(&map, VX_DMAP_MOHO, i, j);
+    if ((surface > -90000.0) &&
+	(test_assert_int(fabs(v - (surface - test_model.moho)) <= 2001.0,
+			 1) != 0)) {
+      retval = 1;
+      break;
+    }
+
+    /* Lookups within the node cell give the node, interpolation at the
+       node gives the node */
+    for (k = 0; k < VX_DMAP_NUM; k++) {
+      v = test_dmap_node(&map, (vx_dmap_layer_t)k, i, j);
+      if ((test_dmap_equal(vx_dmap_interp(&map, (vx_dmap_layer_t)k, coor,
+					  VX_COORD_UTM), v, 1.0e-3) != 0) ||
+	  (test_dmap_equal(vx_dmap_get(&map, (vx_dmap_layer_t)k, coor,
+				       VX_COORD_UTM), v, 0.0) != 0)) {
+	retval = 1;
+      }
+    }
+    coor[0] += 0.4 * map.step[0];
+    coor[1] -= 0.4 * map.step[1];
+    if (test_dmap_equal(vx_dmap_get(&map, VX_DMAP_BASE, coor, VX_COORD_UTM),
+			test_dmap_node(&map, VX_DMAP_BASE, i, j), 0.0) != 0) {
+      retval = 1;
+    }
+  }
+
+  /* Interpolation lies between the corners of cells in the model */
+  for (n = 0; (n < TEST_DMAP_NODES) && (retval == 0); n++) {
+    i = test_dmap_rand(map.dims[0] - 1);
+    j = test_dmap_rand(map.dims[1] - 1);
+    coor[0] = map.origin[0] + (i + 0.3) * map.step[0];
+    coor[1] = map.origin[1] + (j + 0.6) * map.step[1];
+    lo = INFINITY;
+    hi = -INFINITY;
+    for (k = 0; k < 4; k++) {
+      v = test_dmap_node(&map, VX_DMAP_BASE, i + k % 2, j + k / 2);
+      if (isnan(v)) {
+	break;
+      }
+      lo = fmin(lo, v);
+      hi = fmax(hi, v);
+    }
+    if (k < 4) {
+      continue;
+    }
+    v = vx_dmap_interp(&map, VX_DMAP_BASE, coor, VX_COORD_UTM);
+    if (test_assert_int((v >= lo - 1.0e-3) && (v <= hi + 1.0e-3), 1) != 0) {
+      retval = 1;
+    }
+  }
+
+  /* Points outside the maps are undefined */
+  coor[0] = map.origin[0] - map.step[0];
+  coor[1] = map.origin[1];
+  if ((retval == 0) &&
+      ((test_assert_int(isnan(vx_dmap_get(&map, VX_DMAP_Z1, coor,
+					  VX_COORD_UTM)), 1) != 0) ||
+       (test_assert_int(isnan(vx_dmap_interp(&map, VX_DMAP_Z1, coor,
+					     VX_COORD_UTM)), 1) != 0))) {
+    retval = 1;
+  }
+
+  vx_cleanup();
+  vx_dmap_free(&map);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_dmap_cache()
+{
+  vx_dmap_spec_t spec;
+  vx_dmap_t first, map;
+  struct utimbuf ut;
+  struct stat st;
+  char cache[512], path[512];
+  size_t n;
+  int cached, retval = 0;
+
+  printf("Test: depth maps are cached until the model changes\n");
+
+  vx_dmap_defaults(&spec, test_model_dir);
+  spec.num_threads = TEST_DMAP_THREADS;
+  snprintf(cache, sizeof(cache), "%s/maps.vxd", test_model_dir);
+
+  /* Built by test_dmap_build */
+  if ((test_assert_int(vx_dmap_open(&spec, cache, &first, &cached), 0)
+       != 0) || (test_assert_int(cached, 1) != 0)) {
+    return(1);
+  }
+  n = first.dims[0] * first.dims[1] * VX_DMAP_NUM;
+
+  /* Other settings rebuild */
+  spec.use_gtl = False;
+  if ((test_assert_int(vx_dmap_open(&spec, cache, &map, &cached), 0) != 0) ||
+      (test_assert_int(cached, 0) != 0)) {
+    retval = 1;
+  }
+  vx_dmap_free(&map);
+  spec.use_gtl = True;
+
+  /* A touched model file rebuilds once, to the same maps */
+  snprintf(path, sizeof(path), "%s/base@@", test_model_dir);
+  if ((retval == 0) && (stat(path, &st) == 0)) {
+    ut.actime = st.st_atime;
+    ut.modtime = st.st_mtime + 10;
+    utime(path, &ut);
+    if ((test_assert_int(vx_dmap_open(&spec, cache, &map, &cached), 0)
+	 != 0) || (test_assert_int(cached, 0) != 0) ||
+	(test_assert_int(memcmp(first.data, map.data, n * sizeof(float)),
+			 0) != 0)) {
+      retval = 1;
+    }
+    vx_dmap_free(&map);
+    if ((retval == 0) &&
+	((test_assert_int(vx_dmap_open(&spec, cache, &map, &cached), 0)
+	  != 0) || (test_assert_int(cached, 1) != 0))) {
+      retval = 1;
+    }
+    vx_dmap_free(&map);
+  }
+
+  /* Default cache in the model directory */
+  if ((retval == 0) &&
+      ((test_assert_int(vx_dmap_open(&spec, NULL, &map, &cached), 0) != 0) ||
+       (test_assert_int(cached, 0) != 0))) {
+    retval = 1;
+  }
+  vx_dmap_free(&map);
+  if ((retval == 0) &&
+      ((test_assert_int(vx_dmap_open(&spec, NULL, &map, &cached), 0) != 0) ||
+       (test_assert_int(cached, 1) != 0) ||
+       (test_assert_int(memcmp(first.data, map.data, n * sizeof(float)),
+			0) != 0))) {
+    retval = 1;
+  }
+  vx_dmap_free(&map);
+  vx_dmap_free(&first);
+
+  snprintf(path, sizeof(path), "%s/%s", test_model_dir, VX_DMAP_CACHE);
+  unlink(path);
+  *strrchr(path, '/') = '\0';
+  rmdir(path);
+
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int suite_vx_dmap(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_dmap");
+  suite.num_tests = 2;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Generate test model */
+  strcpy(test_model_dir, "/tmp/vx_dmap.XXXXXX");
+  if (test_genmodel_create(test_model_dir, TEST_DMAP_SCALE,
+			   &test_model) != 0) {
+    return(1);
+  }
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_dmap_build()");
+  suite.tests[0].test_func = &test_dmap_build;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_dmap_cache()");
+  suite.tests[1].test_func = &test_dmap_cache;
+  suite.tests[1].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    test_genmodel_remove(test_model_dir);
+    return(1);
+  }
+  test_genmodel_remove(test_model_dir);
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+  return 0;
+}
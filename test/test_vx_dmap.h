@@ -0,0 +1,6 @@
+#ifndef TEST_VX_DMAP_H
+#define TEST_VX_DMAP_H
+
+int suite_vx_dmap(const char *xmldir);
+
+#endif
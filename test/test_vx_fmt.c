@@ -0,0 +1,257 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "vx_fmt.h"
+#include "unittest_defs.h"
+#include "test_vx_fmt.h"
+
+/* Number of random values checked */
+#define TEST_FMT_NUM 1000000
+
+/* Number of values formatted/parsed per benchmark pass */
+#define TEST_FMT_BENCH 2000000
+
+
+/* Random value in the range seen in vx_lite output */
+double random_fmt_value()
+{
+  double v;
+
+  switch (rand() % 4) {
+  case 0:
+    /* Cell centres and exact binary fractions, hit the rounding ties */
+    v = (double)(rand() % 2000000 - 1000000) / 8.0;
+    break;
+  case 1:
+    v = (double)(rand() % 2000001 - 1000000) / 1000.0;
+    break;
+  case 2:
+    v = ((double)rand() / RAND_MAX - 0.5) * 1.0e7;
+    break;
+  default:
+    v = ((double)rand() / RAND_MAX - 0.5) * 400.0;
+    break;
+  }
+  return(v);
+}
+
+
+int test_fmt_fixed()
+{
+  char buf1[VX_FMT_MAX_LEN + 1];
+  char buf2[VX_FMT_MAX_LEN + 1];
+  double special[] = {0.0, -0.0, 0.005, -0.005, 0.125, 0.375, 2.5, -2.5,
+		      0.0049999999999999999, 1.0e15, -1.0e15, 1.0e300,
+		      -99999.0, 5.0e-324, INFINITY, -INFINITY, NAN};
+  int widths[] = {0, 9, 10, 11, 14, 15};
+  int i, prec;
+  double v;
+
+  printf("Test: vx_fmt_fixed matches printf\n");
+
+  for (i = 0; i < (int)(sizeof(special)/sizeof(double)); i++) {
+    for (prec = 0; prec <= VX_FMT_MAX_PREC; prec++) {
+      vx_fmt_fixed(buf1, special[i], 9, prec);
+      sprintf(buf2, "%9.*f", prec, special[i]);
+      if (strcmp(buf1, buf2) != 0) {
+	printf("FAIL: '%s' != '%s'\n", buf1, buf2);
+	return(1);
+      }
+    }
+  }
+
+  srand(1);
+  for (i = 0; i < TEST_FMT_NUM; i++) {
+    v = random_fmt_value();
+    prec = rand() % (VX_FMT_MAX_PREC + 1);
+    vx_fmt_fixed(buf1, v, widths[i % 6], prec);
+    sprintf(buf2, "%*.*f", widths[i % 6], prec, v);
+    if (strcmp(buf1, buf2) != 0) {
+      printf("FAIL: '%s' != '%s'\n", buf1, buf2);
+      return(1);
+    }
+  }
+
+  for (i = -1000; i <= 1000; i++) {
+    vx_fmt_int(buf1, i * 104729);
+    sprintf(buf2, "%d", i * 104729);
+    if (strcmp(buf1, buf2) != 0) {
+      printf("FAIL: '%s' != '%s'\n", buf1, buf2);
+      return(1);
+    }
+  }
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int test_fmt_parse()
+{
+  char *strs[] = {"0", "-0", "+1.5", "  42", ".5", "5.", "-.25e2", "1e",
+		  "1e+", "3.7e-3x", "1.7976931348623157e308", "4.9e-324",
+		  "12345678901234567890123", "0.1000000000000000055511151231",
+		  "9007199254740993", "1e23", "inf", "-nan", "0x1p3", ".",
+		  "-", "abc", "  -118.56  ", "3602285.140000", "1,5"};
+  char buf[64];
+  char *end1, *end2;
+  double v1, v2;
+  int i;
+
+  printf("Test: vx_parse_double matches strtod\n");
+
+  for (i = 0; i < (int)(sizeof(strs)/sizeof(char *)); i++) {
+    v1 = vx_parse_double(strs[i], &end1);
+    v2 = strtod(strs[i], &end2);
+    if ((end1 != end2) || (memcmp(&v1, &v2, sizeof(double)) != 0)) {
+      if (!(isnan(v1) && isnan(v2) && (end1 == end2))) {
+	printf("FAIL: '%s' parsed as %.17g, expected %.17g\n", 
+	       strs[i], v1, v2);
+	return(1);
+      }
+    }
+  }
+
+  srand(2);
+  for (i = 0; i < TEST_FMT_NUM; i++) {
+    sprintf(buf, "%.*f", rand() % 10, random_fmt_value());
+    v1 = vx_parse_double(buf, &end1);
+    v2 = strtod(buf, &end2);
+    if ((end1 != end2) || (memcmp(&v1, &v2, sizeof(double)) != 0)) {
+      printf("FAIL: '%s' parsed as %.17g, expected %.17g\n", buf, v1, v2);
+      return(1);
+    }
+  }
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int test_fmt_benchmark()
+{
+  double *vals;
+  char *text;
+  char *p, *end;
+  size_t len;
+  clock_t start;
+  double t_printf, t_fmt, t_strtod, t_parse, sum1, sum2;
+  int i;
+
+  printf("Test: vx_fmt benchmark against stdio\n");
+
+  vals = malloc(TEST_FMT_BENCH * sizeof(double));
+  text = malloc((size_t)TEST_FMT_BENCH * 16);
+  if ((vals == NULL) || (text == NULL)) {
+    printf("FAIL: cannot allocate buffers\n");
+    return(1);
+  }
+  srand(3);
+  for (i = 0; i < TEST_FMT_BENCH; i++) {
+    vals[i] = random_fmt_value();
+  }
+
+  /* Formatting */
+  start = clock();
+  for (i = 0, len = 0; i < TEST_FMT_BENCH; i++) {
+    len += sprintf(&text[len], "%9.2f ", vals[i]);
+  }
+  t_printf = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  for (i = 0, len = 0; i < TEST_FMT_BENCH; i++) {
+    len += vx_fmt_fixed(&text[len], vals[i], 9, 2);
+    text[len++] = ' ';
+  }
+  text[len] = '\0';
+  t_fmt = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  /* Parsing */
+  start = clock();
+  for (i = 0, p = text, sum1 = 0.0; i < TEST_FMT_BENCH; i++, p = end) {
+    sum1 += strtod(p, &end);
+  }
+  t_strtod = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  for (i = 0, p = text, sum2 = 0.0; i < TEST_FMT_BENCH; i++, p = end) {
+    sum2 += vx_parse_double(p, &end);
+  }
+  t_parse = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  printf("format %%9.2f: printf %.1f ns, vx_fmt_fixed %.1f ns (%.1fx)\n",
+	 t_printf * 1.0e9 / TEST_FMT_BENCH, t_fmt * 1.0e9 / TEST_FMT_BENCH,
+	 t_printf / (t_fmt > 0.0 ? t_fmt : 1.0e-9));
+  printf("parse: strtod %.1f ns, vx_parse_double %.1f ns (%.1fx)\n",
+	 t_strtod * 1.0e9 / TEST_FMT_BENCH, t_parse * 1.0e9 / TEST_FMT_BENCH,
+	 t_strtod / (t_parse > 0.0 ? t_parse : 1.0e-9));
+
+  free(vals);
+  free(text);
+
+  if (sum1 != sum2) {
+    printf("FAIL: parsed sums differ\n");
+    return(1);
+  }
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int suite_vx_fmt(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_fmt");
+  suite.num_tests = 3;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_fmt_fixed()");
+  suite.tests[0].test_func = &test_fmt_fixed;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_fmt_parse()");
+  suite.tests[1].test_func = &test_fmt_parse;
+  suite.tests[1].elapsed_time = 0.0;
+
+  strcpy(suite.tests[2].test_name, "test_fmt_benchmark()");
+  suite.tests[2].test_func = &test_fmt_benchmark;
+  suite.tests[2].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    return(1);
+  }
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+    
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+
+  return 0;
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_VX_FMT_H
+#define TEST_VX_FMT_H
+
+int suite_vx_fmt(const char *xmldir);
+
+#endif
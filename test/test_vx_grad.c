@@ -0,0 +1,322 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "vx_sub.h"
+#include "vx_stack.h"
+#include "vx_grad.h"
+#include "genmodel.h"
+#include "unittest_defs.h"
+#include "test_genmodel.h"
+#include "test_vx_grad.h"
+
+/* Node scale of test model */
+#define TEST_GRAD_SCALE 0.5
+
+/* Points of each test */
+#define TEST_GRAD_POINTS 2000
+
+/* Offset of the difference check, fraction of a cell */
+#define TEST_GRAD_H 1.0e-3
+
+
+/* Test model directory */
+static char test_model_dir[256];
+
+
+/* Random value in [lo, hi) */
+double test_grad_rand(double lo, double hi)
+{
+  return(lo + (hi - lo) * (rand() / (RAND_MAX + 1.0)));
+}
+
+
+/* Random point of voxet 'vol', away from cell centres and midplanes so
+   small offsets keep the stencil */
+void test_grad_point(const vx_volume_t *vol, double *utm)
+{
+  double f;
+  int k;
+
+  for (k = 0; k < 3; k++) {
+    f = floor(test_grad_rand(0.0, vol->a.N[k] - 1.0));
+    f += (rand() % 2) ? test_grad_rand(0.1, 0.4) : test_grad_rand(0.6, 0.9);
+    utm[k] = vol->a.O[k] + f * vol->step[k];
+  }
+}
+
+
+/* Values agree to relative 'tol' */
+int test_grad_close(double a, double b, double tol)
+{
+  return(test_assert_int(fabs(a - b) <= tol * (1.0 + fabs(a) + fabs(b)),
+			 1));
+}
+
+
+int test_grad_nodes()
+{
+  const vx_stack_t *stack;
+  const vx_volume_t *vol;
+  vx_grad_t g;
+  vx_entry_t entry;
+  int i, k, v, gtl, gcoor[3], retval = 0;
+
+  printf("Test: gradient queries at voxet nodes match point queries\n");
+
+  if (test_assert_int(vx_setup(test_model_dir), 0) != 0) {
+    return(1);
+  }
+  stack = vx_get_stack();
+
+  srand(11235);
+  for (gtl = 0; (gtl < 2) && (retval == 0); gtl++) {
+    vx_setgtl(gtl);
+    for (i = 0; (i < TEST_GRAD_POINTS) && (retval == 0); i++) {
+      v = rand() % stack->num_vols;
+      vol = &(stack->vols[v]);
+      memset(&g, 0, sizeof(vx_grad_t));
+      g.coor_type = VX_COORD_UTM;
+      for (k = 0; k < 3; k++) {
+	g.coor[k] = vol->a.O[k] + (rand() % vol->a.N[k]) * vol->step[k];
+      }
+
+      /* Nodes covered by a voxet of higher priority are not nodes of
+	 the voxet read */
+      if (vx_stack_find(stack, g.coor, gcoor) != v) {
+	continue;
+      }
+      memset(&entry, 0, sizeof(vx_entry_t));
+      memcpy(entry.coor, g.coor, sizeof(double) * 3);
+      entry.coor_type = VX_COORD_UTM;
+      if (vx_getcoord_zmode(&entry, VX_ZMODE_ELEV) != 0) {
+	if (test_assert_int(vx_getgrad(&g), 1) != 0) {
+	  retval = 1;
+	}
+	continue;
+      }
+
+      if ((test_assert_int(vx_getgrad(&g), 0) != 0) ||
+	  (test_assert_int(g.data_src, entry.data_src) != 0) ||
+	  (test_grad_close(g.vp, entry.vp, 1.0e-6) != 0) ||
+	  (test_grad_close(g.vs, entry.vs, 1.0e-6) != 0) ||
+	  (test_grad_close(g.rho, entry.rho, 1.0e-6) != 0)) {
+	printf("Node %.1f %.1f %.1f gtl %d: vp %.3f/%.3f vs %.3f/%.3f\n",
+	       g.coor[0], g.coor[1], g.coor[2], gtl, g.vp, entry.vp, g.vs,
+	       entry.vs);
+	retval = 1;
+      }
+    }
+  }
+
+  vx_cleanup();
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_grad_stencil()
+{
+  const vx_stack_t *stack;
+  const vx_volume_t *vol;
+  vx_grad_t g, p[2], *batch;
+  double h;
+  int i, k, s, num = 0, retval = 0;
+
+  printf("Test: gradients match differences of interpolated values\n");
+
+  batch = malloc(TEST_GRAD_POINTS * sizeof(vx_grad_t));
+  if ((batch == NULL) ||
+      (test_assert_int(vx_setup(test_model_dir), 0) != 0)) {
+    free(batch);
+    return(1);
+  }
+  vx_setgtl(False);
+  stack = vx_get_stack();
+
+  srand(81321);
+  for (i = 0; (i < TEST_GRAD_POINTS) && (retval == 0); i++) {
+    vol = &(stack->vols[rand() % stack->num_vols]);
+    memset(&g, 0, sizeof(vx_grad_t));
+    g.coor_type = VX_COORD_UTM;
+    test_grad_point(vol, g.coor);
+    memcpy(&(batch[i]), &g, sizeof(vx_grad_t));
+    if ((vx_getgrad(&g) != 0) || (!g.interpolated)) {
+      continue;
+    }
+
+    for (k = 0; (k < 3) && (retval == 0); k++) {
+      h = TEST_GRAD_H * fabs(vol->step[k]);
+      for (s = 0; s < 2; s++) {
+	memcpy(&(p[s]), &g, sizeof(vx_grad_t));
+	p[s].coor[k] += (s == 0) ? -h : h;
+	vx_getgrad(&(p[s]));
+      }
+      if (!p[0].interpolated || !p[1].interpolated ||
+	  (p[0].data_src != g.data_src) || (p[1].data_src != g.data_src)) {
+	continue;
+      }
+      if ((test_grad_close((p[1].vp - p[0].vp) / (2.0 * h), g.dvp[k], 1.0e-4)
+	   != 0) ||
+	  (test_grad_close((p[1].vs - p[0].vs) / (2.0 * h), g.dvs[k], 1.0e-4)
+	   != 0) ||
+	  (test_grad_close((p[1].rho - p[0].rho) / (2.0 * h), g.drho[k],
+			   1.0e-3) != 0)) {
+	printf("Point %.3f %.3f %.3f axis %d: dvp %g/%g dvs %g/%g "
+	       "drho %g/%g\n", g.coor[0], g.coor[1], g.coor[2], k,
+	       (p[1].vp - p[0].vp) / (2.0 * h), g.dvp[k],
+	       (p[1].vs - p[0].vs) / (2.0 * h), g.dvs[k],
+	       (p[1].rho - p[0].rho) / (2.0 * h), g.drho[k]);
+	retval = 1;
+      }
+    }
+    num++;
+  }
+
+  /* Most points are read from the voxets */
+  if ((retval == 0) &&
+      (test_assert_int(num > TEST_GRAD_POINTS / 2, 1) != 0)) {
+    retval = 1;
+  }
+
+  /* Batch queries match single queries */
+  vx_getgrad_batch(batch, TEST_GRAD_POINTS);
+  for (i = 0; (i < TEST_GRAD_POINTS) && (retval == 0); i++) {
+    memcpy(&g, &(batch[i]), sizeof(vx_grad_t));
+    vx_getgrad(&g);
+    if (test_assert_int(memcmp(&g, &(batch[i]), sizeof(vx_grad_t)), 0)
+	!= 0) {
+      retval = 1;
+    }
+  }
+
+  vx_cleanup();
+  free(batch);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_grad_fallback()
+{
+  vx_grad_t g;
+  float surface;
+  int k, retval = 0;
+
+  printf("Test: gradients off the voxets from point query differences\n");
+
+  if (test_assert_int(vx_setup(test_model_dir), 0) != 0) {
+    return(1);
+  }
+  vx_setgtl(True);
+
+  /* Vs increases with depth through the GTL of the basin centre */
+  memset(&g, 0, sizeof(vx_grad_t));
+  g.coor_type = VX_COORD_UTM;
+  g.coor[0] = 375000.0;
+  g.coor[1] = 3775000.0;
+  vx_getsurface(g.coor, VX_COORD_UTM, &surface);
+  g.coor[2] = surface - 20.0;
+  if ((test_assert_int(vx_getgrad(&g), 0) != 0) ||
+      (test_assert_int(g.data_src, VX_SRC_GT) != 0) ||
+      (test_assert_int(g.interpolated, 0) != 0) ||
+      (test_assert_int(g.dvs[2] < 0.0, 1) != 0)) {
+    retval = 1;
+  }
+
+  /* Points outside the model fail unless there is a background */
+  g.coor[0] = 10000.0;
+  g.coor[1] = 10000.0;
+  g.coor[2] = -1000.0;
+  if ((retval == 0) &&
+      ((test_assert_int(vx_getgrad(&g), 1) != 0) ||
+       (test_assert_int(isnan(g.vp) && isnan(g.dvp[0]), 1) != 0))) {
+    retval = 1;
+  }
+  vx_register_scec();
+  if ((retval == 0) &&
+      ((test_assert_int(vx_getgrad(&g), 0) != 0) ||
+       (test_assert_int(g.data_src, VX_SRC_BK) != 0))) {
+    retval = 1;
+  }
+  for (k = 0; (k < 3) && (retval == 0); k++) {
+    if (test_assert_int(isfinite(g.dvp[k]), 1) != 0) {
+      retval = 1;
+    }
+  }
+
+  vx_cleanup();
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int suite_vx_grad(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_grad");
+  suite.num_tests = 3;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Generate test model */
+  strcpy(test_model_dir, "/tmp/vx_grad.XXXXXX");
+  if (test_genmodel_create(test_model_dir, TEST_GRAD_SCALE, NULL) != 0) {
+    return(1);
+  }
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_grad_nodes()");
+  suite.tests[0].test_func = &test_grad_nodes;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_grad_stencil()");
+  suite.tests[1].test_func = &test_grad_stencil;
+  suite.tests[1].elapsed_time = 0.0;
+
+  strcpy(suite.tests[2].test_name, "test_grad_fallback()");
+  suite.tests[2].test_func = &test_grad_fallback;
+  suite.tests[2].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    test_genmodel_remove(test_model_dir);
+    return(1);
+  }
+  test_genmodel_remove(test_model_dir);
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+  return 0;
+}
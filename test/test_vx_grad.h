@@ -0,0 +1,6 @@
+#ifndef TEST_VX_GRAD_H
+#define TEST_VX_GRAD_H
+
+int suite_vx_grad(const char *xmldir);
+
+#endif
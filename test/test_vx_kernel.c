@@ -0,0 +1,411 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "vx_sub.h"
+#include "vx_stats.h"
+#include "vx_stack.h"
+#include "genmodel.h"
+#include "unittest_defs.h"
+#include "test_genmodel.h"
+#include "test_vx_kernel.h"
+
+/* Node scale of test model */
+#define TEST_KERNEL_SCALE 0.5
+
+/* Points queried per configuration */
+#define TEST_KERNEL_POINTS 4000
+
+
+/* Test model directory and points */
+static char test_model_dir[256];
+static vx_entry_t test_points[TEST_KERNEL_POINTS];
+
+
+/* Background model that marks every point */
+int test_kernel_bkg(vx_entry_t *entry, vx_request_t req_type)
+{
+  if (req_type == VX_REQUEST_ALL) {
+    entry->vp = 1234.0;
+    entry->vs = 567.0;
+    entry->rho = 890.0;
+    entry->data_src = VX_SRC_BK;
+  }
+  return(0);
+}
+
+
+/* Random coordinate in [lo, hi) */
+double test_kernel_rand(double lo, double hi)
+{
+  return(lo + (hi - lo) * (rand() / (RAND_MAX + 1.0)));
+}
+
+
+/* Random points over and around the generated model. Entries are
+   zeroed so results can be compared with memcmp */
+void test_kernel_points()
+{
+  vx_entry_t *entry;
+  int i;
+
+  srand(4321);
+  memset(test_points, 0, sizeof(test_points));
+  for (i = 0; i < TEST_KERNEL_POINTS; i++) {
+    entry = &(test_points[i]);
+    if (i % 8 == 0) {
+      entry->coor_type = VX_COORD_GEO;
+      entry->coor[0] = test_kernel_rand(-119.3, -116.9);
+      entry->coor[1] = test_kernel_rand(33.3, 35.3);
+    } else {
+      entry->coor_type = VX_COORD_UTM;
+      entry->coor[0] = test_kernel_rand(280000.0, 520000.0);
+      entry->coor[1] = test_kernel_rand(3680000.0, 3920000.0);
+    }
+    if (i % 3 == 0) {
+      entry->coor[2] = test_kernel_rand(-500.0, 500.0);
+    } else {
+      entry->coor[2] = test_kernel_rand(-40000.0, 3000.0);
+    }
+  }
+}
+
+
+/* Compare single, batch and generic queries of the test points under
+   the current settings */
+int test_kernel_compare(const char *config)
+{
+  vx_entry_t *single, *batch, *generic;
+  int i, r1, r2, retval = 0;
+
+  single = malloc(sizeof(test_points));
+  batch = malloc(sizeof(test_points));
+  generic = malloc(sizeof(test_points));
+  if ((single == NULL) || (batch == NULL) || (generic == NULL)) {
+    free(single);
+    free(batch);
+    free(generic);
+    return(1);
+  }
+  memcpy(single, test_points, sizeof(test_points));
+  memcpy(batch, test_points, sizeof(test_points));
+  memcpy(generic, test_points, sizeof(test_points));
+
+  vx_getcoord_batch(batch, TEST_KERNEL_POINTS);
+  for (i = 0; (i < TEST_KERNEL_POINTS) && (retval == 0); i++) {
+    r1 = vx_getcoord(&(single[i]));
+    r2 = vx_getcoord_generic(&(generic[i]));
+    if ((r1 != r2) ||
+	(memcmp(&(single[i]), &(generic[i]), sizeof(vx_entry_t)) != 0) ||
+	(memcmp(&(batch[i]), &(generic[i]), sizeof(vx_entry_t)) != 0)) {
+      fprintf(stderr, "%s: point %f %f %f differs from generic kernel\n",
+	      config, test_points[i].coor[0], test_points[i].coor[1],
+	      test_points[i].coor[2]);
+      retval = 1;
+    }
+  }
+
+  free(single);
+  free(batch);
+  free(generic);
+  return(retval);
+}
+
+
+int test_kernel_configs()
+{
+  vx_zmode_t zmodes[3] = {VX_ZMODE_ELEV, VX_ZMODE_DEPTH, VX_ZMODE_ELEVOFF};
+  char config[128];
+  int z, gtl, bkg;
+
+  printf("Test: specialized kernels match the generic kernel\n");
+
+  if (test_assert_int(vx_setup(test_model_dir), 0) != 0) {
+    return(1);
+  }
+
+  test_kernel_points();
+  for (bkg = 0; bkg < 3; bkg++) {
+    switch (bkg) {
+    case 0:
+      vx_register_bkg(NULL);
+      break;
+    case 1:
+      vx_register_scec();
+      break;
+    default:
+      vx_register_bkg(test_kernel_bkg);
+      break;
+    }
+    for (z = 0; z < 3; z++) {
+      for (gtl = 0; gtl < 2; gtl++) {
+	vx_setzmode(zmodes[z]);
+	vx_setgtl(gtl);
+	sprintf(config, "zmode %d gtl %d bkg %d", zmodes[z], gtl, bkg);
+	if (test_kernel_compare(config) != 0) {
+	  vx_cleanup();
+	  return(1);
+	}
+      }
+    }
+  }
+
+  vx_cleanup();
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+/* Classify UTM point under the current settings */
+vx_path_t test_kernel_path(double x, double y, double z)
+{
+  vx_entry_t entry;
+
+  vx_init_entry(&entry);
+  entry.coor_type = VX_COORD_UTM;
+  entry.coor[0] = x;
+  entry.coor[1] = y;
+  entry.coor[2] = z;
+  return(vx_classify(&entry));
+}
+
+
+int test_kernel_classify()
+{
+  vx_zmode_t zmodes[3] = {VX_ZMODE_ELEV, VX_ZMODE_DEPTH, VX_ZMODE_ELEVOFF};
+  vx_stats_t stats;
+  char config[128];
+  unsigned long long total;
+  int z, gtl, bkg, p;
+
+  printf("Test: batches grouped by query path match the generic kernel\n");
+
+  if (test_assert_int(vx_setup(test_model_dir), 0) != 0) {
+    return(1);
+  }
+
+  /* Path labels */
+  vx_setzmode(VX_ZMODE_DEPTH);
+  if ((test_assert_int(test_kernel_path(400000.0, 3800000.0, 10000.0),
+		       VX_PATH_CORE) != 0) ||
+      (test_assert_int(test_kernel_path(400000.0, 3800000.0, 10.0),
+		       VX_PATH_GTL) != 0) ||
+      (test_assert_int(test_kernel_path(400000.0, 3800000.0, -100.0),
+		       VX_PATH_AIR) != 0) ||
+      (test_assert_int(test_kernel_path(100000.0, 3800000.0, 1000.0),
+		       VX_PATH_NR) != 0) ||
+      (test_assert_int(test_kernel_path(400000.0, 20000000.0, 1000.0),
+		       VX_PATH_NR) != 0)) {
+    vx_cleanup();
+    return(1);
+  }
+  vx_setgtl(False);
+  vx_register_scec();
+  if ((test_assert_int(test_kernel_path(400000.0, 3800000.0, 10.0),
+		       VX_PATH_CORE) != 0) ||
+      (test_assert_int(test_kernel_path(100000.0, 3800000.0, 1000.0),
+		       VX_PATH_BKG) != 0)) {
+    vx_cleanup();
+    return(1);
+  }
+
+  test_kernel_points();
+  vx_setclassify(True);
+  vx_reset_stats();
+  for (bkg = 0; bkg < 3; bkg++) {
+    switch (bkg) {
+    case 0:
+      vx_register_bkg(NULL);
+      break;
+    case 1:
+      vx_register_scec();
+      break;
+    default:
+      vx_register_bkg(test_kernel_bkg);
+      break;
+    }
+    for (z = 0; z < 3; z++) {
+      for (gtl = 0; gtl < 2; gtl++) {
+	vx_setzmode(zmodes[z]);
+	vx_setgtl(gtl);
+	sprintf(config, "classified zmode %d gtl %d bkg %d", zmodes[z], gtl,
+		bkg);
+	if (test_kernel_compare(config) != 0) {
+	  vx_cleanup();
+	  return(1);
+	}
+      }
+    }
+  }
+
+  /* Every batch point is counted in one path */
+  if (vx_get_stats(&stats) == 0) {
+    for (p = 0, total = 0; p < VX_PATH_NUM; p++) {
+      total += stats.path_points[p];
+    }
+    if (test_assert_int(total == 18 * TEST_KERNEL_POINTS, 1) != 0) {
+      vx_cleanup();
+      return(1);
+    }
+  }
+
+  vx_cleanup();
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int test_kernel_simd()
+{
+  vx_zmode_t zmodes[3] = {VX_ZMODE_ELEV, VX_ZMODE_DEPTH, VX_ZMODE_ELEVOFF};
+  char config[128];
+  int simd, z, gtl, classify, retval = 0;
+
+  printf("Test: batch queries match single queries with each SIMD lookup\n");
+
+  if (test_assert_int(vx_setup(test_model_dir), 0) != 0) {
+    return(1);
+  }
+
+  test_kernel_points();
+  vx_register_scec();
+  for (simd = VX_SIMD_SCALAR; (simd <= vx_simd_detect()) && (retval == 0);
+       simd++) {
+    printf("Comparing %s lookup\n", VX_SIMD_NAMES[simd]);
+    if (test_assert_int(vx_simd_select(simd), 0) != 0) {
+      retval = 1;
+      break;
+    }
+    for (z = 0; (z < 3) && (retval == 0); z++) {
+      for (gtl = 0; (gtl < 2) && (retval == 0); gtl++) {
+	for (classify = 0; (classify < 2) && (retval == 0); classify++) {
+	  vx_setzmode(zmodes[z]);
+	  vx_setgtl(gtl);
+	  vx_setclassify(classify);
+	  sprintf(config, "%s zmode %d gtl %d classify %d",
+		  VX_SIMD_NAMES[simd], zmodes[z], gtl, classify);
+	  retval = test_kernel_compare(config);
+	}
+      }
+    }
+  }
+
+  /* Unsupported implementation is rejected */
+  if ((retval == 0) && (vx_simd_detect() < VX_SIMD_AVX512)) {
+    retval = test_assert_int(vx_simd_select(VX_SIMD_AVX512), 1);
+  }
+
+  vx_simd_select(vx_simd_detect());
+  vx_setclassify(False);
+  vx_cleanup();
+
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_kernel_invalid()
+{
+  vx_entry_t entry;
+
+  printf("Test: invalid Z mode fails through the generic kernel\n");
+
+  if (test_assert_int(vx_setup(test_model_dir), 0) != 0) {
+    return(1);
+  }
+
+  vx_init_entry(&entry);
+  entry.coor_type = VX_COORD_UTM;
+  entry.coor[0] = 400000.0;
+  entry.coor[1] = 3800000.0;
+  entry.coor[2] = -1000.0;
+  vx_setzmode((vx_zmode_t)7);
+  if ((test_assert_int(vx_getcoord(&entry), 1) != 0) ||
+      (test_assert_int(vx_getcoord_batch(&entry, 1), 1) != 0)) {
+    vx_cleanup();
+    return(1);
+  }
+
+  /* Cleanup restores the default kernel */
+  vx_cleanup();
+  if ((test_assert_int(vx_setup(test_model_dir), 0) != 0) ||
+      (test_assert_int(vx_getcoord(&entry), 0) != 0)) {
+    return(1);
+  }
+  vx_cleanup();
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int suite_vx_kernel(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_kernel");
+  suite.num_tests = 4;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Generate test model */
+  strcpy(test_model_dir, "/tmp/vx_kernel.XXXXXX");
+  if (test_genmodel_create(test_model_dir, TEST_KERNEL_SCALE, NULL) != 0) {
+    return(1);
+  }
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_kernel_configs()");
+  suite.tests[0].test_func = &test_kernel_configs;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_kernel_invalid()");
+  suite.tests[1].test_func = &test_kernel_invalid;
+  suite.tests[1].elapsed_time = 0.0;
+
+  strcpy(suite.tests[2].test_name, "test_kernel_classify()");
+  suite.tests[2].test_func = &test_kernel_classify;
+  suite.tests[2].elapsed_time = 0.0;
+
+  strcpy(suite.tests[3].test_name, "test_kernel_simd()");
+  suite.tests[3].test_func = &test_kernel_simd;
+  suite.tests[3].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    test_genmodel_remove(test_model_dir);
+    return(1);
+  }
+  test_genmodel_remove(test_model_dir);
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+  return 0;
+}
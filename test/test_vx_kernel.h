@@ -0,0 +1,6 @@
+#ifndef TEST_VX_KERNEL_H
+#define TEST_VX_KERNEL_H
+
+int suite_vx_kernel(const char *xmldir);
+
+#endif
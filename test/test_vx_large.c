@@ -0,0 +1,331 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/statvfs.h>
+#include "vx_sub.h"
+#include "vx_io.h"
+#include "utils.h"
+#include "genmodel.h"
+#include "unittest_defs.h"
+#include "test_vx_large.h"
+
+/* Cells in large volume test, just over 2 GB of floats */
+#define TEST_LARGE_CELLS (((size_t)1 << 29) + ((size_t)1 << 20))
+
+/* LR node counts of large model test, 2.2 GB per property */
+#define TEST_LARGE_NX 1201
+#define TEST_LARGE_NY 1201
+#define TEST_LARGE_NZ 377
+
+/* Memory and disk kept free when deciding whether to run */
+#define TEST_LARGE_MARGIN ((size_t)512 << 20)
+
+/* Directory for large files */
+#define TEST_LARGE_DIR "/tmp"
+
+/* Byte offset of voxel */
+size_t voxbytepos(int *ic, int *gs, int esize);
+
+
+/* Available physical memory in bytes */
+size_t test_large_memory()
+{
+  FILE *fp;
+  char line[256];
+  unsigned long long kb = 0;
+
+  fp = fopen("/proc/meminfo", "r");
+  if (fp != NULL) {
+    while (fgets(line, sizeof(line), fp) != NULL) {
+      if (sscanf(line, "MemAvailable: %llu kB", &kb) == 1) {
+	break;
+      }
+    }
+    fclose(fp);
+  }
+  if (kb == 0) {
+    return((size_t)sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGESIZE));
+  }
+  return((size_t)kb * 1024);
+}
+
+
+/* Returns True if 'mem' bytes of memory and 'disk' bytes in the large
+   file directory are available */
+int test_large_available(size_t mem, size_t disk)
+{
+  struct statvfs vfs;
+
+  if ((sizeof(size_t) < 8) ||
+      (test_large_memory() < mem + TEST_LARGE_MARGIN)) {
+    return(False);
+  }
+  if ((statvfs(TEST_LARGE_DIR, &vfs) != 0) ||
+      ((size_t)vfs.f_bavail * vfs.f_frsize < disk + TEST_LARGE_MARGIN)) {
+    return(False);
+  }
+  return(True);
+}
+
+
+/* Big endian marker value of cell */
+float test_large_marker(size_t cell)
+{
+  return((float)(cell % 1000003) + 0.5);
+}
+
+
+int test_large_offsets()
+{
+  int dims[3] = {2000, 2000, 1000};
+  int ic[3] = {1999, 1999, 999};
+  int small[3] = {3, 2, 1};
+
+  printf("Test: voxel byte offsets beyond 2 GB\n");
+
+  if ((test_assert_int(voxbytepos(ic, dims, 4) ==
+		       ((size_t)2000 * 2000 * 1000 - 1) * 4, 1) != 0) ||
+      (test_assert_int(voxbytepos(small, dims, 4) ==
+		       ((size_t)1 * 2000 * 2000 + 2 * 2000 + 3) * 4, 1) != 0)) {
+    return(1);
+  }
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int test_large_loadvolume()
+{
+  size_t cells[6] = {0, 1, ((size_t)1 << 29) - 1, (size_t)1 << 29,
+		     ((size_t)1 << 29) + 12345, TEST_LARGE_CELLS - 1};
+  char dir[] = TEST_LARGE_DIR "/vx_large.XXXXXX";
+  char path[256];
+  unsigned char c[4], *p;
+  float val, expect;
+  char *buf = NULL;
+  FILE *fp;
+  int i, retval = 1;
+
+  printf("Test: vx_io_loadvolume of volume over 2 GB\n");
+
+  if (!test_large_available(TEST_LARGE_CELLS * sizeof(float), 0)) {
+    printf("SKIP: not enough memory\n");
+    return(0);
+  }
+  if (mkdtemp(dir) == NULL) {
+    return(1);
+  }
+  snprintf(path, sizeof(path), "%s/large@@", dir);
+
+  /* Sparse file with big endian markers around the 2 GB boundary */
+  fp = fopen(path, "wb");
+  if (fp == NULL) {
+    rmdir(dir);
+    return(1);
+  }
+  for (i = 0; i < 6; i++) {
+    val = test_large_marker(cells[i]);
+    p = (unsigned char *)&val;
+    if (vx_system_endian() == VX_BYTEORDER_LSB) {
+      c[0] = p[3]; c[1] = p[2]; c[2] = p[1]; c[3] = p[0];
+    } else {
+      memcpy(c, p, 4);
+    }
+    fseeko(fp, (off_t)cells[i] * 4, SEEK_SET);
+    fwrite(c, 1, 4, fp);
+  }
+  fclose(fp);
+
+  buf = malloc(TEST_LARGE_CELLS * sizeof(float));
+  if ((buf != NULL) &&
+      (vx_io_loadvolume(dir, "large@@", 4, TEST_LARGE_CELLS, buf) == 0)) {
+    retval = 0;
+    for (i = 0; i < 6; i++) {
+      memcpy(&val, &buf[cells[i] * 4], 4);
+      expect = test_large_marker(cells[i]);
+      if (test_assert_float(val, expect) != 0) {
+	retval = 1;
+      }
+    }
+    /* Cells between markers are zero */
+    memcpy(&val, &buf[(cells[3] + 1) * 4], 4);
+    if (test_assert_float(val, 0.0) != 0) {
+      retval = 1;
+    }
+  }
+
+  /* Short file is an error */
+  if ((retval == 0) &&
+      (vx_io_loadvolume(dir, "large@@", 4, TEST_LARGE_CELLS + 1, buf) == 0)) {
+    retval = 1;
+  }
+
+  free(buf);
+  unlink(path);
+  rmdir(dir);
+
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_large_model()
+{
+  genmodel_t model;
+  genmodel_grid_t *lr = &model.lr;
+  genmodel_grid_t *hr = &model.hr;
+  char dir[] = TEST_LARGE_DIR "/vx_large.XXXXXX";
+  char path[512];
+  vx_entry_t entry;
+  float vp, vs, tag;
+  size_t bytes;
+  int ic[3], i, n = 0, retval = 0;
+  const char *files[] = {"CVM_LR.vo", "CVM_LR_vp@@", "CVM_LR_tag@@",
+			 "CVM_LR_vs@@", "CVM_HR.vo", "CVM_HR_vp@@",
+			 "CVM_HR_tag@@", "CVM_HR_vs@@", "CVM_CM.vo",
+			 "CVM_CM_vp@@", "CVM_CM_tag@@", "CVM_CM_vs@@",
+			 "interfaces.vo", "topo_dem@@", "base@@", "moho@@",
+			 "model_top@@", "cvm_vs30_wills.hdr",
+			 "cvm_vs30_wills.mdl"};
+
+  printf("Test: query model with LR volumes over 2 GB\n");
+
+  /* Finer LR voxet, cells past 2 GB are the top layers */
+  genmodel_defaults(&model);
+  lr->step[0] = lr->step[0] * (lr->n[0] - 1) / (TEST_LARGE_NX - 1);
+  lr->step[1] = lr->step[1] * (lr->n[1] - 1) / (TEST_LARGE_NY - 1);
+  lr->step[2] = lr->step[2] * (lr->n[2] - 1) / (TEST_LARGE_NZ - 1);
+  lr->n[0] = TEST_LARGE_NX;
+  lr->n[1] = TEST_LARGE_NY;
+  lr->n[2] = TEST_LARGE_NZ;
+
+  bytes = genmodel_size(&model);
+  if (!test_large_available(bytes, bytes)) {
+    printf("SKIP: not enough memory or disk for %.1f GB model\n",
+	   bytes / 1073741824.0);
+    return(0);
+  }
+  if (mkdtemp(dir) == NULL) {
+    return(1);
+  }
+  if (genmodel_write(&model, dir) != 0) {
+    retval = 1;
+  }
+
+  if ((retval == 0) && (test_assert_int(vx_setup(dir), 0) != 0)) {
+    retval = 1;
+  }
+
+  /* Nodes outside the HR voxet, every other one in the top layers */
+  vx_setgtl(False);
+  for (i = 0; (retval == 0) && (i < 400); i++) {
+    ic[0] = (i * 7919) % TEST_LARGE_NX;
+    ic[1] = (i * 104729) % TEST_LARGE_NY;
+    if (i % 2 == 0) {
+      ic[2] = TEST_LARGE_NZ - 1 - (i % 3);
+    } else {
+      ic[2] = (i * 31) % TEST_LARGE_NZ;
+    }
+    vx_init_entry(&entry);
+    entry.coor_type = VX_COORD_UTM;
+    entry.coor[0] = lr->origin[0] + ic[0] * lr->step[0];
+    entry.coor[1] = lr->origin[1] + ic[1] * lr->step[1];
+    entry.coor[2] = lr->origin[2] + ic[2] * lr->step[2];
+    if ((genmodel_topo(&model, entry.coor[0], entry.coor[1]) ==
+	 GENMODEL_NO_DATA) ||
+	((entry.coor[0] > hr->origin[0] - hr->step[0]) &&
+	 (entry.coor[0] < hr->origin[0] + hr->n[0] * hr->step[0]) &&
+	 (entry.coor[1] > hr->origin[1] - hr->step[1]) &&
+	 (entry.coor[1] < hr->origin[1] + hr->n[1] * hr->step[1]))) {
+      continue;
+    }
+    genmodel_voxel(&model, entry.coor[0], entry.coor[1], entry.coor[2],
+		   &vp, &vs, &tag);
+    vx_getcoord(&entry);
+    if ((test_assert_int(entry.data_src, VX_SRC_LR) != 0) ||
+	(test_assert_float(entry.provenance, tag) != 0) ||
+	(test_assert_float(entry.vp, vp) != 0) ||
+	(test_assert_float(entry.vs, vs) != 0)) {
+      retval = 1;
+    }
+    if (voxbytepos(ic, lr->n, 4) > ((size_t)1 << 31)) {
+      n++;
+    }
+  }
+  vx_cleanup();
+
+  for (i = 0; i < (int)(sizeof(files) / sizeof(char *)); i++) {
+    snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+    unlink(path);
+  }
+  rmdir(dir);
+
+  /* Many nodes checked lie past 2 GB */
+  if ((retval != 0) || (test_assert_int(n > 50, 1) != 0)) {
+    return(1);
+  }
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int suite_vx_large(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_large");
+  suite.num_tests = 3;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_large_offsets()");
+  suite.tests[0].test_func = &test_large_offsets;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_large_loadvolume()");
+  suite.tests[1].test_func = &test_large_loadvolume;
+  suite.tests[1].elapsed_time = 0.0;
+
+  strcpy(suite.tests[2].test_name, "test_large_model()");
+  suite.tests[2].test_func = &test_large_model;
+  suite.tests[2].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    return(1);
+  }
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+  return 0;
+}
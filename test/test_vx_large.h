@@ -0,0 +1,6 @@
+#ifndef TEST_VX_LARGE_H
+#define TEST_VX_LARGE_H
+
+int suite_vx_large(const char *xmldir);
+
+#endif
@@ -0,0 +1,267 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "vx_sub.h"
+#include "vx_mem.h"
+#include "genmodel.h"
+#include "unittest_defs.h"
+#include "test_genmodel.h"
+#include "test_vx_mem.h"
+
+/* Node scale of test model */
+#define TEST_MEM_SCALE 0.5
+
+/* Points per batch */
+#define TEST_MEM_POINTS 5000
+
+/* Bytes of test buffers */
+#define TEST_MEM_BYTES (3 * 1048576 + 17)
+
+
+/* Test model directory */
+static char test_model_dir[256];
+
+/* Backends tested */
+static const char *test_mem_specs[] = {"thp", "huge,prefault",
+				       "prefault,lock", "thp,interleave",
+				       "huge,lock,prefault,interleave"};
+
+#define TEST_MEM_NUM_SPECS (int)(sizeof(test_mem_specs)/sizeof(char *))
+
+
+/* Random coordinate in [lo, hi) */
+double test_mem_rand(double lo, double hi)
+{
+  return(lo + (hi - lo) * (rand() / (RAND_MAX + 1.0)));
+}
+
+
+/* Check report against options and allocated bytes */
+int test_mem_check_report(const vx_mem_report_t *r, const vx_mem_opts_t *o,
+			  unsigned long long bytes)
+{
+  if ((test_assert_int(memcmp(&(r->requested), o, sizeof(vx_mem_opts_t)),
+		       0) != 0) ||
+      (test_assert_int(r->bytes >= bytes, 1) != 0) ||
+      (test_assert_int(r->huge_bytes <= r->bytes, 1) != 0) ||
+      (test_assert_int(r->got.pages <= o->pages, 1) != 0) ||
+      (test_assert_int(r->got.numa <= VX_MEM_NUMA_INTERLEAVE, 1) != 0) ||
+      (test_assert_int(r->got.prefault, o->prefault) != 0) ||
+      (test_assert_int(r->got.lock ? (r->locked_bytes >= r->bytes) :
+		       (r->locked_bytes < r->bytes), 1) != 0) ||
+      (test_assert_int(r->got.lock <= o->lock, 1) != 0) ||
+      (test_assert_int(r->numa_nodes >= 1, 1) != 0)) {
+    return(1);
+  }
+  return(0);
+}
+
+
+int test_mem_alloc()
+{
+  vx_mem_opts_t opts;
+  vx_mem_report_t report;
+  char *buf[2];
+  char text[1024];
+  int i, k;
+
+  printf("Test: buffers of each backend are usable and reported\n");
+
+  /* Parsing */
+  if ((test_assert_int(vx_mem_parse("thp,lock", &opts), 0) != 0) ||
+      (test_assert_int(opts.pages, VX_MEM_PAGES_THP) != 0) ||
+      (test_assert_int(opts.lock, 1) != 0) ||
+      (test_assert_int(opts.prefault, 0) != 0) ||
+      (test_assert_int(vx_mem_parse("none", &opts), 0) != 0) ||
+      (test_assert_int(opts.pages, VX_MEM_PAGES_DEFAULT) != 0) ||
+      (test_assert_int(vx_mem_parse("thp,bogus", &opts), 1) != 0) ||
+      (test_assert_int(vx_mem_parse("replicate", &opts), 1) != 0) ||
+      (test_assert_int(vx_mem_parse("", &opts), 0) != 0)) {
+    return(1);
+  }
+
+  for (i = 0; i < TEST_MEM_NUM_SPECS; i++) {
+    if (test_assert_int(vx_mem_parse(test_mem_specs[i], &opts), 0) != 0) {
+      return(1);
+    }
+    vx_mem_set(&opts);
+    for (k = 0; k < 2; k++) {
+      buf[k] = vx_mem_alloc(TEST_MEM_BYTES);
+      if (test_assert_int(buf[k] != NULL, 1) != 0) {
+	return(1);
+      }
+      memset(buf[k], k + 1, TEST_MEM_BYTES);
+    }
+    vx_mem_get_report(&report);
+    vx_mem_text(&report, text, sizeof(text));
+    printf("%s:\n%s", test_mem_specs[i], text);
+    if ((test_assert_int(buf[0][TEST_MEM_BYTES - 1], 1) != 0) ||
+	(test_assert_int(buf[1][0], 2) != 0) ||
+	(test_assert_int((int)report.buffers, 2) != 0) ||
+	(test_mem_check_report(&report, &opts, 2ULL * TEST_MEM_BYTES) != 0)) {
+      return(1);
+    }
+    vx_mem_free(buf[1]);
+    vx_mem_free(buf[0]);
+  }
+
+  /* Default backend is malloc, still reported, and malloc buffers may
+     be freed */
+  memset(&opts, 0, sizeof(vx_mem_opts_t));
+  vx_mem_set(&opts);
+  buf[0] = vx_mem_alloc(16);
+  vx_mem_get_report(&report);
+  if ((test_assert_int(buf[0] != NULL, 1) != 0) ||
+      (test_assert_int((int)report.buffers, 1) != 0) ||
+      (test_assert_int((int)report.bytes, 16) != 0) ||
+      (test_assert_int((int)report.huge_bytes, 0) != 0)) {
+    return(1);
+  }
+  vx_mem_free(buf[0]);
+  vx_mem_free(malloc(16));
+  vx_mem_free(NULL);
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int test_mem_setup()
+{
+  vx_entry_t *plain, *backed, *entry;
+  vx_mem_opts_t opts;
+  vx_mem_report_t report;
+  int i, k, retval = 0;
+
+  printf("Test: models loaded with each backend give the same results\n");
+
+  plain = malloc(TEST_MEM_POINTS * sizeof(vx_entry_t));
+  backed = malloc(TEST_MEM_POINTS * sizeof(vx_entry_t));
+  if ((plain == NULL) || (backed == NULL) ||
+      (test_assert_int(vx_setup(test_model_dir), 0) != 0)) {
+    free(plain);
+    free(backed);
+    return(1);
+  }
+
+  srand(11235);
+  memset(plain, 0, TEST_MEM_POINTS * sizeof(vx_entry_t));
+  for (i = 0; i < TEST_MEM_POINTS; i++) {
+    entry = &(plain[i]);
+    entry->coor_type = VX_COORD_UTM;
+    entry->coor[0] = test_mem_rand(300000.0, 500000.0);
+    entry->coor[1] = test_mem_rand(3700000.0, 3900000.0);
+    entry->coor[2] = test_mem_rand(-20000.0, 1000.0);
+  }
+  memcpy(backed, plain, TEST_MEM_POINTS * sizeof(vx_entry_t));
+  vx_setzmode(VX_ZMODE_DEPTH);
+  vx_getcoord_batch(plain, TEST_MEM_POINTS);
+
+  /* Default setup allocates with malloc, reported */
+  if ((test_assert_int(vx_get_mem_report(&report), 0) != 0) ||
+      (test_assert_int(report.buffers > 0, 1) != 0) ||
+      (test_assert_int(report.bytes > 0, 1) != 0) ||
+      (test_assert_int((int)report.got.pages, VX_MEM_PAGES_DEFAULT) != 0)) {
+    retval = 1;
+  }
+  vx_cleanup();
+
+  for (k = 0; (k < TEST_MEM_NUM_SPECS) && (retval == 0); k++) {
+    vx_mem_parse(test_mem_specs[k], &opts);
+    if ((test_assert_int(vx_setmem(&opts), 0) != 0) ||
+	(test_assert_int(vx_setup(test_model_dir), 0) != 0)) {
+      retval = 1;
+      break;
+    }
+    vx_setzmode(VX_ZMODE_DEPTH);
+    for (i = 0; i < TEST_MEM_POINTS; i++) {
+      memcpy(backed[i].coor, plain[i].coor, sizeof(double) * 3);
+    }
+    vx_getcoord_batch(backed, TEST_MEM_POINTS);
+    if ((test_assert_int(memcmp(plain, backed,
+				TEST_MEM_POINTS * sizeof(vx_entry_t)),
+			 0) != 0) ||
+	(test_assert_int(vx_get_mem_report(&report), 0) != 0) ||
+	(test_assert_int(report.buffers > 0, 1) != 0) ||
+	(test_mem_check_report(&report, &opts, 1) != 0)) {
+      retval = 1;
+    }
+    vx_cleanup();
+  }
+
+  /* Invalid options, and no report without a model */
+  opts.pages = VX_MEM_PAGES_NUM;
+  if ((retval == 0) &&
+      ((test_assert_int(vx_setmem(&opts), 1) != 0) ||
+       (test_assert_int(vx_get_mem_report(&report), 1) != 0))) {
+    retval = 1;
+  }
+
+  free(plain);
+  free(backed);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int suite_vx_mem(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_mem");
+  suite.num_tests = 2;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Generate test model */
+  strcpy(test_model_dir, "/tmp/vx_mem.XXXXXX");
+  if (test_genmodel_create(test_model_dir, TEST_MEM_SCALE, NULL) != 0) {
+    return(1);
+  }
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_mem_alloc()");
+  suite.tests[0].test_func = &test_mem_alloc;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_mem_setup()");
+  suite.tests[1].test_func = &test_mem_setup;
+  suite.tests[1].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    test_genmodel_remove(test_model_dir);
+    return(1);
+  }
+  test_genmodel_remove(test_model_dir);
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+  return 0;
+}
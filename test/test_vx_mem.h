@@ -0,0 +1,6 @@
+#ifndef TEST_VX_MEM_H
+#define TEST_VX_MEM_H
+
+int suite_vx_mem(const char *xmldir);
+
+#endif
@@ -0,0 +1,406 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "vx_sub.h"
+#include "vx_order.h"
+#include "vx_stats.h"
+#include "genmodel.h"
+#include "unittest_defs.h"
+#include "test_genmodel.h"
+#include "test_vx_order.h"
+
+/* Node scale of test model */
+#define TEST_ORDER_SCALE 0.5
+
+/* Points per batch */
+#define TEST_ORDER_POINTS 20000
+
+/* Side of cube walked by the Hilbert curve */
+#define TEST_ORDER_SIDE 16
+
+
+/* Test model directory */
+static char test_model_dir[256];
+
+
+/* Random coordinate in [lo, hi) */
+double test_order_rand(double lo, double hi)
+{
+  return(lo + (hi - lo) * (rand() / (RAND_MAX + 1.0)));
+}
+
+
+/* Mean distance between consecutive finite points in order 'perm' */
+double test_order_path(const double *xyz, const size_t *perm, size_t n)
+{
+  const double *p, *q;
+  double d, sum = 0.0;
+  size_t i, steps = 0;
+
+  for (i = 1; i < n; i++) {
+    p = &xyz[perm[i - 1] * 3];
+    q = &xyz[perm[i] * 3];
+    d = sqrt((p[0] - q[0]) * (p[0] - q[0]) +
+	     (p[1] - q[1]) * (p[1] - q[1]) +
+	     (p[2] - q[2]) * (p[2] - q[2]));
+    if (isfinite(d)) {
+      sum += d;
+      steps++;
+    }
+  }
+  return(sum / steps);
+}
+
+
+int test_order_keys()
+{
+  unsigned int q[3], *cells;
+  int i, j, n = TEST_ORDER_SIDE * TEST_ORDER_SIDE * TEST_ORDER_SIDE;
+  uint64_t key;
+
+  printf("Test: Morton and Hilbert keys\n");
+
+  /* Morton interleaves x, y, z from the low bit */
+  q[0] = 1;
+  q[1] = q[2] = 0;
+  if (test_assert_int(vx_order_morton(q) == 1, 1) != 0) {
+    return(1);
+  }
+  q[0] = 0;
+  q[1] = 1;
+  if (test_assert_int(vx_order_morton(q) == 2, 1) != 0) {
+    return(1);
+  }
+  q[1] = 0;
+  q[2] = 1;
+  if (test_assert_int(vx_order_morton(q) == 4, 1) != 0) {
+    return(1);
+  }
+  q[0] = q[1] = q[2] = (1U << VX_ORDER_BITS) - 1;
+  if ((test_assert_int(vx_order_morton(q) ==
+		       (1ULL << (3 * VX_ORDER_BITS)) - 1, 1) != 0) ||
+      (test_assert_int(vx_order_hilbert(q) < (1ULL << (3 * VX_ORDER_BITS)),
+		       1) != 0)) {
+    return(1);
+  }
+
+  /* The Hilbert curve walks the cube at the origin in unit steps */
+  cells = malloc(n * 3 * sizeof(unsigned int));
+  if (cells == NULL) {
+    return(1);
+  }
+  memset(cells, 0xFF, n * 3 * sizeof(unsigned int));
+  for (q[2] = 0; q[2] < TEST_ORDER_SIDE; q[2]++) {
+    for (q[1] = 0; q[1] < TEST_ORDER_SIDE; q[1]++) {
+      for (q[0] = 0; q[0] < TEST_ORDER_SIDE; q[0]++) {
+	key = vx_order_hilbert(q);
+	if ((test_assert_int(key < (uint64_t)n, 1) != 0) ||
+	    (test_assert_int(cells[key * 3] == 0xFFFFFFFF, 1) != 0)) {
+	  free(cells);
+	  return(1);
+	}
+	memcpy(&cells[key * 3], q, sizeof(q));
+      }
+    }
+  }
+  for (i = 1; i < n; i++) {
+    for (j = 0, key = 0; j < 3; j++) {
+      key += abs((int)cells[i * 3 + j] - (int)cells[(i - 1) * 3 + j]);
+    }
+    if (test_assert_int((int)key, 1) != 0) {
+      free(cells);
+      return(1);
+    }
+  }
+  free(cells);
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int test_order_sort()
+{
+  double *xyz, *ordered;
+  size_t *perm, *seen, i;
+  double before, after;
+  int order, retval = 0;
+
+  printf("Test: curve order is a permutation with short steps\n");
+
+  xyz = malloc(TEST_ORDER_POINTS * 3 * sizeof(double));
+  perm = malloc(TEST_ORDER_POINTS * sizeof(size_t));
+  seen = calloc(TEST_ORDER_POINTS, sizeof(size_t));
+  ordered = malloc(TEST_ORDER_POINTS * 3 * sizeof(double));
+  if ((xyz == NULL) || (perm == NULL) || (seen == NULL) ||
+      (ordered == NULL)) {
+    free(xyz);
+    free(perm);
+    free(seen);
+    free(ordered);
+    return(1);
+  }
+
+  srand(97531);
+  for (i = 0; i < TEST_ORDER_POINTS; i++) {
+    xyz[i * 3] = test_order_rand(300000.0, 500000.0);
+    xyz[i * 3 + 1] = test_order_rand(3700000.0, 3900000.0);
+    xyz[i * 3 + 2] = test_order_rand(-30000.0, 0.0);
+  }
+  xyz[5] = NAN;
+  xyz[9] = INFINITY;
+
+  for (i = 0; i < TEST_ORDER_POINTS; i++) {
+    perm[i] = i;
+  }
+  before = test_order_path(xyz, perm, TEST_ORDER_POINTS);
+
+  for (order = VX_ORDER_MORTON; (order < VX_ORDER_NUM) && (retval == 0);
+       order++) {
+    memset(seen, 0, TEST_ORDER_POINTS * sizeof(size_t));
+    if (test_assert_int(vx_order_sort(xyz, 3, TEST_ORDER_POINTS, order,
+				      perm), 0) != 0) {
+      retval = 1;
+      break;
+    }
+    for (i = 0; (i < TEST_ORDER_POINTS) && (retval == 0); i++) {
+      if ((test_assert_int(perm[i] < TEST_ORDER_POINTS, 1) != 0) ||
+	  (test_assert_int(seen[perm[i]]++, 0) != 0)) {
+	retval = 1;
+      }
+    }
+
+    after = test_order_path(xyz, perm, TEST_ORDER_POINTS);
+    printf("%s: mean step %.1f m, input order %.1f m\n",
+	   VX_ORDER_NAMES[order], after, before);
+    if ((retval == 0) && (test_assert_int(after < before / 10.0, 1) != 0)) {
+      retval = 1;
+    }
+
+    /* Sorted input is coherent, the random input is not */
+    for (i = 0; (i < TEST_ORDER_POINTS) && (retval == 0); i++) {
+      memcpy(&ordered[i * 3], &xyz[perm[i] * 3], sizeof(double) * 3);
+    }
+    if ((retval == 0) &&
+	((test_assert_int(vx_order_coherence(ordered, 3, TEST_ORDER_POINTS)
+			  >= VX_ORDER_COHERENT, 1) != 0) ||
+	 (test_assert_int(vx_order_coherence(xyz, 3, TEST_ORDER_POINTS)
+			  < VX_ORDER_COHERENT, 1) != 0))) {
+      retval = 1;
+    }
+  }
+
+  free(ordered);
+  free(xyz);
+  free(perm);
+  free(seen);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_order_coherence()
+{
+  double *xyz;
+  int i, n = 4096;
+  int retval = 0;
+
+  printf("Test: coherence of grids, profiles and scattered points\n");
+
+  xyz = malloc(n * 3 * sizeof(double));
+  if (xyz == NULL) {
+    return(1);
+  }
+
+  /* Slice in row order */
+  for (i = 0; i < n; i++) {
+    xyz[i * 3] = 300000.0 + (i % 64) * 1000.0;
+    xyz[i * 3 + 1] = 3700000.0 + (i / 64) * 1000.0;
+    xyz[i * 3 + 2] = -1000.0;
+  }
+  if (test_assert_int(vx_order_coherence(xyz, 3, n) >= VX_ORDER_COHERENT,
+		      1) != 0) {
+    retval = 1;
+  }
+
+  /* Depth profiles */
+  srand(1357);
+  for (i = 0; (i < n) && (retval == 0); i++) {
+    if (i % 200 == 0) {
+      xyz[i * 3] = test_order_rand(300000.0, 500000.0);
+      xyz[i * 3 + 1] = test_order_rand(3700000.0, 3900000.0);
+    } else {
+      xyz[i * 3] = xyz[(i - 1) * 3];
+      xyz[i * 3 + 1] = xyz[(i - 1) * 3 + 1];
+    }
+    xyz[i * 3 + 2] = -(i % 200) * 50.0;
+  }
+  if ((retval == 0) &&
+      (test_assert_int(vx_order_coherence(xyz, 3, n) >= VX_ORDER_COHERENT,
+		       1) != 0)) {
+    retval = 1;
+  }
+
+  /* Scattered points */
+  for (i = 0; i < n * 3; i++) {
+    xyz[i] = test_order_rand(0.0, 100000.0);
+  }
+  if ((retval == 0) &&
+      (test_assert_int(vx_order_coherence(xyz, 3, n) < 0.1, 1) != 0)) {
+    retval = 1;
+  }
+
+  free(xyz);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_order_batch()
+{
+  vx_entry_t *plain, *sorted;
+  vx_stats_t stats;
+  vx_entry_t *entry;
+  int i, order, retval = 0;
+
+  printf("Test: ordered batches return the input order results\n");
+
+  plain = malloc(TEST_ORDER_POINTS * sizeof(vx_entry_t));
+  sorted = malloc(TEST_ORDER_POINTS * sizeof(vx_entry_t));
+  if ((plain == NULL) || (sorted == NULL) ||
+      (test_assert_int(vx_setup(test_model_dir), 0) != 0)) {
+    free(plain);
+    free(sorted);
+    return(1);
+  }
+
+  /* Scattered UTM and geographic points */
+  srand(8642);
+  memset(plain, 0, TEST_ORDER_POINTS * sizeof(vx_entry_t));
+  for (i = 0; i < TEST_ORDER_POINTS; i++) {
+    entry = &(plain[i]);
+    if (i % 4 == 0) {
+      entry->coor_type = VX_COORD_GEO;
+      entry->coor[0] = test_order_rand(-119.0, -117.0);
+      entry->coor[1] = test_order_rand(33.5, 35.0);
+    } else {
+      entry->coor_type = VX_COORD_UTM;
+      entry->coor[0] = test_order_rand(300000.0, 500000.0);
+      entry->coor[1] = test_order_rand(3700000.0, 3900000.0);
+    }
+    entry->coor[2] = test_order_rand(-20000.0, 1000.0);
+  }
+  memcpy(sorted, plain, TEST_ORDER_POINTS * sizeof(vx_entry_t));
+  vx_setzmode(VX_ZMODE_DEPTH);
+  vx_getcoord_batch(plain, TEST_ORDER_POINTS);
+
+  for (order = VX_ORDER_MORTON; (order < VX_ORDER_NUM) && (retval == 0);
+       order++) {
+    vx_reset_stats();
+    if (test_assert_int(vx_setorder(order), 0) != 0) {
+      retval = 1;
+      break;
+    }
+    for (i = 0; i < TEST_ORDER_POINTS; i++) {
+      memcpy(sorted[i].coor, &(plain[i].coor), sizeof(double) * 3);
+    }
+    vx_getcoord_batch(sorted, TEST_ORDER_POINTS);
+    if (test_assert_int(memcmp(plain, sorted,
+			       TEST_ORDER_POINTS * sizeof(vx_entry_t)),
+			0) != 0) {
+      retval = 1;
+    }
+    if ((retval == 0) && (vx_get_stats(&stats) == 0) &&
+	(test_assert_int((int)stats.batch_sorted, 1) != 0)) {
+      retval = 1;
+    }
+  }
+
+  /* Invalid curve */
+  if ((retval == 0) &&
+      (test_assert_int(vx_setorder((vx_order_t)VX_ORDER_NUM), 1) != 0)) {
+    retval = 1;
+  }
+
+  vx_cleanup();
+  free(plain);
+  free(sorted);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int suite_vx_order(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_order");
+  suite.num_tests = 4;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Generate test model */
+  strcpy(test_model_dir, "/tmp/vx_order.XXXXXX");
+  if (test_genmodel_create(test_model_dir, TEST_ORDER_SCALE, NULL) != 0) {
+    return(1);
+  }
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_order_keys()");
+  suite.tests[0].test_func = &test_order_keys;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_order_sort()");
+  suite.tests[1].test_func = &test_order_sort;
+  suite.tests[1].elapsed_time = 0.0;
+
+  strcpy(suite.tests[2].test_name, "test_order_coherence()");
+  suite.tests[2].test_func = &test_order_coherence;
+  suite.tests[2].elapsed_time = 0.0;
+
+  strcpy(suite.tests[3].test_name, "test_order_batch()");
+  suite.tests[3].test_func = &test_order_batch;
+  suite.tests[3].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    test_genmodel_remove(test_model_dir);
+    return(1);
+  }
+  test_genmodel_remove(test_model_dir);
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+  return 0;
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_VX_ORDER_H
+#define TEST_VX_ORDER_H
+
+int suite_vx_order(const char *xmldir);
+
+#endif
@@ -0,0 +1,205 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <unistd.h>
+#include "vx_sub.h"
+#include "vx_rec.h"
+#include "unittest_defs.h"
+#include "test_helper.h"
+#include "test_vx_rec.h"
+
+
+/* Fill entry with distinct values */
+void fill_rec_entry(vx_entry_t *entry)
+{
+  entry->coor[0] = -118.56;
+  entry->coor[1] = 32.55;
+  entry->coor[2] = -2450.0;
+  entry->coor_utm[0] = 353525.18;
+  entry->coor_utm[1] = 3602285.14;
+  entry->elev_cell[0] = 353000.0;
+  entry->elev_cell[1] = 3602000.0;
+  entry->topo = -1114.9;
+  entry->mtop = -1150.0;
+  entry->base = -3000.5;
+  entry->moho = -30000.0;
+  entry->data_src = VX_SRC_LR;
+  entry->vel_cell[0] = 353000.0;
+  entry->vel_cell[1] = 3602000.0;
+  entry->vel_cell[2] = -2400.0;
+  entry->provenance = 2.0;
+  entry->vp = 5575.147461;
+  entry->vs = 3132.099854;
+  entry->rho = 2631.810447;
+}
+
+
+int test_rec_roundtrip()
+{
+  vx_entry_t entry, out;
+  vx_rec_layout_t layout, inlayout;
+  char buf[256];
+  char tmpfile[128];
+  FILE *fp;
+  int order;
+
+  printf("Test: vx_rec header and record round trip\n");
+
+  fill_rec_entry(&entry);
+  sprintf(tmpfile, "test-vx-rec-%d.bin", (int)getpid());
+
+  for (order = VX_BYTEORDER_LSB; order <= VX_BYTEORDER_MSB; order++) {
+    if (test_assert_int(vx_rec_parse_fields("all", order, &layout), 0) 
+	!= 0) {
+      return(1);
+    }
+    if (test_assert_int(layout.record_size, 100) != 0) {
+      return(1);
+    }
+
+    fp = fopen(tmpfile, "w+");
+    if (fp == NULL) {
+      printf("FAIL: cannot open %s\n", tmpfile);
+      return(1);
+    }
+    vx_rec_write_header(fp, &layout);
+    vx_rec_pack(&layout, &entry, buf);
+    fwrite(buf, layout.record_size, 1, fp);
+    rewind(fp);
+
+    if (test_assert_int(vx_rec_read_header(fp, &inlayout), 0) != 0) {
+      fclose(fp);
+      return(1);
+    }
+    if ((test_assert_int(inlayout.byteorder, order) != 0) ||
+	(test_assert_int(inlayout.record_size, layout.record_size) != 0) ||
+	(test_assert_int(fread(buf, inlayout.record_size, 1, fp), 1) != 0)) {
+      fclose(fp);
+      return(1);
+    }
+    fclose(fp);
+    unlink(tmpfile);
+
+    memset(&out, 0, sizeof(vx_entry_t));
+    vx_rec_unpack(&inlayout, buf, &out);
+    if ((test_assert_double(out.coor[0], entry.coor[0]) != 0) ||
+	(test_assert_double(out.coor_utm[1], entry.coor_utm[1]) != 0) ||
+	(test_assert_float(out.moho, entry.moho) != 0) ||
+	(test_assert_int(out.data_src, entry.data_src) != 0) ||
+	(test_assert_float(out.vel_cell[2], entry.vel_cell[2]) != 0) ||
+	(test_assert_float(out.vp, entry.vp) != 0) ||
+	(test_assert_float(out.vs, entry.vs) != 0) ||
+	(test_assert_double(out.rho, entry.rho) != 0)) {
+      return(1);
+    }
+  }
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int test_rec_fields()
+{
+  vx_rec_layout_t layout;
+  vx_entry_t entry, out;
+  char buf[64];
+  double xyz[6];
+  float raw[6] = {1.0, 2.0, 3.0, -4.5, 5.25, -6.0};
+  int i;
+
+  printf("Test: vx_rec field selection and coordinate decoding\n");
+
+  if ((test_assert_int(vx_rec_parse_fields("vp,vs,rho", VX_BYTEORDER_MSB,
+					   &layout), 0) != 0) ||
+      (test_assert_int(layout.num_fields, 3) != 0) ||
+      (test_assert_int(layout.offsets[2], 8) != 0) ||
+      (test_assert_int(layout.record_size, 16) != 0)) {
+    return(1);
+  }
+  if (test_assert_int(vx_rec_parse_fields("vp,bogus", VX_BYTEORDER_MSB,
+					  &layout), 1) != 0) {
+    return(1);
+  }
+
+  /* Subset records carry only the selected values */
+  fill_rec_entry(&entry);
+  vx_rec_parse_fields("src,vs", VX_BYTEORDER_MSB, &layout);
+  vx_rec_pack(&layout, &entry, buf);
+  memset(&out, 0, sizeof(vx_entry_t));
+  vx_rec_unpack(&layout, buf, &out);
+  if ((test_assert_int(out.data_src, VX_SRC_LR) != 0) ||
+      (test_assert_float(out.vs, entry.vs) != 0) ||
+      (test_assert_float(out.vp, 0.0) != 0)) {
+    return(1);
+  }
+
+  /* Byte swapped float triplets */
+  for (i = 0; i < 6; i++) {
+    vx_rec_swap((char *)&raw[i], 4);
+  }
+  vx_rec_decode_coords((char *)raw, 4, 
+		       (vx_system_endian() == VX_BYTEORDER_LSB) ? 
+		       VX_BYTEORDER_MSB : VX_BYTEORDER_LSB, xyz, 2);
+  if ((test_assert_double(xyz[0], 1.0) != 0) ||
+      (test_assert_double(xyz[3], -4.5) != 0) ||
+      (test_assert_double(xyz[5], -6.0) != 0)) {
+    return(1);
+  }
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int suite_vx_rec(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_rec");
+  suite.num_tests = 2;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_rec_roundtrip()");
+  suite.tests[0].test_func = &test_rec_roundtrip;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_rec_fields()");
+  suite.tests[1].test_func = &test_rec_fields;
+  suite.tests[1].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    return(1);
+  }
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+    
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+
+  return 0;
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_VX_REC_H
+#define TEST_VX_REC_H
+
+int suite_vx_rec(const char *xmldir);
+
+#endif
@@ -0,0 +1,287 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <pthread.h>
+#include "vx_sub.h"
+#include "vx_sched.h"
+#include "genmodel.h"
+#include "unittest_defs.h"
+#include "test_genmodel.h"
+#include "test_vx_sched.h"
+
+/* Node scale of test model */
+#define TEST_SCHED_SCALE 0.5
+
+/* Points per batch */
+#define TEST_SCHED_POINTS 20000
+
+/* Tasks of scheduler tests */
+#define TEST_SCHED_TASKS 1000
+
+/* Total cost of scheduler test tasks */
+#define TEST_SCHED_COST (TEST_SCHED_TASKS / 10 * 100.0 + \
+			 TEST_SCHED_TASKS * 9 / 10)
+
+/* Scheduler threads */
+#define TEST_SCHED_THREADS 4
+
+
+/* Test model directory */
+static char test_model_dir[256];
+
+
+/* Task counters */
+typedef struct test_sched_arg_t
+{
+  int *runs;
+  pthread_mutex_t lock;
+  size_t fail_task;
+} test_sched_arg_t;
+
+
+/* Random coordinate in [lo, hi) */
+double test_sched_rand(double lo, double hi)
+{
+  return(lo + (hi - lo) * (rand() / (RAND_MAX + 1.0)));
+}
+
+
+/* Count task runs, failing task 'fail_task'. The first tasks are
+   slow */
+int test_sched_work(size_t task, void *arg)
+{
+  test_sched_arg_t *a = (test_sched_arg_t *)arg;
+  volatile double x = 0.0;
+  int i;
+
+  if (task < TEST_SCHED_TASKS / 10) {
+    for (i = 0; i < 20000; i++) {
+      x += i * 0.5;
+    }
+  }
+  pthread_mutex_lock(&(a->lock));
+  a->runs[task]++;
+  pthread_mutex_unlock(&(a->lock));
+  return(task == a->fail_task);
+}
+
+
+int test_sched_run()
+{
+  test_sched_arg_t arg;
+  vx_sched_report_t report;
+  double cost[TEST_SCHED_TASKS];
+  unsigned long long tasks;
+  int i, k, threads, retval = 0;
+
+  printf("Test: every task runs once, seeded by cost\n");
+
+  arg.runs = malloc(TEST_SCHED_TASKS * sizeof(int));
+  if (arg.runs == NULL) {
+    return(1);
+  }
+  pthread_mutex_init(&(arg.lock), NULL);
+
+  /* The slow tasks are 100 times more expensive */
+  for (i = 0; i < TEST_SCHED_TASKS; i++) {
+    cost[i] = (i < TEST_SCHED_TASKS / 10) ? 100.0 : 1.0;
+  }
+
+  for (threads = 1; (threads <= TEST_SCHED_THREADS) && (retval == 0);
+       threads++) {
+    for (k = 0; (k < 2) && (retval == 0); k++) {
+      memset(arg.runs, 0, TEST_SCHED_TASKS * sizeof(int));
+      arg.fail_task = (k == 0) ? TEST_SCHED_TASKS : 17;
+      if (test_assert_int(vx_sched_run(TEST_SCHED_TASKS, threads,
+				       (k == 0) ? cost : NULL,
+				       test_sched_work, &arg, &report),
+			  k) != 0) {
+	retval = 1;
+	break;
+      }
+      for (i = 0; (i < TEST_SCHED_TASKS) && (retval == 0); i++) {
+	if (test_assert_int(arg.runs[i], 1) != 0) {
+	  retval = 1;
+	}
+      }
+      for (i = 0, tasks = 0; i < report.num_threads; i++) {
+	tasks += report.threads[i].tasks;
+      }
+      if ((retval == 0) &&
+	  ((test_assert_int(report.num_threads, threads) != 0) ||
+	   (test_assert_int((int)tasks, TEST_SCHED_TASKS) != 0))) {
+	retval = 1;
+      }
+
+      /* Seeded costs are within one slow task of an equal share */
+      for (i = 0; (i < report.num_threads) && (retval == 0) && (k == 0);
+	   i++) {
+	if (test_assert_int(fabs(report.threads[i].seeded_cost -
+				 TEST_SCHED_COST / threads) <= 100.0,
+			    1) != 0) {
+	  retval = 1;
+	}
+      }
+    }
+  }
+
+  /* No tasks */
+  if ((retval == 0) &&
+      ((test_assert_int(vx_sched_run(0, TEST_SCHED_THREADS, NULL,
+				     test_sched_work, &arg, &report), 0) != 0) ||
+       (test_assert_int((int)report.num_tasks, 0) != 0))) {
+    retval = 1;
+  }
+
+  pthread_mutex_destroy(&(arg.lock));
+  free(arg.runs);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_sched_parallel()
+{
+  vx_entry_t *plain, *parallel, *entry;
+  vx_sched_report_t report;
+  unsigned long long tasks;
+  char text[8192];
+  int i, threads, retval = 0;
+
+  printf("Test: parallel batches match serial batches\n");
+
+  plain = malloc(TEST_SCHED_POINTS * sizeof(vx_entry_t));
+  parallel = malloc(TEST_SCHED_POINTS * sizeof(vx_entry_t));
+  if ((plain == NULL) || (parallel == NULL) ||
+      (test_assert_int(vx_setup(test_model_dir), 0) != 0)) {
+    free(plain);
+    free(parallel);
+    return(1);
+  }
+
+  /* Skewed batch: the second half is outside the model, where points
+     fall to the background */
+  srand(24680);
+  memset(plain, 0, TEST_SCHED_POINTS * sizeof(vx_entry_t));
+  for (i = 0; i < TEST_SCHED_POINTS; i++) {
+    entry = &(plain[i]);
+    entry->coor_type = VX_COORD_UTM;
+    if (i < TEST_SCHED_POINTS / 2) {
+      entry->coor[0] = test_sched_rand(300000.0, 500000.0);
+      entry->coor[1] = test_sched_rand(3700000.0, 3900000.0);
+    } else {
+      entry->coor[0] = test_sched_rand(0.0, 100000.0);
+      entry->coor[1] = test_sched_rand(0.0, 100000.0);
+    }
+    entry->coor[2] = test_sched_rand(-20000.0, 1000.0);
+  }
+  memcpy(parallel, plain, TEST_SCHED_POINTS * sizeof(vx_entry_t));
+  vx_setzmode(VX_ZMODE_DEPTH);
+  vx_register_scec();
+  vx_getcoord_batch(plain, TEST_SCHED_POINTS);
+
+  /* Costs follow the query path */
+  if (test_assert_int(vx_sched_cost(&(parallel[TEST_SCHED_POINTS - 64]), 64)
+		      > vx_sched_cost(parallel, 64), 1) != 0) {
+    retval = 1;
+  }
+
+  for (threads = 1; (threads <= TEST_SCHED_THREADS) && (retval == 0);
+       threads++) {
+    for (i = 0; i < TEST_SCHED_POINTS; i++) {
+      memcpy(parallel[i].coor, plain[i].coor, sizeof(double) * 3);
+    }
+    vx_getcoord_parallel(parallel, TEST_SCHED_POINTS, threads, &report);
+    if (test_assert_int(memcmp(plain, parallel,
+			       TEST_SCHED_POINTS * sizeof(vx_entry_t)),
+			0) != 0) {
+      retval = 1;
+    }
+    for (i = 0, tasks = 0; i < report.num_threads; i++) {
+      tasks += report.threads[i].tasks;
+    }
+    if ((retval == 0) &&
+	(test_assert_int((int)tasks, (TEST_SCHED_POINTS + VX_SCHED_CHUNK - 1)
+			 / VX_SCHED_CHUNK) != 0)) {
+      retval = 1;
+    }
+  }
+
+  if ((retval == 0) &&
+      (test_assert_int(vx_sched_text(&report, text, sizeof(text)) > 0,
+		       1) != 0)) {
+    retval = 1;
+  }
+
+  vx_cleanup();
+  free(plain);
+  free(parallel);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int suite_vx_sched(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_sched");
+  suite.num_tests = 2;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Generate test model */
+  strcpy(test_model_dir, "/tmp/vx_sched.XXXXXX");
+  if (test_genmodel_create(test_model_dir, TEST_SCHED_SCALE, NULL) != 0) {
+    return(1);
+  }
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_sched_run()");
+  suite.tests[0].test_func = &test_sched_run;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_sched_parallel()");
+  suite.tests[1].test_func = &test_sched_parallel;
+  suite.tests[1].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    test_genmodel_remove(test_model_dir);
+    return(1);
+  }
+  test_genmodel_remove(test_model_dir);
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+  return 0;
+}
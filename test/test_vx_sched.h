@@ -0,0 +1,6 @@
+#ifndef TEST_VX_SCHED_H
+#define TEST_VX_SCHED_H
+
+int suite_vx_sched(const char *xmldir);
+
+#endif
@@ -0,0 +1,402 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include "vx_sdf.h"
+#include "genmodel.h"
+#include "unittest_defs.h"
+#include "test_genmodel.h"
+#include "test_vx_sdf.h"
+
+/* Node scale of test model */
+#define TEST_SDF_SCALE 0.5
+
+/* Random points per check */
+#define TEST_SDF_POINTS 2000
+
+/* Tilted plane z = TEST_SDF_DIP * x + TEST_SDF_Z0 over 0 to 10 km */
+#define TEST_SDF_DIP 0.05
+#define TEST_SDF_Z0 -2000.0
+
+
+/* Test model and its files */
+static char test_model_dir[256];
+static char test_plane[256];
+static char test_cache[256];
+static genmodel_t test_model;
+
+
+/* Random coordinate in [lo, hi) */
+double test_sdf_rand(double lo, double hi)
+{
+  return(lo + (hi - lo) * (rand() / (RAND_MAX + 1.0)));
+}
+
+
+/* Surface and grid of a height spec of interface 'name' */
+void test_sdf_height_spec(vx_sdf_spec_t *spec, const char *name)
+{
+  memset(spec, 0, sizeof(vx_sdf_spec_t));
+  spec->kind = VX_SDF_HEIGHT;
+  snprintf(spec->source, VX_SDF_PATH, "%s/interfaces.vo:%s",
+	   test_model_dir, name);
+  spec->step[0] = spec->step[1] = 1000.0;
+  spec->num_samples = VX_SDF_SAMPLES;
+  spec->num_threads = 2;
+}
+
+
+/* Flip the sign of the first node of interface data file 'file' and
+   date it 10 s later, as an edit of the model. Flipping twice restores
+   the data */
+int test_sdf_edit(const char *file)
+{
+  char path[512];
+  struct stat st;
+  struct utimbuf ut;
+  unsigned char b;
+  FILE *fp;
+  int retval = 0;
+
+  snprintf(path, sizeof(path), "%s/%s", test_model_dir, file);
+  if (stat(path, &st) != 0) {
+    return(1);
+  }
+  fp = fopen(path, "r+b");
+  if (fp == NULL) {
+    return(1);
+  }
+  /* Property files are big endian, sign bit in the first byte */
+  if ((fread(&b, 1, 1, fp) != 1) || (fseek(fp, 0, SEEK_SET) != 0)) {
+    retval = 1;
+  }
+  b ^= 0x80;
+  if ((retval == 0) && (fwrite(&b, 1, 1, fp) != 1)) {
+    retval = 1;
+  }
+  fclose(fp);
+  ut.actime = st.st_atime;
+  ut.modtime = st.st_mtime + 10;
+  if ((retval == 0) && (utime(path, &ut) != 0)) {
+    retval = 1;
+  }
+  return(retval);
+}
+
+
+int test_sdf_sample()
+{
+  vx_sdf_spec_t spec;
+  vx_sdf_t sdf;
+  vx_mesh_t mesh;
+  vx_bvh_t bvh;
+  double p[3], d;
+  int i, retval = 0;
+
+  printf("Test: grids sample the exact distances\n");
+
+  /* Signed distances to a plane are linear, and so exact in a volume */
+  memset(&spec, 0, sizeof(vx_sdf_spec_t));
+  snprintf(spec.source, VX_SDF_PATH, "%s", test_plane);
+  spec.kind = VX_SDF_VOLUME;
+  spec.max[0] = spec.max[1] = 10000.0;
+  spec.min[2] = -3000.0;
+  spec.max[2] = 0.0;
+  spec.step[0] = spec.step[1] = spec.step[2] = 500.0;
+  spec.num_samples = VX_SDF_SAMPLES;
+  spec.num_threads = 2;
+  if (test_assert_int(vx_sdf_open(&spec, NULL, &sdf, NULL), 0) != 0) {
+    return(1);
+  }
+  if ((test_assert_int((int)sdf.dims[2], 7) != 0) ||
+      (test_assert_int(isfinite(sdf.max_err), 1) != 0)) {
+    retval = 1;
+  }
+  srand(31415);
+  for (i = 0; (i < TEST_SDF_POINTS) && (retval == 0); i++) {
+    p[0] = test_sdf_rand(1000.0, 9000.0);
+    p[1] = test_sdf_rand(1000.0, 9000.0);
+    p[2] = test_sdf_rand(-3000.0, 0.0);
+    d = (p[2] - TEST_SDF_DIP * p[0] - TEST_SDF_Z0) /
+      sqrt(1.0 + TEST_SDF_DIP * TEST_SDF_DIP);
+    if (test_assert_int(fabs(vx_sdf_sample(&sdf, p) - d) < 0.01, 1) != 0) {
+      retval = 1;
+    }
+  }
+  p[2] = 100.0;
+  if ((retval == 0) && (test_assert_int(isnan(vx_sdf_sample(&sdf, p)), 1)
+			!= 0)) {
+    retval = 1;
+  }
+  vx_sdf_free(&sdf);
+
+  /* Basement height grid against the model and the triangulated
+     interface */
+  test_sdf_height_spec(&spec, "base");
+  if ((retval != 0) ||
+      (test_assert_int(vx_sdf_open(&spec, NULL, &sdf, NULL), 0) != 0)) {
+    return(1);
+  }
+  if ((test_assert_int(vx_mesh_load(spec.source, &mesh), 0) != 0) ||
+      (test_assert_int(vx_bvh_build(&mesh, &bvh), 0) != 0)) {
+    vx_sdf_free(&sdf);
+    return(1);
+  }
+  vx_mesh_free(&mesh);
+  if ((test_assert_int((int)sdf.dims[2], 1) != 0) ||
+      (test_assert_int(isfinite(sdf.max_err), 1) != 0)) {
+    retval = 1;
+  }
+  for (i = 0; (i < TEST_SDF_POINTS) && (retval == 0); i++) {
+    p[0] = test_sdf_rand(test_model.topo.origin[0], test_model.topo.origin[0] +
+			 (test_model.topo.n[0] - 1) * test_model.topo.step[0]);
+    p[1] = test_sdf_rand(test_model.topo.origin[1], test_model.topo.origin[1] +
+			 (test_model.topo.n[1] - 1) * test_model.topo.step[1]);
+    p[2] = test_sdf_rand(-10000.0, 1000.0);
+    if (test_assert_int(fabs(vx_sdf_sample(&sdf, p) -
+			     vx_sdf_exact(VX_SDF_HEIGHT, &bvh, p)) <=
+			sdf.max_err * 2.0 + 0.01, 1) != 0) {
+      retval = 1;
+    }
+  }
+
+  /* Model nodes are grid nodes */
+  for (i = 0; (i < TEST_SDF_POINTS) && (retval == 0); i++) {
+    p[0] = test_model.topo.origin[0] +
+      (rand() % test_model.topo.n[0]) * test_model.topo.step[0];
+    p[1] = test_model.topo.origin[1] +
+      (rand() % test_model.topo.n[1]) * test_model.topo.step[1];
+    p[2] = 0.0;
+    if (test_assert_int(fabs(vx_sdf_sample(&sdf, p) +
+			     genmodel_base(&test_model, p[0], p[1])) < 0.01,
+			1) != 0) {
+      retval = 1;
+    }
+  }
+  vx_bvh_free(&bvh);
+  vx_sdf_free(&sdf);
+
+  /* No heights in the topo gap */
+  test_sdf_height_spec(&spec, "topo");
+  if ((retval != 0) ||
+      (test_assert_int(vx_sdf_open(&spec, NULL, &sdf, NULL), 0) != 0)) {
+    return(1);
+  }
+  p[0] = (test_model.gap[0] + test_model.gap[1]) / 2.0;
+  p[1] = (test_model.gap[2] + test_model.gap[3]) / 2.0;
+  p[2] = 0.0;
+  if (test_assert_int(isnan(vx_sdf_sample(&sdf, p)), 1) != 0) {
+    retval = 1;
+  }
+  vx_sdf_free(&sdf);
+
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_sdf_cache()
+{
+  vx_sdf_spec_t spec;
+  vx_sdf_t built, cached;
+  vx_bvh_t bvh;
+  char key[VX_SDF_PATH + 64];
+  char bvh_cache[512];
+  uint64_t sum, other;
+  FILE *fp;
+  size_t n;
+  int from_cache, retval = 0;
+
+  printf("Test: grids are cached until their spec or surface changes\n");
+
+  test_sdf_height_spec(&spec, "moho");
+  if ((test_assert_int(vx_sdf_open(&spec, test_cache, &built, &from_cache),
+		       0) != 0) ||
+      (test_assert_int(from_cache, 0) != 0)) {
+    return(1);
+  }
+  if ((test_assert_int(vx_sdf_open(&spec, test_cache, &cached, &from_cache),
+		       0) != 0) ||
+      (test_assert_int(from_cache, 1) != 0)) {
+    vx_sdf_free(&built);
+    return(1);
+  }
+  n = built.dims[0] * built.dims[1] * built.dims[2];
+  if ((test_assert_int(memcmp(built.dims, cached.dims, sizeof(built.dims)),
+		       0) != 0) ||
+      (test_assert_double(built.max_err, cached.max_err) != 0) ||
+      (test_assert_int(memcmp(built.data, cached.data, n * sizeof(float)),
+		       0) != 0)) {
+    retval = 1;
+  }
+  vx_sdf_free(&cached);
+
+  /* Other keys do not match, any key does */
+  vx_sdf_key(&spec, key, sizeof(key));
+  if ((retval == 0) &&
+      ((test_assert_int(vx_sdf_read(test_cache, &cached, "other"), 1) != 0) ||
+       (test_assert_int(vx_sdf_read(test_cache, &cached, key), 0) != 0))) {
+    retval = 1;
+  }
+  vx_sdf_free(&cached);
+  if ((retval == 0) &&
+      (test_assert_int(vx_sdf_read(test_cache, &cached, NULL), 0) != 0)) {
+    retval = 1;
+  }
+  vx_sdf_free(&cached);
+
+  /* New spacing rebuilds */
+  spec.step[0] = 2000.0;
+  if ((retval == 0) &&
+      ((test_assert_int(vx_sdf_open(&spec, test_cache, &cached, &from_cache),
+			0) != 0) ||
+       (test_assert_int(from_cache, 0) != 0) ||
+       (test_assert_int((int)cached.dims[0],
+			(int)(built.dims[0] + 1) / 2) != 0))) {
+    retval = 1;
+  }
+  vx_sdf_free(&cached);
+
+  /* An edited interface data file rebuilds */
+  if ((retval == 0) &&
+      ((test_assert_int(vx_sdf_open(&spec, test_cache, &cached, &from_cache),
+			0) != 0) ||
+       (test_assert_int(from_cache, 1) != 0))) {
+    retval = 1;
+  }
+  vx_sdf_free(&cached);
+  if ((retval == 0) &&
+      ((test_assert_int(test_sdf_edit("moho@@"), 0) != 0) ||
+       (test_assert_int(vx_sdf_open(&spec, test_cache, &cached, &from_cache),
+			0) != 0) ||
+       (test_assert_int(from_cache, 0) != 0))) {
+    retval = 1;
+  }
+  vx_sdf_free(&cached);
+  test_sdf_edit("moho@@");
+  vx_sdf_free(&built);
+
+  /* Truncated files are rejected */
+  fp = fopen(test_cache, "r+");
+  if ((fp == NULL) || (ftruncate(fileno(fp), 300) != 0)) {
+    retval = 1;
+  }
+  if (fp != NULL) {
+    fclose(fp);
+  }
+  if ((retval == 0) &&
+      (test_assert_int(vx_sdf_read(test_cache, &cached, NULL), 1) != 0)) {
+    retval = 1;
+  }
+  unlink(test_cache);
+
+  /* Hierarchies of voxet interfaces follow the interface data file */
+  snprintf(bvh_cache, sizeof(bvh_cache), "%s/moho.bvh", test_model_dir);
+  memset(&bvh, 0, sizeof(vx_bvh_t));
+  if ((retval == 0) &&
+      ((test_assert_int(vx_bvh_load(spec.source, bvh_cache, &bvh,
+				    &from_cache), 0) != 0) ||
+       (test_assert_int(from_cache, 0) != 0) ||
+       (test_assert_int(vx_mesh_checksum(spec.source, &sum), 0) != 0))) {
+    retval = 1;
+  }
+  vx_bvh_free(&bvh);
+  if ((retval == 0) &&
+      ((test_assert_int(test_sdf_edit("moho@@"), 0) != 0) ||
+       (test_assert_int(vx_mesh_checksum(spec.source, &other), 0) != 0) ||
+       (test_assert_int(sum != other, 1) != 0) ||
+       (test_assert_int(vx_bvh_load(spec.source, bvh_cache, &bvh,
+				    &from_cache), 0) != 0) ||
+       (test_assert_int(from_cache, 0) != 0))) {
+    retval = 1;
+  }
+  vx_bvh_free(&bvh);
+  test_sdf_edit("moho@@");
+  unlink(bvh_cache);
+
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int suite_vx_sdf(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_sdf");
+  suite.num_tests = 2;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Generate test model and plane */
+  strcpy(test_model_dir, "/tmp/vx_sdf.XXXXXX");
+  if (test_genmodel_create(test_model_dir, TEST_SDF_SCALE,
+			   &test_model) != 0) {
+    return(1);
+  }
+  sprintf(test_plane, "%s/plane.ts", test_model_dir);
+  sprintf(test_cache, "%s/grid.sdf", test_model_dir);
+  lf = fopen(test_plane, "w");
+  if (lf == NULL) {
+    test_genmodel_remove(test_model_dir);
+    return(1);
+  }
+  fprintf(lf, "GOCAD TSurf 1\nTFACE\nVRTX 1 0 0 %f\nVRTX 2 10000 0 %f\n"
+	  "VRTX 3 10000 10000 %f\nVRTX 4 0 10000 %f\n"
+	  "TRGL 1 2 3\nTRGL 1 3 4\nEND\n", TEST_SDF_Z0,
+	  TEST_SDF_Z0 + TEST_SDF_DIP * 10000.0,
+	  TEST_SDF_Z0 + TEST_SDF_DIP * 10000.0, TEST_SDF_Z0);
+  fclose(lf);
+  lf = NULL;
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_sdf_sample()");
+  suite.tests[0].test_func = &test_sdf_sample;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_sdf_cache()");
+  suite.tests[1].test_func = &test_sdf_cache;
+  suite.tests[1].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    test_genmodel_remove(test_model_dir);
+    return(1);
+  }
+  test_genmodel_remove(test_model_dir);
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+  return 0;
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_VX_SDF_H
+#define TEST_VX_SDF_H
+
+int suite_vx_sdf(const char *xmldir);
+
+#endif
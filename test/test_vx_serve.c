@@ -0,0 +1,312 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <unistd.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "vx_sub.h"
+#include "vx_serve.h"
+#include "unittest_defs.h"
+#include "test_vx_serve.h"
+
+/* Number of points per test query */
+#define TEST_SERVE_POINTS 100
+
+/* Number of latencies per histogram distribution */
+#define TEST_SERVE_LATENCIES 100000
+
+
+/* Minimal server answering one HELLO, one QUERY and one STATS. HELLO
+   accepts the current directory by absolute path. The query result
+   echoes the point with vp set to the point index and vs set to the
+   request flags */
+void *test_serve_server(void *arg)
+{
+  int fd = *(int *)arg;
+  vx_serve_req_t req;
+  vx_serve_point_t points[TEST_SERVE_POINTS];
+  vx_entry_t entries[TEST_SERVE_POINTS];
+  char buf[PATH_MAX];
+  char model[PATH_MAX];
+  int i;
+
+  /* HELLO */
+  if ((realpath(".", model) == NULL) ||
+      (vx_serve_read(fd, &req, sizeof(req)) != 0) || 
+      (req.op != VX_SERVE_HELLO) || (req.len >= PATH_MAX) ||
+      (vx_serve_read(fd, buf, req.len) != 0)) {
+    return(NULL);
+  }
+  buf[req.len] = '\0';
+  vx_serve_send_response(fd, ((strcmp(buf, model) == 0) ? 
+			      VX_SERVE_OK : VX_SERVE_ERROR), 0, NULL, 0);
+
+  /* QUERY */
+  if ((vx_serve_read(fd, &req, sizeof(req)) != 0) || 
+      (req.op != VX_SERVE_QUERY) || (req.count > TEST_SERVE_POINTS) ||
+      (req.entry_size != sizeof(vx_entry_t)) ||
+      (vx_serve_read(fd, points, req.len) != 0)) {
+    return(NULL);
+  }
+  for (i = 0; i < req.count; i++) {
+    vx_init_entry(&entries[i]);
+    memcpy(entries[i].coor, points[i].coor, sizeof(double) * 3);
+    entries[i].coor_type = points[i].coor_type;
+    entries[i].vp = i;
+    entries[i].vs = req.flags + req.zmode * 10;
+  }
+  vx_serve_send_response(fd, VX_SERVE_OK, req.count, entries,
+			 req.count * sizeof(vx_entry_t));
+
+  /* STATS */
+  if ((vx_serve_read(fd, &req, sizeof(req)) != 0) || 
+      (req.op != VX_SERVE_STATS)) {
+    return(NULL);
+  }
+  vx_serve_send_response(fd, VX_SERVE_OK, 0, "points 100\n", 11);
+  return(NULL);
+}
+
+
+int test_serve_query()
+{
+  int fds[2];
+  pthread_t server;
+  vx_serve_point_t points[TEST_SERVE_POINTS];
+  vx_entry_t entries[TEST_SERVE_POINTS];
+  char text[64];
+  int i, retval = 0;
+
+  printf("Test: vx_serve request/response framing\n");
+
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    printf("FAIL: cannot create socket pair\n");
+    return(1);
+  }
+  pthread_create(&server, NULL, test_serve_server, &fds[1]);
+
+  for (i = 0; i < TEST_SERVE_POINTS; i++) {
+    points[i].coor[0] = 350000.0 + i;
+    points[i].coor[1] = 3750000.0;
+    points[i].coor[2] = -i;
+    points[i].coor_type = VX_COORD_UTM;
+  }
+
+  if ((test_assert_int(vx_serve_check_peer(fds[0]), 0) != 0) ||
+      (test_assert_int(vx_serve_hello(fds[0], "."), 0) != 0) ||
+      (test_assert_int(vx_serve_query(fds[0], VX_ZMODE_DEPTH, 
+				      VX_SERVE_SCEC, points, 
+				      TEST_SERVE_POINTS, entries), 0) != 0)) {
+    retval = 1;
+  }
+  for (i = 0; (retval == 0) && (i < TEST_SERVE_POINTS); i++) {
+    if ((test_assert_double(entries[i].coor[0], points[i].coor[0]) != 0) ||
+	(test_assert_int(entries[i].coor_type, VX_COORD_UTM) != 0) ||
+	(test_assert_float(entries[i].vp, i) != 0) ||
+	(test_assert_float(entries[i].vs, 12.0) != 0)) {
+      retval = 1;
+    }
+  }
+  if ((retval == 0) &&
+      ((test_assert_int(vx_serve_command(fds[0], VX_SERVE_STATS, text, 
+					 sizeof(text)), 0) != 0) ||
+       (strcmp(text, "points 100\n") != 0))) {
+    retval = 1;
+  }
+
+  close(fds[0]);
+  pthread_join(server, NULL);
+  close(fds[1]);
+
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_serve_reject()
+{
+  int fds[2];
+  pthread_t server;
+  char path[VX_SERVE_MAX_PATH];
+  char longpath[VX_SERVE_MAX_PATH + 1];
+  int retval = 0;
+
+  printf("Test: vx_serve rejects wrong model and bad paths\n");
+
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    printf("FAIL: cannot create socket pair\n");
+    return(1);
+  }
+  pthread_create(&server, NULL, test_serve_server, &fds[1]);
+  if ((test_assert_int(vx_serve_hello(fds[0], "/nonexistent/model"), 1)
+       != 0) ||
+      (test_assert_int(vx_serve_hello(fds[0], "/"), 1) != 0)) {
+    retval = 1;
+  }
+  close(fds[0]);
+  pthread_join(server, NULL);
+  close(fds[1]);
+
+  /* No server listening */
+  if ((test_assert_int(vx_serve_socket_path("/nonexistent/vx.sock", 
+					    path), 0) != 0) ||
+      (test_assert_int(vx_serve_connect(path), -1) != 0)) {
+    retval = 1;
+  }
+  memset(longpath, 'x', sizeof(longpath));
+  longpath[sizeof(longpath) - 1] = '\0';
+  if (test_assert_int(vx_serve_socket_path(longpath, path), 1) != 0) {
+    retval = 1;
+  }
+
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+/* Check percentiles of a histogram against the exact values of the
+   ascending latencies 'us'. A bucket spans at most 1/16 of its lower
+   bound, or 1 us below 16 us */
+int test_serve_percentiles(const char *name, const double *us, int n)
+{
+  vx_serve_hist_t *hist;
+  double p[4] = {0.5, 0.9, 0.99, 0.999};
+  double exact, est, tol;
+  int i, retval = 0;
+
+  hist = calloc(1, sizeof(vx_serve_hist_t));
+  if (hist == NULL) {
+    printf("FAIL: cannot allocate histogram\n");
+    return(1);
+  }
+  for (i = 0; i < n; i++) {
+    vx_serve_hist_add(hist, us[i]);
+  }
+  for (i = 0; i < 4; i++) {
+    exact = us[(int)ceil(p[i] * n) - 1];
+    est = vx_serve_hist_percentile(hist, p[i]);
+    tol = (exact < VX_SERVE_HIST_SUB) ? 1.0 : exact / VX_SERVE_HIST_SUB;
+    if (fabs(est - exact) > tol) {
+      printf("FAIL: %s p%g is %.1f us, expected %.1f +- %.1f us\n",
+	     name, p[i] * 100.0, est, exact, tol);
+      retval = 1;
+    }
+  }
+  free(hist);
+  return(retval);
+}
+
+
+int test_serve_hist()
+{
+  vx_serve_hist_t hist;
+  double *us;
+  int i, retval = 0;
+
+  printf("Test: vx_serve latency histogram percentiles\n");
+
+  memset(&hist, 0, sizeof(hist));
+  if (test_assert_double(vx_serve_hist_percentile(&hist, 0.5), 0.0) != 0) {
+    return(1);
+  }
+
+  us = malloc(TEST_SERVE_LATENCIES * sizeof(double));
+  if (us == NULL) {
+    printf("FAIL: cannot allocate latencies\n");
+    return(1);
+  }
+
+  /* Uniform from 1 us to 100 ms */
+  for (i = 0; i < TEST_SERVE_LATENCIES; i++) {
+    us[i] = (i + 1) * 1.0e5 / TEST_SERVE_LATENCIES;
+  }
+  if (test_serve_percentiles("uniform", us, TEST_SERVE_LATENCIES) != 0) {
+    retval = 1;
+  }
+
+  /* Log-uniform from 1 us to 10 s, a long tail */
+  for (i = 0; i < TEST_SERVE_LATENCIES; i++) {
+    us[i] = pow(10.0, 7.0 * i / TEST_SERVE_LATENCIES);
+  }
+  if (test_serve_percentiles("log-uniform", us, TEST_SERVE_LATENCIES) != 0) {
+    retval = 1;
+  }
+
+  /* Single value */
+  for (i = 0; i < TEST_SERVE_LATENCIES; i++) {
+    us[i] = 250.0;
+  }
+  if (test_serve_percentiles("constant", us, TEST_SERVE_LATENCIES) != 0) {
+    retval = 1;
+  }
+  free(us);
+
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int suite_vx_serve(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_serve");
+  suite.num_tests = 3;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_serve_query()");
+  suite.tests[0].test_func = &test_serve_query;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_serve_reject()");
+  suite.tests[1].test_func = &test_serve_reject;
+  suite.tests[1].elapsed_time = 0.0;
+
+  strcpy(suite.tests[2].test_name, "test_serve_hist()");
+  suite.tests[2].test_func = &test_serve_hist;
+  suite.tests[2].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    return(1);
+  }
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+    
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+
+  return 0;
+}
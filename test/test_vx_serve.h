@@ -0,0 +1,6 @@
+#ifndef TEST_VX_SERVE_H
+#define TEST_VX_SERVE_H
+
+int suite_vx_serve(const char *xmldir);
+
+#endif
@@ -0,0 +1,428 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "vx_sub.h"
+#include "vx_site.h"
+#include "genmodel.h"
+#include "unittest_defs.h"
+#include "test_genmodel.h"
+#include "test_vx_site.h"
+
+/* Node scale of test model */
+#define TEST_SITE_SCALE 0.5
+
+/* Sites compared with dense sampling */
+#define TEST_SITE_SITES 12
+
+/* Sites of the parallel test */
+#define TEST_SITE_PARALLEL 500
+
+/* Threads of the parallel test */
+#define TEST_SITE_THREADS 4
+
+/* Dense sampling steps of Vs30 and the isosurfaces, m */
+#define TEST_SITE_VS30_STEP 0.01
+#define TEST_SITE_Z_STEP 1.0
+
+/* Sites, bottom depth and dense sampling step of the profile test */
+#define TEST_SITE_PROFILES 8
+#define TEST_SITE_PROFILE_DEPTH 2000.0
+#define TEST_SITE_PROFILE_STEP 0.25
+
+/* Max layers of profiles in the profile test */
+#define TEST_SITE_LAYERS 4096
+
+
+/* Test model directory */
+static char test_model_dir[256];
+
+
+/* Random coordinate in [lo, hi) */
+double test_site_rand(double lo, double hi)
+{
+  return(lo + (hi - lo) * (rand() / (RAND_MAX + 1.0)));
+}
+
+
+/* Query point 'depth' below site. Returns 1 on failure */
+int test_site_query(const vx_site_t *site, double depth, vx_entry_t *entry)
+{
+  memset(entry, 0, sizeof(vx_entry_t));
+  entry->coor[0] = site->coor[0];
+  entry->coor[1] = site->coor[1];
+  entry->coor[2] = depth;
+  entry->coor_type = site->coor_type;
+  return(vx_getcoord_zmode(entry, VX_ZMODE_DEPTH));
+}
+
+
+/* Vs at 'depth' below site */
+double test_site_vs(const vx_site_t *site, double depth)
+{
+  vx_entry_t entry;
+
+  if (test_site_query(site, depth, &entry) != 0) {
+    return(NAN);
+  }
+  return(entry.vs);
+}
+
+
+/* Metrics of site by dense sampling */
+void test_site_dense(const vx_site_t *site, double *vs30, double *z)
+{
+  const double vs[2] = {VX_SITE_VS_Z1, VX_SITE_VS_Z25};
+  double d, v, t = 0.0;
+  int k;
+
+  *vs30 = NAN;
+  for (d = TEST_SITE_VS30_STEP / 2.0; d < VX_SITE_VS30_DEPTH;
+       d += TEST_SITE_VS30_STEP) {
+    v = test_site_vs(site, d);
+    if (!(v > 0.0)) {
+      t = NAN;
+      break;
+    }
+    t += TEST_SITE_VS30_STEP / v;
+  }
+  if (t > 0.0) {
+    *vs30 = VX_SITE_VS30_DEPTH / t;
+  }
+
+  z[0] = z[1] = NAN;
+  for (d = 0.0; (d <= VX_SITE_MAX_DEPTH) && (isnan(z[1]));
+       d += TEST_SITE_Z_STEP) {
+    v = test_site_vs(site, d);
+    for (k = 0; k < 2; k++) {
+      if (isnan(z[k]) && (v >= vs[k])) {
+	z[k] = d;
+      }
+    }
+  }
+}
+
+
+/* Depths agree to the resolution of both searches */
+int test_site_depth(double z, double dense)
+{
+  if (isnan(z) || isnan(dense)) {
+    return(test_assert_int(isnan(z) && isnan(dense), 1));
+  }
+  return(test_assert_int(fabs(z - dense) <= VX_SITE_TOL + TEST_SITE_Z_STEP,
+			 1));
+}
+
+
+int test_site_metrics()
+{
+  vx_site_t site;
+  double vs30, z[2];
+  int i, gtl, queries = 0, retval = 0;
+
+  printf("Test: site metrics match dense column sampling\n");
+
+  if (test_assert_int(vx_setup(test_model_dir), 0) != 0) {
+    return(1);
+  }
+
+  srand(13579);
+  for (gtl = 0; (gtl < 2) && (retval == 0); gtl++) {
+    vx_setgtl(gtl);
+    for (i = 0; (i < TEST_SITE_SITES) && (retval == 0); i++) {
+      memset(&site, 0, sizeof(vx_site_t));
+      site.coor_type = VX_COORD_UTM;
+      if (i < 4) {
+	/* Basin centres and flanks */
+	site.coor[0] = 375000.0 + (i % 2) * 8000.0;
+	site.coor[1] = 3775000.0 + (i / 2) * 4000.0;
+      } else {
+	site.coor[0] = test_site_rand(320000.0, 480000.0);
+	site.coor[1] = test_site_rand(3720000.0, 3880000.0);
+      }
+      if (test_assert_int(vx_site_metrics(&site, NULL), 0) != 0) {
+	retval = 1;
+	break;
+      }
+      test_site_dense(&site, &vs30, z);
+      if ((test_assert_int(fabs(site.vs30 - vs30) <= 1.0e-3 * vs30, 1)
+	   != 0) ||
+	  (test_site_depth(site.z1, z[0]) != 0) ||
+	  (test_site_depth(site.z25, z[1]) != 0)) {
+	printf("Site %.1f %.1f gtl %d: vs30 %.3f/%.3f z1 %.2f/%.2f "
+	       "z2.5 %.2f/%.2f\n", site.coor[0], site.coor[1], gtl,
+	       site.vs30, vs30, site.z1, z[0], site.z25, z[1]);
+	retval = 1;
+      }
+      queries += site.num_queries;
+    }
+  }
+
+  /* A few targeted reads instead of dense sampling */
+  if ((retval == 0) &&
+      (test_assert_int(queries < 2 * TEST_SITE_SITES * 400, 1) != 0)) {
+    retval = 1;
+  }
+
+  /* Sites outside the model fail unless there is a background */
+  memset(&site, 0, sizeof(vx_site_t));
+  site.coor_type = VX_COORD_UTM;
+  site.coor[0] = 10000.0;
+  site.coor[1] = 10000.0;
+  if ((retval == 0) &&
+      ((test_assert_int(vx_site_metrics(&site, NULL), 1) != 0) ||
+       (test_assert_int(isnan(site.vs30), 1) != 0))) {
+    retval = 1;
+  }
+  vx_register_scec();
+  if ((retval == 0) &&
+      ((test_assert_int(vx_site_metrics(&site, NULL), 0) != 0) ||
+       (test_assert_int(site.vs30 > 0.0, 1) != 0))) {
+    retval = 1;
+  }
+
+  vx_cleanup();
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+/* Velocity 'v' of a layer agrees with dense sample 'd' to 'tol', or
+   lies within the values 'a' and 'b' of the ends of a layer of the
+   min thickness */
+int test_site_layer_vel(double v, double d, double a, double b, double tol,
+			int thin)
+{
+  if (thin) {
+    return(test_assert_int((v >= fmin(a, b) - 1.0e-2) &&
+			   (v <= fmax(a, b) + 1.0e-2), 1));
+  }
+  return(test_assert_int(fabs(v - d) <= tol + 1.0e-2, 1));
+}
+
+
+int test_site_profile()
+{
+  vx_site_t site;
+  vx_site_opts_t opts;
+  vx_layer_t *layers, first[2];
+  vx_entry_t entry, top, bottom;
+  double d, end;
+  int i, k, n, gtl, thin, retval = 0;
+
+  printf("Test: layered profiles match dense column sampling\n");
+
+  layers = malloc(TEST_SITE_LAYERS * sizeof(vx_layer_t));
+  if ((layers == NULL) ||
+      (test_assert_int(vx_setup(test_model_dir), 0) != 0)) {
+    free(layers);
+    return(1);
+  }
+
+  vx_site_defaults(&opts);
+  opts.max_depth = TEST_SITE_PROFILE_DEPTH;
+  srand(86420);
+  for (gtl = 0; (gtl < 2) && (retval == 0); gtl++) {
+    vx_setgtl(gtl);
+    for (i = 0; (i < TEST_SITE_PROFILES) && (retval == 0); i++) {
+      memset(&site, 0, sizeof(vx_site_t));
+      site.coor_type = VX_COORD_UTM;
+      site.coor[0] = (i == 0) ? 375000.0 : test_site_rand(320000.0, 480000.0);
+      site.coor[1] = (i == 0) ? 3775000.0 :
+	test_site_rand(3720000.0, 3880000.0);
+
+      n = vx_site_profile(&site, &opts, layers, TEST_SITE_LAYERS);
+      if ((test_assert_int(n > 0, 1) != 0) ||
+	  (test_assert_int(n < TEST_SITE_LAYERS, 1) != 0) ||
+	  (test_assert_int(n < TEST_SITE_PROFILE_DEPTH /
+			   TEST_SITE_PROFILE_STEP / 20, 1) != 0) ||
+	  (test_assert_int(layers[0].top == 0.0, 1) != 0)) {
+	retval = 1;
+	break;
+      }
+
+      /* Short buffers are filled and the full count returned */
+      if ((test_assert_int(vx_site_profile(&site, &opts, first, 2), n)
+	   != 0) ||
+	  (test_assert_int(memcmp(first, layers,
+				  ((n < 2) ? n : 2) * sizeof(vx_layer_t)),
+			   0) != 0)) {
+	retval = 1;
+	break;
+      }
+
+      for (k = 0; (k < n) && (retval == 0); k++) {
+	end = (k + 1 < n) ? layers[k + 1].top : TEST_SITE_PROFILE_DEPTH;
+	if ((test_assert_int(end > layers[k].top, 1) != 0) ||
+	    ((k > 0) &&
+	     (test_assert_int((layers[k].vp != layers[k - 1].vp) ||
+			      (layers[k].vs != layers[k - 1].vs) ||
+			      (layers[k].provenance !=
+			       layers[k - 1].provenance), 1) != 0))) {
+	  retval = 1;
+	  break;
+	}
+
+	/* Layers no thicker than the depth resolution bound a steep
+	   change */
+	thin = (end - layers[k].top <= opts.tol * 1.001);
+	test_site_query(&site, layers[k].top, &top);
+	test_site_query(&site, end, &bottom);
+	for (d = layers[k].top + TEST_SITE_PROFILE_STEP / 2.0; d < end;
+	     d += TEST_SITE_PROFILE_STEP) {
+	  test_site_query(&site, d, &entry);
+	  if ((test_site_layer_vel(layers[k].vp, entry.vp, top.vp, bottom.vp,
+				   opts.vel_tol, thin) != 0) ||
+	      (test_site_layer_vel(layers[k].vs, entry.vs, top.vs, bottom.vs,
+				   opts.vel_tol, thin) != 0)) {
+	    printf("Site %.1f %.1f gtl %d layer %d %.3f-%.3f at %.3f: "
+		   "vp %.2f/%.2f vs %.2f/%.2f\n", site.coor[0], site.coor[1],
+		   gtl, k, layers[k].top, end, d, layers[k].vp, entry.vp,
+		   layers[k].vs, entry.vs);
+	    retval = 1;
+	    break;
+	  }
+	}
+      }
+    }
+  }
+
+  /* Sites outside the model have no profile */
+  memset(&site, 0, sizeof(vx_site_t));
+  site.coor_type = VX_COORD_UTM;
+  site.coor[0] = 10000.0;
+  site.coor[1] = 10000.0;
+  if ((retval == 0) &&
+      (test_assert_int(vx_site_profile(&site, &opts, layers,
+				       TEST_SITE_LAYERS), -1) != 0)) {
+    retval = 1;
+  }
+
+  vx_cleanup();
+  free(layers);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_site_parallel()
+{
+  vx_site_t *plain, *parallel;
+  vx_site_opts_t opts;
+  int i, threads, retval = 0;
+
+  printf("Test: parallel site metrics match serial metrics\n");
+
+  plain = malloc(TEST_SITE_PARALLEL * sizeof(vx_site_t));
+  parallel = malloc(TEST_SITE_PARALLEL * sizeof(vx_site_t));
+  if ((plain == NULL) || (parallel == NULL) ||
+      (test_assert_int(vx_setup(test_model_dir), 0) != 0)) {
+    free(plain);
+    free(parallel);
+    return(1);
+  }
+
+  vx_site_defaults(&opts);
+  opts.tol = 0.1;
+  srand(97531);
+  memset(plain, 0, TEST_SITE_PARALLEL * sizeof(vx_site_t));
+  for (i = 0; i < TEST_SITE_PARALLEL; i++) {
+    plain[i].coor_type = VX_COORD_UTM;
+    plain[i].coor[0] = test_site_rand(300000.0, 500000.0);
+    plain[i].coor[1] = test_site_rand(3700000.0, 3900000.0);
+    vx_site_metrics(&(plain[i]), &opts);
+  }
+
+  for (threads = 1; (threads <= TEST_SITE_THREADS) && (retval == 0);
+       threads++) {
+    for (i = 0; i < TEST_SITE_PARALLEL; i++) {
+      memset(&(parallel[i]), 0, sizeof(vx_site_t));
+      parallel[i].coor_type = VX_COORD_UTM;
+      memcpy(parallel[i].coor, plain[i].coor, sizeof(double) * 2);
+    }
+    vx_site_metrics_parallel(parallel, TEST_SITE_PARALLEL, &opts, threads,
+			     NULL);
+    if (test_assert_int(memcmp(plain, parallel,
+			       TEST_SITE_PARALLEL * sizeof(vx_site_t)),
+			0) != 0) {
+      retval = 1;
+    }
+  }
+
+  vx_cleanup();
+  free(plain);
+  free(parallel);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int suite_vx_site(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_site");
+  suite.num_tests = 3;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Generate test model */
+  strcpy(test_model_dir, "/tmp/vx_site.XXXXXX");
+  if (test_genmodel_create(test_model_dir, TEST_SITE_SCALE, NULL) != 0) {
+    return(1);
+  }
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_site_metrics()");
+  suite.tests[0].test_func = &test_site_metrics;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_site_parallel()");
+  suite.tests[1].test_func = &test_site_parallel;
+  suite.tests[1].elapsed_time = 0.0;
+
+  strcpy(suite.tests[2].test_name, "test_site_profile()");
+  suite.tests[2].test_func = &test_site_profile;
+  suite.tests[2].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    test_genmodel_remove(test_model_dir);
+    return(1);
+  }
+  test_genmodel_remove(test_model_dir);
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+  return 0;
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_VX_SITE_H
+#define TEST_VX_SITE_H
+
+int suite_vx_site(const char *xmldir);
+
+#endif
@@ -0,0 +1,479 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "vx_sub.h"
+#include "vx_stack.h"
+#include "genmodel.h"
+#include "unittest_defs.h"
+#include "test_genmodel.h"
+#include "test_vx_stack.h"
+
+/* Node scale of test model */
+#define TEST_STACK_SCALE 0.5
+
+/* Random points compared between map lookup and voxet search */
+#define TEST_STACK_POINTS 200000
+
+
+/* Test model with a fine voxet nested in HR, and its directory */
+static genmodel_t test_model;
+static genmodel_grid_t test_xr;
+static char test_model_dir[256];
+
+
+/* Write manifest to model directory */
+int test_stack_manifest(const char *text)
+{
+  char path[512];
+  FILE *fp;
+
+  snprintf(path, sizeof(path), "%s/%s", test_model_dir, VX_STACK_MANIFEST);
+  fp = fopen(path, "w");
+  if (fp == NULL) {
+    return(1);
+  }
+  fputs(text, fp);
+  fclose(fp);
+  return(0);
+}
+
+
+/* Random coordinate in [lo, hi) */
+double test_stack_rand(double lo, double hi)
+{
+  return(lo + (hi - lo) * (rand() / (RAND_MAX + 1.0)));
+}
+
+
+/* Compare map lookup with voxet search at point */
+int test_stack_compare(const vx_stack_t *stack, const double *utm)
+{
+  int g1[3], g2[3];
+  int v1, v2;
+
+  v1 = vx_stack_find(stack, utm, g1);
+  v2 = vx_stack_search(stack, utm, g2);
+  if ((v1 != v2) ||
+      ((v1 >= 0) && ((g1[0] != g2[0]) || (g1[1] != g2[1]) ||
+		     (g1[2] != g2[2])))) {
+    fprintf(stderr, "Point %f %f %f: map voxet %d, search voxet %d\n",
+	    utm[0], utm[1], utm[2], v1, v2);
+    return(1);
+  }
+  return(0);
+}
+
+
+int test_stack_find()
+{
+  vx_stack_t stack;
+  const vx_volume_t *vol;
+  double utm[3], lo[3], hi[3];
+  int i, j, k, v, n, retval = 0;
+
+  printf("Test: priority map lookup matches voxet search\n");
+
+  if ((test_stack_manifest("# name header priority source\n"
+			   "CM CVM_CM.vo 1 cm\n"
+			   "LR CVM_LR.vo 2 lr\n"
+			   "HR CVM_HR.vo 3 hr\n"
+			   "\n"
+			   "XR CVM_XR.vo 4 hr\n") != 0) ||
+      (test_assert_int(vx_stack_load(test_model_dir, &stack), 0) != 0)) {
+    return(1);
+  }
+
+  /* Ordered by priority */
+  if ((test_assert_int(stack.num_vols, 4) != 0) ||
+      (test_assert_int(strcmp(stack.vols[0].name, "XR"), 0) != 0) ||
+      (test_assert_int(strcmp(stack.vols[3].name, "CM"), 0) != 0) ||
+      (test_assert_int(vx_stack_map_resolved(&stack) > 0.5, 1) != 0)) {
+    vx_stack_free(&stack);
+    return(1);
+  }
+
+  /* Random points over the map */
+  srand(12345);
+  for (i = 0; i < 3; i++) {
+    lo[i] = stack.map_o[i];
+    hi[i] = stack.map_o[i] + stack.map_n[i] * stack.map_step[i];
+  }
+  for (n = 0; (n < TEST_STACK_POINTS) && (retval == 0); n++) {
+    for (i = 0; i < 3; i++) {
+      utm[i] = test_stack_rand(lo[i], hi[i]);
+    }
+    retval = test_stack_compare(&stack, utm);
+  }
+
+  /* Points on and next to the rounding boundaries of each voxet */
+  for (v = 0; (v < stack.num_vols) && (retval == 0); v++) {
+    vol = &(stack.vols[v]);
+    for (n = 0; (n < 2000) && (retval == 0); n++) {
+      i = n % 3;
+      k = (n / 3) % 2;
+      for (j = 0; j < 3; j++) {
+	utm[j] = test_stack_rand(vol->a.O[j] - vol->step[j],
+				 vol->a.O[j] + vol->a.N[j] * vol->step[j]);
+      }
+      utm[i] = vol->a.O[i] +
+	((k == 0) ? -0.5 : vol->a.N[i] - 0.5) * vol->step[i];
+      utm[i] += ((n / 6) % 3 - 1) * 1.0e-3;
+      retval = test_stack_compare(&stack, utm);
+    }
+  }
+
+  /* Points outside the map */
+  utm[0] = lo[0] - 1.0;
+  utm[1] = utm[2] = 0.0;
+  if ((retval == 0) && (test_assert_int(vx_stack_find(&stack, utm, &i),
+					-1) != 0)) {
+    retval = 1;
+  }
+
+  vx_stack_free(&stack);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+/* Query node of grid and check source, cell centre and values */
+int test_stack_node(const genmodel_grid_t *grid, int i, int j, int k)
+{
+  vx_entry_t entry;
+  float vp, vs, tag;
+  double cell[3];
+
+  vx_init_entry(&entry);
+  entry.coor_type = VX_COORD_UTM;
+  cell[0] = entry.coor[0] = grid->origin[0] + i * grid->step[0];
+  cell[1] = entry.coor[1] = grid->origin[1] + j * grid->step[1];
+  cell[2] = entry.coor[2] = grid->origin[2] + k * grid->step[2];
+  genmodel_voxel(&test_model, entry.coor[0], entry.coor[1], entry.coor[2],
+		 &vp, &vs, &tag);
+
+  vx_getcoord(&entry);
+  if ((test_assert_int(entry.data_src, VX_SRC_HR) != 0) ||
+      (test_assert_double(entry.vel_cell[0], cell[0]) != 0) ||
+      (test_assert_double(entry.vel_cell[1], cell[1]) != 0) ||
+      (test_assert_double(entry.vel_cell[2], cell[2]) != 0) ||
+      (test_assert_float(entry.provenance, tag) != 0) ||
+      (test_assert_float(entry.vp, vp) != 0) ||
+      (test_assert_float(entry.vs, vs) != 0)) {
+    return(1);
+  }
+  return(0);
+}
+
+
+int test_stack_nested()
+{
+  genmodel_grid_t *hr = &test_model.hr;
+  int i, j, k;
+
+  printf("Test: query model with a fine voxet nested in HR\n");
+
+  if ((test_stack_manifest("HR CVM_HR.vo 3 hr\n"
+			   "LR CVM_LR.vo 2 lr\n"
+			   "CM CVM_CM.vo 1 cm\n"
+			   "XR CVM_XR.vo 4 hr\n") != 0) ||
+      (test_assert_int(vx_setup(test_model_dir), 0) != 0)) {
+    return(1);
+  }
+  vx_setgtl(False);
+
+  /* Nodes of the nested voxet */
+  for (k = 0; k < test_xr.n[2]; k += 5) {
+    for (j = 0; j < test_xr.n[1]; j += 3) {
+      for (i = 0; i < test_xr.n[0]; i += 3) {
+	if (test_stack_node(&test_xr, i, j, k) != 0) {
+	  vx_cleanup();
+	  return(1);
+	}
+      }
+    }
+  }
+
+  /* HR nodes around it */
+  for (k = 0; k < hr->n[2]; k += 7) {
+    for (i = 0; i < 4; i++) {
+      if (test_stack_node(hr, i, i + 1, k) != 0) {
+	vx_cleanup();
+	return(1);
+      }
+    }
+  }
+
+  vx_cleanup();
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+/* Compare batch lookup 'simd' with the scalar lookup over 'n' points */
+int test_stack_simd_compare(const vx_stack_t *stack, vx_simd_t simd,
+			    const double *utm, size_t n)
+{
+  int *vol[2], *g[2];
+  float *val[2];
+  size_t i;
+  int s, retval = 0;
+
+  for (s = 0; s < 2; s++) {
+    vol[s] = malloc(n * sizeof(int));
+    g[s] = malloc(n * 3 * sizeof(int));
+    val[s] = malloc(n * 3 * sizeof(float));
+    if ((vol[s] == NULL) || (g[s] == NULL) || (val[s] == NULL)) {
+      retval = 1;
+    }
+  }
+
+  if (retval == 0) {
+    vx_stack_lookup_simd(stack, VX_SIMD_SCALAR, utm, n, vol[0], g[0],
+			 val[0], &val[0][n], &val[0][2 * n]);
+    retval = vx_stack_lookup_simd(stack, simd, utm, n, vol[1], g[1],
+				  val[1], &val[1][n], &val[1][2 * n]);
+  }
+  for (i = 0; (i < n) && (retval == 0); i++) {
+    if ((vol[0][i] != vol[1][i]) ||
+	((vol[0][i] >= 0) &&
+	 ((memcmp(&g[0][i * 3], &g[1][i * 3], sizeof(int) * 3) != 0) ||
+	  (memcmp(&val[0][i], &val[1][i], sizeof(float)) != 0) ||
+	  (memcmp(&val[0][n + i], &val[1][n + i], sizeof(float)) != 0) ||
+	  (memcmp(&val[0][2 * n + i], &val[1][2 * n + i],
+		  sizeof(float)) != 0)))) {
+      fprintf(stderr, "%s: point %f %f %f differs from scalar lookup\n",
+	      VX_SIMD_NAMES[simd], utm[i * 3], utm[i * 3 + 1], utm[i * 3 + 2]);
+      retval = 1;
+    }
+  }
+
+  for (s = 0; s < 2; s++) {
+    free(vol[s]);
+    free(g[s]);
+    free(val[s]);
+  }
+  return(retval);
+}
+
+
+int test_stack_simd()
+{
+  vx_stack_t stack;
+  const vx_volume_t *vol;
+  double *utm, *p, lo[3], hi[3], edge;
+  float f;
+  size_t n, m;
+  int g[3], i, j, v, simd, retval = 0;
+
+  printf("Test: SIMD batch lookups match the scalar lookup\n");
+
+  if ((test_stack_manifest("CM CVM_CM.vo 1 cm\n"
+			   "LR CVM_LR.vo 2 lr\n"
+			   "HR CVM_HR.vo 3 hr\n"
+			   "XR CVM_XR.vo 4 hr\n") != 0) ||
+      (test_assert_int(vx_stack_load(test_model_dir, &stack), 0) != 0)) {
+    return(1);
+  }
+  if (test_assert_int(stack.simd_ok, True) != 0) {
+    vx_stack_free(&stack);
+    return(1);
+  }
+
+  utm = malloc(TEST_STACK_POINTS * 3 * sizeof(double));
+  if (utm == NULL) {
+    vx_stack_free(&stack);
+    return(1);
+  }
+
+  /* Random points over and around the map */
+  srand(2468);
+  for (i = 0; i < 3; i++) {
+    lo[i] = stack.map_o[i] - stack.map_step[i];
+    hi[i] = stack.map_o[i] + (stack.map_n[i] + 1) * stack.map_step[i];
+  }
+  n = TEST_STACK_POINTS / 2;
+  for (m = 0; m < n * 3; m++) {
+    utm[m] = test_stack_rand(lo[m % 3], hi[m % 3]);
+  }
+
+  /* Half cell edges of each voxet, and the floats either side */
+  for (m = n; m < TEST_STACK_POINTS - 8; m++) {
+    p = &utm[m * 3];
+    vol = &(stack.vols[m % stack.num_vols]);
+    for (j = 0; j < 3; j++) {
+      p[j] = test_stack_rand(vol->a.O[j] - vol->step[j],
+			     vol->a.O[j] + vol->a.N[j] * vol->step[j]);
+    }
+    j = (m / stack.num_vols) % 3;
+    i = rand() % (vol->a.N[j] + 2) - 1;
+    edge = (double)vol->a.O[j] + (i - 0.5) * (double)vol->step[j];
+    switch (m % 5) {
+    case 0:
+      p[j] = nextafter(edge, -1.0e30);
+      break;
+    case 1:
+      p[j] = nextafter(edge, 1.0e30);
+      break;
+    case 2:
+      p[j] = (double)vol->a.O[j] + i * (double)vol->step[j];
+      break;
+    default:
+      p[j] = edge;
+      break;
+    }
+  }
+
+  /* Invalid coordinates */
+  for (m = TEST_STACK_POINTS - 8; m < TEST_STACK_POINTS; m++) {
+    for (j = 0; j < 3; j++) {
+      utm[m * 3 + j] = stack.vols[0].a.O[j];
+    }
+  }
+  utm[(TEST_STACK_POINTS - 8) * 3] = NAN;
+  utm[(TEST_STACK_POINTS - 7) * 3 + 1] = NAN;
+  utm[(TEST_STACK_POINTS - 6) * 3 + 2] = INFINITY;
+  utm[(TEST_STACK_POINTS - 5) * 3] = -INFINITY;
+  utm[(TEST_STACK_POINTS - 4) * 3] = 1.0e300;
+  utm[(TEST_STACK_POINTS - 3) * 3 + 2] = -1.0e300;
+  utm[(TEST_STACK_POINTS - 2) * 3 + 1] = 1.0e10;
+
+  for (simd = VX_SIMD_SCALAR; (simd <= vx_simd_detect()) && (retval == 0);
+       simd++) {
+    printf("Comparing %s lookup\n", VX_SIMD_NAMES[simd]);
+    retval = test_stack_simd_compare(&stack, simd, utm, TEST_STACK_POINTS);
+
+    /* Batches not a multiple of the vector width */
+    for (v = 1; (v < 17) && (retval == 0); v++) {
+      retval = test_stack_simd_compare(&stack, simd, &utm[(n + v * 7) * 3],
+				       v);
+    }
+  }
+
+  /* Unsupported implementation */
+  if ((retval == 0) && (vx_simd_detect() < VX_SIMD_AVX512)) {
+    retval = test_assert_int(vx_stack_lookup_simd(&stack, VX_SIMD_AVX512,
+						  utm, 1, &i, g, &f, &f, &f),
+			     1);
+  }
+
+  free(utm);
+  vx_stack_free(&stack);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_stack_invalid()
+{
+  printf("Test: setup fails on invalid manifests\n");
+
+  /* Unknown source, missing CM source, missing header */
+  if ((test_stack_manifest("HR CVM_HR.vo 3 hr\n"
+			   "LR CVM_LR.vo 2 xx\n") != 0) ||
+      (test_assert_int(vx_setup(test_model_dir), 1) != 0)) {
+    return(1);
+  }
+  if ((test_stack_manifest("HR CVM_HR.vo 3 hr\n"
+			   "LR CVM_LR.vo 2 lr\n") != 0) ||
+      (test_assert_int(vx_setup(test_model_dir), 1) != 0)) {
+    return(1);
+  }
+  if ((test_stack_manifest("HR CVM_HR.vo 3 hr\n"
+			   "LR CVM_LR.vo 2 lr\n"
+			   "CM CVM_CM.vo 1 cm\n"
+			   "YR CVM_YR.vo 4 hr\n") != 0) ||
+      (test_assert_int(vx_setup(test_model_dir), 1) != 0)) {
+    return(1);
+  }
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int suite_vx_stack(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_stack");
+  suite.num_tests = 4;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Generate test model with a fine voxet offset from the HR nodes */
+  strcpy(test_model_dir, "/tmp/vx_stack.XXXXXX");
+  if (test_genmodel_create(test_model_dir, TEST_STACK_SCALE,
+			   &test_model) != 0) {
+    return(1);
+  }
+  test_xr.origin[0] = 360125.0;
+  test_xr.origin[1] = 3760125.0;
+  test_xr.origin[2] = -2975.0;
+  test_xr.step[0] = test_xr.step[1] = 250.0;
+  test_xr.step[2] = 50.0;
+  test_xr.n[0] = test_xr.n[1] = test_xr.n[2] = 41;
+  if (genmodel_write_voxet(&test_model, test_model_dir, "CVM_XR",
+			   &test_xr) != 0) {
+    fprintf(stderr, "Failed to generate model\n");
+    test_genmodel_remove(test_model_dir);
+    return(1);
+  }
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_stack_find()");
+  suite.tests[0].test_func = &test_stack_find;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_stack_nested()");
+  suite.tests[1].test_func = &test_stack_nested;
+  suite.tests[1].elapsed_time = 0.0;
+
+  strcpy(suite.tests[2].test_name, "test_stack_invalid()");
+  suite.tests[2].test_func = &test_stack_invalid;
+  suite.tests[2].elapsed_time = 0.0;
+
+  strcpy(suite.tests[3].test_name, "test_stack_simd()");
+  suite.tests[3].test_func = &test_stack_simd;
+  suite.tests[3].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    test_genmodel_remove(test_model_dir);
+    return(1);
+  }
+  test_genmodel_remove(test_model_dir);
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+  return 0;
+}
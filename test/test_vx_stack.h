@@ -0,0 +1,6 @@
+#ifndef TEST_VX_STACK_H
+#define TEST_VX_STACK_H
+
+int suite_vx_stack(const char *xmldir);
+
+#endif
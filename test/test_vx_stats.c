@@ -0,0 +1,154 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "vx_sub.h"
+#include "vx_stats.h"
+#include "unittest_defs.h"
+#include "test_vx_stats.h"
+
+/* Number of counter updates per thread */
+#define TEST_STATS_COUNT 100000
+
+/* Number of threads */
+#define TEST_STATS_THREADS 4
+
+
+/* Update counters as the query code does */
+void *test_stats_worker(void *arg)
+{
+  int i;
+
+  for (i = 0; i < TEST_STATS_COUNT; i++) {
+    VX_STATS_TIMER(t);
+    VX_STATS_COUNT(src_hits[VX_SRC_LR]);
+    VX_STATS_ADD(surface_iter, 2);
+    VX_STATS_STOP(VX_STAGE_CASCADE, t);
+  }
+  return(NULL);
+}
+
+
+int test_stats_threads()
+{
+  pthread_t threads[TEST_STATS_THREADS];
+  vx_stats_t stats;
+  unsigned long long expect;
+  int i;
+
+  printf("Test: vx_get_stats sums counters of all threads\n");
+
+  vx_reset_stats();
+  for (i = 0; i < TEST_STATS_THREADS; i++) {
+    pthread_create(&threads[i], NULL, test_stats_worker, NULL);
+  }
+  for (i = 0; i < TEST_STATS_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  /* Counters are compiled out unless VX_ENABLE_STATS is set */
+  if (test_assert_int(vx_get_stats(&stats), 
+		      (vx_stats_enabled() ? 0 : 1)) != 0) {
+    return(1);
+  }
+  expect = vx_stats_enabled() ? TEST_STATS_COUNT * TEST_STATS_THREADS : 0;
+  if ((test_assert_int(stats.src_hits[VX_SRC_LR] == expect, 1) != 0) ||
+      (test_assert_int(stats.surface_iter == expect * 2, 1) != 0) ||
+      (test_assert_int(stats.calls[VX_STAGE_CASCADE] == expect, 1) != 0)) {
+    return(1);
+  }
+
+  vx_reset_stats();
+  vx_get_stats(&stats);
+  if (test_assert_int(stats.src_hits[VX_SRC_LR] == 0, 1) != 0) {
+    return(1);
+  }
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int test_stats_text()
+{
+  vx_stats_t stats;
+  char buf[8192];
+  char small[16];
+  int len;
+
+  printf("Test: vx_stats_text report\n");
+
+  vx_reset_stats();
+  vx_get_stats(&stats);
+  stats.src_hits[VX_SRC_HR] = 42;
+  len = vx_stats_text(&stats, buf, sizeof(buf));
+  if ((test_assert_int(len, strlen(buf)) != 0) || (len == 0)) {
+    return(1);
+  }
+  if (vx_stats_enabled() && 
+      ((strstr(buf, "cascade") == NULL) || (strstr(buf, "42") == NULL))) {
+    printf("FAIL: unexpected report\n%s", buf);
+    return(1);
+  }
+
+  /* Truncated report stays terminated */
+  len = vx_stats_text(&stats, small, sizeof(small));
+  if (test_assert_int(strlen(small) < sizeof(small), 1) != 0) {
+    return(1);
+  }
+
+  printf("PASS\n");
+  return(0);
+}
+
+
+int suite_vx_stats(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_stats");
+  suite.num_tests = 2;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_stats_threads()");
+  suite.tests[0].test_func = &test_stats_threads;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_stats_text()");
+  suite.tests[1].test_func = &test_stats_text;
+  suite.tests[1].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    return(1);
+  }
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+    
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+
+  return 0;
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_VX_STATS_H
+#define TEST_VX_STATS_H
+
+int suite_vx_stats(const char *xmldir);
+
+#endif
@@ -0,0 +1,327 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <unistd.h>
+#include "params.h"
+#include "vx_sub.h"
+#include "vx_tt.h"
+#include "genmodel.h"
+#include "unittest_defs.h"
+#include "test_genmodel.h"
+#include "test_vx_tt.h"
+
+/* Node scale of test model */
+#define TEST_TT_SCALE 0.5
+
+/* Velocity of the constant medium, m/s */
+#define TEST_TT_VEL 4000.0
+
+/* Relative error bound of first order times, away from the source */
+#define TEST_TT_ERR 0.08
+
+/* Threads of parallel solves */
+#define TEST_TT_THREADS 4
+
+/* Nodes compared with direct queries */
+#define TEST_TT_NODES 200
+
+
+/* Test model directory */
+static char test_model_dir[256];
+
+
+/* Distance from node 'pos' of 'tt' to 'p' */
+double test_tt_dist(const vx_tt_t *tt, size_t pos, const double *p)
+{
+  size_t i[3];
+  double f, d = 0.0;
+  int k;
+
+  i[0] = pos % tt->dims[0];
+  i[1] = (pos / tt->dims[0]) % tt->dims[1];
+  i[2] = pos / (tt->dims[0] * tt->dims[1]);
+  for (k = 0; k < 3; k++) {
+    f = tt->origin[k] + i[k] * tt->step[k] - p[k];
+    d += f * f;
+  }
+  return(sqrt(d));
+}
+
+
+int test_tt_constant()
+{
+  vx_tt_t tt, other;
+  double min[3] = {0.0, 0.0, -20000.0};
+  double max[3] = {40000.0, 40000.0, 0.0};
+  double step[3] = {1000.0, 1000.0, 500.0};
+  double source[3] = {12300.0, 17700.0, -9100.0};
+  double d, err, p[3];
+  char path[512];
+  size_t pos, n;
+  int k, retval = 0;
+
+  printf("Test: travel times in a constant medium match straight rays\n");
+
+  if ((test_assert_int(vx_tt_init(&tt, min, max, step), 0) != 0) ||
+      (test_assert_int(vx_tt_init(&other, min, max, step), 0) != 0)) {
+    return(1);
+  }
+  n = tt.dims[0] * tt.dims[1] * tt.dims[2];
+  if ((test_assert_int(tt.dims[0], 41) != 0) ||
+      (test_assert_int(tt.dims[2], 41) != 0)) {
+    retval = 1;
+  }
+  for (pos = 0; pos < n; pos++) {
+    tt.slow[pos] = other.slow[pos] = 1.0 / TEST_TT_VEL;
+  }
+
+  if ((retval == 0) &&
+      ((test_assert_int(vx_tt_solve(&tt, source, VX_TT_TOL, VX_TT_MAX_ITER,
+				    1), 0) != 0) ||
+       (test_assert_int(tt.iterations < VX_TT_MAX_ITER, 1) != 0))) {
+    retval = 1;
+  }
+
+  /* First order error away from the source, times only overestimated
+     by the upwind solution */
+  err = 0.0;
+  for (pos = 0; (pos < n) && (retval == 0); pos++) {
+    d = test_tt_dist(&tt, pos, source);
+    if (d < 3.0 * step[0]) {
+      continue;
+    }
+    if (test_assert_int(tt.time[pos] >= d / TEST_TT_VEL * (1.0 - 1.0e-6),
+			1) != 0) {
+      printf("Node %zu: time %f below %f\n", pos, tt.time[pos],
+	     d / TEST_TT_VEL);
+      retval = 1;
+    }
+    err = fmax(err, fabs(tt.time[pos] * TEST_TT_VEL - d) / d);
+  }
+  printf("Max relative error %.4f\n", err);
+  if ((retval == 0) && (test_assert_int(err < TEST_TT_ERR, 1) != 0)) {
+    retval = 1;
+  }
+
+  /* Interpolation gives the nodes, nothing outside the grid */
+  for (k = 0; k < 3; k++) {
+    p[k] = tt.origin[k] + 7 * tt.step[k];
+  }
+  pos = (7 * tt.dims[1] + 7) * tt.dims[0] + 7;
+  if ((retval == 0) &&
+      ((test_assert_int(vx_tt_time(&tt, p) == tt.time[pos], 1) != 0) ||
+       (test_assert_int(fabs(vx_tt_time(&tt, source) * TEST_TT_VEL) <
+			step[0], 1) != 0))) {
+    retval = 1;
+  }
+  p[2] = max[2] + 1.0;
+  if ((retval == 0) &&
+      (test_assert_int(isnan(vx_tt_time(&tt, p)), 1) != 0)) {
+    retval = 1;
+  }
+
+  /* Same times on several threads */
+  if ((retval == 0) &&
+      ((test_assert_int(vx_tt_solve(&other, source, VX_TT_TOL,
+				    VX_TT_MAX_ITER, TEST_TT_THREADS), 0)
+	!= 0) ||
+       (test_assert_int(other.iterations, tt.iterations) != 0) ||
+       (test_assert_int(memcmp(tt.time, other.time, n * sizeof(float)), 0)
+	!= 0))) {
+    retval = 1;
+  }
+  vx_tt_free(&other);
+
+  /* Sources must lie in the grid */
+  source[0] = -1.0;
+  if ((retval == 0) &&
+      (test_assert_int(vx_tt_solve(&other, source, VX_TT_TOL,
+				   VX_TT_MAX_ITER, 1), 1) != 0)) {
+    retval = 1;
+  }
+  source[0] = 12300.0;
+
+  /* Files read back */
+  snprintf(path, sizeof(path), "%s/const.P.vxt", test_model_dir);
+  if ((retval == 0) &&
+      ((test_assert_int(vx_tt_write(path, &tt), 0) != 0) ||
+       (test_assert_int(vx_tt_read(path, &other), 0) != 0))) {
+    retval = 1;
+  }
+  if ((retval == 0) &&
+      ((test_assert_int(other.phase, VX_TT_P) != 0) ||
+       (test_assert_int(other.slow == NULL, 1) != 0) ||
+       (test_assert_int(memcmp(other.dims, tt.dims, sizeof(tt.dims)), 0)
+	!= 0) ||
+       (test_assert_int(memcmp(other.origin, tt.origin, sizeof(tt.origin)),
+			0) != 0) ||
+       (test_assert_int(memcmp(other.source, source, sizeof(source)), 0)
+	!= 0) ||
+       (test_assert_int(memcmp(other.time, tt.time, n * sizeof(float)), 0)
+	!= 0))) {
+    retval = 1;
+  }
+  vx_tt_free(&other);
+  unlink(path);
+
+  vx_tt_free(&tt);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int test_tt_model()
+{
+  vx_tt_t tt, other;
+  vx_entry_t entry;
+  double min[3] = {345000.0, 3745000.0, -8000.0};
+  double max[3] = {405000.0, 3805000.0, 2000.0};
+  double step[3] = {1000.0, 1000.0, 500.0};
+  double source[3] = {375000.0, 3775000.0, 0.0};
+  double smin = INFINITY, v;
+  float surface;
+  size_t pos, n, i;
+  int retval = 0;
+
+  printf("Test: travel times on model slowness\n");
+
+  if ((test_assert_int(vx_tt_init(&tt, min, max, step), 0) != 0) ||
+      (test_assert_int(vx_tt_init(&other, min, max, step), 0) != 0) ||
+      (test_assert_int(vx_setup(test_model_dir), 0) != 0)) {
+    vx_tt_free(&tt);
+    vx_tt_free(&other);
+    return(1);
+  }
+  vx_setgtl(True);
+  n = tt.dims[0] * tt.dims[1] * tt.dims[2];
+
+  /* Slowness is that of point queries, on any number of threads */
+  if ((test_assert_int(vx_tt_slowness(&tt, VX_TT_P, 1), 0) != 0) ||
+      (test_assert_int(vx_tt_slowness(&other, VX_TT_P, TEST_TT_THREADS), 0)
+       != 0) ||
+      (test_assert_int(memcmp(tt.slow, other.slow, n * sizeof(float)), 0)
+       != 0)) {
+    retval = 1;
+  }
+  srand(97531);
+  for (i = 0; (i < TEST_TT_NODES) && (retval == 0); i++) {
+    pos = (size_t)(n * (rand() / (RAND_MAX + 1.0)));
+    memset(&entry, 0, sizeof(vx_entry_t));
+    entry.coor[0] = tt.origin[0] + (pos % tt.dims[0]) * tt.step[0];
+    entry.coor[1] = tt.origin[1] +
+      ((pos / tt.dims[0]) % tt.dims[1]) * tt.step[1];
+    entry.coor[2] = tt.origin[2] +
+      (pos / (tt.dims[0] * tt.dims[1])) * tt.step[2];
+    entry.coor_type = VX_COORD_UTM;
+    v = (vx_getcoord_zmode(&entry, VX_ZMODE_ELEV) == 0) ? entry.vp : -1.0;
+    if (v > 0.0) {
+      retval = test_assert_int(tt.slow[pos] == (float)(1.0 / v), 1);
+    } else {
+      retval = test_assert_int(isinf(tt.slow[pos]), 1);
+    }
+  }
+
+  /* Station just below the surface */
+  vx_getsurface(source, VX_COORD_UTM, &surface);
+  source[2] = surface - 10.0;
+  vx_cleanup();
+
+  if ((retval == 0) &&
+      ((test_assert_int(vx_tt_solve(&tt, source, VX_TT_TOL, VX_TT_MAX_ITER,
+				    1), 0) != 0) ||
+       (test_assert_int(vx_tt_solve(&other, source, VX_TT_TOL,
+				    VX_TT_MAX_ITER, TEST_TT_THREADS), 0)
+	!= 0) ||
+       (test_assert_int(memcmp(tt.time, other.time, n * sizeof(float)), 0)
+	!= 0))) {
+    retval = 1;
+  }
+
+  /* Every node with velocity is reached, no sooner than at the top
+     speed of the grid */
+  for (pos = 0; pos < n; pos++) {
+    smin = fmin(smin, tt.slow[pos]);
+  }
+  for (pos = 0; (pos < n) && (retval == 0); pos++) {
+    if (isinf(tt.slow[pos])) {
+      retval = test_assert_int(isinf(tt.time[pos]), 1);
+    } else if ((test_assert_int(isfinite(tt.time[pos]), 1) != 0) ||
+	       (test_assert_int(tt.time[pos] >= test_tt_dist(&tt, pos, source)
+				* smin * (1.0 - 1.0e-6), 1) != 0)) {
+      printf("Node %zu: time %f, distance %f\n", pos, tt.time[pos],
+	     test_tt_dist(&tt, pos, source));
+      retval = 1;
+    }
+  }
+
+  vx_tt_free(&tt);
+  vx_tt_free(&other);
+  if (retval == 0) {
+    printf("PASS\n");
+  }
+  return(retval);
+}
+
+
+int suite_vx_tt(const char *xmldir)
+{
+  suite_t suite;
+  char logfile[256];
+  FILE *lf = NULL;
+
+  /* Setup test suite */
+  strcpy(suite.suite_name, "suite_vx_tt");
+  suite.num_tests = 2;
+  suite.tests = malloc(suite.num_tests * sizeof(test_t));
+  if (suite.tests == NULL) {
+    fprintf(stderr, "Failed to alloc test structure\n");
+    return(1);
+  }
+  test_get_time(&suite.exec_time);
+
+  /* Generate test model */
+  strcpy(test_model_dir, "/tmp/vx_tt.XXXXXX");
+  if (test_genmodel_create(test_model_dir, TEST_TT_SCALE, NULL) != 0) {
+    return(1);
+  }
+
+  /* Setup test cases */
+  strcpy(suite.tests[0].test_name, "test_tt_constant()");
+  suite.tests[0].test_func = &test_tt_constant;
+  suite.tests[0].elapsed_time = 0.0;
+
+  strcpy(suite.tests[1].test_name, "test_tt_model()");
+  suite.tests[1].test_func = &test_tt_model;
+  suite.tests[1].elapsed_time = 0.0;
+
+  if (test_run_suite(&suite) != 0) {
+    fprintf(stderr, "Failed to execute tests\n");
+    test_genmodel_remove(test_model_dir);
+    return(1);
+  }
+  test_genmodel_remove(test_model_dir);
+
+  if (xmldir != NULL) {
+    sprintf(logfile, "%s/%s.xml", xmldir, suite.suite_name);
+    lf = init_log(logfile);
+    if (lf == NULL) {
+      fprintf(stderr, "Failed to initialize logfile\n");
+      return(1);
+    }
+
+    if (write_log(lf, &suite) != 0) {
+      fprintf(stderr, "Failed to write test log\n");
+      return(1);
+    }
+
+    close_log(lf);
+  }
+
+  free(suite.tests);
+  return 0;
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_VX_TT_H
+#define TEST_VX_TT_H
+
+int suite_vx_tt(const char *xmldir);
+
+#endif
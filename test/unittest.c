@@ -6,6 +6,23 @@
 #include "test_vx_sub.h"
 #include "test_vx_exec.h"
 #include "test_vx_lite_exec.h"
+#include "test_vx_rec.h"
+#include "test_vx_fmt.h"
+#include "test_vx_serve.h"
+#include "test_vx_stats.h"
+#include "test_genmodel.h"
+#include "test_vx_large.h"
+#include "test_vx_stack.h"
+#include "test_vx_kernel.h"
+#include "test_vx_order.h"
+#include "test_vx_sched.h"
+#include "test_vx_mem.h"
+#include "test_vx_bvh.h"
+#include "test_vx_sdf.h"
+#include "test_vx_site.h"
+#include "test_vx_dmap.h"
+#include "test_vx_grad.h"
+#include "test_vx_tt.h"
 
 
 
@@ -23,6 +40,23 @@ int main (int argc, char *argv[])
   suite_vx_sub(xmldir);
   suite_vx_exec(xmldir);
   suite_vx_lite_exec(xmldir);
+  suite_vx_rec(xmldir);
+  suite_vx_fmt(xmldir);
+  suite_vx_serve(xmldir);
+  suite_vx_stats(xmldir);
+  suite_genmodel(xmldir);
+  suite_vx_large(xmldir);
+  suite_vx_stack(xmldir);
+  suite_vx_kernel(xmldir);
+  suite_vx_order(xmldir);
+  suite_vx_sched(xmldir);
+  suite_vx_mem(xmldir);
+  suite_vx_bvh(xmldir);
+  suite_vx_sdf(xmldir);
+  suite_vx_site(xmldir);
+  suite_vx_dmap(xmldir);
+  suite_vx_grad(xmldir);
+  suite_vx_tt(xmldir);
 
   return 0;
 }
@@ -0,0 +1,762 @@
+/**
+    vx_bench - Query benchmark. Runs named, reproducible workloads
+    against a model directory and reports throughput, per-query
+    latency percentiles, startup time and peak RSS as JSON.
+
+    10/2026: Initial implementation
+    10/2026: Report voxet gathers per second of each batch lookup
+    10/2026: Report batch query time, cache misses and simulated line
+             misses of each ordering
+    10/2026: Added -M to choose the memory backend, reported with the
+             startup time
+**/
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "params.h"
+#include "vx_sub.h"
+#include "vx_stack.h"
+#include "vx_io.h"
+#include "unittest_defs.h"
+
+
+/* Default points per workload */
+#define BENCH_POINTS 100000
+
+/* Points per depth profile */
+#define BENCH_PROFILE_LEN 200
+
+/* Depth step of profiles */
+#define BENCH_PROFILE_DZ 50.0
+
+/* Depth of slices */
+#define BENCH_SLICE_DEPTH 1000.0
+
+/* Depth range of GTL workload */
+#define BENCH_GTL_DEPTH 350.0
+
+/* Max depth of basin workload */
+#define BENCH_BASIN_DEPTH 5000.0
+
+/* Cache line size in bytes */
+#define BENCH_LINE 64
+
+/* Lines of the simulated cache, 2 MB */
+#define BENCH_SIM_LINES 32768
+
+
+/* Voxet footprint and vertical range in UTM */
+typedef struct bench_box_t
+{
+  double min[3];
+  double max[3];
+} bench_box_t;
+
+
+/* Workload definition */
+typedef struct bench_workload_t
+{
+  const char *name;
+  const char *desc;
+  vx_coord_t coord_type;
+  vx_zmode_t zmode;
+  int use_gtl;
+  int use_scec;
+} bench_workload_t;
+
+
+/* Available workloads */
+static bench_workload_t workloads[] = {
+  {"uniform", "uniform random points in the LR voxet",
+   VX_COORD_UTM, VX_ZMODE_ELEV, True, False},
+  {"uniform_geo", "uniform points as geographic coordinates",
+   VX_COORD_GEO, VX_ZMODE_ELEV, True, False},
+  {"basin", "HR voxet footprint, 0-5 km depth",
+   VX_COORD_UTM, VX_ZMODE_DEPTH, True, False},
+  {"gtl", "LR footprint, 0-350 m depth",
+   VX_COORD_UTM, VX_ZMODE_DEPTH, True, False},
+  {"offshore", "outside the LR footprint with SCEC background",
+   VX_COORD_UTM, VX_ZMODE_ELEVOFF, True, True},
+  {"profile", "depth profiles at random LR locations",
+   VX_COORD_UTM, VX_ZMODE_DEPTH, True, False},
+  {"slice", "regular grid over the LR footprint at 1 km depth",
+   VX_COORD_UTM, VX_ZMODE_DEPTH, True, False},
+  {"slice_geo", "slice grid as geographic coordinates",
+   VX_COORD_GEO, VX_ZMODE_DEPTH, True, False},
+};
+
+#define BENCH_NUM_WORKLOADS (int)(sizeof(workloads)/sizeof(bench_workload_t))
+
+static char *zmode_names[3] = {"elev", "dep", "off"};
+
+/* Random state */
+static unsigned long long rng_state = 1;
+
+/* Byte offset of voxel */
+size_t voxbytepos(int *, int *, int);
+
+extern char *optarg;
+extern int optind, opterr, optopt;
+
+
+/* Usage function */
+void usage() {
+  int i;
+
+  printf("     vx_bench - (c) Harvard University, SCEC\n");
+  printf("Benchmark CVM-H queries. Results are written as JSON.\n\n");
+  printf("\tusage: vx_bench [-m dir] [-n points] [-w workloads] [-S seed] [-M backend]\n");
+  printf("\t                [-O points]\n\n");
+  printf("Flags:\n");
+  printf("\t-m directory containing model files (default is '%s').\n",
+	 MODEL_DIR);
+  printf("\t-n points per workload (default is %d).\n", BENCH_POINTS);
+  printf("\t-w comma separated workloads (default is all).\n");
+  printf("\t-S random seed (default is 1).\n");
+  printf("\t-M comma separated memory backend options of the model\n");
+  printf("\t   buffers: thp or huge pages, lock, prefault, interleave\n");
+  printf("\t   (default is none).\n");
+  printf("\t-O points of the ordering batches (default is -n). The vp lines\n");
+  printf("\t   they touch are reported as working_set_kb, pick a count that\n");
+  printf("\t   takes it past llc_kb for the orderings to matter.\n\n");
+  printf("Workloads:\n");
+  for (i = 0; i < BENCH_NUM_WORKLOADS; i++) {
+    printf("\t%-12s %s\n", workloads[i].name, workloads[i].desc);
+  }
+  printf("\n");
+  exit (0);
+}
+
+
+/* Monotonic clock in nanoseconds */
+double get_ns()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((double)ts.tv_sec * 1.0e9 + (double)ts.tv_nsec);
+}
+
+
+/* Peak resident set size in KB */
+long get_peak_rss()
+{
+  struct rusage ru;
+
+  getrusage(RUSAGE_SELF, &ru);
+  return(ru.ru_maxrss);
+}
+
+
+/* Open hardware cache miss counter of this thread, or -1 if not
+   available */
+int cache_counter_open()
+{
+#ifdef __linux__
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return((int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+  return(-1);
+#endif
+}
+
+
+/* Size of the last level cache in KB, or 0 if not known */
+long get_llc_kb()
+{
+  long size = 0;
+
+#ifdef _SC_LEVEL3_CACHE_SIZE
+  size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  if (size <= 0) {
+    size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  }
+#endif
+  return((size > 0) ? size / 1024 : 0);
+}
+
+
+/* Compare 64-bit keys for qsort */
+int cmp_key(const void *a, const void *b)
+{
+  unsigned long long ka = *(const unsigned long long *)a;
+  unsigned long long kb = *(const unsigned long long *)b;
+
+  return((ka > kb) - (ka < kb));
+}
+
+
+/* Replay the vp loads of 'n' UTM points through a direct mapped cache
+   of BENCH_SIM_LINES lines, visiting the points in the order the batch
+   query uses for 'order'. Returns the simulated misses in 'misses' and
+   the distinct lines in 'lines'. Stands in for the hardware counter,
+   which is often not available in containers and virtual machines */
+int sim_line_misses(const double *pts, int n, vx_order_t order,
+		    long long *misses, long long *lines)
+{
+  const vx_stack_t *stack = vx_get_stack();
+  const vx_volume_t *v;
+  unsigned long long *keys, *cache;
+  size_t *perm;
+  int g[3], vol, i, j, m = 0;
+
+  keys = malloc((size_t)n * sizeof(unsigned long long));
+  cache = malloc(BENCH_SIM_LINES * sizeof(unsigned long long));
+  perm = malloc((size_t)n * sizeof(size_t));
+  if ((stack == NULL) || (keys == NULL) || (cache == NULL) ||
+      (perm == NULL)) {
+    free(keys);
+    free(cache);
+    free(perm);
+    return(1);
+  }
+
+  /* Same permutation as vx_getcoord_batch */
+  for (i = 0; i < n; i++) {
+    perm[i] = i;
+  }
+  if ((order != VX_ORDER_NONE) && (n >= VX_ORDER_MIN) &&
+      (vx_order_coherence(pts, 3, n) < VX_ORDER_COHERENT)) {
+    vx_order_sort(pts, 3, n, order, perm);
+  }
+
+  /* Line of each vp load, tagged with the voxet */
+  memset(cache, 0xFF, BENCH_SIM_LINES * sizeof(unsigned long long));
+  *misses = 0;
+  for (i = 0; i < n; i++) {
+    vol = vx_stack_find(stack, &pts[perm[i] * 3], g);
+    if (vol < 0) {
+      continue;
+    }
+    v = &(stack->vols[vol]);
+    keys[m] = ((unsigned long long)vol << 56) |
+      (voxbytepos(g, (int *)v->a.N, v->vp_p.ESIZE) / BENCH_LINE);
+    j = (int)((keys[m] ^ (keys[m] >> 56) * 0x9E3779B1ULL) %
+	      BENCH_SIM_LINES);
+    if (cache[j] != keys[m]) {
+      cache[j] = keys[m];
+      (*misses)++;
+    }
+    m++;
+  }
+
+  /* Working set */
+  qsort(keys, m, sizeof(unsigned long long), cmp_key);
+  for (i = 0, *lines = 0; i < m; i++) {
+    *lines += ((i == 0) || (keys[i] != keys[i - 1]));
+  }
+
+  free(keys);
+  free(cache);
+  free(perm);
+  return(0);
+}
+
+
+/* Uniform random number in [0,1), xorshift64* so sequences do not
+   depend on the C library */
+double rng_uniform()
+{
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return((double)((rng_state * 2685821657736338717ULL) >> 11) /
+	 9007199254740992.0);
+}
+
+
+/* Random value in [a,b) */
+double rng_range(double a, double b)
+{
+  return(a + (b - a) * rng_uniform());
+}
+
+
+/* Read voxet extent from parameter file */
+int read_box(const char *modeldir, const char *file, bench_box_t *box)
+{
+  char path[CMLEN];
+  float o[3], u[3], v[3], w[3];
+  int i;
+
+  snprintf(path, CMLEN, "%s/%s", modeldir, file);
+  if (vx_io_init(path) != 0) {
+    vx_io_finalize();
+    fprintf(stderr, "Failed to read %s\n", path);
+    return(1);
+  }
+  vx_io_getvec("AXIS_O", o);
+  vx_io_getvec("AXIS_U", u);
+  vx_io_getvec("AXIS_V", v);
+  vx_io_getvec("AXIS_W", w);
+  vx_io_finalize();
+
+  for (i = 0; i < 3; i++) {
+    box->min[i] = o[i];
+    box->max[i] = o[i] + u[i] + v[i] + w[i];
+  }
+  return(0);
+}
+
+
+/* Convert UTM to geographic coordinates by Newton iteration on the
+   forward projection, so both forms address the same point */
+void utm2geo(double *utm, double *geo)
+{
+  double p[2], q[2], r[2];
+  double j00, j01, j10, j11, det, dx, dy;
+  double h = 1.0e-6;
+  int i;
+
+  geo[0] = -117.0 + (utm[0] - 500000.0) / 92000.0;
+  geo[1] = utm[1] / 110900.0;
+  for (i = 0; i < 8; i++) {
+    vx_geo2utm(geo, p);
+    dx = utm[0] - p[0];
+    dy = utm[1] - p[1];
+    if ((fabs(dx) < 1.0e-6) && (fabs(dy) < 1.0e-6)) {
+      break;
+    }
+    q[0] = geo[0] + h;
+    q[1] = geo[1];
+    vx_geo2utm(q, r);
+    j00 = (r[0] - p[0]) / h;
+    j10 = (r[1] - p[1]) / h;
+    q[0] = geo[0];
+    q[1] = geo[1] + h;
+    vx_geo2utm(q, r);
+    j01 = (r[0] - p[0]) / h;
+    j11 = (r[1] - p[1]) / h;
+    det = j00 * j11 - j01 * j10;
+    geo[0] += (j11 * dx - j01 * dy) / det;
+    geo[1] += (j00 * dy - j10 * dx) / det;
+  }
+}
+
+
+/* Generate points for workload. Returns number of points */
+int make_points(bench_workload_t *wl, bench_box_t *lr, bench_box_t *hr,
+		bench_box_t *cm, double *pts, int n)
+{
+  double utm[3], col[2] = {0.0, 0.0};
+  int i, j, nx, ny;
+
+  for (i = 0; i < n; i++) {
+    if ((strcmp(wl->name, "uniform") == 0) ||
+	(strcmp(wl->name, "uniform_geo") == 0)) {
+      utm[0] = rng_range(lr->min[0], lr->max[0]);
+      utm[1] = rng_range(lr->min[1], lr->max[1]);
+      utm[2] = rng_range(lr->min[2], lr->max[2]);
+    } else if (strcmp(wl->name, "basin") == 0) {
+      utm[0] = rng_range(hr->min[0], hr->max[0]);
+      utm[1] = rng_range(hr->min[1], hr->max[1]);
+      utm[2] = rng_range(0.0, BENCH_BASIN_DEPTH);
+    } else if (strcmp(wl->name, "gtl") == 0) {
+      utm[0] = rng_range(lr->min[0], lr->max[0]);
+      utm[1] = rng_range(lr->min[1], lr->max[1]);
+      utm[2] = rng_range(0.0, BENCH_GTL_DEPTH);
+    } else if (strcmp(wl->name, "offshore") == 0) {
+      /* CM footprint widened by a quarter, outside LR */
+      do {
+	utm[0] = rng_range(cm->min[0] - 0.25 * (cm->max[0] - cm->min[0]),
+			   cm->max[0] + 0.25 * (cm->max[0] - cm->min[0]));
+	utm[1] = rng_range(cm->min[1] - 0.25 * (cm->max[1] - cm->min[1]),
+			   cm->max[1] + 0.25 * (cm->max[1] - cm->min[1]));
+      } while ((utm[0] >= lr->min[0]) && (utm[0] <= lr->max[0]) &&
+	       (utm[1] >= lr->min[1]) && (utm[1] <= lr->max[1]));
+      utm[2] = rng_range(-30000.0, 0.0);
+    } else if (strcmp(wl->name, "profile") == 0) {
+      /* Columns of consecutive depths */
+      if (i % BENCH_PROFILE_LEN == 0) {
+	col[0] = rng_range(lr->min[0], lr->max[0]);
+	col[1] = rng_range(lr->min[1], lr->max[1]);
+      }
+      utm[0] = col[0];
+      utm[1] = col[1];
+      utm[2] = (i % BENCH_PROFILE_LEN) * BENCH_PROFILE_DZ;
+    } else {
+      /* Slices, row by row */
+      nx = (int)sqrt((double)n);
+      ny = n / nx;
+      if (i >= nx * ny) {
+	return(i);
+      }
+      utm[0] = lr->min[0] + (lr->max[0] - lr->min[0]) * (i % nx) / nx;
+      utm[1] = lr->min[1] + (lr->max[1] - lr->min[1]) * (i / nx) / ny;
+      utm[2] = BENCH_SLICE_DEPTH;
+    }
+
+    if (wl->coord_type == VX_COORD_GEO) {
+      utm2geo(utm, &pts[i * 3]);
+      pts[i * 3 + 2] = utm[2];
+    } else {
+      for (j = 0; j < 3; j++) {
+	pts[i * 3 + j] = utm[j];
+      }
+    }
+  }
+  return(n);
+}
+
+
+/* Compare doubles for qsort */
+int cmp_double(const void *a, const void *b)
+{
+  double da = *(const double *)a;
+  double db = *(const double *)b;
+
+  return((da > db) - (da < db));
+}
+
+
+/* Value at percentile 'p' of sorted array */
+double percentile(double *v, int n, double p)
+{
+  int i = (int)(p * (n - 1) + 0.5);
+
+  return(v[i]);
+}
+
+
+/* Run workload and print its JSON object */
+int run_workload(bench_workload_t *wl, double *pts, double *lat, int n,
+		 int first)
+{
+  vx_entry_t entry;
+  double start, t0, t1, total, sum = 0.0;
+  int i, failed = 0;
+
+  vx_setzmode(wl->zmode);
+  vx_setgtl(wl->use_gtl);
+  if (wl->use_scec) {
+    vx_register_scec();
+  } else {
+    vx_register_bkg(NULL);
+  }
+
+  start = get_ns();
+  for (i = 0; i < n; i++) {
+    entry.coor[0] = pts[i * 3];
+    entry.coor[1] = pts[i * 3 + 1];
+    entry.coor[2] = pts[i * 3 + 2];
+    entry.coor_type = wl->coord_type;
+    t0 = get_ns();
+    if (vx_getcoord(&entry) != 0) {
+      failed++;
+    }
+    t1 = get_ns();
+    lat[i] = t1 - t0;
+    sum += lat[i];
+  }
+  total = (get_ns() - start) * 1.0e-9;
+
+  qsort(lat, n, sizeof(double), cmp_double);
+
+  printf("%s    {\"name\": \"%s\", \"coords\": \"%s\", \"zmode\": \"%s\", "
+	 "\"gtl\": %s, \"scec\": %s,\n", (first ? "" : ",\n"), wl->name,
+	 (wl->coord_type == VX_COORD_GEO ? "geo" : "utm"),
+	 zmode_names[wl->zmode], (wl->use_gtl ? "true" : "false"),
+	 (wl->use_scec ? "true" : "false"));
+  printf("     \"points\": %d, \"failed\": %d, \"seconds\": %.6f, "
+	 "\"qps\": %.1f,\n", n, failed, total,
+	 (total > 0.0) ? n / total : 0.0);
+  printf("     \"ns_mean\": %.1f, \"ns_p50\": %.1f, \"ns_p90\": %.1f, "
+	 "\"ns_p99\": %.1f, \"ns_max\": %.1f}",
+	 sum / n, percentile(lat, n, 0.5), percentile(lat, n, 0.9),
+	 percentile(lat, n, 0.99), lat[n - 1]);
+  return(0);
+}
+
+
+/* Run batch voxet lookups over UTM points with each implementation
+   supported by the CPU and print the JSON array. Each point gathers
+   vp, vs and tag */
+int run_lookups(double *pts, int n)
+{
+  const vx_stack_t *stack = vx_get_stack();
+  int *vol, *gcoor;
+  float *val;
+  double start, total;
+  int simd, i, found;
+
+  vol = malloc((size_t)n * sizeof(int));
+  gcoor = malloc((size_t)n * 3 * sizeof(int));
+  val = malloc((size_t)n * 3 * sizeof(float));
+  if ((stack == NULL) || (vol == NULL) || (gcoor == NULL) || (val == NULL)) {
+    free(vol);
+    free(gcoor);
+    free(val);
+    return(1);
+  }
+
+  for (simd = VX_SIMD_SCALAR; simd <= vx_simd_detect(); simd++) {
+    start = get_ns();
+    vx_stack_lookup_simd(stack, simd, pts, n, vol, gcoor, val, &val[n],
+			 &val[2 * n]);
+    total = (get_ns() - start) * 1.0e-9;
+    for (i = 0, found = 0; i < n; i++) {
+      found += (vol[i] >= 0);
+    }
+
+    printf("%s    {\"impl\": \"%s\", \"points\": %d, \"found\": %d, "
+	   "\"seconds\": %.6f, \"gathers_per_s\": %.1f}",
+	   (simd == VX_SIMD_SCALAR ? "" : ",\n"), VX_SIMD_NAMES[simd], n,
+	   found, total, (total > 0.0) ? 3.0 * n / total : 0.0);
+  }
+
+  free(vol);
+  free(gcoor);
+  free(val);
+  return(0);
+}
+
+
+/* Query uniform points as batches with each ordering and print the
+   JSON array. Cache misses are -1 if the counter is not available,
+   the simulated misses and working set of the vp loads are always
+   reported */
+int run_orderings(double *pts, int n)
+{
+  vx_entry_t *entries;
+  long long misses, sim_misses, lines;
+  double start, total;
+  int order, i, fd;
+
+  entries = malloc((size_t)n * sizeof(vx_entry_t));
+  if (entries == NULL) {
+    return(1);
+  }
+
+  vx_setzmode(VX_ZMODE_ELEV);
+  vx_setgtl(True);
+  vx_register_bkg(NULL);
+  fd = cache_counter_open();
+
+  for (order = VX_ORDER_NONE; order < VX_ORDER_NUM; order++) {
+    for (i = 0; i < n; i++) {
+      memcpy(entries[i].coor, &pts[i * 3], sizeof(double) * 3);
+      entries[i].coor_type = VX_COORD_UTM;
+    }
+    vx_setorder(order);
+    misses = -1;
+#ifdef __linux__
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+    start = get_ns();
+    vx_getcoord_batch(entries, n);
+    total = (get_ns() - start) * 1.0e-9;
+#ifdef __linux__
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd, &misses, sizeof(misses)) != sizeof(misses)) {
+	misses = -1;
+      }
+    }
+#endif
+    if (sim_line_misses(pts, n, order, &sim_misses, &lines) != 0) {
+      sim_misses = -1;
+      lines = -1;
+    }
+
+    printf("%s    {\"order\": \"%s\", \"points\": %d, \"seconds\": %.6f, "
+	   "\"qps\": %.1f, \"cache_misses\": %lld,\n"
+	   "     \"sim_line_misses\": %lld, \"working_set_kb\": %lld}",
+	   (order == VX_ORDER_NONE ? "" : ",\n"), VX_ORDER_NAMES[order], n,
+	   total, (total > 0.0) ? n / total : 0.0, misses, sim_misses,
+	   (lines < 0) ? -1 : lines * BENCH_LINE / 1024);
+  }
+
+  vx_setorder(VX_ORDER_NONE);
+  if (fd >= 0) {
+    close(fd);
+  }
+  free(entries);
+  return(0);
+}
+
+
+/* Check if workload is in comma separated list */
+int selected(const char *list, const char *name)
+{
+  const char *p = list;
+  size_t len = strlen(name);
+
+  if (list == NULL) {
+    return(True);
+  }
+  while ((p = strstr(p, name)) != NULL) {
+    if (((p == list) || (p[-1] == ',')) &&
+	((p[len] == ',') || (p[len] == '\0'))) {
+      return(True);
+    }
+    p += len;
+  }
+  return(False);
+}
+
+
+int main (int argc, char *argv[])
+{
+  char modeldir[CMLEN];
+  char version[CMLEN];
+  char *list = NULL;
+  bench_box_t lr, hr, cm;
+  double *pts, *lat;
+  double start, startup;
+  vx_mem_opts_t mem;
+  vx_mem_report_t report;
+  int num_points = BENCH_POINTS;
+  int order_points = 0;
+  int opt, i, n, first = True;
+
+  strcpy(modeldir, MODEL_DIR);
+  memset(&mem, 0, sizeof(vx_mem_opts_t));
+
+  /* Parse options */
+  while ((opt = getopt(argc, argv, "m:n:w:S:M:O:h")) != -1) {
+    switch (opt) {
+    case 'm':
+      strcpy(modeldir, optarg);
+      break;
+    case 'n':
+      num_points = atoi(optarg);
+      if (num_points < 1) {
+	fprintf(stderr, "Invalid point count %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'O':
+      order_points = atoi(optarg);
+      if (order_points < 1) {
+	fprintf(stderr, "Invalid point count %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'w':
+      list = optarg;
+      for (i = 0, n = 0; i < BENCH_NUM_WORKLOADS; i++) {
+	n += selected(list, workloads[i].name);
+      }
+      if (n == 0) {
+	fprintf(stderr, "No known workload in %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'M':
+      if (vx_mem_parse(optarg, &mem) != 0) {
+	fprintf(stderr, "Invalid memory backend %s\n", optarg);
+	exit(1);
+      }
+      break;
+    case 'S':
+      rng_state = strtoull(optarg, NULL, 10);
+      if (rng_state == 0) {
+	rng_state = 1;
+      }
+      break;
+    case 'h':
+      usage();
+      exit(0);
+      break;
+    default: /* '?' */
+      usage();
+      exit(1);
+    }
+  }
+
+  if ((read_box(modeldir, "CVM_LR.vo", &lr) != 0) ||
+      (read_box(modeldir, "CVM_HR.vo", &hr) != 0) ||
+      (read_box(modeldir, "CVM_CM.vo", &cm) != 0)) {
+    exit(1);
+  }
+
+  if (order_points == 0) {
+    order_points = num_points;
+  }
+  pts = malloc((size_t)((num_points > order_points) ?
+			num_points : order_points) * 3 * sizeof(double));
+  lat = malloc((size_t)num_points * sizeof(double));
+  if ((pts == NULL) || (lat == NULL)) {
+    fprintf(stderr, "Failed to allocate %d points\n", num_points);
+    exit(1);
+  }
+
+  /* Startup */
+  vx_setmem(&mem);
+  start = get_ns();
+  if (vx_setup(modeldir) != 0) {
+    fprintf(stderr, "Failed to init vx\n");
+    exit(1);
+  }
+  startup = (get_ns() - start) * 1.0e-9;
+  vx_version(version);
+
+  printf("{\n  \"model\": \"%s\",\n  \"version\": \"%s\",\n", modeldir,
+	 version);
+  printf("  \"startup_s\": %.6f,\n  \"rss_after_setup_kb\": %ld,\n",
+	 startup, get_peak_rss());
+  printf("  \"llc_kb\": %ld,\n", get_llc_kb());
+  vx_get_mem_report(&report);
+  printf("  \"memory\": {\"pages\": \"%s\", \"lock\": %s, "
+	 "\"prefault\": %s, \"numa\": \"%s\", \"numa_nodes\": %d,\n"
+	 "             \"bytes\": %llu, \"huge_bytes\": %llu, "
+	 "\"locked_bytes\": %llu, \"prefault_s\": %.6f},\n",
+	 VX_MEM_PAGES_NAMES[report.got.pages],
+	 (report.got.lock ? "true" : "false"),
+	 (report.got.prefault ? "true" : "false"),
+	 VX_MEM_NUMA_NAMES[report.got.numa], report.numa_nodes, report.bytes,
+	 report.huge_bytes, report.locked_bytes, report.prefault_ns * 1.0e-9);
+  printf("  \"workloads\": [\n");
+
+  for (i = 0; i < BENCH_NUM_WORKLOADS; i++) {
+    if (!selected(list, workloads[i].name)) {
+      continue;
+    }
+    n = make_points(&workloads[i], &lr, &hr, &cm, pts, num_points);
+    run_workload(&workloads[i], pts, lat, n, first);
+    first = False;
+  }
+
+  /* Batch lookups over uniform points */
+  n = make_points(&workloads[0], &lr, &hr, &cm, pts, num_points);
+  printf("\n  ],\n  \"lookups\": [\n");
+  run_lookups(pts, n);
+
+  /* Scattered batches in input and curve order */
+  n = make_points(&workloads[0], &lr, &hr, &cm, pts, order_points);
+  printf("\n  ],\n  \"orderings\": [\n");
+  run_orderings(pts, n);
+
+  printf("\n  ],\n  \"peak_rss_kb\": %ld\n}\n", get_peak_rss());
+
+  vx_cleanup();
+  free(pts);
+  free(lat);
+
+  return 0;
+}
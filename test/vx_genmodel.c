@@ -0,0 +1,160 @@
+/**
+    vx_genmodel - Synthetic model generator. Writes a self-consistent
+    CVM-H model directory (voxets, interfaces and Vs30 GTL) that can be
+    loaded by vx_setup, for tests and benchmarks on machines without
+    the real model files.
+
+    10/2026: Initial implementation
+**/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "genmodel.h"
+
+extern char *optarg;
+extern int optind, opterr, optopt;
+
+
+/* Usage function */
+void usage() {
+  printf("     vx_genmodel - (c) Harvard University, SCEC\n");
+  printf("Generate a synthetic CVM-H model directory.\n\n");
+  printf("\tusage: vx_genmodel [-s scale] [-l nx,ny,nz] [-r nx,ny,nz] "
+	 "[-c nx,ny,nz] [-t nx,ny] [-g nx,ny] dir\n\n");
+  printf("Flags:\n");
+  printf("\t-s scale node counts of all grids per axis (default is 1).\n");
+  printf("\t-l node counts of LR voxet (default is 101,101,101).\n");
+  printf("\t-r node counts of HR voxet (default is 101,101,76).\n");
+  printf("\t-c node counts of CM voxet (default is 31,31,46).\n");
+  printf("\t-t node counts of interfaces (default is 201,201).\n");
+  printf("\t-g node counts of Vs30 map (default is 121,161).\n\n");
+  printf("Node counts are applied after scaling, grid extents are kept.\n");
+  printf("The model covers UTM zone 11 x 300-500 km, y 3700-3900 km,\n");
+  printf("with sea floor to the west, two basins and a topo gap in the\n");
+  printf("north east corner.\n\n");
+  exit (0);
+}
+
+
+/* Set node counts of grid from "nx,ny[,nz]", keeping its extent */
+int set_nodes(genmodel_grid_t *grid, const char *arg, int dims)
+{
+  int n[3] = {1, 1, 1};
+  int i;
+
+  if (sscanf(arg, "%d,%d,%d", &n[0], &n[1], &n[2]) != dims) {
+    return(1);
+  }
+  for (i = 0; i < dims; i++) {
+    if (n[i] < 2) {
+      return(1);
+    }
+    grid->step[i] = grid->step[i] * (grid->n[i] - 1) / (n[i] - 1);
+    grid->n[i] = n[i];
+  }
+  return(0);
+}
+
+
+/* Report grid */
+void print_grid(const char *name, const genmodel_grid_t *grid)
+{
+  printf("%-10s %6d x %6d x %6d nodes, spacing %.1f %.1f %.1f m\n",
+	 name, grid->n[0], grid->n[1], grid->n[2],
+	 grid->step[0], grid->step[1], grid->step[2]);
+}
+
+
+int main(int argc, char **argv)
+{
+  genmodel_t model;
+  genmodel_grid_t *grids[5] = {&model.lr, &model.hr, &model.cm,
+			       &model.topo, &model.gtl};
+  char *nodes[5];
+  struct timespec t0, t1;
+  double scale = 1.0;
+  double elapsed;
+  char *dir;
+  int opt, i;
+
+  genmodel_defaults(&model);
+  memset(nodes, 0, sizeof(nodes));
+
+  while ((opt = getopt(argc, argv, "s:l:r:c:t:g:h")) != -1) {
+    switch (opt) {
+    case 's':
+      scale = atof(optarg);
+      break;
+    case 'l':
+      nodes[0] = optarg;
+      break;
+    case 'r':
+      nodes[1] = optarg;
+      break;
+    case 'c':
+      nodes[2] = optarg;
+      break;
+    case 't':
+      nodes[3] = optarg;
+      break;
+    case 'g':
+      nodes[4] = optarg;
+      break;
+    case 'h':
+      usage();
+      break;
+    default: /* '?' */
+      usage();
+      break;
+    }
+  }
+
+  /* Scale first so explicit node counts take precedence */
+  if (genmodel_scale(&model, scale) != 0) {
+    fprintf(stderr, "Invalid scale %f\n", scale);
+    return(1);
+  }
+  for (i = 0; i < 5; i++) {
+    if ((nodes[i] != NULL) &&
+	(set_nodes(grids[i], nodes[i], (i < 3) ? 3 : 2) != 0)) {
+      fprintf(stderr, "Invalid node counts '%s'\n", nodes[i]);
+      return(1);
+    }
+  }
+
+  if (optind != argc - 1) {
+    usage();
+  }
+  dir = argv[optind];
+
+  if ((mkdir(dir, 0755) != 0) && (errno != EEXIST)) {
+    fprintf(stderr, "Failed to create directory %s\n", dir);
+    return(1);
+  }
+
+  print_grid("CVM_LR", &model.lr);
+  print_grid("CVM_HR", &model.hr);
+  print_grid("CVM_CM", &model.cm);
+  print_grid("interfaces", &model.topo);
+  print_grid("vs30", &model.gtl);
+  printf("Writing %.1f MB to %s\n", genmodel_size(&model) / 1048576.0, dir);
+  fflush(stdout);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  if (genmodel_write(&model, dir) != 0) {
+    fprintf(stderr, "Failed to write model to %s\n", dir);
+    return(1);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1.0e-9;
+  printf("Done in %.2f s\n", elapsed);
+
+  return(0);
+}